@@ -0,0 +1,107 @@
+/**
+ * @file cbor_writer.c
+ * @brief CBOR encoding.
+ */
+
+#include "cbor_writer.h"
+#include <string.h>
+
+void cbor_writer_init(cbor_writer_t* writer, uint8_t* buf, size_t size)
+{
+    writer->buf = buf;
+    writer->size = buf != NULL ? size : 0;
+    writer->len = 0;
+    writer->overflow = false;
+}
+
+/// Reserve n bytes, or mark the overflow and return NULL
+static uint8_t* reserve(cbor_writer_t* writer, size_t n)
+{
+    if (writer->overflow || n > writer->size - writer->len) {
+        writer->overflow = true;
+        return NULL;
+    }
+    uint8_t* out = writer->buf + writer->len;
+    writer->len += n;
+    return out;
+}
+
+/// Initial byte and argument, in the shortest form: inline below 24, then 1, 2, 4 or 8 bytes
+static void put_head(cbor_writer_t* writer, cbor_major_t major, uint64_t value)
+{
+    uint8_t type = (uint8_t) (major << 5);
+    int extra;
+    uint8_t info;
+    if (value < 24) {
+        extra = 0;
+        info = (uint8_t) value;
+    } else if (value <= 0xff) {
+        extra = 1;
+        info = 24;
+    } else if (value <= 0xffff) {
+        extra = 2;
+        info = 25;
+    } else if (value <= 0xffffffffu) {
+        extra = 4;
+        info = 26;
+    } else {
+        extra = 8;
+        info = 27;
+    }
+
+    uint8_t* out = reserve(writer, 1 + (size_t) extra);
+    if (out == NULL) {
+        return;
+    }
+    out[0] = type | info;
+    for (int i = 0; i < extra; i++) {
+        out[1 + i] = (uint8_t) (value >> (8 * (extra - 1 - i)));        // Big-endian
+    }
+}
+
+void cbor_put_uint(cbor_writer_t* writer, uint64_t value)
+{
+    put_head(writer, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t* writer, int64_t value)
+{
+    if (value >= 0) {
+        put_head(writer, CBOR_MAJOR_UINT, (uint64_t) value);
+    } else {
+        put_head(writer, CBOR_MAJOR_NEGINT, (uint64_t) (-1 - value));    // -1 - n, which cannot overflow
+    }
+}
+
+void cbor_put_bool(cbor_writer_t* writer, bool value)
+{
+    uint8_t* out = reserve(writer, 1);
+    if (out != NULL) {
+        *out = value ? CBOR_TRUE : CBOR_FALSE;
+    }
+}
+
+void cbor_put_text(cbor_writer_t* writer, const char* text)
+{
+    size_t n = strlen(text);
+    put_head(writer, CBOR_MAJOR_TEXT, n);
+    uint8_t* out = reserve(writer, n);
+    if (out != NULL) {
+        memcpy(out, text, n);
+    }
+}
+
+void cbor_put_array(cbor_writer_t* writer, size_t count)
+{
+    put_head(writer, CBOR_MAJOR_ARRAY, count);
+}
+
+void cbor_put_map(cbor_writer_t* writer, size_t count)
+{
+    put_head(writer, CBOR_MAJOR_MAP, count);
+}
+
+int cbor_writer_finish(const cbor_writer_t* writer)
+{
+    return writer->overflow ? -1 : (int) writer->len;
+}
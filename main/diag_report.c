@@ -0,0 +1,166 @@
+/**
+ * @file diag_report.c
+ * @brief Diagnostics report implementation.
+ */
+
+#include "diag_report.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TASKS_TAIL_MAX  sizeof("],\"last\":false}")
+
+/// Whether the payload is exactly the given word
+static bool is_word(const char* data, int len, const char* word)
+{
+    return (size_t) len == strlen(word) && memcmp(data, word, (size_t) len) == 0;
+}
+
+int diag_parse_command(const char* data, int len)
+{
+    if (data == NULL || len <= 0) {
+        return 0;
+    }
+    if (is_word(data, len, "tasks")) {
+        return DIAG_SECTION_TASKS;
+    }
+    if (is_word(data, len, "heap")) {
+        return DIAG_SECTION_HEAP;
+    }
+    if (is_word(data, len, "queues")) {
+        return DIAG_SECTION_QUEUES;
+    }
+    if (is_word(data, len, "all")) {
+        return DIAG_SECTION_ALL;
+    }
+    return 0;
+}
+
+/// Run time counter of the task with this number in the sample, 0 if it was not there
+static uint32_t runtime_in(const diag_tasks_t* sample, uint32_t number)
+{
+    for (int i = 0; sample != NULL && i < sample->count; i++) {
+        if (sample->tasks[i].number == number) {
+            return sample->tasks[i].runtime;
+        }
+    }
+    return 0;
+}
+
+void diag_cpu_shares(const diag_tasks_t* previous, diag_tasks_t* current)
+{
+    uint32_t total = current->total_runtime - (previous != NULL ? previous->total_runtime : 0);
+    for (int i = 0; i < current->count; i++) {
+        diag_task_t* task = &current->tasks[i];
+        uint32_t ran = task->runtime - runtime_in(previous, task->number);
+        uint64_t permille = total > 0 ? ((uint64_t) ran * 1000 + total / 2) / total : 0;
+        task->cpu_permille = (uint16_t) (permille < 1000 ? permille : 1000);
+    }
+
+    // Insertion sort: a handful of tasks, and equal shares keep their order
+    for (int i = 1; i < current->count; i++) {
+        diag_task_t task = current->tasks[i];
+        int j = i;
+        while (j > 0 && current->tasks[j - 1].cpu_permille < task.cpu_permille) {
+            current->tasks[j] = current->tasks[j - 1];
+            j--;
+        }
+        current->tasks[j] = task;
+    }
+}
+
+/// One task as a JSON object. Names come from the SDK and the firmware; anything that would need
+/// escaping is replaced.
+static int task_to_json(const diag_task_t* task, char* buf, size_t size)
+{
+    char name[DIAG_TASK_NAME_MAX + 1];
+    size_t n = 0;
+    for (; n < DIAG_TASK_NAME_MAX && task->name[n] != '\0'; n++) {
+        char ch = task->name[n];
+        name[n] = ch == '"' || ch == '\\' || (unsigned char) ch < 0x20 ? '?' : ch;
+    }
+    name[n] = '\0';
+    int written = snprintf(buf, size,
+                           "{\"name\":\"%s\",\"num\":%u,\"state\":\"%c\",\"prio\":%u,\"cpu_pm\":%u,"
+                           "\"stack_free\":%u}",
+                           name, (unsigned) task->number, task->state != '\0' ? task->state : '?',
+                           (unsigned) task->priority, (unsigned) task->cpu_permille, (unsigned) task->stack_free);
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    return written;
+}
+
+int diag_tasks_to_json(const diag_tasks_t* current, uint32_t window_ms, uint32_t report, int start,
+                       char* buf, size_t size, int* next)
+{
+    if (buf == NULL || size == 0 || start < 0) {
+        return -1;
+    }
+    int used = snprintf(buf, size, "{\"report\":%u,\"section\":\"tasks\",\"window_ms\":%u,\"first\":%d,\"tasks\":[",
+                        (unsigned) report, (unsigned) window_ms, start);
+    if (used < 0 || (size_t) used + TASKS_TAIL_MAX > size) {
+        return -1;
+    }
+
+    // Each task is kept only if the closing tail still fits after it
+    int i = start;
+    for (; i < current->count; i++) {
+        size_t sep = i > start ? 1 : 0;
+        size_t room = size - (size_t) used - TASKS_TAIL_MAX;
+        if (room <= sep) {
+            break;
+        }
+        int written = task_to_json(&current->tasks[i], buf + used + sep, room - sep + 1);
+        if (written < 0) {
+            break;
+        }
+        if (sep) {
+            buf[used] = ',';
+        }
+        used += (int) sep + written;
+    }
+    if (i == start && start < current->count) {
+        return -1;
+    }
+
+    int tail = snprintf(buf + used, size - (size_t) used, "],\"last\":%s}", i >= current->count ? "true" : "false");
+    if (tail < 0 || (size_t) tail >= size - (size_t) used) {
+        return -1;
+    }
+    if (next != NULL) {
+        *next = i;
+    }
+    return used + tail;
+}
+
+int diag_heap_to_json(const diag_heap_t* heap, uint32_t report, char* buf, size_t size)
+{
+    int written = snprintf(buf, size, "{\"report\":%u,\"section\":\"heap\",\"free\":%u,\"min_free\":%u}",
+                           (unsigned) report, (unsigned) heap->free, (unsigned) heap->min_free);
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    return written;
+}
+
+int diag_queues_to_json(const diag_queue_t* queues, int count, uint32_t report, char* buf, size_t size)
+{
+    int used = snprintf(buf, size, "{\"report\":%u,\"section\":\"queues\",\"queues\":[", (unsigned) report);
+    if (used < 0 || (size_t) used >= size) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        int written = snprintf(buf + used, size - (size_t) used, "%s{\"name\":\"%s\",\"waiting\":%u,\"size\":%u}",
+                               i > 0 ? "," : "", queues[i].name, (unsigned) queues[i].waiting,
+                               (unsigned) queues[i].size);
+        if (written < 0 || (size_t) written >= size - (size_t) used) {
+            return -1;
+        }
+        used += written;
+    }
+    int tail = snprintf(buf + used, size - (size_t) used, "]}");
+    if (tail < 0 || (size_t) tail >= size - (size_t) used) {
+        return -1;
+    }
+    return used + tail;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file distance_hal_hcsr04.c
+ * @brief HC-SR04 ultrasonic implementation of the distance HAL
+ *
+ * A 10 us pulse on the trigger pin starts a ping. The echo pin then goes high
+ * for the round trip time of the sound, up to about 38 ms when nothing answers.
+ * Both echo edges are timestamped in the GPIO interrupt, so the sampling task
+ * never waits for the sound.
+ */
+
+#include "distance_hal_interface.h"
+#include "gpio_hal_interface.h"
+#include "rom/ets_sys.h"
+
+#define TRIGGER_PULSE_US    10
+#define SOUND_MM_PER_MS     343     // At 20 C; the round trip is halved below
+
+static int trigger_gpio = -1;
+static int echo_gpio = -1;
+static bool started = false;
+static volatile int64_t echo_rise_us = 0;
+static volatile int32_t echo_width_us = -1;    // -1 until the falling edge of this ping
+
+static void echo_isr_handler(void* arg)
+{
+    int64_t now_us = gpio_hal_get_time_us();
+    if (gpio_hal_get_level(echo_gpio)) {
+        echo_rise_us = now_us;
+    } else if (echo_rise_us > 0 && echo_width_us < 0) {
+        echo_width_us = (int32_t) (now_us - echo_rise_us);
+    }
+}
+
+esp_err_t distance_hal_init(const distance_hal_config_t* config)
+{
+    trigger_gpio = config->trigger_gpio;
+    echo_gpio = config->echo_gpio;
+
+    esp_err_t err = gpio_hal_config_output(1u << trigger_gpio);
+    if (err == ESP_OK) {
+        err = gpio_hal_set_level(trigger_gpio, 0);
+    }
+    if (err == ESP_OK) {
+        err = gpio_hal_config_input(1u << echo_gpio, GPIO_HAL_EDGE_ANY, false);
+    }
+    if (err == ESP_OK) {
+        err = gpio_hal_isr_handler_add(echo_gpio, echo_isr_handler, NULL);
+    }
+    return err;
+}
+
+esp_err_t distance_hal_start(void)
+{
+    if (trigger_gpio < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    echo_rise_us = 0;
+    echo_width_us = -1;
+    started = true;
+
+    gpio_hal_set_level(trigger_gpio, 1);
+    ets_delay_us(TRIGGER_PULSE_US);
+    return gpio_hal_set_level(trigger_gpio, 0);
+}
+
+esp_err_t distance_hal_read_mm(int* mm)
+{
+    if (!started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int32_t width_us = echo_width_us;
+    if (width_us < 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *mm = (int) ((int64_t) width_us * SOUND_MM_PER_MS / 2000);
+    return ESP_OK;
+}
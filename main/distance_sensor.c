@@ -0,0 +1,163 @@
+/**
+ * @file distance_sensor.c
+ * @brief Distance sensor filtering and classification.
+ */
+
+#include "distance_sensor.h"
+#include <string.h>
+
+#define Q4_SHIFT 4      // EWMA fraction bits, so small steps are not rounded away
+
+void distance_sensor_init(distance_sensor_t* sensor, const distance_sensor_config_t* config)
+{
+    memset(sensor, 0, sizeof(*sensor));
+    sensor->config = *config;
+    if (sensor->config.ewma_shift <= 0) {
+        sensor->config.ewma_shift = DISTANCE_SENSOR_EWMA_SHIFT;
+    }
+    distance_sensor_restart(sensor);
+}
+
+void distance_sensor_restart(distance_sensor_t* sensor)
+{
+    sensor->window_next = 0;
+    sensor->window_count = 0;
+    sensor->filtered_valid = false;
+    sensor->zone = DISTANCE_ZONE_UNKNOWN;
+    sensor->candidate = DISTANCE_ZONE_UNKNOWN;
+    sensor->candidate_samples = 0;
+}
+
+/// Median of the full ring; insertion sort on a copy is cheapest at this size
+static int window_median(const distance_sensor_t* sensor)
+{
+    int sorted[DISTANCE_SENSOR_MEDIAN_WINDOW];
+    for (int i = 0; i < DISTANCE_SENSOR_MEDIAN_WINDOW; i++) {
+        int value = sensor->window[i];
+        int j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    return sorted[DISTANCE_SENSOR_MEDIAN_WINDOW / 2];
+}
+
+/// Zone of a filtered distance, with the current zone widened by the hysteresis
+static distance_zone_t zone_of(const distance_sensor_config_t* config, int mm, distance_zone_t current)
+{
+    int door_max = config->door_max_mm;
+    int car_max = config->car_max_mm;
+    bool has_car = car_max > door_max;
+
+    if (current == DISTANCE_ZONE_DOOR) {
+        door_max += config->hysteresis_mm;
+    } else if (current == DISTANCE_ZONE_CAR) {
+        door_max -= config->hysteresis_mm;
+        car_max += config->hysteresis_mm;
+    } else if (current == DISTANCE_ZONE_FLOOR && has_car) {
+        car_max -= config->hysteresis_mm;
+    } else if (current == DISTANCE_ZONE_FLOOR) {
+        door_max -= config->hysteresis_mm;
+    }
+
+    if (mm <= door_max) {
+        return DISTANCE_ZONE_DOOR;
+    }
+    if (has_car && mm <= car_max) {
+        return DISTANCE_ZONE_CAR;
+    }
+    return DISTANCE_ZONE_FLOOR;
+}
+
+distance_sensor_change_t distance_sensor_add_sample(distance_sensor_t* sensor, int mm)
+{
+    distance_sensor_change_t change = { false, false };
+
+    sensor->samples++;
+    if (mm <= 0 || (sensor->config.max_range_mm > 0 && mm > sensor->config.max_range_mm)) {
+        sensor->dropped++;
+        return change;
+    }
+
+    sensor->window[sensor->window_next] = mm;
+    sensor->window_next = (sensor->window_next + 1) % DISTANCE_SENSOR_MEDIAN_WINDOW;
+    if (sensor->window_count < DISTANCE_SENSOR_MEDIAN_WINDOW) {
+        sensor->window_count++;
+        if (sensor->window_count < DISTANCE_SENSOR_MEDIAN_WINDOW) {
+            return change;
+        }
+    }
+
+    int32_t median_q4 = (int32_t) window_median(sensor) << Q4_SHIFT;
+    int32_t step_q4 = median_q4 - sensor->filtered_q4;
+    if (sensor->filtered_valid && step_q4 <= (DISTANCE_SENSOR_STEP_MM << Q4_SHIFT) &&
+        step_q4 >= -(DISTANCE_SENSOR_STEP_MM << Q4_SHIFT)) {
+        sensor->filtered_q4 += step_q4 / (1 << sensor->config.ewma_shift);
+    } else {
+        sensor->filtered_q4 = median_q4;
+        sensor->filtered_valid = true;
+    }
+
+    distance_zone_t zone = zone_of(&sensor->config, distance_sensor_get_mm(sensor), sensor->zone);
+    if (zone == sensor->zone) {
+        sensor->candidate = zone;
+        sensor->candidate_samples = 0;
+        return change;
+    }
+    if (zone != sensor->candidate) {
+        sensor->candidate = zone;
+        sensor->candidate_samples = 0;
+    }
+    if (++sensor->candidate_samples < DISTANCE_SENSOR_CONFIRM_SAMPLES && sensor->zone != DISTANCE_ZONE_UNKNOWN) {
+        return change;
+    }
+
+    // After a restart the first zone is reported at once: the window already filtered it
+    bool was_open = sensor->zone == DISTANCE_ZONE_DOOR;
+    change.door_changed = sensor->zone == DISTANCE_ZONE_UNKNOWN || was_open != (zone == DISTANCE_ZONE_DOOR);
+    sensor->zone = zone;
+    sensor->candidate_samples = 0;
+
+    if (zone != DISTANCE_ZONE_DOOR) {
+        distance_occupancy_t occupancy = zone == DISTANCE_ZONE_CAR ? DISTANCE_OCCUPANCY_PRESENT
+                                                                   : DISTANCE_OCCUPANCY_ABSENT;
+        change.occupancy_changed = occupancy != sensor->occupancy;
+        sensor->occupancy = occupancy;
+    }
+    return change;
+}
+
+int distance_sensor_get_mm(const distance_sensor_t* sensor)
+{
+    if (!sensor->filtered_valid) {
+        return DISTANCE_SENSOR_UNKNOWN;
+    }
+    return (int) ((sensor->filtered_q4 + (1 << (Q4_SHIFT - 1))) >> Q4_SHIFT);
+}
+
+bool distance_sensor_door_open(const distance_sensor_t* sensor)
+{
+    return sensor->zone == DISTANCE_ZONE_DOOR;
+}
+
+distance_occupancy_t distance_sensor_get_occupancy(const distance_sensor_t* sensor)
+{
+    return sensor->occupancy;
+}
+
+bool distance_sensor_sampling_needed(garage_state_t state, int64_t ms_in_state)
+{
+    return state != GARAGE_STATE_CLOSED || ms_in_state < DISTANCE_SENSOR_SETTLE_MS;
+}
+
+const char* distance_occupancy_to_string(distance_occupancy_t occupancy)
+{
+    switch (occupancy) {
+        case DISTANCE_OCCUPANCY_PRESENT: return "present";
+        case DISTANCE_OCCUPANCY_ABSENT:  return "absent";
+        case DISTANCE_OCCUPANCY_UNKNOWN:
+        default:                         return "unknown";
+    }
+}
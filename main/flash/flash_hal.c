@@ -0,0 +1,48 @@
+/**
+ * @file flash_hal.c
+ * @brief Real ESP8266 flash HAL implementation - passes through to the partition API
+ *
+ * This is the production implementation that calls the actual ESP8266 SDK functions.
+ * For host testing, use test/sim/flash_hal_sim.c instead.
+ */
+
+#include "flash_hal_interface.h"
+#include "esp_partition.h"
+
+static const esp_partition_t* s_partition = NULL;
+
+esp_err_t flash_hal_open(const char* label, uint32_t* size)
+{
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (s_partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (size != NULL) {
+        *size = s_partition->size;
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_hal_read(uint32_t offset, void* buf, size_t len)
+{
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_partition_read(s_partition, offset, buf, len);
+}
+
+esp_err_t flash_hal_write(uint32_t offset, const void* buf, size_t len)
+{
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_partition_write(s_partition, offset, buf, len);
+}
+
+esp_err_t flash_hal_erase_sector(uint32_t offset)
+{
+    if (s_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_partition_erase_range(s_partition, offset, FLASH_HAL_SECTOR_SIZE);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file garage_command.c
+ * @brief MQTT ingress classification implementation.
+ */
+
+#include "garage_command.h"
+#include <stddef.h>
+#include <string.h>
+
+/// Exact match of a length-delimited buffer against a NUL-terminated string
+static bool buffer_equals(const char* buf, int len, const char* str)
+{
+    if (buf == NULL || str == NULL || len < 0) {
+        return false;
+    }
+    size_t str_len = strlen(str);
+    return (size_t) len == str_len && memcmp(buf, str, str_len) == 0;
+}
+
+/// Buffer is a NUL-terminated word, a space and at least one more byte
+static bool starts_with_word(const char* buf, int len, const char* word)
+{
+    if (buf == NULL || len < 0) {
+        return false;
+    }
+    size_t word_len = strlen(word);
+    return (size_t) len > word_len + 1 && memcmp(buf, word, word_len) == 0 && buf[word_len] == ' ';
+}
+
+garage_message_t garage_command_classify(const garage_command_topics_t* topics,
+                                         const char* topic, int topic_len,
+                                         const char* data, int data_len)
+{
+    garage_message_t message = { .kind = GARAGE_MESSAGE_UNKNOWN_TOPIC, .input = GARAGE_INPUT_NONE,
+                                 .rule_id = NULL, .rule_id_len = 0 };
+
+    if (topics == NULL) {
+        return message;
+    }
+
+    if (buffer_equals(topic, topic_len, topics->command_topic)) {
+        message.kind = GARAGE_MESSAGE_COMMAND;
+        if (buffer_equals(data, data_len, GARAGE_COMMAND_OPEN)) {
+            message.input = GARAGE_INPUT_COMMAND_OPEN;
+        } else if (buffer_equals(data, data_len, GARAGE_COMMAND_CLOSE)) {
+            message.input = GARAGE_INPUT_COMMAND_CLOSE;
+        } else if (buffer_equals(data, data_len, GARAGE_COMMAND_STOP)) {
+            message.input = GARAGE_INPUT_COMMAND_STOP;
+        } else if (starts_with_word(data, data_len, GARAGE_COMMAND_OPEN) ||
+                   starts_with_word(data, data_len, GARAGE_COMMAND_CLOSE) ||
+                   starts_with_word(data, data_len, GARAGE_COMMAND_STOP)) {
+            message.kind = GARAGE_MESSAGE_SIGNED_COMMAND;   // Not trusted until verified
+        } else {
+            message.kind = GARAGE_MESSAGE_INVALID_COMMAND;
+        }
+    } else if (buffer_equals(topic, topic_len, topics->status_topic)) {
+        message.kind = GARAGE_MESSAGE_STATUS;
+    } else if (buffer_equals(topic, topic_len, topics->history_topic)) {
+        message.kind = GARAGE_MESSAGE_HISTORY_QUERY;
+    } else if (buffer_equals(topic, topic_len, topics->debug_topic)) {
+        message.kind = GARAGE_MESSAGE_DEBUG_COMMAND;
+    } else if (topics->schedule_prefix != NULL && topic != NULL && topic_len > 0) {
+        // One level below the prefix; the id itself is validated by the scheduler
+        size_t prefix_len = strlen(topics->schedule_prefix);
+        if ((size_t) topic_len > prefix_len && memcmp(topic, topics->schedule_prefix, prefix_len) == 0 &&
+            memchr(topic + prefix_len, '/', (size_t) topic_len - prefix_len) == NULL) {
+            message.kind = GARAGE_MESSAGE_SCHEDULE_RULE;
+            message.rule_id = topic + prefix_len;
+            message.rule_id_len = topic_len - (int) prefix_len;
+        }
+    }
+
+    return message;
+}
+
+bool garage_command_is_unsigned_control(garage_message_kind_t kind)
+{
+    return kind == GARAGE_MESSAGE_COMMAND || kind == GARAGE_MESSAGE_SCHEDULE_RULE;
+}
+
+int garage_command_log_len(const char* data, int len)
+{
+    if (data == NULL || len < 0) {
+        return 0;
+    }
+    return len > GARAGE_COMMAND_LOG_MAX ? GARAGE_COMMAND_LOG_MAX : len;
+}
@@ -0,0 +1,274 @@
+/**
+ * @file garage_controller.c
+ * @brief Garage door controller implementation - hardware access only through the GPIO HAL.
+ */
+
+#include "garage_controller.h"
+#include "gpio_hal_interface.h"
+#include <stddef.h>
+
+void garage_controller_init(garage_controller_t* ctrl, const garage_controller_config_t* config,
+                            garage_state_t initial_state)
+{
+    if (ctrl == NULL || config == NULL) {
+        return;
+    }
+
+    garage_sm_init_with_config(&ctrl->sm, initial_state, &config->sm_config);
+    ctrl->reed_switch_gpio = config->reed_switch_gpio;
+    ctrl->relay_gpio = config->relay_gpio;
+    ctrl->relay_pulse_ms = config->relay_pulse_ms > 0 ? config->relay_pulse_ms : GARAGE_RELAY_PULSE_MS;
+    ctrl->relay_active = false;
+    ctrl->relay_remaining_ms = 0;
+    ctrl->relay_presses_queued = 0;
+    ctrl->relay_press_count = 0;
+    ctrl->last_transition_us = gpio_hal_get_time_us();
+    ctrl->transition_count = 0;
+    ctrl->last_tick_us = ctrl->last_transition_us;
+    ctrl->position_step_pct = config->position_step_pct > 0 ? config->position_step_pct : GARAGE_POSITION_STEP_PCT;
+    ctrl->published_position = GARAGE_POSITION_UNKNOWN;
+
+    gpio_hal_set_level(ctrl->relay_gpio, 0);
+}
+
+garage_event_t garage_input_to_event(garage_input_t input, int sensor_level)
+{
+    switch (input) {
+        case GARAGE_INPUT_REED_SWITCH:
+            return sensor_level == 0 ? GARAGE_EVENT_SENSOR_CLOSED : GARAGE_EVENT_SENSOR_OPEN;
+        case GARAGE_INPUT_SENSOR_CLOSED:
+            return GARAGE_EVENT_SENSOR_CLOSED;
+        case GARAGE_INPUT_SENSOR_OPEN:
+            return GARAGE_EVENT_SENSOR_OPEN;
+        case GARAGE_INPUT_COMMAND_OPEN:
+            return GARAGE_EVENT_COMMAND_OPEN;
+        case GARAGE_INPUT_COMMAND_CLOSE:
+            return GARAGE_EVENT_COMMAND_CLOSE;
+        case GARAGE_INPUT_COMMAND_STOP:
+            return GARAGE_EVENT_COMMAND_STOP;
+        case GARAGE_INPUT_DISTANCE_OPEN:
+            return GARAGE_EVENT_DISTANCE_OPEN;
+        case GARAGE_INPUT_DISTANCE_CLEAR:
+            return GARAGE_EVENT_DISTANCE_CLEAR;
+        case GARAGE_INPUT_NONE:
+        default:
+            return GARAGE_EVENT_NONE;
+    }
+}
+
+const char* garage_input_to_string(garage_input_t input)
+{
+    switch (input) {
+        case GARAGE_INPUT_REED_SWITCH:   return "reed_switch";
+        case GARAGE_INPUT_SENSOR_CLOSED: return "sensor_closed";
+        case GARAGE_INPUT_SENSOR_OPEN:   return "sensor_open";
+        case GARAGE_INPUT_COMMAND_OPEN:  return "OPEN";
+        case GARAGE_INPUT_COMMAND_CLOSE: return "CLOSE";
+        case GARAGE_INPUT_COMMAND_STOP:  return "STOP";
+        case GARAGE_INPUT_DISTANCE_OPEN: return "distance_open";
+        case GARAGE_INPUT_DISTANCE_CLEAR: return "distance_clear";
+        case GARAGE_INPUT_MQTT_CONNECTED: return "mqtt_connected";
+        case GARAGE_INPUT_NONE:
+        default:                         return "none";
+    }
+}
+
+/**
+ * @brief Start a relay pulse
+ */
+static void start_relay_pulse(garage_controller_t* ctrl)
+{
+    ctrl->relay_active = true;
+    ctrl->relay_remaining_ms = ctrl->relay_pulse_ms;
+    ctrl->relay_press_count++;
+    gpio_hal_set_level(ctrl->relay_gpio, 1);
+}
+
+static void record_transition(garage_controller_t* ctrl)
+{
+    ctrl->last_transition_us = gpio_hal_get_time_us();
+    ctrl->transition_count++;
+}
+
+static garage_transition_result_t no_change_result(garage_state_t state)
+{
+    garage_transition_result_t result = {
+        .new_state = state,
+        .state_changed = false,
+        .actions = { .publish_state = false, .trigger_button_press = false, .start_timeout_timer = false }
+    };
+    return result;
+}
+
+garage_transition_result_t garage_controller_handle_input(garage_controller_t* ctrl, garage_input_t input)
+{
+    if (ctrl == NULL) {
+        return no_change_result(GARAGE_STATE_UNKNOWN);
+    }
+
+    if (input == GARAGE_INPUT_MQTT_CONNECTED) {
+        ctrl->published_position = GARAGE_POSITION_UNKNOWN;
+    }
+
+    int sensor_level = 0;
+    if (input == GARAGE_INPUT_REED_SWITCH) {
+        sensor_level = gpio_hal_get_level(ctrl->reed_switch_gpio);
+    }
+
+    garage_event_t event = garage_input_to_event(input, sensor_level);
+    if (event == GARAGE_EVENT_NONE) {
+        return no_change_result(ctrl->sm.current_state);
+    }
+    if (garage_controller_is_pressing(ctrl) && (event == GARAGE_EVENT_COMMAND_OPEN ||
+                                                event == GARAGE_EVENT_COMMAND_CLOSE ||
+                                                event == GARAGE_EVENT_COMMAND_STOP)) {
+        // The opener would see these presses merged with the ones in progress
+        return no_change_result(ctrl->sm.current_state);
+    }
+
+    garage_transition_result_t result = garage_sm_process_event(&ctrl->sm, event);
+    if (result.state_changed) {
+        record_transition(ctrl);
+    }
+    if (result.actions.trigger_button_press) {
+        start_relay_pulse(ctrl);
+        ctrl->relay_presses_queued = result.actions.button_presses > 1 ? result.actions.button_presses - 1 : 0;
+    }
+    return result;
+}
+
+garage_transition_result_t garage_controller_tick(garage_controller_t* ctrl, int delta_ms)
+{
+    if (ctrl == NULL) {
+        return no_change_result(GARAGE_STATE_UNKNOWN);
+    }
+
+    if (ctrl->relay_active || ctrl->relay_presses_queued > 0) {
+        ctrl->relay_remaining_ms -= delta_ms;
+        if (ctrl->relay_remaining_ms <= 0) {
+            if (ctrl->relay_active) {
+                // Release; a queued press follows after a gap as long as the pulse
+                ctrl->relay_active = false;
+                ctrl->relay_remaining_ms = ctrl->relay_presses_queued > 0 ? ctrl->relay_pulse_ms : 0;
+                gpio_hal_set_level(ctrl->relay_gpio, 0);
+            } else {
+                ctrl->relay_presses_queued--;
+                start_relay_pulse(ctrl);
+            }
+        }
+    }
+
+    garage_transition_result_t result = garage_sm_update_timer(&ctrl->sm, delta_ms);
+    if (result.state_changed) {
+        record_transition(ctrl);
+    }
+    if (!ctrl->relay_active && ctrl->relay_presses_queued == 0) {
+        // Sequence sent: the door moves as commanded from here
+        garage_sm_start_motion(&ctrl->sm);
+    }
+    return result;
+}
+
+garage_transition_result_t garage_controller_tick_to(garage_controller_t* ctrl, int64_t now_us)
+{
+    if (ctrl == NULL) {
+        return no_change_result(GARAGE_STATE_UNKNOWN);
+    }
+
+    int64_t elapsed_ms = (now_us - ctrl->last_tick_us) / 1000;
+    if (elapsed_ms < GARAGE_TICK_PERIOD_MS) {
+        return no_change_result(ctrl->sm.current_state);
+    }
+    if (elapsed_ms > INT32_MAX) {
+        elapsed_ms = INT32_MAX;
+    }
+
+    ctrl->last_tick_us += elapsed_ms * 1000;
+    return garage_controller_tick(ctrl, (int) elapsed_ms);
+}
+
+int garage_controller_ms_until_tick(const garage_controller_t* ctrl, int64_t now_us)
+{
+    if (ctrl == NULL) {
+        return GARAGE_TICK_PERIOD_MS;
+    }
+
+    int64_t remaining_us = ctrl->last_tick_us + (int64_t) GARAGE_TICK_PERIOD_MS * 1000 - now_us;
+    if (remaining_us <= 0) {
+        return 0;
+    }
+    return (int) ((remaining_us + 999) / 1000);
+}
+
+bool garage_controller_poll_position(garage_controller_t* ctrl, int* position)
+{
+    if (ctrl == NULL || position == NULL) {
+        return false;
+    }
+
+    int current = garage_sm_get_position(&ctrl->sm);
+    if (current == GARAGE_POSITION_UNKNOWN || current == ctrl->published_position) {
+        return false;
+    }
+
+    int moved = current - ctrl->published_position;
+    if (moved < 0) {
+        moved = -moved;
+    }
+    if (ctrl->published_position != GARAGE_POSITION_UNKNOWN && moved < ctrl->position_step_pct &&
+        current != GARAGE_POSITION_CLOSED && current != GARAGE_POSITION_OPEN) {
+        return false;
+    }
+
+    *position = current;
+    return true;
+}
+
+void garage_controller_position_published(garage_controller_t* ctrl, int position)
+{
+    if (ctrl != NULL) {
+        ctrl->published_position = position;
+    }
+}
+
+void garage_controller_get_snapshot(const garage_controller_t* ctrl, garage_controller_snapshot_t* snapshot)
+{
+    if (ctrl == NULL || snapshot == NULL) {
+        return;
+    }
+    snapshot->state = ctrl->sm.current_state;
+    snapshot->position = garage_sm_get_position(&ctrl->sm);
+    snapshot->obstructed = ctrl->sm.obstructed;
+    snapshot->last_transition_us = ctrl->last_transition_us;
+    snapshot->transition_count = ctrl->transition_count;
+    snapshot->relay_press_count = ctrl->relay_press_count;
+    snapshot->obstruction_count = ctrl->sm.obstruction_count;
+}
+
+garage_state_t garage_controller_get_state(const garage_controller_t* ctrl)
+{
+    if (ctrl == NULL) {
+        return GARAGE_STATE_UNKNOWN;
+    }
+    return garage_sm_get_state(&ctrl->sm);
+}
+
+int64_t garage_controller_get_last_transition_us(const garage_controller_t* ctrl)
+{
+    return (ctrl != NULL) ? ctrl->last_transition_us : 0;
+}
+
+uint32_t garage_controller_get_transition_count(const garage_controller_t* ctrl)
+{
+    return (ctrl != NULL) ? ctrl->transition_count : 0;
+}
+
+bool garage_controller_is_relay_active(const garage_controller_t* ctrl)
+{
+    return (ctrl != NULL) ? ctrl->relay_active : false;
+}
+
+bool garage_controller_is_pressing(const garage_controller_t* ctrl)
+{
+    return (ctrl != NULL) ? (ctrl->relay_active || ctrl->relay_presses_queued > 0) : false;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file garage_scenario.c
+ * @brief Scenario runner - pure logic, time and injection come from platform hooks.
+ */
+
+#include "garage_scenario.h"
+#include <stddef.h>
+#include <string.h>
+
+int garage_scenario_run(const garage_scenario_t* scenario, const garage_scenario_ops_t* ops,
+                        garage_scenario_report_t* report)
+{
+    if (scenario == NULL || ops == NULL || report == NULL) {
+        return 0;
+    }
+
+    memset(report, 0, sizeof(*report));
+    report->max_latency_us = -1;
+
+    int step_count = scenario->step_count;
+    if (step_count > GARAGE_SCENARIO_MAX_STEPS) {
+        step_count = GARAGE_SCENARIO_MAX_STEPS;
+    }
+
+    for (int i = 0; i < step_count; i++) {
+        const garage_scenario_step_t* step = &scenario->steps[i];
+        garage_scenario_step_report_t* step_report = &report->steps[i];
+
+        int64_t start_us = ops->now_us(ops->ctx);
+        uint32_t transitions_before = ops->transition_count(ops->ctx);
+        if (step->input != GARAGE_INPUT_NONE) {
+            ops->inject(step->input, ops->ctx);
+        }
+        if (step->delay_ms > 0) {
+            ops->wait_ms(step->delay_ms, ops->ctx);
+        }
+
+        step_report->actual_state = ops->get_state(ops->ctx);
+        step_report->passed = (step_report->actual_state == step->expected_state);
+
+        if (ops->transition_count(ops->ctx) != transitions_before) {
+            step_report->latency_us = ops->last_transition_us(ops->ctx) - start_us;
+        } else {
+            step_report->latency_us = -1;
+        }
+        if (step_report->latency_us > report->max_latency_us) {
+            report->max_latency_us = step_report->latency_us;
+        }
+
+        report->steps_run++;
+        if (!step_report->passed) {
+            report->steps_failed++;
+        }
+    }
+
+    return report->steps_failed;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file garage_scenarios.c
+ * @brief Built-in scenario suite run by TEST_MODE on the device and by the host tests.
+ *
+ * Every scenario starts from a sensor reading so it does not depend on the
+ * state left behind by the previous one. Delays are the real-time waits used
+ * on the device; on the host they elapse on a virtual clock.
+ */
+
+#include "garage_scenario.h"
+
+#define STEPS(array) array, (int) (sizeof(array) / sizeof((array)[0]))
+
+static const garage_scenario_step_t open_command_times_out_to_open[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 3000,  GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_COMMAND_OPEN,  500,   GARAGE_STATE_OPENING },
+    { GARAGE_INPUT_NONE,          16000, GARAGE_STATE_OPEN },
+};
+
+static const garage_scenario_step_t close_command_then_sensor_closed[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_SENSOR_OPEN,   16000, GARAGE_STATE_OPEN },
+    { GARAGE_INPUT_COMMAND_CLOSE, 500,   GARAGE_STATE_CLOSING },
+    { GARAGE_INPUT_NONE,          8000,  GARAGE_STATE_CLOSING },
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+};
+
+static const garage_scenario_step_t sensor_open_times_out_to_open[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_SENSOR_OPEN,   500,   GARAGE_STATE_OPENING },
+    { GARAGE_INPUT_NONE,          16000, GARAGE_STATE_OPEN },
+};
+
+static const garage_scenario_step_t close_timeout_goes_unknown[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_SENSOR_OPEN,   16000, GARAGE_STATE_OPEN },
+    { GARAGE_INPUT_COMMAND_CLOSE, 16000, GARAGE_STATE_UNKNOWN },
+    { GARAGE_INPUT_NONE,          2000,  GARAGE_STATE_UNKNOWN },
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+};
+
+static const garage_scenario_step_t redundant_commands_ignored[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_COMMAND_CLOSE, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_SENSOR_OPEN,   16000, GARAGE_STATE_OPEN },
+    { GARAGE_INPUT_COMMAND_OPEN,  500,   GARAGE_STATE_OPEN },
+};
+
+static const garage_scenario_step_t closed_while_opening[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_COMMAND_OPEN,  500,   GARAGE_STATE_OPENING },
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+};
+
+static const garage_scenario_step_t unknown_recovers_by_command[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_SENSOR_OPEN,   16000, GARAGE_STATE_OPEN },
+    { GARAGE_INPUT_COMMAND_CLOSE, 16000, GARAGE_STATE_UNKNOWN },
+    { GARAGE_INPUT_COMMAND_OPEN,  500,   GARAGE_STATE_OPENING },
+    { GARAGE_INPUT_NONE,          16000, GARAGE_STATE_OPEN },
+};
+
+static const garage_scenario_step_t stop_while_opening_then_close[] = {
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+    { GARAGE_INPUT_COMMAND_OPEN,  3000,  GARAGE_STATE_OPENING },
+    { GARAGE_INPUT_COMMAND_STOP,  16000, GARAGE_STATE_STOPPED },
+    { GARAGE_INPUT_COMMAND_STOP,  500,   GARAGE_STATE_STOPPED },
+    { GARAGE_INPUT_COMMAND_CLOSE, 500,   GARAGE_STATE_CLOSING },
+    { GARAGE_INPUT_SENSOR_CLOSED, 500,   GARAGE_STATE_CLOSED },
+};
+
+const garage_scenario_t garage_scenarios[] = {
+    { "open_command_times_out_to_open",   STEPS(open_command_times_out_to_open) },
+    { "close_command_then_sensor_closed", STEPS(close_command_then_sensor_closed) },
+    { "sensor_open_times_out_to_open",    STEPS(sensor_open_times_out_to_open) },
+    { "close_timeout_goes_unknown",       STEPS(close_timeout_goes_unknown) },
+    { "redundant_commands_ignored",       STEPS(redundant_commands_ignored) },
+    { "closed_while_opening",             STEPS(closed_while_opening) },
+    { "unknown_recovers_by_command",      STEPS(unknown_recovers_by_command) },
+    { "stop_while_opening_then_close",    STEPS(stop_while_opening_then_close) },
+};
+
+const int garage_scenario_count = (int) (sizeof(garage_scenarios) / sizeof(garage_scenarios[0]));
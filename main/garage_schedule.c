@@ -0,0 +1,403 @@
+/**
+ * @file garage_schedule.c
+ * @brief Scheduled door behaviours implementation.
+ */
+
+#include "garage_schedule.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_TOKENS          3
+#define MINUTES_MAX         (24 * 60)
+#define CLOCK_TOLERANCE_S   2
+
+typedef struct {
+    const char* ptr;
+    int len;
+} token_t;
+
+void garage_schedule_init(garage_schedule_t* sched, uint32_t now_s)
+{
+    if (sched == NULL) {
+        return;
+    }
+    memset(sched, 0, sizeof(*sched));
+    timer_wheel_init(&sched->wheel, now_s);
+}
+
+static bool valid_id(const char* id, int id_len)
+{
+    if (id == NULL || id_len <= 0 || id_len > GARAGE_SCHEDULE_ID_MAX) {
+        return false;
+    }
+    for (int i = 0; i < id_len; i++) {
+        char c = id[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Split on spaces; -1 if there are more than max tokens
+static int tokenize(const char* text, int len, token_t* tokens, int max)
+{
+    int count = 0;
+    int i = 0;
+    while (i < len) {
+        while (i < len && text[i] == ' ') {
+            i++;
+        }
+        if (i == len) {
+            break;
+        }
+        if (count == max) {
+            return -1;
+        }
+        tokens[count].ptr = text + i;
+        while (i < len && text[i] != ' ') {
+            i++;
+        }
+        tokens[count].len = (int) (text + i - tokens[count].ptr);
+        count++;
+    }
+    return count;
+}
+
+static bool token_equals(token_t token, const char* str)
+{
+    return (size_t) token.len == strlen(str) && memcmp(token.ptr, str, (size_t) token.len) == 0;
+}
+
+static bool parse_number(const char* p, int len, int* value)
+{
+    if (len <= 0 || len > 4) {
+        return false;
+    }
+    *value = 0;
+    for (int i = 0; i < len; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        *value = *value * 10 + (p[i] - '0');
+    }
+    return true;
+}
+
+/// Minutes, 1 to a day, as seconds
+static bool parse_minutes(token_t token, uint32_t* seconds)
+{
+    int minutes;
+    if (!parse_number(token.ptr, token.len, &minutes) || minutes < 1 || minutes > MINUTES_MAX) {
+        return false;
+    }
+    *seconds = (uint32_t) minutes * 60;
+    return true;
+}
+
+/// H:MM or HH:MM as seconds of day
+static bool parse_hhmm(token_t token, int32_t* seconds_of_day)
+{
+    const char* colon = memchr(token.ptr, ':', (size_t) token.len);
+    if (colon == NULL) {
+        return false;
+    }
+    int hours_len = (int) (colon - token.ptr);
+    int hours;
+    int minutes;
+    if (hours_len < 1 || hours_len > 2 || token.len - hours_len - 1 != 2 ||
+        !parse_number(token.ptr, hours_len, &hours) || !parse_number(colon + 1, 2, &minutes) ||
+        hours > 23 || minutes > 59) {
+        return false;
+    }
+    *seconds_of_day = hours * 3600 + minutes * 60;
+    return true;
+}
+
+static bool parse_rule(const char* text, int text_len, garage_rule_t* rule)
+{
+    token_t tokens[MAX_TOKENS];
+    int count = tokenize(text, text_len, tokens, MAX_TOKENS);
+
+    if (count == 2 && token_equals(tokens[0], "auto_close")) {
+        rule->kind = GARAGE_RULE_AUTO_CLOSE;
+        return parse_minutes(tokens[1], &rule->period_s);
+    }
+    if (count == 2 && token_equals(tokens[0], "reminder")) {
+        rule->kind = GARAGE_RULE_REMINDER;
+        return parse_minutes(tokens[1], &rule->period_s);
+    }
+    if (count == 3 && token_equals(tokens[0], "lockout")) {
+        rule->kind = GARAGE_RULE_LOCKOUT;
+        return parse_hhmm(tokens[1], &rule->start_s) && parse_hhmm(tokens[2], &rule->end_s) &&
+               rule->start_s != rule->end_s;
+    }
+    return false;
+}
+
+static uint32_t seconds_of_day(const garage_schedule_t* sched, uint32_t now_s)
+{
+    return (now_s % GARAGE_SCHEDULE_DAY_S + sched->day_offset_s) % GARAGE_SCHEDULE_DAY_S;
+}
+
+static bool in_window(const garage_rule_t* rule, int32_t sod)
+{
+    if (rule->start_s < rule->end_s) {
+        return sod >= rule->start_s && sod < rule->end_s;
+    }
+    return sod >= rule->start_s || sod < rule->end_s;      // Wraps midnight
+}
+
+/// Work out whether the window is active and time its next boundary
+static void arm_lockout(garage_schedule_t* sched, garage_rule_t* rule, uint32_t now_s)
+{
+    if (!sched->clock_known) {
+        rule->inside = false;
+        timer_wheel_cancel(&sched->wheel, &rule->timer);
+        return;
+    }
+    int32_t sod = (int32_t) seconds_of_day(sched, now_s);
+    rule->inside = in_window(rule, sod);
+    int32_t boundary = rule->inside ? rule->end_s : rule->start_s;
+    int32_t delta = (boundary - sod + GARAGE_SCHEDULE_DAY_S) % GARAGE_SCHEDULE_DAY_S;
+    timer_wheel_start(&sched->wheel, &rule->timer, now_s + (uint32_t) delta);
+}
+
+/// Open-door rules count from when the door opened, including rules added later
+static void arm_open_rule(garage_schedule_t* sched, garage_rule_t* rule)
+{
+    if (sched->door_open) {
+        timer_wheel_start(&sched->wheel, &rule->timer, sched->open_since_s + rule->period_s);
+    } else {
+        timer_wheel_cancel(&sched->wheel, &rule->timer);
+    }
+}
+
+static garage_rule_t* find_rule(garage_schedule_t* sched, const char* id, int id_len)
+{
+    for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES; i++) {
+        garage_rule_t* rule = &sched->rules[i];
+        if (rule->in_use && strlen(rule->id) == (size_t) id_len && memcmp(rule->id, id, (size_t) id_len) == 0) {
+            return rule;
+        }
+    }
+    return NULL;
+}
+
+garage_schedule_status_t garage_schedule_set_rule(garage_schedule_t* sched, const char* id, int id_len,
+                                                  const char* text, int text_len, uint32_t now_s)
+{
+    if (sched == NULL || !valid_id(id, id_len)) {
+        return GARAGE_SCHEDULE_BAD_ID;
+    }
+    garage_rule_t* rule = find_rule(sched, id, id_len);
+
+    if (text == NULL || text_len <= 0) {
+        if (rule != NULL) {
+            timer_wheel_cancel(&sched->wheel, &rule->timer);
+            rule->in_use = false;
+        }
+        return GARAGE_SCHEDULE_DELETED;
+    }
+
+    garage_rule_t parsed;
+    memset(&parsed, 0, sizeof(parsed));
+    if (!parse_rule(text, text_len, &parsed)) {
+        return GARAGE_SCHEDULE_BAD_RULE;        // An existing rule with this id is kept
+    }
+
+    if (rule == NULL) {
+        for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES && rule == NULL; i++) {
+            if (!sched->rules[i].in_use) {
+                rule = &sched->rules[i];
+            }
+        }
+        if (rule == NULL) {
+            return GARAGE_SCHEDULE_FULL;
+        }
+    } else {
+        timer_wheel_cancel(&sched->wheel, &rule->timer);
+    }
+
+    *rule = parsed;
+    rule->in_use = true;
+    memcpy(rule->id, id, (size_t) id_len);
+    rule->id[id_len] = '\0';
+    timer_wheel_timer_init(&rule->timer, rule);
+    if (rule->kind == GARAGE_RULE_LOCKOUT) {
+        arm_lockout(sched, rule, now_s);
+    } else {
+        arm_open_rule(sched, rule);
+    }
+    return GARAGE_SCHEDULE_SET;
+}
+
+void garage_schedule_on_state(garage_schedule_t* sched, garage_state_t state, uint32_t now_s)
+{
+    if (sched == NULL) {
+        return;
+    }
+    bool open = state == GARAGE_STATE_OPEN || state == GARAGE_STATE_STOPPED;
+    if (open == sched->door_open) {
+        return;
+    }
+    sched->door_open = open;
+    sched->open_since_s = now_s;
+    for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES; i++) {
+        garage_rule_t* rule = &sched->rules[i];
+        if (rule->in_use && rule->kind != GARAGE_RULE_LOCKOUT) {
+            arm_open_rule(sched, rule);
+        }
+    }
+}
+
+void garage_schedule_suspend_auto_close(garage_schedule_t* sched, bool suspended)
+{
+    if (sched != NULL) {
+        sched->auto_close_suspended = suspended;
+    }
+}
+
+void garage_schedule_set_time_of_day(garage_schedule_t* sched, int32_t sod, uint32_t now_s)
+{
+    if (sched == NULL || sod >= GARAGE_SCHEDULE_DAY_S) {
+        return;
+    }
+    if (sod < 0) {
+        if (!sched->clock_known) {
+            return;
+        }
+        sched->clock_known = false;
+    } else {
+        if (sched->clock_known) {
+            int32_t diff = (int32_t) seconds_of_day(sched, now_s) - sod;
+            if (diff < 0) {
+                diff = -diff;
+            }
+            if (diff <= CLOCK_TOLERANCE_S || GARAGE_SCHEDULE_DAY_S - diff <= CLOCK_TOLERANCE_S) {
+                return;
+            }
+        }
+        sched->clock_known = true;
+        sched->day_offset_s = ((uint32_t) sod + GARAGE_SCHEDULE_DAY_S - now_s % GARAGE_SCHEDULE_DAY_S) %
+                              GARAGE_SCHEDULE_DAY_S;
+    }
+
+    for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES; i++) {
+        garage_rule_t* rule = &sched->rules[i];
+        if (rule->in_use && rule->kind == GARAGE_RULE_LOCKOUT) {
+            arm_lockout(sched, rule, now_s);
+        }
+    }
+}
+
+static void emit(garage_schedule_t* sched, garage_schedule_event_kind_t kind, const garage_rule_t* rule,
+                 uint32_t open_s, garage_schedule_event_t* events, int max_events, int* count)
+{
+    if (events == NULL || *count >= max_events) {
+        sched->dropped_events++;
+        return;
+    }
+    garage_schedule_event_t* event = &events[(*count)++];
+    memset(event, 0, sizeof(*event));
+    event->kind = kind;
+    memcpy(event->rule_id, rule->id, sizeof(event->rule_id));
+    event->open_s = open_s;
+    event->input = GARAGE_INPUT_NONE;
+}
+
+int garage_schedule_tick(garage_schedule_t* sched, uint32_t now_s, garage_schedule_event_t* events, int max_events)
+{
+    if (sched == NULL) {
+        return 0;
+    }
+
+    int count = 0;
+    timer_wheel_timer_t* timer;
+    while ((timer = timer_wheel_expire(&sched->wheel, now_s)) != NULL) {
+        garage_rule_t* rule = (garage_rule_t*) timer->data;
+        if (rule->kind == GARAGE_RULE_LOCKOUT) {
+            bool was_inside = rule->inside;
+            arm_lockout(sched, rule, now_s);
+            if (rule->inside != was_inside) {
+                emit(sched, rule->inside ? GARAGE_SCHEDULE_EVENT_LOCKOUT_START : GARAGE_SCHEDULE_EVENT_LOCKOUT_END,
+                     rule, 0, events, max_events, &count);
+            }
+        } else if (sched->door_open) {
+            // Auto-close repeats too, in case the close was refused; after a failed one it is only reported
+            garage_schedule_event_kind_t kind = GARAGE_SCHEDULE_EVENT_REMINDER;
+            if (rule->kind == GARAGE_RULE_AUTO_CLOSE) {
+                kind = sched->auto_close_suspended ? GARAGE_SCHEDULE_EVENT_AUTO_CLOSE_SUSPENDED
+                                                   : GARAGE_SCHEDULE_EVENT_AUTO_CLOSE;
+            }
+            emit(sched, kind, rule, now_s - sched->open_since_s, events, max_events, &count);
+            timer_wheel_start(&sched->wheel, &rule->timer, now_s + rule->period_s);
+        }
+    }
+    return count;
+}
+
+bool garage_schedule_check_command(const garage_schedule_t* sched, garage_input_t input,
+                                   garage_schedule_event_t* refused)
+{
+    if (sched == NULL || input != GARAGE_INPUT_COMMAND_OPEN) {
+        return true;
+    }
+    for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES; i++) {
+        const garage_rule_t* rule = &sched->rules[i];
+        if (rule->in_use && rule->kind == GARAGE_RULE_LOCKOUT && rule->inside) {
+            if (refused != NULL) {
+                memset(refused, 0, sizeof(*refused));
+                refused->kind = GARAGE_SCHEDULE_EVENT_REFUSED;
+                memcpy(refused->rule_id, rule->id, sizeof(refused->rule_id));
+                refused->input = input;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+int garage_schedule_event_to_json(const garage_schedule_event_t* event, char* buf, size_t size)
+{
+    if (event == NULL || buf == NULL || size == 0) {
+        return -1;
+    }
+
+    int written;
+    switch (event->kind) {
+        case GARAGE_SCHEDULE_EVENT_AUTO_CLOSE:
+        case GARAGE_SCHEDULE_EVENT_AUTO_CLOSE_SUSPENDED:
+        case GARAGE_SCHEDULE_EVENT_REMINDER:
+            written = snprintf(buf, size, "{\"rule\":\"%s\",\"event\":\"%s\",\"open_s\":%u}", event->rule_id,
+                               event->kind == GARAGE_SCHEDULE_EVENT_AUTO_CLOSE ? "auto_close" :
+                               event->kind == GARAGE_SCHEDULE_EVENT_AUTO_CLOSE_SUSPENDED ? "auto_close_suspended" :
+                               "reminder",
+                               (unsigned) event->open_s);
+            break;
+        case GARAGE_SCHEDULE_EVENT_REFUSED:
+            written = snprintf(buf, size, "{\"rule\":\"%s\",\"event\":\"refused\",\"command\":\"%s\"}",
+                               event->rule_id, garage_input_to_string(event->input));
+            break;
+        default:
+            written = snprintf(buf, size, "{\"rule\":\"%s\",\"event\":\"%s\"}", event->rule_id,
+                               event->kind == GARAGE_SCHEDULE_EVENT_LOCKOUT_START ? "lockout_start" : "lockout_end");
+            break;
+    }
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    return written;
+}
+
+const char* garage_schedule_status_to_string(garage_schedule_status_t status)
+{
+    switch (status) {
+        case GARAGE_SCHEDULE_SET:       return "set";
+        case GARAGE_SCHEDULE_DELETED:   return "deleted";
+        case GARAGE_SCHEDULE_BAD_ID:    return "bad_id";
+        case GARAGE_SCHEDULE_BAD_RULE:  return "bad_rule";
+        case GARAGE_SCHEDULE_FULL:      return "full";
+        default:                        return "unknown";
+    }
+}
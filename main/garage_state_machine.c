@@ -4,21 +4,29 @@
  */
 
 #include "garage_state_machine.h"
-#include <stddef.h>
-#include <stdint.h>
+#include <stdio.h>
 
 #define DEFAULT_TIMEOUT_MS 15000  // 15 seconds
+#define DEFAULT_TRAVEL_MS  12000  // Typical full travel of a residential opener
+#define LEARN_WEIGHT       4      // A measured close moves the learned travel time by 1/4
+#define DEFAULT_REVERSAL_WINDOW_MS 3000 // Auto-reverse off the floor reopens the switch within a second or two
+#define OVERDUE_MARGIN_PCT 20     // Close is overdue at 120% of the expected travel time
+#define REVERSAL_CONFIRM_MS 200   // Far longer than reed switch bounce
 
-void garage_sm_init(garage_state_machine_t* sm, garage_state_t initial_state)
+static int initial_position(garage_state_t state)
 {
-    if (sm != NULL) {
-        sm->current_state = initial_state;
-        sm->timeout_ms = DEFAULT_TIMEOUT_MS;
-        sm->timer_elapsed_ms = 0;
-        sm->timer_active = false;
+    switch (state) {
+        case GARAGE_STATE_CLOSED: return GARAGE_POSITION_CLOSED;
+        case GARAGE_STATE_OPEN:   return GARAGE_POSITION_OPEN;
+        default:                  return GARAGE_POSITION_UNKNOWN;
     }
 }
 
+void garage_sm_init(garage_state_machine_t* sm, garage_state_t initial_state)
+{
+    garage_sm_init_with_config(sm, initial_state, NULL);
+}
+
 void garage_sm_init_with_config(garage_state_machine_t* sm, garage_state_t initial_state,
                                  const garage_sm_config_t* config)
 {
@@ -28,6 +36,23 @@ void garage_sm_init_with_config(garage_state_machine_t* sm, garage_state_t initi
                          config->timeout_ms : DEFAULT_TIMEOUT_MS;
         sm->timer_elapsed_ms = 0;
         sm->timer_active = false;
+        sm->open_travel_ms = (config != NULL && config->open_travel_ms > 0) ?
+                             config->open_travel_ms : DEFAULT_TRAVEL_MS;
+        sm->close_travel_ms = (config != NULL && config->close_travel_ms > 0) ?
+                              config->close_travel_ms : DEFAULT_TRAVEL_MS;
+        sm->position = initial_position(initial_state);
+        sm->motion_start_position = sm->position;
+        sm->motion_held = false;
+        sm->stopped_from = GARAGE_STATE_UNKNOWN;
+        sm->reversal_window_ms = (config != NULL && config->reversal_window_ms > 0) ?
+                                 config->reversal_window_ms : DEFAULT_REVERSAL_WINDOW_MS;
+        sm->reversal_watch_ms = 0;
+        sm->reversal_suspected = false;
+        sm->reversal_open_ms = 0;
+        sm->obstructed = false;
+        sm->last_obstruction = GARAGE_OBSTRUCTION_NONE;
+        sm->obstruction_count = 0;
+        sm->close_failures = 0;
     }
 }
 
@@ -55,6 +80,70 @@ int garage_sm_get_timer_elapsed(const garage_state_machine_t* sm)
     return sm->timer_elapsed_ms;
 }
 
+garage_state_t garage_sm_next_press_direction(const garage_state_machine_t* sm)
+{
+    if (sm == NULL) {
+        return GARAGE_STATE_UNKNOWN;
+    }
+    switch (sm->current_state) {
+        case GARAGE_STATE_CLOSED:  return GARAGE_STATE_OPENING;
+        case GARAGE_STATE_OPEN:    return GARAGE_STATE_CLOSING;
+        case GARAGE_STATE_STOPPED:
+            return sm->stopped_from == GARAGE_STATE_OPENING ? GARAGE_STATE_CLOSING : GARAGE_STATE_OPENING;
+        default:                   return GARAGE_STATE_UNKNOWN;    // Moving: the press would stop it
+    }
+}
+
+int garage_sm_get_position(const garage_state_machine_t* sm)
+{
+    if (sm == NULL) {
+        return GARAGE_POSITION_UNKNOWN;
+    }
+
+    bool opening = sm->current_state == GARAGE_STATE_OPENING;
+    if ((!opening && sm->current_state != GARAGE_STATE_CLOSING) || !sm->timer_active || sm->motion_held) {
+        return sm->position;
+    }
+
+    int travel_ms = opening ? sm->open_travel_ms : sm->close_travel_ms;
+    int moved = (int) ((int64_t) sm->timer_elapsed_ms * GARAGE_POSITION_OPEN / travel_ms);
+    int position = opening ? sm->motion_start_position + moved : sm->motion_start_position - moved;
+    if (position < GARAGE_POSITION_CLOSED + 1) {
+        position = GARAGE_POSITION_CLOSED + 1;
+    }
+    if (position > GARAGE_POSITION_OPEN - 1) {
+        position = GARAGE_POSITION_OPEN - 1;
+    }
+    return position;
+}
+
+const char* garage_obstruction_to_string(garage_obstruction_t obstruction)
+{
+    switch (obstruction) {
+        case GARAGE_OBSTRUCTION_FLOOR_REVERSAL: return "floor_reversal";
+        case GARAGE_OBSTRUCTION_CLOSE_OVERDUE:  return "close_overdue";
+        case GARAGE_OBSTRUCTION_CLOSE_TIMEOUT:  return "close_timeout";
+        case GARAGE_OBSTRUCTION_REOPENED:       return "reopened";
+        case GARAGE_OBSTRUCTION_NONE:
+        default:                                return "none";
+    }
+}
+
+int garage_sm_attributes_to_json(const garage_state_machine_t* sm, char* buf, size_t size)
+{
+    if (sm == NULL || buf == NULL || size == 0) {
+        return -1;
+    }
+    int written = snprintf(buf, size,
+                           "{\"obstructed\":%s,\"last_obstruction\":\"%s\",\"obstructions\":%u,\"close_failures\":%u}",
+                           sm->obstructed ? "true" : "false", garage_obstruction_to_string(sm->last_obstruction),
+                           (unsigned) sm->obstruction_count, (unsigned) sm->close_failures);
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    return written;
+}
+
 const char* garage_state_to_string(garage_state_t state)
 {
     switch (state) {
@@ -62,6 +151,7 @@ const char* garage_state_to_string(garage_state_t state)
         case GARAGE_STATE_OPEN:    return "open";
         case GARAGE_STATE_CLOSING: return "closing";
         case GARAGE_STATE_OPENING: return "opening";
+        case GARAGE_STATE_STOPPED: return "stopped";
         case GARAGE_STATE_UNKNOWN:
         default:                   return "unknown";
     }
@@ -74,6 +164,7 @@ const char* garage_state_to_display_string(garage_state_t state)
         case GARAGE_STATE_OPEN:    return "OPEN";
         case GARAGE_STATE_CLOSING: return "CLOSING";
         case GARAGE_STATE_OPENING: return "OPENING";
+        case GARAGE_STATE_STOPPED: return "STOPPED";
         case GARAGE_STATE_UNKNOWN:
         default:                   return "UNKNOWN";
     }
@@ -91,7 +182,8 @@ static garage_transition_result_t make_result(garage_state_t current, garage_sta
         .actions = {
             .publish_state = (current != new_state),
             .trigger_button_press = button_press,
-            .start_timeout_timer = start_timer
+            .start_timeout_timer = start_timer,
+            .button_presses = button_press ? 1 : 0
         }
     };
     return result;
@@ -131,6 +223,10 @@ static garage_transition_result_t handle_open_state(garage_state_t current, gara
             // Command to close -> press button, transition to closing
             return make_result(current, GARAGE_STATE_CLOSING, true, true);
 
+        case GARAGE_EVENT_DISTANCE_CLEAR:
+            // Door left the open end without a command -> closing from the wall button
+            return make_result(current, GARAGE_STATE_CLOSING, false, true);
+
         default:
             // No state change
             return make_result(current, current, false, false);
@@ -151,6 +247,14 @@ static garage_transition_result_t handle_closing_state(garage_state_t current, g
             // Timeout without reaching closed -> unknown state
             return make_result(current, GARAGE_STATE_UNKNOWN, false, false);
 
+        case GARAGE_EVENT_COMMAND_STOP:
+            // Press while moving -> door stops where it is
+            return make_result(current, GARAGE_STATE_STOPPED, true, false);
+
+        case GARAGE_EVENT_DISTANCE_OPEN:
+            // Back at the open end -> the opener reversed
+            return make_result(current, GARAGE_STATE_OPEN, false, false);
+
         default:
             // No state change
             return make_result(current, current, false, false);
@@ -171,10 +275,57 @@ static garage_transition_result_t handle_opening_state(garage_state_t current, g
             // Timeout -> assume door is now open
             return make_result(current, GARAGE_STATE_OPEN, false, false);
 
+        case GARAGE_EVENT_DISTANCE_OPEN:
+            // Distance sensor sees the open end -> door is open
+            return make_result(current, GARAGE_STATE_OPEN, false, false);
+
+        case GARAGE_EVENT_COMMAND_STOP:
+            // Press while moving -> door stops where it is
+            return make_result(current, GARAGE_STATE_STOPPED, true, false);
+
+        default:
+            // No state change
+            return make_result(current, current, false, false);
+    }
+}
+
+/**
+ * @brief Handle events when in STOPPED state
+ */
+static garage_transition_result_t handle_stopped_state(const garage_state_machine_t* sm, garage_event_t event)
+{
+    garage_state_t current = sm->current_state;
+    garage_state_t next = garage_sm_next_press_direction(sm);
+    garage_state_t wanted;
+
+    switch (event) {
+        case GARAGE_EVENT_SENSOR_CLOSED:
+            // Closed by hand or from the wall button
+            return make_result(current, GARAGE_STATE_CLOSED, false, false);
+
+        case GARAGE_EVENT_DISTANCE_OPEN:
+            // Opened by hand or from the wall button
+            return make_result(current, GARAGE_STATE_OPEN, false, false);
+
+        case GARAGE_EVENT_COMMAND_OPEN:
+            wanted = GARAGE_STATE_OPENING;
+            break;
+
+        case GARAGE_EVENT_COMMAND_CLOSE:
+            wanted = GARAGE_STATE_CLOSING;
+            break;
+
         default:
             // No state change
             return make_result(current, current, false, false);
     }
+
+    garage_transition_result_t result = make_result(current, wanted, true, true);
+    if (wanted != next) {
+        // Reverse, stop, then the commanded direction
+        result.actions.button_presses = 3;
+    }
+    return result;
 }
 
 /**
@@ -191,6 +342,10 @@ static garage_transition_result_t handle_unknown_state(garage_state_t current, g
             // Sensor says not closed -> door is open
             return make_result(current, GARAGE_STATE_OPEN, false, false);
 
+        case GARAGE_EVENT_DISTANCE_OPEN:
+            // Distance sensor sees the open end -> door is open
+            return make_result(current, GARAGE_STATE_OPEN, false, false);
+
         case GARAGE_EVENT_COMMAND_OPEN:
             // Command to open -> press button, assume opening
             return make_result(current, GARAGE_STATE_OPENING, true, true);
@@ -205,6 +360,124 @@ static garage_transition_result_t handle_unknown_state(garage_state_t current, g
     }
 }
 
+/**
+ * @brief Settle the position after a transition and learn the close travel time
+ *
+ * Called before the timer is reset, so timer_elapsed_ms still covers the motion.
+ */
+static void update_position(garage_state_machine_t* sm, garage_state_t previous,
+                            const garage_transition_result_t* result, int estimate)
+{
+    switch (result->new_state) {
+        case GARAGE_STATE_CLOSED:
+            // Only a full-travel close measures the travel time
+            if (previous == GARAGE_STATE_CLOSING && sm->timer_active &&
+                sm->motion_start_position == GARAGE_POSITION_OPEN &&
+                sm->timer_elapsed_ms > 0 && sm->timer_elapsed_ms < sm->timeout_ms) {
+                sm->close_travel_ms += (sm->timer_elapsed_ms - sm->close_travel_ms) / LEARN_WEIGHT;
+            }
+            sm->position = GARAGE_POSITION_CLOSED;
+            break;
+
+        case GARAGE_STATE_OPEN:
+            sm->position = GARAGE_POSITION_OPEN;
+            break;
+
+        default:
+            sm->position = estimate;
+            break;
+    }
+
+    if (result->actions.start_timeout_timer) {
+        if (estimate == GARAGE_POSITION_UNKNOWN) {
+            estimate = result->new_state == GARAGE_STATE_OPENING ? GARAGE_POSITION_CLOSED : GARAGE_POSITION_OPEN;
+        }
+        sm->motion_start_position = estimate;
+    }
+}
+
+static void record_obstruction(garage_state_machine_t* sm, garage_obstruction_t obstruction,
+                               garage_actions_t* actions)
+{
+    sm->obstructed = true;
+    sm->last_obstruction = obstruction;
+    sm->obstruction_count++;
+    sm->close_failures++;
+    actions->publish_attributes = true;
+}
+
+/**
+ * @brief Look for obstruction signatures in a transition
+ *
+ * Called before the timer is reset, so timer_elapsed_ms still covers the motion.
+ */
+static void detect_obstruction(garage_state_machine_t* sm, garage_state_t previous, garage_event_t event,
+                               garage_transition_result_t* result)
+{
+    garage_state_t next = result->new_state;
+
+    if (result->actions.trigger_button_press) {
+        // Our own press explains whatever the switch does next
+        sm->reversal_suspected = false;
+        sm->reversal_watch_ms = 0;
+    }
+
+    if (next == GARAGE_STATE_CLOSING && result->state_changed) {
+        // New attempt
+        if (sm->obstructed) {
+            sm->obstructed = false;
+            result->actions.publish_attributes = true;
+        }
+        sm->reversal_suspected = false;
+        sm->reversal_watch_ms = 0;
+    }
+
+    if (previous == GARAGE_STATE_CLOSING && next == GARAGE_STATE_CLOSED) {
+        if (sm->obstructed && sm->last_obstruction == GARAGE_OBSTRUCTION_CLOSE_OVERDUE) {
+            // Slow, not obstructed
+            sm->obstruction_count--;
+            sm->close_failures--;
+            sm->last_obstruction = GARAGE_OBSTRUCTION_NONE;
+        }
+        if (sm->obstructed) {
+            sm->obstructed = false;
+            result->actions.publish_attributes = true;
+        }
+        sm->reversal_watch_ms = sm->reversal_window_ms;
+    }
+
+    if (previous == GARAGE_STATE_CLOSED && event == GARAGE_EVENT_SENSOR_OPEN && sm->reversal_watch_ms > 0) {
+        sm->reversal_suspected = true;
+        sm->reversal_open_ms = 0;
+        sm->reversal_watch_ms = 0;
+    } else if (sm->reversal_suspected && next == GARAGE_STATE_CLOSED) {
+        // Contact bounce: keep watching
+        sm->reversal_suspected = false;
+        sm->reversal_watch_ms = sm->reversal_window_ms;
+    }
+
+    if (previous == GARAGE_STATE_CLOSING && event == GARAGE_EVENT_TIMER_EXPIRED && !sm->obstructed) {
+        record_obstruction(sm, GARAGE_OBSTRUCTION_CLOSE_TIMEOUT, &result->actions);
+    }
+
+    if (previous == GARAGE_STATE_CLOSING && event == GARAGE_EVENT_DISTANCE_OPEN && !sm->obstructed) {
+        record_obstruction(sm, GARAGE_OBSTRUCTION_REOPENED, &result->actions);
+    }
+}
+
+/**
+ * @brief Time after which the current close is overdue, 0 if it can only time out
+ *
+ * Compared against the timer, which for a multi-press sequence restarts at the last press,
+ * and not checked while the sequence is still being sent.
+ */
+static int close_overdue_ms(const garage_state_machine_t* sm)
+{
+    int64_t expected_ms = (int64_t) sm->motion_start_position * sm->close_travel_ms / GARAGE_POSITION_OPEN;
+    int64_t overdue_ms = expected_ms * (100 + OVERDUE_MARGIN_PCT) / 100;
+    return overdue_ms > 0 && overdue_ms < sm->timeout_ms ? (int) overdue_ms : 0;
+}
+
 garage_transition_result_t garage_sm_process_event(garage_state_machine_t* sm, garage_event_t event)
 {
     if (sm == NULL) {
@@ -217,6 +490,7 @@ garage_transition_result_t garage_sm_process_event(garage_state_machine_t* sm, g
     }
 
     garage_state_t current = sm->current_state;
+    int position = garage_sm_get_position(sm);   // Estimate before the event
     garage_transition_result_t result;
 
     switch (current) {
@@ -236,30 +510,61 @@ garage_transition_result_t garage_sm_process_event(garage_state_machine_t* sm, g
             result = handle_opening_state(current, event);
             break;
 
+        case GARAGE_STATE_STOPPED:
+            result = handle_stopped_state(sm, event);
+            break;
+
         case GARAGE_STATE_UNKNOWN:
         default:
             result = handle_unknown_state(current, event);
             break;
     }
 
+    if (result.new_state == GARAGE_STATE_STOPPED && result.state_changed) {
+        sm->stopped_from = current;
+    }
+
     // Update state machine's current state
     sm->current_state = result.new_state;
+    update_position(sm, current, &result, position);
+    detect_obstruction(sm, current, event, &result);
 
     // Manage timer based on actions
     if (result.actions.start_timeout_timer) {
         sm->timer_active = true;
         sm->timer_elapsed_ms = 0;
+        sm->motion_held = result.actions.button_presses > 1;
     }
 
-    // Stop timer if we reached a stable state (CLOSED or OPEN)
-    if (result.new_state == GARAGE_STATE_CLOSED || result.new_state == GARAGE_STATE_OPEN) {
+    // Stop timer if we reached a stable state (CLOSED, OPEN or STOPPED)
+    if (result.new_state == GARAGE_STATE_CLOSED || result.new_state == GARAGE_STATE_OPEN ||
+        result.new_state == GARAGE_STATE_STOPPED) {
         sm->timer_active = false;
         sm->timer_elapsed_ms = 0;
+        sm->motion_held = false;
     }
 
     return result;
 }
 
+uint32_t garage_sm_confirmed_obstruction_count(const garage_state_machine_t* sm)
+{
+    if (sm == NULL) {
+        return 0;
+    }
+    bool pending = sm->obstructed && sm->last_obstruction == GARAGE_OBSTRUCTION_CLOSE_OVERDUE &&
+                   sm->current_state == GARAGE_STATE_CLOSING;
+    return pending ? sm->obstruction_count - 1 : sm->obstruction_count;
+}
+
+void garage_sm_start_motion(garage_state_machine_t* sm)
+{
+    if (sm != NULL && sm->motion_held) {
+        sm->motion_held = false;
+        sm->timer_elapsed_ms = 0;
+    }
+}
+
 garage_transition_result_t garage_sm_update_timer(garage_state_machine_t* sm, int delta_ms)
 {
     garage_transition_result_t no_change = {
@@ -268,7 +573,28 @@ garage_transition_result_t garage_sm_update_timer(garage_state_machine_t* sm, in
         .actions = { .publish_state = false, .trigger_button_press = false, .start_timeout_timer = false }
     };
 
-    if (sm == NULL || !sm->timer_active) {
+    if (sm == NULL) {
+        return no_change;
+    }
+
+    if (sm->reversal_suspected) {
+        sm->reversal_open_ms += delta_ms;
+        if (sm->reversal_open_ms >= REVERSAL_CONFIRM_MS) {
+            // Stayed open: not bounce
+            sm->reversal_suspected = false;
+            record_obstruction(sm, GARAGE_OBSTRUCTION_FLOOR_REVERSAL, &no_change.actions);
+        }
+    }
+    if (sm->reversal_watch_ms > 0) {
+        sm->reversal_watch_ms -= delta_ms;
+        if (sm->reversal_watch_ms <= 0 && sm->current_state == GARAGE_STATE_CLOSED && sm->close_failures > 0) {
+            // Stayed closed
+            sm->close_failures = 0;
+            no_change.actions.publish_attributes = true;
+        }
+    }
+
+    if (!sm->timer_active) {
         return no_change;
     }
 
@@ -276,10 +602,21 @@ garage_transition_result_t garage_sm_update_timer(garage_state_machine_t* sm, in
 
     // Check if timeout exceeded
     if (sm->timer_elapsed_ms >= sm->timeout_ms) {
-        // Timer expired - send timer expired event
+        // Timer expired - keep the estimate, then send timer expired event
+        sm->position = garage_sm_get_position(sm);
         sm->timer_active = false;
         sm->timer_elapsed_ms = 0;
-        return garage_sm_process_event(sm, GARAGE_EVENT_TIMER_EXPIRED);
+        sm->motion_held = false;
+        garage_transition_result_t result = garage_sm_process_event(sm, GARAGE_EVENT_TIMER_EXPIRED);
+        result.actions.publish_attributes |= no_change.actions.publish_attributes;
+        return result;
+    }
+
+    if (sm->current_state == GARAGE_STATE_CLOSING && !sm->obstructed && !sm->motion_held) {
+        int overdue_ms = close_overdue_ms(sm);
+        if (overdue_ms > 0 && sm->timer_elapsed_ms >= overdue_ms) {
+            record_obstruction(sm, GARAGE_OBSTRUCTION_CLOSE_OVERDUE, &no_change.actions);
+        }
     }
 
     return no_change;
@@ -0,0 +1,81 @@
+/**
+ * @file gpio_hal.c
+ * @brief Real ESP8266 GPIO HAL implementation - passes through to the GPIO driver
+ *
+ * This is the production implementation that calls the actual ESP8266 SDK functions.
+ * For host testing, use test/sim/gpio_hal_sim.c instead.
+ */
+
+#include "gpio_hal_interface.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+
+/* ============================================================================
+ * GPIO Configuration HAL Implementation
+ * ============================================================================ */
+
+static gpio_int_type_t edge_to_intr_type(gpio_hal_edge_t edge)
+{
+    switch (edge) {
+        case GPIO_HAL_EDGE_RISING:  return GPIO_INTR_POSEDGE;
+        case GPIO_HAL_EDGE_FALLING: return GPIO_INTR_NEGEDGE;
+        case GPIO_HAL_EDGE_ANY:     return GPIO_INTR_ANYEDGE;
+        case GPIO_HAL_EDGE_NONE:
+        default:                    return GPIO_INTR_DISABLE;
+    }
+}
+
+esp_err_t gpio_hal_config_output(uint32_t pin_bit_mask)
+{
+    gpio_config_t io_conf;
+    io_conf.intr_type = GPIO_INTR_DISABLE;
+    io_conf.mode = GPIO_MODE_OUTPUT;
+    io_conf.pin_bit_mask = pin_bit_mask;
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = GPIO_PULLUP_DISABLE;
+    return gpio_config(&io_conf);
+}
+
+esp_err_t gpio_hal_config_input(uint32_t pin_bit_mask, gpio_hal_edge_t edge, bool pull_up)
+{
+    gpio_config_t io_conf;
+    io_conf.intr_type = edge_to_intr_type(edge);
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pin_bit_mask = pin_bit_mask;
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.pull_up_en = pull_up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE;
+    return gpio_config(&io_conf);
+}
+
+esp_err_t gpio_hal_install_isr_service(void)
+{
+    return gpio_install_isr_service(0);
+}
+
+esp_err_t gpio_hal_isr_handler_add(int gpio_num, gpio_hal_isr_t handler, void* arg)
+{
+    return gpio_isr_handler_add((gpio_num_t) gpio_num, handler, arg);
+}
+
+/* ============================================================================
+ * GPIO Level HAL Implementation
+ * ============================================================================ */
+
+esp_err_t gpio_hal_set_level(int gpio_num, int level)
+{
+    return gpio_set_level((gpio_num_t) gpio_num, level);
+}
+
+int gpio_hal_get_level(int gpio_num)
+{
+    return gpio_get_level((gpio_num_t) gpio_num);
+}
+
+/* ============================================================================
+ * Time HAL Implementation
+ * ============================================================================ */
+
+int64_t gpio_hal_get_time_us(void)
+{
+    return esp_timer_get_time();
+}
@@ -0,0 +1,436 @@
+/**
+ * @file history_log.c
+ * @brief Door audit trail in a flash ring implementation.
+ */
+
+#include "history_log.h"
+#include <stdio.h>
+#include <string.h>
+#include "cbor_writer.h"
+#include "flash_hal_interface.h"
+#include "garage_controller.h"
+
+#define RECORDS_PER_SECTOR  (FLASH_HAL_SECTOR_SIZE / HISTORY_RECORD_SIZE)
+#define CRC_OFFSET          (HISTORY_RECORD_SIZE - 2)
+#define SEQ_ERASED          0xFFFFFFFFu
+
+static void put_u16(uint8_t* p, uint16_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t) value;
+    p[1] = (uint8_t) (value >> 8);
+    p[2] = (uint8_t) (value >> 16);
+    p[3] = (uint8_t) (value >> 24);
+}
+
+static uint16_t get_u16(const uint8_t* p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/// CRC-16/CCITT-FALSE
+static uint16_t crc16(const uint8_t* data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t) (data[i] << 8);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+void history_record_encode(const history_record_t* record, uint8_t out[HISTORY_RECORD_SIZE])
+{
+    put_u32(out, record->seq);
+    put_u32(out + 4, record->time_s);
+    put_u16(out + 8, record->boot);
+    out[10] = (uint8_t) record->kind;
+    memcpy(out + 11, record->args, sizeof(record->args));
+    put_u16(out + CRC_OFFSET, crc16(out, CRC_OFFSET));
+}
+
+bool history_record_decode(const uint8_t in[HISTORY_RECORD_SIZE], history_record_t* record)
+{
+    uint32_t seq = get_u32(in);
+    if (seq == SEQ_ERASED || get_u16(in + CRC_OFFSET) != crc16(in, CRC_OFFSET)) {
+        return false;
+    }
+    record->seq = seq;
+    record->time_s = get_u32(in + 4);
+    record->boot = get_u16(in + 8);
+    record->kind = (history_kind_t) in[10];
+    memcpy(record->args, in + 11, sizeof(record->args));
+    return true;
+}
+
+static bool read_slot(uint32_t slot, history_record_t* record)
+{
+    uint8_t raw[HISTORY_RECORD_SIZE];
+    return flash_hal_read(slot * HISTORY_RECORD_SIZE, raw, sizeof(raw)) == ESP_OK &&
+           history_record_decode(raw, record);
+}
+
+static bool slot_is_blank(uint32_t slot)
+{
+    uint8_t raw[HISTORY_RECORD_SIZE];
+    if (flash_hal_read(slot * HISTORY_RECORD_SIZE, raw, sizeof(raw)) != ESP_OK) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(raw); i++) {
+        if (raw[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t history_log_init(history_log_t* log, const char* label)
+{
+    if (log == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(log, 0, sizeof(*log));
+
+    uint32_t size;
+    esp_err_t err = flash_hal_open(label, &size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint32_t sectors = size / FLASH_HAL_SECTOR_SIZE;
+    if (sectors < 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    log->capacity = sectors * RECORDS_PER_SECTOR;
+
+    // The sector being filled is the one whose first record is newest
+    history_record_t record;
+    history_record_t newest;
+    uint32_t newest_slot = 0;
+    bool found = false;
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (read_slot(s * RECORDS_PER_SECTOR, &record) && (!found || record.seq > newest.seq)) {
+            newest = record;
+            newest_slot = s * RECORDS_PER_SECTOR;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        log->write_slot = 0;        // Sector 0 is erased before the first record goes in
+        log->next_seq = 1;
+        log->boot = 1;
+    } else {
+        uint32_t sector_start = newest_slot;
+        for (uint32_t i = 1; i < RECORDS_PER_SECTOR; i++) {
+            if (read_slot(sector_start + i, &record) && record.seq > newest.seq) {
+                newest = record;
+                newest_slot = sector_start + i;
+            }
+        }
+        // Anything programmed after the newest valid record is a torn write: skip past it
+        uint32_t slot = newest_slot + 1;
+        while (slot % RECORDS_PER_SECTOR != 0 && !slot_is_blank(slot)) {
+            slot++;
+        }
+        log->write_slot = slot % log->capacity;
+        log->next_seq = newest.seq + 1;
+        log->boot = (uint16_t) (newest.boot + 1);
+    }
+
+    log->ready = true;
+    return ESP_OK;
+}
+
+uint32_t history_log_append(history_log_t* log, history_kind_t kind, uint32_t time_s,
+                            uint8_t arg0, uint8_t arg1, uint8_t arg2)
+{
+    if (log == NULL || !log->ready) {
+        return 0;
+    }
+    history_record_t record = {
+        .seq = log->next_seq++,
+        .time_s = time_s,
+        .boot = log->boot,
+        .kind = kind,
+        .args = { arg0, arg1, arg2 },
+    };
+    history_record_encode(&record, log->batch + log->batch_count * HISTORY_RECORD_SIZE);
+    log->batch_count++;
+
+    if (log->batch_count == HISTORY_BATCH_RECORDS) {
+        history_log_flush(log);
+    }
+    return record.seq;
+}
+
+esp_err_t history_log_flush(history_log_t* log)
+{
+    if (log == NULL || !log->ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int done = 0;
+    esp_err_t err = ESP_OK;
+    while (done < log->batch_count) {
+        uint32_t slot = log->write_slot;
+        uint32_t in_sector = slot % RECORDS_PER_SECTOR;
+        if (in_sector == 0) {
+            err = flash_hal_erase_sector((slot / RECORDS_PER_SECTOR) * FLASH_HAL_SECTOR_SIZE);
+            if (err != ESP_OK) {
+                break;
+            }
+        }
+
+        // One write per sector the batch lands in
+        int n = log->batch_count - done;
+        if ((uint32_t) n > RECORDS_PER_SECTOR - in_sector) {
+            n = (int) (RECORDS_PER_SECTOR - in_sector);
+        }
+        err = flash_hal_write(slot * HISTORY_RECORD_SIZE, log->batch + done * HISTORY_RECORD_SIZE,
+                              (size_t) n * HISTORY_RECORD_SIZE);
+        // The slots are no longer blank even if the write failed part way
+        log->write_slot = (slot + (uint32_t) n) % log->capacity;
+        if (err != ESP_OK) {
+            break;
+        }
+        done += n;
+    }
+
+    if (err != ESP_OK) {
+        log->write_errors++;
+    } else if (log->batch_count > 0) {
+        log->flushes++;
+    }
+    log->batch_count = 0;
+    return err;
+}
+
+int history_log_read(history_log_t* log, uint32_t since_seq, history_record_t* records, int max_records)
+{
+    if (log == NULL || !log->ready || records == NULL || max_records <= 0) {
+        return 0;
+    }
+
+    // Start at the sector holding since_seq, or at the oldest data if it is older than the log
+    history_record_t record;
+    uint32_t start = log->write_slot;
+    uint32_t best_seq = 0;
+    bool found = false;
+    for (uint32_t slot = 0; slot < log->capacity; slot += RECORDS_PER_SECTOR) {
+        if (read_slot(slot, &record) && record.seq <= since_seq && (!found || record.seq > best_seq)) {
+            start = slot;
+            best_seq = record.seq;
+            found = true;
+        }
+    }
+
+    // Ring order from start up to the write position
+    uint32_t steps = (log->write_slot + log->capacity - start) % log->capacity;
+    if (steps == 0) {
+        steps = log->capacity;
+    }
+    int count = 0;
+    for (uint32_t i = 0; i < steps && count < max_records; i++) {
+        if (read_slot((start + i) % log->capacity, &record) && record.seq >= since_seq) {
+            records[count++] = record;
+        }
+    }
+
+    for (int i = 0; i < log->batch_count && count < max_records; i++) {
+        if (history_record_decode(log->batch + i * HISTORY_RECORD_SIZE, &record) && record.seq >= since_seq) {
+            records[count++] = record;
+        }
+    }
+    return count;
+}
+
+static bool parse_u32(const char* p, int len, uint32_t* value)
+{
+    if (len <= 0 || len > 10) {
+        return false;
+    }
+    uint64_t v = 0;
+    for (int i = 0; i < len; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        v = v * 10 + (uint64_t) (p[i] - '0');
+    }
+    if (v > UINT32_MAX) {
+        return false;
+    }
+    *value = (uint32_t) v;
+    return true;
+}
+
+bool history_log_parse_query(const char* text, int len, uint32_t* since_seq, int* count)
+{
+    if (since_seq == NULL || count == NULL || len < 0 || (text == NULL && len > 0)) {
+        return false;
+    }
+    *since_seq = 0;
+    *count = HISTORY_PAGE_MAX;
+
+    static const char prefix[] = "history?";
+    if (len >= (int) sizeof(prefix) - 1 && memcmp(text, prefix, sizeof(prefix) - 1) == 0) {
+        text += sizeof(prefix) - 1;
+        len -= (int) sizeof(prefix) - 1;
+    }
+
+    int i = 0;
+    while (i < len) {
+        const char* key = text + i;
+        const char* end = memchr(key, '&', (size_t) (len - i));
+        int field_len = end != NULL ? (int) (end - key) : len - i;
+        const char* eq = memchr(key, '=', (size_t) field_len);
+        if (eq == NULL) {
+            return false;
+        }
+        int key_len = (int) (eq - key);
+        const char* value = eq + 1;
+        int value_len = field_len - key_len - 1;
+        uint32_t number;
+        if (!parse_u32(value, value_len, &number)) {
+            return false;
+        }
+
+        if (key_len == 5 && memcmp(key, "since", 5) == 0) {
+            *since_seq = number;
+        } else if (key_len == 1 && key[0] == 'n' && number >= 1) {
+            *count = number > HISTORY_PAGE_MAX ? HISTORY_PAGE_MAX : (int) number;
+        } else {
+            return false;
+        }
+        i += field_len + 1;
+    }
+    return true;
+}
+
+static const char* fault_to_string(uint8_t fault)
+{
+    switch (fault) {
+        case HISTORY_FAULT_OBSTRUCTION: return "obstruction";
+        case HISTORY_FAULT_MQTT_LOST:   return "mqtt_lost";
+        default:                        return "unknown";
+    }
+}
+
+int history_record_to_json(const history_record_t* record, char* buf, size_t size)
+{
+    if (record == NULL || buf == NULL || size == 0) {
+        return -1;
+    }
+
+    // A clock record maps its boot's seconds to UTC: "t" is still seconds since boot
+    const uint8_t* args = record->args;
+    uint32_t time_s = record->kind == HISTORY_CLOCK ?
+                      (uint32_t) args[0] | ((uint32_t) args[1] << 8) | ((uint32_t) args[2] << 16) : record->time_s;
+    int head = snprintf(buf, size, "{\"seq\":%u,\"boot\":%u,\"t\":%u,", (unsigned) record->seq,
+                        (unsigned) record->boot, (unsigned) time_s);
+    if (head < 0 || (size_t) head >= size) {
+        return -1;
+    }
+
+    int written;
+    switch (record->kind) {
+        case HISTORY_BOOT:
+            written = snprintf(buf + head, size - (size_t) head, "\"kind\":\"boot\",\"reason\":%u}",
+                               (unsigned) args[0]);
+            break;
+        case HISTORY_TRANSITION:
+            written = snprintf(buf + head, size - (size_t) head,
+                               "\"kind\":\"transition\",\"from\":\"%s\",\"to\":\"%s\"}",
+                               garage_state_to_string((garage_state_t) args[0]),
+                               garage_state_to_string((garage_state_t) args[1]));
+            break;
+        case HISTORY_COMMAND:
+            written = snprintf(buf + head, size - (size_t) head,
+                               "\"kind\":\"command\",\"command\":\"%s\",\"accepted\":%s,\"source\":\"%s\"}",
+                               garage_input_to_string((garage_input_t) args[0]), args[1] ? "true" : "false",
+                               args[2] == HISTORY_SOURCE_SCHEDULE ? "schedule" : "remote");
+            break;
+        case HISTORY_FAULT:
+            written = snprintf(buf + head, size - (size_t) head,
+                               "\"kind\":\"fault\",\"fault\":\"%s\",\"state\":\"%s\"}",
+                               fault_to_string(args[0]), garage_state_to_string((garage_state_t) args[1]));
+            break;
+        case HISTORY_CLOCK:
+            written = snprintf(buf + head, size - (size_t) head, "\"kind\":\"clock\",\"utc\":%u}",
+                               (unsigned) record->time_s);
+            break;
+        default:
+            written = snprintf(buf + head, size - (size_t) head, "\"kind\":\"unknown\"}");
+            break;
+    }
+    if (written < 0 || (size_t) written >= size - (size_t) head) {
+        return -1;
+    }
+    return head + written;
+}
+
+int history_page_to_json(const history_record_t* records, int count, uint32_t next, bool last,
+                         char* buf, size_t size)
+{
+    if (buf == NULL || size == 0) {
+        return -1;
+    }
+    int used = snprintf(buf, size, "{\"records\":[");
+    if (used < 0 || (size_t) used >= size) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            if ((size_t) used + 1 >= size) {
+                return -1;
+            }
+            buf[used++] = ',';
+        }
+        int written = history_record_to_json(&records[i], buf + used, size - (size_t) used);
+        if (written < 0) {
+            return -1;
+        }
+        used += written;
+    }
+    int tail = snprintf(buf + used, size - (size_t) used, "],\"next\":%u,\"last\":%s}", (unsigned) next,
+                        last ? "true" : "false");
+    if (tail < 0 || (size_t) tail >= size - (size_t) used) {
+        return -1;
+    }
+    return used + tail;
+}
+
+int history_page_to_cbor(const history_record_t* records, int count, uint32_t next, bool last,
+                         uint8_t* buf, size_t size)
+{
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buf, size);
+    cbor_put_array(&writer, 4);
+    cbor_put_uint(&writer, HISTORY_CBOR_VERSION);
+    cbor_put_uint(&writer, next);
+    cbor_put_bool(&writer, last);
+    cbor_put_array(&writer, (size_t) (count > 0 ? count : 0));
+    for (int i = 0; i < count; i++) {
+        const history_record_t* record = &records[i];
+        cbor_put_array(&writer, 7);
+        cbor_put_uint(&writer, record->seq);
+        cbor_put_uint(&writer, record->boot);
+        cbor_put_uint(&writer, record->time_s);
+        cbor_put_uint(&writer, (uint64_t) record->kind);
+        cbor_put_uint(&writer, record->args[0]);
+        cbor_put_uint(&writer, record->args[1]);
+        cbor_put_uint(&writer, record->args[2]);
+    }
+    return cbor_writer_finish(&writer);
+}
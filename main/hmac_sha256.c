@@ -0,0 +1,164 @@
+/**
+ * @file hmac_sha256.c
+ * @brief SHA-256 (FIPS 180-4) and HMAC-SHA256 (RFC 2104) implementation.
+ */
+
+#include "hmac_sha256.h"
+#include <string.h>
+
+static const uint32_t round_constants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void compress(uint32_t h[8], const uint8_t block[SHA256_BLOCK_LEN])
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t) block[i * 4] << 24) | ((uint32_t) block[i * 4 + 1] << 16) |
+               ((uint32_t) block[i * 4 + 2] << 8) | (uint32_t) block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+                      round_constants[i] + w[i];
+        uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+void sha256_init(sha256_t* ctx)
+{
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    memcpy(ctx->h, initial, sizeof(initial));
+    ctx->total_len = 0;
+    ctx->block_len = 0;
+}
+
+void sha256_update(sha256_t* ctx, const void* data, size_t len)
+{
+    const uint8_t* bytes = (const uint8_t*) data;
+    ctx->total_len += len;
+
+    if (ctx->block_len > 0) {
+        size_t take = SHA256_BLOCK_LEN - ctx->block_len;
+        if (take > len) {
+            take = len;
+        }
+        memcpy(ctx->block + ctx->block_len, bytes, take);
+        ctx->block_len += take;
+        bytes += take;
+        len -= take;
+        if (ctx->block_len < SHA256_BLOCK_LEN) {
+            return;
+        }
+        compress(ctx->h, ctx->block);
+        ctx->block_len = 0;
+    }
+    while (len >= SHA256_BLOCK_LEN) {
+        compress(ctx->h, bytes);
+        bytes += SHA256_BLOCK_LEN;
+        len -= SHA256_BLOCK_LEN;
+    }
+    memcpy(ctx->block, bytes, len);
+    ctx->block_len = len;
+}
+
+void sha256_final(sha256_t* ctx, uint8_t digest[SHA256_DIGEST_LEN])
+{
+    uint64_t bit_len = ctx->total_len * 8;
+
+    // 0x80, zeros to 56 mod 64, then the 64-bit big-endian length
+    ctx->block[ctx->block_len++] = 0x80;
+    if (ctx->block_len > SHA256_BLOCK_LEN - 8) {
+        memset(ctx->block + ctx->block_len, 0, SHA256_BLOCK_LEN - ctx->block_len);
+        compress(ctx->h, ctx->block);
+        ctx->block_len = 0;
+    }
+    memset(ctx->block + ctx->block_len, 0, SHA256_BLOCK_LEN - 8 - ctx->block_len);
+    for (int i = 0; i < 8; i++) {
+        ctx->block[SHA256_BLOCK_LEN - 1 - i] = (uint8_t) (bit_len >> (8 * i));
+    }
+    compress(ctx->h, ctx->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (uint8_t) (ctx->h[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t) (ctx->h[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t) (ctx->h[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t) ctx->h[i];
+    }
+}
+
+void hmac_sha256(const uint8_t* key, size_t key_len, const void* data, size_t len,
+                 uint8_t mac[SHA256_DIGEST_LEN])
+{
+    uint8_t pad[SHA256_BLOCK_LEN];
+    uint8_t inner[SHA256_DIGEST_LEN];
+    sha256_t ctx;
+
+    // Keys longer than a block are replaced by their hash; shorter ones are zero-padded
+    memset(pad, 0, sizeof(pad));
+    if (key_len > SHA256_BLOCK_LEN) {
+        sha256_init(&ctx);
+        sha256_update(&ctx, key, key_len);
+        sha256_final(&ctx, pad);
+    } else if (key_len > 0) {
+        memcpy(pad, key, key_len);
+    }
+
+    for (int i = 0; i < SHA256_BLOCK_LEN; i++) {
+        pad[i] ^= 0x36;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, pad, sizeof(pad));
+    sha256_update(&ctx, data, len);
+    sha256_final(&ctx, inner);
+
+    for (int i = 0; i < SHA256_BLOCK_LEN; i++) {
+        pad[i] ^= 0x36 ^ 0x5c;
+    }
+    sha256_init(&ctx);
+    sha256_update(&ctx, pad, sizeof(pad));
+    sha256_update(&ctx, inner, sizeof(inner));
+    sha256_final(&ctx, mac);
+}
+
+bool hmac_sha256_equal(const uint8_t* a, const uint8_t* b, size_t len)
+{
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= (uint8_t) (a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
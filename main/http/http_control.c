@@ -0,0 +1,267 @@
+/**
+ * @file http_control.c
+ * @brief LAN HTTP control endpoint implementation.
+ */
+
+#include "http_control.h"
+#include "metrics.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Status line and headers are formatted after the body, which is written this far into the buffer
+#define HEADER_RESERVE 192
+
+typedef struct {
+    const char* path;
+    garage_input_t input;
+} command_route_t;
+
+static const command_route_t command_routes[] = {
+    { "/open", GARAGE_INPUT_COMMAND_OPEN },
+    { "/close", GARAGE_INPUT_COMMAND_CLOSE },
+    { "/stop", GARAGE_INPUT_COMMAND_STOP },
+};
+
+void http_control_init(http_control_t* control, const http_control_config_t* config)
+{
+    if (control == NULL) {
+        return;
+    }
+    memset(control, 0, sizeof(*control));
+    if (config != NULL) {
+        control->config = *config;
+    }
+}
+
+static const char* reason_phrase(int status)
+{
+    switch (status) {
+        case 200: return "OK";
+        case 202: return "Accepted";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 431: return "Request Header Fields Too Large";
+        case 503: return "Service Unavailable";
+        default:  return "Internal Server Error";
+    }
+}
+
+/// Prepend the status line and headers to a body already at out + HEADER_RESERVE
+static int finish_response(http_control_t* control, int status, const char* content_type,
+                           const char* extra_header, int body_len, char* out, size_t size)
+{
+    if (body_len < 0) {
+        return -1;
+    }
+    char head[HEADER_RESERVE];
+    int head_len = snprintf(head, sizeof(head),
+                            "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n%sConnection: close\r\n\r\n",
+                            status, reason_phrase(status), content_type, body_len,
+                            extra_header != NULL ? extra_header : "");
+    if (head_len < 0 || (size_t) head_len >= sizeof(head)) {
+        return -1;
+    }
+    // head_len < HEADER_RESERVE, so the body only ever moves towards the start
+    memmove(out + head_len, out + HEADER_RESERVE, (size_t) body_len);
+    memcpy(out, head, (size_t) head_len);
+    if ((size_t) (head_len + body_len) < size) {
+        out[head_len + body_len] = '\0';
+    }
+
+    control->requests++;
+    if (status >= 400) {
+        control->rejected++;
+    }
+    return head_len + body_len;
+}
+
+/// snprintf into the body area; -1 if it does not fit
+static int format_body(char* out, size_t size, const char* fmt, ...)
+{
+    if (size <= HEADER_RESERVE) {
+        return -1;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int written = vsnprintf(out + HEADER_RESERVE, size - HEADER_RESERVE, fmt, args);
+    va_end(args);
+    if (written < 0 || (size_t) written >= size - HEADER_RESERVE) {
+        return -1;
+    }
+    return written;
+}
+
+static int respond_text(http_control_t* control, int status, const char* extra_header, const char* message,
+                        char* out, size_t size)
+{
+    int body_len = format_body(out, size, "%s\n", message);
+    return finish_response(control, status, "text/plain", extra_header, body_len, out, size);
+}
+
+static void read_snapshot(const http_control_t* control, garage_controller_snapshot_t* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->state = GARAGE_STATE_UNKNOWN;
+    snapshot->position = GARAGE_POSITION_UNKNOWN;
+    if (control->config.get_snapshot != NULL) {
+        control->config.get_snapshot(snapshot, control->config.ctx);
+    }
+}
+
+static int respond_state(http_control_t* control, char* out, size_t size)
+{
+    garage_controller_snapshot_t snapshot;
+    read_snapshot(control, &snapshot);
+    int body_len = format_body(out, size, "{\"state\":\"%s\",\"position\":%d,\"obstructed\":%s}",
+                               garage_state_to_string(snapshot.state), snapshot.position,
+                               snapshot.obstructed ? "true" : "false");
+    return finish_response(control, 200, "application/json", NULL, body_len, out, size);
+}
+
+/// Account for one snprintf into body + *used; false if it did not fit
+static bool advance(size_t* used, int written, size_t avail)
+{
+    if (written < 0 || (size_t) written >= avail - *used) {
+        return false;
+    }
+    *used += (size_t) written;
+    return true;
+}
+
+static int respond_metrics(http_control_t* control, char* out, size_t size)
+{
+    garage_controller_snapshot_t snapshot;
+    read_snapshot(control, &snapshot);
+    if (size <= HEADER_RESERVE) {
+        return -1;
+    }
+
+    char* body = out + HEADER_RESERVE;
+    size_t avail = size - HEADER_RESERVE;
+    size_t used = 0;
+    if (!advance(&used, snprintf(body, avail, "# TYPE garage_door_state gauge\n"), avail)) {
+        return -1;
+    }
+    for (int state = GARAGE_STATE_CLOSED; state <= GARAGE_STATE_STOPPED; state++) {
+        int written = snprintf(body + used, avail - used, "garage_door_state{state=\"%s\"} %d\n",
+                               garage_state_to_string((garage_state_t) state), (int) snapshot.state == state);
+        if (!advance(&used, written, avail)) {
+            return -1;
+        }
+    }
+
+    // This request is counted once the response is formatted; include it here
+    int written = snprintf(body + used, avail - used,
+                           "# TYPE garage_door_position_percent gauge\n"
+                           "garage_door_position_percent %d\n"
+                           "# TYPE garage_door_obstructed gauge\n"
+                           "garage_door_obstructed %d\n"
+                           "# TYPE garage_door_transitions_total counter\n"
+                           "garage_door_transitions_total %u\n"
+                           "# TYPE garage_door_relay_presses_total counter\n"
+                           "garage_door_relay_presses_total %u\n"
+                           "# TYPE garage_door_obstructions_total counter\n"
+                           "garage_door_obstructions_total %u\n"
+                           "# TYPE garage_door_http_requests_total counter\n"
+                           "garage_door_http_requests_total %u\n"
+                           "# TYPE garage_door_http_commands_total counter\n"
+                           "garage_door_http_commands_total %u\n"
+                           "# TYPE garage_door_http_rejected_total counter\n"
+                           "garage_door_http_rejected_total %u\n",
+                           snapshot.position, snapshot.obstructed ? 1 : 0, (unsigned) snapshot.transition_count,
+                           (unsigned) snapshot.relay_press_count, (unsigned) snapshot.obstruction_count,
+                           (unsigned) control->requests + 1, (unsigned) control->commands,
+                           (unsigned) control->rejected);
+    if (!advance(&used, written, avail)) {
+        return -1;
+    }
+    written = metrics_to_prometheus(body + used, avail - used);
+    if (written < 0) {
+        return -1;
+    }
+    used += (size_t) written;
+    return finish_response(control, 200, "text/plain; version=0.0.4", NULL, (int) used, out, size);
+}
+
+/// Compare in time independent of where the first mismatch is
+static bool token_matches(const char* token, http_slice_t presented)
+{
+    size_t token_len = strlen(token);
+    if (presented.len != token_len) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (size_t i = 0; i < token_len; i++) {
+        diff |= (unsigned char) (token[i] ^ presented.ptr[i]);
+    }
+    return diff == 0;
+}
+
+static int respond_command(http_control_t* control, const http_request_t* req, garage_input_t input,
+                           char* out, size_t size)
+{
+    const char* token = control->config.token;
+    if (token == NULL || token[0] == '\0' || strlen(token) > HTTP_CONTROL_TOKEN_MAX) {
+        return respond_text(control, 403, NULL, "control disabled: no token configured", out, size);
+    }
+
+    static const char scheme[] = "Bearer ";
+    http_slice_t credentials = { NULL, 0 };
+    if (req->authorization.len > sizeof(scheme) - 1 &&
+        memcmp(req->authorization.ptr, scheme, sizeof(scheme) - 1) == 0) {
+        credentials.ptr = req->authorization.ptr + sizeof(scheme) - 1;
+        credentials.len = req->authorization.len - (sizeof(scheme) - 1);
+    }
+    if (credentials.ptr == NULL || !token_matches(token, credentials)) {
+        return respond_text(control, 401, "WWW-Authenticate: Bearer\r\n", "unauthorized", out, size);
+    }
+
+    if (control->config.on_command == NULL || !control->config.on_command(input, control->config.ctx)) {
+        return respond_text(control, 503, "Retry-After: 1\r\n", "busy", out, size);
+    }
+    control->commands++;
+    int body_len = format_body(out, size, "{\"accepted\":\"%s\"}", garage_input_to_string(input));
+    return finish_response(control, 202, "application/json", NULL, body_len, out, size);
+}
+
+int http_control_handle(http_control_t* control, const http_request_t* req, char* out, size_t size)
+{
+    if (control == NULL || req == NULL || out == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < sizeof(command_routes) / sizeof(command_routes[0]); i++) {
+        if (http_slice_equals(req->path, command_routes[i].path)) {
+            if (req->method != HTTP_METHOD_POST) {
+                return respond_text(control, 405, "Allow: POST\r\n", "method not allowed", out, size);
+            }
+            return respond_command(control, req, command_routes[i].input, out, size);
+        }
+    }
+
+    bool is_state = http_slice_equals(req->path, "/state");
+    bool is_metrics = http_slice_equals(req->path, "/metrics");
+    if (!is_state && !is_metrics) {
+        return respond_text(control, 404, NULL, "not found", out, size);
+    }
+    if (req->method != HTTP_METHOD_GET) {
+        return respond_text(control, 405, "Allow: GET\r\n", "method not allowed", out, size);
+    }
+    return is_state ? respond_state(control, out, size) : respond_metrics(control, out, size);
+}
+
+int http_control_error(http_control_t* control, int status, char* out, size_t size)
+{
+    if (control == NULL || out == NULL) {
+        return -1;
+    }
+    if (status != 400 && status != 408 && status != 431) {
+        status = 500;
+    }
+    return respond_text(control, status, NULL, reason_phrase(status), out, size);
+}
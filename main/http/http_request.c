@@ -0,0 +1,187 @@
+/**
+ * @file http_request.c
+ * @brief HTTP/1.x request parser implementation.
+ */
+
+#include "http_request.h"
+#include <string.h>
+
+#define CONTENT_LENGTH_MAX 1000000L
+
+bool http_slice_equals(http_slice_t slice, const char* str)
+{
+    if (str == NULL || (slice.ptr == NULL && slice.len > 0)) {
+        return false;
+    }
+    size_t str_len = strlen(str);
+    return slice.len == str_len && (str_len == 0 || memcmp(slice.ptr, str, str_len) == 0);
+}
+
+/// ASCII-only case folding; header names are case-insensitive
+static char lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char) (c - 'A' + 'a') : c;
+}
+
+static bool name_equals(const char* name, size_t len, const char* lowercase)
+{
+    size_t i = 0;
+    for (; i < len; i++) {
+        if (lowercase[i] == '\0' || lower(name[i]) != lowercase[i]) {
+            return false;
+        }
+    }
+    return lowercase[i] == '\0';
+}
+
+/// RFC 9110 token characters
+static bool is_tchar(char c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+        return true;
+    }
+    return c != '\0' && strchr("!#$%&'*+-.^_`|~", c) != NULL;
+}
+
+/// Offset of the first "\r\n\r\n" plus 4, or 0 if not found
+static size_t find_header_end(const char* buf, size_t len)
+{
+    for (size_t i = 3; i < len; i++) {
+        if (buf[i] == '\n' && buf[i - 1] == '\r' && buf[i - 2] == '\n' && buf[i - 3] == '\r') {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static http_parse_result_t parse_request_line(const char* line, size_t len, http_request_t* req)
+{
+    size_t i = 0;
+    while (i < len && line[i] != ' ') {
+        if (!is_tchar(line[i])) {
+            return HTTP_PARSE_BAD_REQUEST;
+        }
+        i++;
+    }
+    if (i == 0 || i == len) {
+        return HTTP_PARSE_BAD_REQUEST;
+    }
+    http_slice_t method = { line, i };
+    if (http_slice_equals(method, "GET")) {
+        req->method = HTTP_METHOD_GET;
+    } else if (http_slice_equals(method, "POST")) {
+        req->method = HTTP_METHOD_POST;
+    } else {
+        req->method = HTTP_METHOD_OTHER;
+    }
+
+    size_t target = ++i;
+    while (i < len && line[i] != ' ') {
+        if ((unsigned char) line[i] <= 0x20 || (unsigned char) line[i] >= 0x7f) {
+            return HTTP_PARSE_BAD_REQUEST;
+        }
+        i++;
+    }
+    if (i == target || i == len || line[target] != '/') {
+        return HTTP_PARSE_BAD_REQUEST;
+    }
+    const char* question = memchr(line + target, '?', i - target);
+    size_t path_end = question != NULL ? (size_t) (question - line) : i;
+    req->path.ptr = line + target;
+    req->path.len = path_end - target;
+    req->query.ptr = question != NULL ? question + 1 : line + i;
+    req->query.len = question != NULL ? i - path_end - 1 : 0;
+
+    http_slice_t version = { line + i + 1, len - i - 1 };
+    if (!http_slice_equals(version, "HTTP/1.1") && !http_slice_equals(version, "HTTP/1.0")) {
+        return HTTP_PARSE_BAD_REQUEST;
+    }
+    return HTTP_PARSE_OK;
+}
+
+static http_parse_result_t parse_header(const char* line, size_t len, http_request_t* req)
+{
+    const char* colon = memchr(line, ':', len);
+    if (colon == NULL || colon == line) {
+        return HTTP_PARSE_BAD_REQUEST;
+    }
+    size_t name_len = (size_t) (colon - line);
+    for (size_t i = 0; i < name_len; i++) {
+        if (!is_tchar(line[i])) {
+            return HTTP_PARSE_BAD_REQUEST;
+        }
+    }
+
+    // Trim optional whitespace around the value
+    const char* value = colon + 1;
+    const char* end = line + len;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+    }
+    size_t value_len = (size_t) (end - value);
+
+    if (name_equals(line, name_len, "content-length")) {
+        if (value_len == 0 || req->content_length >= 0) {
+            return HTTP_PARSE_BAD_REQUEST;     // Empty or repeated
+        }
+        long length = 0;
+        for (size_t i = 0; i < value_len; i++) {
+            if (value[i] < '0' || value[i] > '9') {
+                return HTTP_PARSE_BAD_REQUEST;
+            }
+            length = length * 10 + (value[i] - '0');
+            if (length > CONTENT_LENGTH_MAX) {
+                return HTTP_PARSE_BAD_REQUEST;
+            }
+        }
+        req->content_length = length;
+    } else if (name_equals(line, name_len, "authorization")) {
+        req->authorization.ptr = value;
+        req->authorization.len = value_len;
+    }
+    return HTTP_PARSE_OK;
+}
+
+http_parse_result_t http_request_parse(const char* buf, size_t len, http_request_t* req)
+{
+    if (req == NULL || (buf == NULL && len > 0)) {
+        return HTTP_PARSE_BAD_REQUEST;
+    }
+
+    size_t header_len = find_header_end(buf, len);
+    if (header_len == 0) {
+        return HTTP_PARSE_INCOMPLETE;
+    }
+
+    memset(req, 0, sizeof(*req));
+    req->content_length = -1;
+    req->header_len = header_len;
+    req->authorization.ptr = buf;
+
+    // Each line ends in CRLF; the last one is the empty line at header_len - 2
+    const char* line = buf;
+    const char* stop = buf + header_len - 2;
+    bool first = true;
+    while (line < stop) {
+        const char* cr = memchr(line, '\r', (size_t) (stop - line) + 1);
+        if (cr == NULL || cr[1] != '\n') {
+            return HTTP_PARSE_BAD_REQUEST;     // Bare CR or LF inside a line
+        }
+        size_t line_len = (size_t) (cr - line);
+        if (memchr(line, '\n', line_len) != NULL) {
+            return HTTP_PARSE_BAD_REQUEST;
+        }
+
+        http_parse_result_t result = first ? parse_request_line(line, line_len, req)
+                                           : parse_header(line, line_len, req);
+        if (result != HTTP_PARSE_OK) {
+            return result;
+        }
+        first = false;
+        line = cr + 2;
+    }
+    return first ? HTTP_PARSE_BAD_REQUEST : HTTP_PARSE_OK;
+}
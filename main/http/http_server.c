@@ -0,0 +1,161 @@
+/**
+ * @file http_server.c
+ * @brief Blocking single-connection HTTP server implementation.
+ */
+
+#include "http_server.h"
+#include <string.h>
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+
+#define LISTEN_BACKLOG 2
+#define DRAIN_READS    4           // Bounds the time a slow client can hold the server after the response
+#define DRAIN_MIN_MS   100         // Drain time left to a request that used up its deadline
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL     // A client that hung up must not raise SIGPIPE on POSIX
+#else
+#define SEND_FLAGS 0
+#endif
+
+static char request_buf[HTTP_SERVER_REQUEST_MAX];
+static char response_buf[HTTP_SERVER_RESPONSE_MAX];
+
+int http_server_listen(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, LISTEN_BACKLOG) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+uint16_t http_server_port(int listen_fd)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(listen_fd, (struct sockaddr*) &addr, &len) != 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+static bool send_all(int fd, const char* data, size_t len)
+{
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, SEND_FLAGS);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= (size_t) sent;
+    }
+    return true;
+}
+
+/// Limit the next reads to what is left of the request deadline; false once it has passed
+static bool set_recv_deadline(int fd, uint32_t accepted_ms, uint32_t min_ms)
+{
+    uint32_t elapsed_ms = sys_now() - accepted_ms;
+    uint32_t left_ms = elapsed_ms < HTTP_SERVER_REQUEST_TIMEOUT_MS ? HTTP_SERVER_REQUEST_TIMEOUT_MS - elapsed_ms : 0;
+    if (left_ms < min_ms) {
+        left_ms = min_ms;
+    }
+    if (left_ms == 0) {
+        return false;                               // A zero timeout would block forever
+    }
+    struct timeval timeout = {
+        .tv_sec = left_ms / 1000,
+        .tv_usec = (left_ms % 1000) * 1000,
+    };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return true;
+}
+
+/// Read until the headers are complete, the buffer is full, the client stops sending or the
+/// deadline passes, then format the response. Returns its length, or 0 if the client sent nothing.
+static int read_request(int fd, http_control_t* control, uint32_t accepted_ms)
+{
+    http_request_t req;
+    size_t received = 0;
+    for (;;) {
+        // Each read gets only the time left, so a client sending a byte at a time cannot hold the server
+        ssize_t n = set_recv_deadline(fd, accepted_ms, 0)
+                        ? recv(fd, request_buf + received, sizeof(request_buf) - received, 0) : -1;
+        if (n <= 0) {
+            if (received == 0) {
+                return 0;                           // Closed or idle before a request
+            }
+            return http_control_error(control, 408, response_buf, sizeof(response_buf));
+        }
+        received += (size_t) n;
+
+        http_parse_result_t result = http_request_parse(request_buf, received, &req);
+        if (result == HTTP_PARSE_OK) {
+            return http_control_handle(control, &req, response_buf, sizeof(response_buf));
+        }
+        if (result == HTTP_PARSE_BAD_REQUEST) {
+            return http_control_error(control, 400, response_buf, sizeof(response_buf));
+        }
+        if (received == sizeof(request_buf)) {
+            return http_control_error(control, 431, response_buf, sizeof(response_buf));
+        }
+    }
+}
+
+/// Status code from the formatted status line ("HTTP/1.1 NNN ...")
+static int response_status(const char* response, int len)
+{
+    if (len < 12) {
+        return -1;
+    }
+    return (response[9] - '0') * 100 + (response[10] - '0') * 10 + (response[11] - '0');
+}
+
+int http_server_serve_one(int listen_fd, http_control_t* control)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return -1;
+    }
+
+    uint32_t accepted_ms = sys_now();
+    int status = 0;
+    int response_len = read_request(fd, control, accepted_ms);
+    if (response_len < 0) {
+        response_len = http_control_error(control, 500, response_buf, sizeof(response_buf));
+    }
+    if (response_len > 0) {
+        status = send_all(fd, response_buf, (size_t) response_len)
+                     ? response_status(response_buf, response_len) : -1;
+
+        // Half-close and drain what the client still sends (an unread POST body), so
+        // closing does not reset the connection before the response is read
+        shutdown(fd, SHUT_WR);
+        for (int i = 0; i < DRAIN_READS && set_recv_deadline(fd, accepted_ms, DRAIN_MIN_MS) &&
+                        recv(fd, request_buf, sizeof(request_buf), 0) > 0; i++) {
+        }
+    }
+    close(fd);
+    return status;
+}
+
+void http_server_close(int listen_fd)
+{
+    if (listen_fd >= 0) {
+        close(listen_fd);
+    }
+}
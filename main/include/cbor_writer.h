@@ -0,0 +1,114 @@
+/**
+ * @file cbor_writer.h
+ * @brief Minimal CBOR (RFC 8949) encoder into a caller's buffer - pure C, no allocation.
+ *
+ * Only what the fixed payload schemas need: unsigned and negative integers,
+ * booleans, text strings, and arrays and maps of known length. Every item
+ * uses the shortest head, as the deterministic encoding rules require, so a
+ * value always encodes to the same bytes.
+ *
+ * Writes past the end of the buffer are not made; the writer remembers the
+ * overflow and cbor_writer_finish() reports it, so callers check once at the
+ * end rather than after every item.
+ */
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Major types (the top three bits of an item's first byte)
+ */
+typedef enum {
+    CBOR_MAJOR_UINT = 0,
+    CBOR_MAJOR_NEGINT,
+    CBOR_MAJOR_BYTES,
+    CBOR_MAJOR_TEXT,
+    CBOR_MAJOR_ARRAY,
+    CBOR_MAJOR_MAP,
+    CBOR_MAJOR_TAG,
+    CBOR_MAJOR_SIMPLE
+} cbor_major_t;
+
+#define CBOR_FALSE  0xf4
+#define CBOR_TRUE   0xf5
+
+/**
+ * @brief Writer state
+ */
+typedef struct {
+    uint8_t* buf;
+    size_t size;
+    size_t len;             // Bytes written so far
+    bool overflow;          // An item did not fit
+} cbor_writer_t;
+
+/**
+ * @brief Start writing into a buffer
+ * @param writer Writer
+ * @param buf Output buffer
+ * @param size Buffer size
+ */
+void cbor_writer_init(cbor_writer_t* writer, uint8_t* buf, size_t size);
+
+/**
+ * @brief Write an unsigned integer
+ * @param writer Writer
+ * @param value Value
+ */
+void cbor_put_uint(cbor_writer_t* writer, uint64_t value);
+
+/**
+ * @brief Write a signed integer (negative values use major type 1)
+ * @param writer Writer
+ * @param value Value
+ */
+void cbor_put_int(cbor_writer_t* writer, int64_t value);
+
+/**
+ * @brief Write a boolean
+ * @param writer Writer
+ * @param value Value
+ */
+void cbor_put_bool(cbor_writer_t* writer, bool value);
+
+/**
+ * @brief Write a text string
+ * @param writer Writer
+ * @param text UTF-8 text, NUL-terminated
+ */
+void cbor_put_text(cbor_writer_t* writer, const char* text);
+
+/**
+ * @brief Start an array; the next count items are its elements
+ * @param writer Writer
+ * @param count Number of elements
+ */
+void cbor_put_array(cbor_writer_t* writer, size_t count);
+
+/**
+ * @brief Start a map; the next 2 * count items are its keys and values
+ * @param writer Writer
+ * @param count Number of pairs
+ */
+void cbor_put_map(cbor_writer_t* writer, size_t count);
+
+/**
+ * @brief Get the result
+ * @param writer Writer
+ * @return Bytes written, or -1 if anything did not fit
+ */
+int cbor_writer_finish(const cbor_writer_t* writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CBOR_WRITER_H
@@ -0,0 +1,142 @@
+/**
+ * @file diag_report.h
+ * @brief Diagnostics report for the DIAG_MODE build: per-task CPU share, stack and heap
+ * headroom and queue depths as bounded JSON chunks - pure C, extracted for testability.
+ *
+ * The firmware samples FreeRTOS (uxTaskGetSystemState, the heap and its queues)
+ * into these structs; everything from there on runs on the host too.
+ *
+ * CPU share is measured between two samples of the run time counters, so a
+ * report covers the time since the previous one. To see what ran during a
+ * WiFi reconnect storm, ask for a report before it and another once the
+ * broker is back. Each task's share is in tenths of a percent, and the
+ * tasks are listed busiest first.
+ *
+ * The task list is split into chunks of at most the caller's buffer size,
+ * each a complete JSON object. The last chunk has "last":true.
+ */
+
+#ifndef DIAG_REPORT_H
+#define DIAG_REPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DIAG_TASKS_MAX          20
+#define DIAG_TASK_NAME_MAX      16      // configMAX_TASK_NAME_LEN
+#define DIAG_CHUNK_MAX          512     // Bytes in one published chunk
+
+/**
+ * @brief Report sections, asked for by name on the debug command topic
+ */
+typedef enum {
+    DIAG_SECTION_TASKS = 1 << 0,        // "tasks": list, CPU share, stack headroom
+    DIAG_SECTION_HEAP = 1 << 1,         // "heap"
+    DIAG_SECTION_QUEUES = 1 << 2,       // "queues"
+    DIAG_SECTION_ALL = DIAG_SECTION_TASKS | DIAG_SECTION_HEAP | DIAG_SECTION_QUEUES     // "all"
+} diag_section_t;
+
+/**
+ * @brief One task, as sampled
+ */
+typedef struct {
+    char name[DIAG_TASK_NAME_MAX + 1];
+    uint32_t number;                // Task number: a task deleted and created again gets a new one
+    char state;                     // 'X' running, 'R' ready, 'B' blocked, 'S' suspended, 'D' deleted
+    uint8_t priority;
+    uint32_t runtime;               // Run time counter (wraps)
+    uint32_t stack_free;            // Stack bytes never used
+    uint16_t cpu_permille;          // Filled in by diag_cpu_shares()
+} diag_task_t;
+
+/**
+ * @brief All tasks, as sampled at one time
+ */
+typedef struct {
+    diag_task_t tasks[DIAG_TASKS_MAX];
+    int count;
+    uint32_t total_runtime;         // Run time counter total at the sample (wraps)
+    uint32_t time_ms;               // Uptime at the sample
+} diag_tasks_t;
+
+/**
+ * @brief Heap state
+ */
+typedef struct {
+    uint32_t free;
+    uint32_t min_free;              // Lowest since boot
+} diag_heap_t;
+
+/**
+ * @brief One queue's depth
+ */
+typedef struct {
+    const char* name;
+    uint32_t waiting;
+    uint32_t size;
+} diag_queue_t;
+
+/**
+ * @brief Parse a debug command
+ * @param data Payload (not NUL-terminated, may be NULL)
+ * @param len Payload length
+ * @return Sections asked for ("tasks", "heap", "queues" or "all"), or 0 if the command is not one
+ */
+int diag_parse_command(const char* data, int len);
+
+/**
+ * @brief Work out each task's CPU share since the previous sample, then sort the tasks busiest first
+ *
+ * A task missing from the previous sample started since; all its run time
+ * counts. The counters wrap, so the samples must be less than one wrap apart.
+ *
+ * @param previous Previous sample (NULL: since boot)
+ * @param current Current sample; cpu_permille is filled in and the tasks are reordered
+ */
+void diag_cpu_shares(const diag_tasks_t* previous, diag_tasks_t* current);
+
+/**
+ * @brief Write as many tasks as fit, from the given one, as a JSON chunk
+ * @param current Sample after diag_cpu_shares()
+ * @param window_ms Time since the previous sample (0: since boot)
+ * @param report Report number, the same in every chunk of one report
+ * @param start First task to write
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @param next Receives the task to start the next chunk with (current->count when done)
+ * @return Length written, or -1 if not even one task fits
+ */
+int diag_tasks_to_json(const diag_tasks_t* current, uint32_t window_ms, uint32_t report, int start,
+                       char* buf, size_t size, int* next);
+
+/**
+ * @brief Write the heap section as JSON
+ * @param heap Heap state
+ * @param report Report number
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer is too small
+ */
+int diag_heap_to_json(const diag_heap_t* heap, uint32_t report, char* buf, size_t size);
+
+/**
+ * @brief Write the queues section as JSON
+ * @param queues Queue depths
+ * @param count Number of queues
+ * @param report Report number
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer is too small
+ */
+int diag_queues_to_json(const diag_queue_t* queues, int count, uint32_t report, char* buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DIAG_REPORT_H
@@ -0,0 +1,58 @@
+/**
+ * @file distance_hal_interface.h
+ * @brief Hardware Abstraction Layer for a distance sensor
+ *
+ * This interface abstracts one ranging measurement: start it, then read the
+ * result back one sample period later. The application only sees millimetres,
+ * so an ultrasonic sensor and a time-of-flight sensor are interchangeable by
+ * linking a different implementation. distance_hal_hcsr04.c drives an HC-SR04
+ * through the GPIO HAL.
+ */
+
+#ifndef DISTANCE_HAL_INTERFACE_H
+#define DISTANCE_HAL_INTERFACE_H
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sensor wiring
+ */
+typedef struct {
+    int trigger_gpio;               // Output that starts a measurement
+    int echo_gpio;                  // Input the sensor answers on
+} distance_hal_config_t;
+
+/**
+ * @brief Configure the sensor pins; the GPIO interrupt service must already be installed
+ * @param config Wiring
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t distance_hal_init(const distance_hal_config_t* config);
+
+/**
+ * @brief Start a measurement; returns at once, the result arrives in the background
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t distance_hal_start(void);
+
+/**
+ * @brief Read the result of the last measurement started
+ *
+ * Called no sooner than the sensor's longest measurement after
+ * distance_hal_start() (about 40 ms for ultrasonic), typically at the next
+ * sample period just before starting the next one.
+ *
+ * @param mm Receives the distance in millimetres
+ * @return ESP_OK, ESP_ERR_TIMEOUT if nothing answered, ESP_ERR_INVALID_STATE if none was started
+ */
+esp_err_t distance_hal_read_mm(int* mm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISTANCE_HAL_INTERFACE_H
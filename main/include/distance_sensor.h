@@ -0,0 +1,168 @@
+/**
+ * @file distance_sensor.h
+ * @brief Distance sensor filtering and classification - pure C, no allocation.
+ *
+ * The sensor looks down from the ceiling into the bay, placed so that the
+ * panels of the open door pass under it. A reading is then one of three
+ * things: the door panel (the door is at the open end), the roof of a car,
+ * or the floor.
+ *
+ * Readings go through a median over the last DISTANCE_SENSOR_MEDIAN_WINDOW
+ * samples, which drops single spikes such as stray echoes, then an EWMA that
+ * smooths the rest. A median that jumps by more than DISTANCE_SENSOR_STEP_MM
+ * restarts the EWMA there: that is the door or a car moving, not noise, and
+ * sweeping across would pass through the zones in between. The filtered
+ * distance is sorted into a zone by two calibrated thresholds, widened by a
+ * hysteresis around the current zone so noise at a boundary does not flap.
+ * A zone is reported once it has held for DISTANCE_SENSOR_CONFIRM_SAMPLES
+ * samples.
+ *
+ * While the door panel is under the sensor the bay cannot be seen, so the
+ * occupancy keeps its last value.
+ */
+
+#ifndef DISTANCE_SENSOR_H
+#define DISTANCE_SENSOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "garage_state_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISTANCE_SENSOR_MEDIAN_WINDOW   5       // Samples in the median; also the samples needed after a restart
+#define DISTANCE_SENSOR_CONFIRM_SAMPLES 5       // Consecutive samples a new zone must hold
+#define DISTANCE_SENSOR_EWMA_SHIFT      2       // Default EWMA weight of a new median: 1/4
+#define DISTANCE_SENSOR_STEP_MM         250     // Median jump that restarts the EWMA
+#define DISTANCE_SENSOR_SETTLE_MS       3000    // Sampling continues this long after the door closes
+#define DISTANCE_SENSOR_NO_READING      (-1)    // Sample value for a measurement with no echo
+#define DISTANCE_SENSOR_UNKNOWN         (-1)    // Filtered distance before the window has filled
+
+/**
+ * @brief What the filtered distance is looking at
+ */
+typedef enum {
+    DISTANCE_ZONE_UNKNOWN = 0,      // Not enough samples yet
+    DISTANCE_ZONE_DOOR,             // The open door's panel
+    DISTANCE_ZONE_CAR,              // The roof of a parked car
+    DISTANCE_ZONE_FLOOR             // The empty bay
+} distance_zone_t;
+
+/**
+ * @brief Whether a car is parked in the bay
+ */
+typedef enum {
+    DISTANCE_OCCUPANCY_UNKNOWN = 0,
+    DISTANCE_OCCUPANCY_ABSENT,
+    DISTANCE_OCCUPANCY_PRESENT
+} distance_occupancy_t;
+
+/**
+ * @brief Calibration, from readings taken with the sensor in place
+ */
+typedef struct {
+    int door_max_mm;                // Readings up to this are the open door's panel
+    int car_max_mm;                 // Readings above door_max_mm up to this are a car (<= door_max_mm: no occupancy)
+    int hysteresis_mm;              // Widening of the current zone at each boundary
+    int max_range_mm;               // Readings past this are treated as no echo (<= 0: no limit)
+    int ewma_shift;                 // EWMA weight of a new median is 1/2^shift (<= 0 uses DISTANCE_SENSOR_EWMA_SHIFT)
+} distance_sensor_config_t;
+
+/**
+ * @brief Filter state, written only by the task that samples the sensor
+ */
+typedef struct {
+    distance_sensor_config_t config;
+    int window[DISTANCE_SENSOR_MEDIAN_WINDOW];  // Ring of the latest valid readings
+    int window_next;                // Ring slot the next reading goes into
+    int window_count;               // Valid readings in the ring
+    int32_t filtered_q4;            // EWMA in 1/16 mm, valid once the ring has filled
+    bool filtered_valid;
+    distance_zone_t zone;           // Reported zone
+    distance_zone_t candidate;      // Zone the filtered distance is currently in
+    int candidate_samples;          // Consecutive samples in the candidate zone
+    distance_occupancy_t occupancy;
+    uint32_t samples;               // Samples taken since init
+    uint32_t dropped;               // Samples without a usable echo
+} distance_sensor_t;
+
+/**
+ * @brief What a sample changed
+ */
+typedef struct {
+    bool door_changed;              // Door arrived at or left the open end, or was first seen
+    bool occupancy_changed;
+} distance_sensor_change_t;
+
+/**
+ * @brief Set up the filter with no samples and occupancy unknown
+ * @param sensor Filter state
+ * @param config Calibration
+ */
+void distance_sensor_init(distance_sensor_t* sensor, const distance_sensor_config_t* config);
+
+/**
+ * @brief Forget the samples after sampling was paused; the zone is unknown until the window refills
+ *
+ * The occupancy is kept: the bay cannot change while the door stays closed.
+ *
+ * @param sensor Filter state
+ */
+void distance_sensor_restart(distance_sensor_t* sensor);
+
+/**
+ * @brief Feed one measurement through the filter and classification
+ * @param sensor Filter state
+ * @param mm Measured distance, or DISTANCE_SENSOR_NO_READING
+ * @return What changed
+ */
+distance_sensor_change_t distance_sensor_add_sample(distance_sensor_t* sensor, int mm);
+
+/**
+ * @brief Get the filtered distance
+ * @param sensor Filter state
+ * @return Millimetres, or DISTANCE_SENSOR_UNKNOWN until the window has filled
+ */
+int distance_sensor_get_mm(const distance_sensor_t* sensor);
+
+/**
+ * @brief Check whether the door is at the open end
+ * @param sensor Filter state
+ * @return true if the reported zone is the door panel
+ */
+bool distance_sensor_door_open(const distance_sensor_t* sensor);
+
+/**
+ * @brief Get the occupancy
+ * @param sensor Filter state
+ * @return Last occupancy seen with the bay in view
+ */
+distance_occupancy_t distance_sensor_get_occupancy(const distance_sensor_t* sensor);
+
+/**
+ * @brief Decide whether the sensor needs sampling
+ *
+ * Sampling runs in every state but CLOSED, and for DISTANCE_SENSOR_SETTLE_MS
+ * after the door closes so a car that just drove in is seen with the door
+ * down. A door that is closed and idle is not sampled at all.
+ *
+ * @param state Door state
+ * @param ms_in_state Time since the door entered that state
+ * @return true if sampling should be running
+ */
+bool distance_sensor_sampling_needed(garage_state_t state, int64_t ms_in_state);
+
+/**
+ * @brief Convert occupancy to string for publishing
+ * @param occupancy The occupancy to convert
+ * @return "present", "absent" or "unknown"
+ */
+const char* distance_occupancy_to_string(distance_occupancy_t occupancy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DISTANCE_SENSOR_H
@@ -0,0 +1,63 @@
+/**
+ * @file flash_hal_interface.h
+ * @brief Hardware Abstraction Layer for a raw flash data partition
+ *
+ * This interface abstracts the partition calls used by the history log
+ * (lookup, read, program and sector erase), allowing the log's layout and
+ * recovery to run on the host against a simulated NOR flash.
+ *
+ * NOR semantics apply: erase sets a whole sector to 0xFF and programming can
+ * only clear bits, so a region must be erased before it is written again.
+ */
+
+#ifndef FLASH_HAL_INTERFACE_H
+#define FLASH_HAL_INTERFACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_HAL_SECTOR_SIZE   4096    // Erase unit
+
+/**
+ * @brief Select the data partition with this label for the other calls
+ * @param label Partition label from the partition table
+ * @param size Receives the partition size in bytes
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if there is no such partition
+ */
+esp_err_t flash_hal_open(const char* label, uint32_t* size);
+
+/**
+ * @brief Read from the partition
+ * @param offset Byte offset within the partition
+ * @param buf Destination
+ * @param len Bytes to read
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_hal_read(uint32_t offset, void* buf, size_t len);
+
+/**
+ * @brief Program erased flash
+ * @param offset Byte offset within the partition
+ * @param buf Source
+ * @param len Bytes to write
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_hal_write(uint32_t offset, const void* buf, size_t len);
+
+/**
+ * @brief Erase one sector
+ * @param offset Byte offset of the sector (a multiple of FLASH_HAL_SECTOR_SIZE)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flash_hal_erase_sector(uint32_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASH_HAL_INTERFACE_H
@@ -0,0 +1,101 @@
+/**
+ * @file garage_command.h
+ * @brief MQTT ingress classification - pure logic, extracted from mqtt_data_callback for testability.
+ *
+ * Topic and payload come straight from the broker: they are length-delimited,
+ * not NUL-terminated, may contain embedded NULs and may carry any length the
+ * client reports. Matching is exact on length and bytes, and nothing is read
+ * past the given length.
+ */
+
+#ifndef GARAGE_COMMAND_H
+#define GARAGE_COMMAND_H
+
+#include "garage_controller.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GARAGE_COMMAND_OPEN     "OPEN"
+#define GARAGE_COMMAND_CLOSE    "CLOSE"
+#define GARAGE_COMMAND_STOP     "STOP"
+#define GARAGE_COMMAND_LOG_MAX  64      // Longest topic/payload excerpt passed to %.*s
+
+/**
+ * @brief What an incoming message is
+ */
+typedef enum {
+    GARAGE_MESSAGE_UNKNOWN_TOPIC = 0,   // Not a topic we handle (or an invalid buffer)
+    GARAGE_MESSAGE_COMMAND,             // OPEN/CLOSE/STOP on the command topic
+    GARAGE_MESSAGE_SIGNED_COMMAND,      // "<OPEN|CLOSE|STOP> ..." on the command topic, for signed_command_verify
+    GARAGE_MESSAGE_INVALID_COMMAND,     // Anything else on the command topic
+    GARAGE_MESSAGE_STATUS,              // Message on the status topic
+    GARAGE_MESSAGE_SCHEDULE_RULE,       // Rule under the schedule prefix (payload is the rule text)
+    GARAGE_MESSAGE_HISTORY_QUERY,       // Page request on the history topic (payload is the query)
+    GARAGE_MESSAGE_DEBUG_COMMAND        // Report request on the debug topic (payload is the command)
+} garage_message_kind_t;
+
+/**
+ * @brief Topics the device subscribes to (NUL-terminated)
+ */
+typedef struct {
+    const char* command_topic;
+    const char* status_topic;
+    const char* schedule_prefix;    // Rule topics are this prefix + rule id (NULL: none)
+    const char* history_topic;      // History page requests (NULL: none)
+    const char* debug_topic;        // Diagnostics report requests (NULL: none)
+} garage_command_topics_t;
+
+/**
+ * @brief Classification result
+ */
+typedef struct {
+    garage_message_kind_t kind;
+    garage_input_t input;           // COMMAND_OPEN/CLOSE/STOP for GARAGE_MESSAGE_COMMAND, NONE otherwise
+    const char* rule_id;            // GARAGE_MESSAGE_SCHEDULE_RULE: id within the topic buffer, else NULL
+    int rule_id_len;
+} garage_message_t;
+
+/**
+ * @brief Classify an incoming message
+ * @param topics Subscribed topics
+ * @param topic Topic bytes (may be NULL)
+ * @param topic_len Topic length (negative is treated as invalid)
+ * @param data Payload bytes (may be NULL)
+ * @param data_len Payload length (negative is treated as invalid)
+ * @return Classification
+ */
+garage_message_t garage_command_classify(const garage_command_topics_t* topics,
+                                         const char* topic, int topic_len,
+                                         const char* data, int data_len);
+
+/**
+ * @brief Whether a message of this kind can move the door without a signature
+ *
+ * True for plain commands, and for schedule rules: an auto-close rule closes
+ * the door and a lockout refuses signed OPEN commands. These are the messages
+ * to drop when only signed commands may move the door.
+ *
+ * @param kind Classification
+ * @return true if the message is unsigned control
+ */
+bool garage_command_is_unsigned_control(garage_message_kind_t kind);
+
+/**
+ * @brief Length to pass as the %.*s precision when logging a broker buffer
+ *
+ * A negative precision makes printf read up to a NUL, which a broker buffer
+ * need not have; a huge one makes logging cost proportional to the payload.
+ *
+ * @param data Buffer (may be NULL)
+ * @param len Reported length
+ * @return 0 for NULL or negative lengths, otherwise len capped at GARAGE_COMMAND_LOG_MAX
+ */
+int garage_command_log_len(const char* data, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GARAGE_COMMAND_H
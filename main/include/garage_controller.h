@@ -0,0 +1,230 @@
+/**
+ * @file garage_controller.h
+ * @brief Garage door controller - binds inputs, the state machine and the relay.
+ *
+ * The controller turns queued inputs (reed switch edges, commands) into state
+ * machine events and drives the relay through the GPIO HAL. It contains no
+ * FreeRTOS or MQTT calls, so the ISR -> queue -> state machine -> relay path
+ * can be exercised on the host against the simulated GPIO HAL.
+ */
+
+#ifndef GARAGE_CONTROLLER_H
+#define GARAGE_CONTROLLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "garage_state_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GARAGE_RELAY_PULSE_MS 500  // Relay hold time for one button press
+#define GARAGE_TICK_PERIOD_MS 100  // Controller time resolution (relay pulse, state machine timeout)
+#define GARAGE_POSITION_STEP_PCT 10 // Default position change between position publishes
+
+/**
+ * @brief Inputs delivered to the controller through the state machine queue
+ */
+typedef enum {
+    GARAGE_INPUT_NONE = 0,
+    GARAGE_INPUT_REED_SWITCH,       // Reed switch edge, level is sampled when handled
+    GARAGE_INPUT_SENSOR_CLOSED,     // Reed switch reading injected as closed (no GPIO read)
+    GARAGE_INPUT_SENSOR_OPEN,       // Reed switch reading injected as open (no GPIO read)
+    GARAGE_INPUT_COMMAND_OPEN,      // Command to open
+    GARAGE_INPUT_COMMAND_CLOSE,     // Command to close
+    GARAGE_INPUT_COMMAND_STOP,      // Command to stop a moving door
+    GARAGE_INPUT_DISTANCE_OPEN,     // Distance sensor sees the door at the open end
+    GARAGE_INPUT_DISTANCE_CLEAR,    // Distance sensor no longer sees the door at the open end
+    GARAGE_INPUT_MQTT_CONNECTED     // Broker session came up: retained values are published again
+} garage_input_t;
+
+/**
+ * @brief Controller configuration
+ */
+typedef struct {
+    int reed_switch_gpio;           // Reed switch input, low level means closed
+    int relay_gpio;                 // Relay control output, high level presses the button
+    int relay_pulse_ms;             // Relay hold time and gap between presses (<= 0 uses GARAGE_RELAY_PULSE_MS)
+    int position_step_pct;          // Position publish step (<= 0 uses GARAGE_POSITION_STEP_PCT)
+    garage_sm_config_t sm_config;   // State machine configuration
+} garage_controller_config_t;
+
+/**
+ * @brief Controller context
+ */
+typedef struct {
+    garage_state_machine_t sm;
+    int reed_switch_gpio;
+    int relay_gpio;
+    int relay_pulse_ms;
+    bool relay_active;              // Relay output currently held high
+    int relay_remaining_ms;         // Time left in the current pulse or gap
+    int relay_presses_queued;       // Presses of the sequence still to come after the current pulse
+    uint32_t relay_press_count;     // Number of button presses performed
+    int64_t last_transition_us;     // GPIO HAL timestamp of the last state change
+    uint32_t transition_count;      // Number of state changes since init
+    int64_t last_tick_us;           // Time accounted for by garage_controller_tick_to()
+    int position_step_pct;
+    int published_position;         // Last position recorded by garage_controller_position_published()
+} garage_controller_t;
+
+/**
+ * @brief Copy of the controller fields other tasks may read
+ *
+ * Only the owner task touches the controller; it publishes a snapshot for
+ * readers such as the scenario runner and the HTTP endpoint.
+ */
+typedef struct {
+    garage_state_t state;
+    int position;                   // Percent, or GARAGE_POSITION_UNKNOWN
+    bool obstructed;
+    int64_t last_transition_us;
+    uint32_t transition_count;
+    uint32_t relay_press_count;
+    uint32_t obstruction_count;
+} garage_controller_snapshot_t;
+
+/**
+ * @brief Initialize the controller and release the relay
+ * @param ctrl Pointer to controller context
+ * @param config Configuration (pins, relay pulse, state machine timeout)
+ * @param initial_state Initial state (typically GARAGE_STATE_UNKNOWN)
+ */
+void garage_controller_init(garage_controller_t* ctrl, const garage_controller_config_t* config,
+                            garage_state_t initial_state);
+
+/**
+ * @brief Handle one input taken from the state machine queue
+ *
+ * Converts the input to a state machine event, processes it and starts a relay
+ * pulse if the transition requests a button press. A sequence of presses is
+ * sent as pulses separated by gaps of the same length. Commands are refused
+ * while a press or sequence is still being sent, since the opener would count
+ * fewer presses than the state machine. Publishing is left to the caller
+ * through the returned actions.
+ *
+ * @param ctrl Pointer to controller context
+ * @param input The input to handle
+ * @return Result of the transition (state_changed is false for ignored inputs)
+ */
+garage_transition_result_t garage_controller_handle_input(garage_controller_t* ctrl, garage_input_t input);
+
+/**
+ * @brief Advance controller time: relay pulse and state machine timeout
+ * @param ctrl Pointer to controller context
+ * @param delta_ms Time elapsed since the last tick in milliseconds
+ * @return Result if timeout caused a state transition, otherwise state_changed will be false
+ */
+garage_transition_result_t garage_controller_tick(garage_controller_t* ctrl, int delta_ms);
+
+/**
+ * @brief Advance controller time to now if a tick period has passed
+ *
+ * For a single owner task that both handles inputs and keeps time: it blocks
+ * on its queue for at most garage_controller_ms_until_tick() and calls this
+ * after every wake-up, so no other task touches the controller. Whole
+ * milliseconds are ticked and the remainder carried over, so time does not drift.
+ *
+ * @param ctrl Pointer to controller context
+ * @param now_us Current GPIO HAL time in microseconds
+ * @return Result of garage_controller_tick(), or no change if less than a period has passed
+ */
+garage_transition_result_t garage_controller_tick_to(garage_controller_t* ctrl, int64_t now_us);
+
+/**
+ * @brief Get how long the owner task may block before the next tick is due
+ * @param ctrl Pointer to controller context
+ * @param now_us Current GPIO HAL time in microseconds
+ * @return Milliseconds until the next tick (0 if due)
+ */
+int garage_controller_ms_until_tick(const garage_controller_t* ctrl, int64_t now_us);
+
+/**
+ * @brief Check whether the position estimate is due for publishing
+ *
+ * Due when the estimate has moved by at least the configured step since the
+ * last published value, or has reached an endpoint. The owner task calls this
+ * after handling an input or ticking and publishes when it returns true.
+ * Nothing is recorded until garage_controller_position_published(), so a
+ * publish that fails is retried on the next call.
+ *
+ * @param ctrl Pointer to controller context
+ * @param position Receives the position to publish (percent, 0 closed)
+ * @return true if the position should be published
+ */
+bool garage_controller_poll_position(garage_controller_t* ctrl, int* position);
+
+/**
+ * @brief Record a position as published
+ *
+ * GARAGE_INPUT_MQTT_CONNECTED forgets it again, so the next poll publishes
+ * the current position to the new session.
+ *
+ * @param ctrl Pointer to controller context
+ * @param position Position handed out by garage_controller_poll_position()
+ */
+void garage_controller_position_published(garage_controller_t* ctrl, int position);
+
+/**
+ * @brief Take a snapshot of the controller
+ * @param ctrl Pointer to controller context
+ * @param snapshot Receives the snapshot
+ */
+void garage_controller_get_snapshot(const garage_controller_t* ctrl, garage_controller_snapshot_t* snapshot);
+
+/**
+ * @brief Get current door state
+ * @param ctrl Pointer to controller context
+ * @return Current state
+ */
+garage_state_t garage_controller_get_state(const garage_controller_t* ctrl);
+
+/**
+ * @brief Get the time of the most recent state change
+ * @param ctrl Pointer to controller context
+ * @return GPIO HAL timestamp in microseconds (init time if no change yet)
+ */
+int64_t garage_controller_get_last_transition_us(const garage_controller_t* ctrl);
+
+/**
+ * @brief Get the number of state changes since init
+ * @param ctrl Pointer to controller context
+ * @return Transition count
+ */
+uint32_t garage_controller_get_transition_count(const garage_controller_t* ctrl);
+
+/**
+ * @brief Check if the relay is currently pressed
+ * @param ctrl Pointer to controller context
+ * @return true while a relay pulse is in progress (false in the gaps of a press sequence)
+ */
+bool garage_controller_is_relay_active(const garage_controller_t* ctrl);
+
+/**
+ * @brief Check if a press or press sequence is still being sent
+ * @param ctrl Pointer to controller context
+ * @return true from the start of the first pulse to the release of the last
+ */
+bool garage_controller_is_pressing(const garage_controller_t* ctrl);
+
+/**
+ * @brief Convert an input to the state machine event it represents
+ * @param input The input to convert
+ * @param sensor_level The reed switch level if input is GARAGE_INPUT_REED_SWITCH, otherwise ignored
+ * @return The corresponding garage event
+ */
+garage_event_t garage_input_to_event(garage_input_t input, int sensor_level);
+
+/**
+ * @brief Convert input to string for logging
+ * @param input The input to convert
+ * @return String representation
+ */
+const char* garage_input_to_string(garage_input_t input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GARAGE_CONTROLLER_H */
@@ -0,0 +1,96 @@
+/**
+ * @file garage_scenario.h
+ * @brief Data-driven door scenarios - runs on device in real time or on the host in virtual time.
+ *
+ * A scenario is a table of steps (input, delay, expected state). The runner
+ * injects each input, lets delay_ms elapse through the platform's wait
+ * function and then checks the state. Timing comes from the runner ops, so
+ * the same tables run against FreeRTOS delays on the device and against a
+ * virtual millisecond clock on the host.
+ */
+
+#ifndef GARAGE_SCENARIO_H
+#define GARAGE_SCENARIO_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "garage_state_machine.h"
+#include "garage_controller.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GARAGE_SCENARIO_MAX_STEPS 32
+
+/**
+ * @brief One scenario step
+ */
+typedef struct {
+    garage_input_t input;            // Input to inject (GARAGE_INPUT_NONE only waits)
+    int delay_ms;                    // Time allowed to elapse before checking
+    garage_state_t expected_state;   // State expected once delay_ms has elapsed
+} garage_scenario_step_t;
+
+/**
+ * @brief A named sequence of steps
+ */
+typedef struct {
+    const char* name;
+    const garage_scenario_step_t* steps;
+    int step_count;
+} garage_scenario_t;
+
+/**
+ * @brief Platform hooks used by the runner
+ */
+typedef struct {
+    void (*inject)(garage_input_t input, void* ctx);        // Deliver an input to the controller
+    void (*wait_ms)(int delay_ms, void* ctx);               // Let time pass (real or virtual)
+    int64_t (*now_us)(void* ctx);                           // Current timestamp
+    garage_state_t (*get_state)(void* ctx);                 // Current door state
+    int64_t (*last_transition_us)(void* ctx);               // Timestamp of the last state change
+    uint32_t (*transition_count)(void* ctx);                // Number of state changes so far
+    void* ctx;                                              // Passed to every hook
+} garage_scenario_ops_t;
+
+/**
+ * @brief Outcome of one step
+ */
+typedef struct {
+    bool passed;                     // State matched expected_state
+    garage_state_t actual_state;     // State observed after the delay
+    int64_t latency_us;              // Step start to last state change, -1 if no change during the step
+} garage_scenario_step_report_t;
+
+/**
+ * @brief Outcome of a scenario
+ */
+typedef struct {
+    int steps_run;
+    int steps_failed;
+    int64_t max_latency_us;          // Largest per-step latency (-1 if no step changed state)
+    garage_scenario_step_report_t steps[GARAGE_SCENARIO_MAX_STEPS];
+} garage_scenario_report_t;
+
+/**
+ * @brief Run a scenario
+ * @param scenario Scenario to run (steps beyond GARAGE_SCENARIO_MAX_STEPS are ignored)
+ * @param ops Platform hooks
+ * @param report Filled with per-step results
+ * @return Number of failed steps
+ */
+int garage_scenario_run(const garage_scenario_t* scenario, const garage_scenario_ops_t* ops,
+                        garage_scenario_report_t* report);
+
+/**
+ * @brief Built-in scenario suite shared by TEST_MODE and the host tests
+ */
+extern const garage_scenario_t garage_scenarios[];
+extern const int garage_scenario_count;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GARAGE_SCENARIO_H */
@@ -0,0 +1,199 @@
+/**
+ * @file garage_schedule.h
+ * @brief Scheduled door behaviours on a timer wheel - pure C, no allocation.
+ *
+ * Rules are set by id from MQTT as short text:
+ *
+ *   auto_close <minutes>        close the door once it has been open this long
+ *   reminder <minutes>          remind every <minutes> while the door is open
+ *   lockout <HH:MM> <HH:MM>     refuse OPEN commands in this local time window
+ *
+ * An empty rule deletes the id. "Open" means OPEN or STOPPED. Auto-close is
+ * suspended after an obstruction or a failed close, until a close succeeds;
+ * a suspended auto-close is reported instead of issued. Every rule owns
+ * one timer in a single hashed timer wheel ticked in seconds by the controller
+ * owner, so adding, replacing and deleting a rule is O(1). Lockout windows
+ * need the local time of day; until it is known no window is active.
+ */
+
+#ifndef GARAGE_SCHEDULE_H
+#define GARAGE_SCHEDULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "garage_controller.h"
+#include "timer_wheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GARAGE_SCHEDULE_MAX_RULES       32
+#define GARAGE_SCHEDULE_ID_MAX          16      // Rule id: 1..16 of [A-Za-z0-9_-]
+#define GARAGE_SCHEDULE_TIME_UNKNOWN    (-1)
+#define GARAGE_SCHEDULE_DAY_S           86400
+
+/**
+ * @brief Rule kinds
+ */
+typedef enum {
+    GARAGE_RULE_AUTO_CLOSE = 0,
+    GARAGE_RULE_REMINDER,
+    GARAGE_RULE_LOCKOUT
+} garage_rule_kind_t;
+
+/**
+ * @brief One rule and its timer
+ */
+typedef struct {
+    bool in_use;
+    char id[GARAGE_SCHEDULE_ID_MAX + 1];
+    garage_rule_kind_t kind;
+    uint32_t period_s;              // AUTO_CLOSE and REMINDER
+    int32_t start_s;                // LOCKOUT window start, seconds of day
+    int32_t end_s;                  // LOCKOUT window end (exclusive; before start wraps midnight)
+    bool inside;                    // LOCKOUT window currently active
+    timer_wheel_timer_t timer;
+} garage_rule_t;
+
+/**
+ * @brief What a rule asks the owner to do or report
+ */
+typedef enum {
+    GARAGE_SCHEDULE_EVENT_AUTO_CLOSE = 0,   // Issue CLOSE
+    GARAGE_SCHEDULE_EVENT_REMINDER,
+    GARAGE_SCHEDULE_EVENT_LOCKOUT_START,
+    GARAGE_SCHEDULE_EVENT_LOCKOUT_END,
+    GARAGE_SCHEDULE_EVENT_REFUSED,          // A command was refused by a lockout
+    GARAGE_SCHEDULE_EVENT_AUTO_CLOSE_SUSPENDED  // Auto-close due but not issued: the last close failed
+} garage_schedule_event_kind_t;
+
+/**
+ * @brief Event (self-contained: the rule may change afterwards)
+ */
+typedef struct {
+    garage_schedule_event_kind_t kind;
+    char rule_id[GARAGE_SCHEDULE_ID_MAX + 1];
+    uint32_t open_s;                // AUTO_CLOSE, AUTO_CLOSE_SUSPENDED and REMINDER: how long the door has been open
+    garage_input_t input;           // REFUSED: the command
+} garage_schedule_event_t;
+
+/**
+ * @brief Outcome of setting a rule
+ */
+typedef enum {
+    GARAGE_SCHEDULE_SET = 0,
+    GARAGE_SCHEDULE_DELETED,
+    GARAGE_SCHEDULE_BAD_ID,
+    GARAGE_SCHEDULE_BAD_RULE,
+    GARAGE_SCHEDULE_FULL
+} garage_schedule_status_t;
+
+/**
+ * @brief Scheduler state
+ */
+typedef struct {
+    timer_wheel_t wheel;
+    garage_rule_t rules[GARAGE_SCHEDULE_MAX_RULES];
+    bool door_open;
+    uint32_t open_since_s;
+    bool auto_close_suspended;      // Obstructed or the last close failed: auto-close is reported, not issued
+    bool clock_known;
+    uint32_t day_offset_s;          // Seconds of day = (now_s + day_offset_s) % GARAGE_SCHEDULE_DAY_S
+    uint32_t dropped_events;        // Events that did not fit the caller's array
+} garage_schedule_t;
+
+/**
+ * @brief Initialize with no rules, door closed and the time of day unknown
+ * @param sched Scheduler
+ * @param now_s Monotonic time in seconds
+ */
+void garage_schedule_init(garage_schedule_t* sched, uint32_t now_s);
+
+/**
+ * @brief Add, replace or delete a rule
+ * @param sched Scheduler
+ * @param id Rule id bytes (not NUL-terminated)
+ * @param id_len Id length
+ * @param text Rule text (not NUL-terminated); empty deletes the rule
+ * @param text_len Text length
+ * @param now_s Monotonic time in seconds
+ * @return Outcome
+ */
+garage_schedule_status_t garage_schedule_set_rule(garage_schedule_t* sched, const char* id, int id_len,
+                                                  const char* text, int text_len, uint32_t now_s);
+
+/**
+ * @brief Follow the door state (arms and cancels the open-door timers)
+ * @param sched Scheduler
+ * @param state Current state
+ * @param now_s Monotonic time in seconds
+ */
+void garage_schedule_on_state(garage_schedule_t* sched, garage_state_t state, uint32_t now_s);
+
+/**
+ * @brief Suspend or resume auto-close
+ *
+ * The owner suspends it while the door is obstructed or after a failed close,
+ * and resumes it once a close succeeds, by the schedule or by hand. Reminders
+ * are not affected.
+ *
+ * @param sched Scheduler
+ * @param suspended Whether a due auto-close becomes AUTO_CLOSE_SUSPENDED
+ */
+void garage_schedule_suspend_auto_close(garage_schedule_t* sched, bool suspended);
+
+/**
+ * @brief Set the local time of day
+ *
+ * A value within 2 s of the current one is ignored, so this can be called
+ * periodically; a jump re-arms the lockout windows.
+ *
+ * @param sched Scheduler
+ * @param seconds_of_day 0..86399, or GARAGE_SCHEDULE_TIME_UNKNOWN
+ * @param now_s Monotonic time in seconds
+ */
+void garage_schedule_set_time_of_day(garage_schedule_t* sched, int32_t seconds_of_day, uint32_t now_s);
+
+/**
+ * @brief Advance the wheel and collect due events
+ * @param sched Scheduler
+ * @param now_s Monotonic time in seconds
+ * @param events Receives events
+ * @param max_events Capacity (extra events are counted in dropped_events)
+ * @return Number of events written
+ */
+int garage_schedule_tick(garage_schedule_t* sched, uint32_t now_s, garage_schedule_event_t* events, int max_events);
+
+/**
+ * @brief Check a command against the active lockouts
+ * @param sched Scheduler
+ * @param input Command
+ * @param refused Receives a REFUSED event when the command is refused (may be NULL)
+ * @return true if the command may go ahead
+ */
+bool garage_schedule_check_command(const garage_schedule_t* sched, garage_input_t input,
+                                   garage_schedule_event_t* refused);
+
+/**
+ * @brief Format an event as JSON, e.g. {"rule":"evening","event":"auto_close","open_s":600}
+ * @param event Event
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer was too small
+ */
+int garage_schedule_event_to_json(const garage_schedule_event_t* event, char* buf, size_t size);
+
+/**
+ * @brief Convert a set-rule outcome to string for logging and publishing
+ * @param status Outcome
+ * @return "set", "deleted", "bad_id", "bad_rule" or "full"
+ */
+const char* garage_schedule_status_to_string(garage_schedule_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GARAGE_SCHEDULE_H
@@ -10,11 +10,17 @@
 #define GARAGE_STATE_MACHINE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define GARAGE_POSITION_CLOSED   0
+#define GARAGE_POSITION_OPEN     100
+#define GARAGE_POSITION_UNKNOWN  (-1)
+
 /**
  * @brief Garage door states
  */
@@ -23,9 +29,21 @@ typedef enum {
     GARAGE_STATE_OPEN,
     GARAGE_STATE_CLOSING,
     GARAGE_STATE_OPENING,
-    GARAGE_STATE_UNKNOWN
+    GARAGE_STATE_UNKNOWN,
+    GARAGE_STATE_STOPPED        // Stopped part way by a STOP command
 } garage_state_t;
 
+/**
+ * @brief Evidence for the most recent obstruction
+ */
+typedef enum {
+    GARAGE_OBSTRUCTION_NONE = 0,
+    GARAGE_OBSTRUCTION_FLOOR_REVERSAL,  // Reed switch opened again just after a close
+    GARAGE_OBSTRUCTION_CLOSE_OVERDUE,   // Close took well over the learned travel time
+    GARAGE_OBSTRUCTION_CLOSE_TIMEOUT,   // Close timed out without an earlier signature
+    GARAGE_OBSTRUCTION_REOPENED         // Distance sensor saw the door back at the open end during a close
+} garage_obstruction_t;
+
 /**
  * @brief Input events to the state machine
  */
@@ -35,7 +53,10 @@ typedef enum {
     GARAGE_EVENT_SENSOR_OPEN,       // Reed switch indicates door not closed
     GARAGE_EVENT_COMMAND_OPEN,      // MQTT command to open
     GARAGE_EVENT_COMMAND_CLOSE,     // MQTT command to close
-    GARAGE_EVENT_TIMER_EXPIRED      // Timeout timer expired
+    GARAGE_EVENT_TIMER_EXPIRED,     // Timeout timer expired
+    GARAGE_EVENT_COMMAND_STOP,      // MQTT command to stop a moving door
+    GARAGE_EVENT_DISTANCE_OPEN,     // Distance sensor sees the door at the open end
+    GARAGE_EVENT_DISTANCE_CLEAR     // Distance sensor no longer sees the door at the open end
 } garage_event_t;
 
 /**
@@ -45,6 +66,8 @@ typedef struct {
     bool publish_state;          // Should publish new state to MQTT
     bool trigger_button_press;   // Should trigger the relay/button press
     bool start_timeout_timer;    // Should start the timeout timer
+    int button_presses;          // Presses in the sequence (1 when trigger_button_press, 3 to turn a stopped door around)
+    bool publish_attributes;     // Obstruction flag or counts changed
 } garage_actions_t;
 
 /**
@@ -60,7 +83,10 @@ typedef struct {
  * @brief State machine configuration
  */
 typedef struct {
-    int timeout_ms;  // Timeout for OPENING/CLOSING states in milliseconds
+    int timeout_ms;       // Timeout for OPENING/CLOSING states in milliseconds
+    int open_travel_ms;   // Full travel time upwards for position estimation (<= 0 uses the default)
+    int close_travel_ms;  // Full travel time downwards, refined by measured closes (<= 0 uses the default)
+    int reversal_window_ms; // An open edge this soon after a close is a reversal (<= 0 uses the default)
 } garage_sm_config_t;
 
 /**
@@ -71,8 +97,66 @@ typedef struct {
     int timeout_ms;           // Configured timeout duration
     int timer_elapsed_ms;     // Current timer elapsed time
     bool timer_active;             // Whether timer is currently running
+    int open_travel_ms;       // Full travel time upwards
+    int close_travel_ms;      // Full travel time downwards (learned)
+    int position;             // Position outside of OPENING/CLOSING, or GARAGE_POSITION_UNKNOWN
+    int motion_start_position; // Position when the current OPENING/CLOSING started
+    bool motion_held;         // Multi-press sequence still being sent: the motion has not started yet
+    garage_state_t stopped_from; // OPENING or CLOSING: the motion a STOP interrupted
+    int reversal_window_ms;
+    int reversal_watch_ms;    // Time left in which an open edge after a close counts as a reversal
+    bool reversal_suspected;  // Open edge inside the watch; confirmed once the switch has stayed open long enough
+    int reversal_open_ms;     // Time the switch has stayed open since the suspected reversal
+    bool obstructed;          // Obstruction detected since the last close attempt started
+    garage_obstruction_t last_obstruction;
+    uint32_t obstruction_count; // Obstructions since init
+    uint32_t close_failures;  // Consecutive close attempts that ended obstructed
 } garage_state_machine_t;
 
+/**
+ * @brief Press cycle
+ *
+ * The opener has a single button that cycles open -> stop -> close -> stop.
+ * STOP presses once while OPENING or CLOSING and is ignored otherwise. From
+ * STOPPED, the next press moves the door against the interrupted motion, so
+ * a command in that direction is one press. A command the other way is three
+ * presses: the door briefly reverses, stops, then moves as commanded. Only
+ * the reed switch can report a door closed by hand while STOPPED.
+ *
+ * The commanded motion starts when the last press of a sequence is released,
+ * so for a multi-press sequence the position estimate is held until then and
+ * the timer restarts from garage_sm_start_motion(). The timeout still runs
+ * while the sequence is sent.
+ */
+
+/**
+ * @brief Obstruction detection
+ *
+ * With one reed switch at the closed end, an auto-reversing opener leaves
+ * timing signatures rather than a state. A reversal off the floor shows as
+ * the switch opening again within the reversal window of a close. A reversal
+ * mid-travel shows as a close running well over the learned travel time,
+ * counted from the last press of the sequence that started it.
+ * When no signature comes first, the close timeout itself is the signature.
+ * Each one sets the obstructed flag at once and bumps the counts, with
+ * publish_attributes set; the state transitions are unchanged. The flag
+ * clears when the next close starts or the door closes. A close flagged as
+ * overdue that still reaches the switch was just slow, so its flag and counts
+ * are retracted. With a distance sensor, a close that ends with the door seen
+ * back at the open end is a reversal as well.
+ */
+
+/**
+ * @brief Distance sensor fusion
+ *
+ * An optional distance sensor reports when the door is at the open end. The
+ * reed switch stays the only authority for closed. The open end ends OPENING,
+ * STOPPED and UNKNOWN in OPEN, so the position is measured rather than timed
+ * out. The door leaving the open end while OPEN is a close from the wall
+ * button and moves to CLOSING, which starts the timer and a full-travel
+ * measurement as a commanded close would.
+ */
+
 /**
  * @brief Initialize the state machine with default config (15 second timeout)
  * @param sm Pointer to state machine context
@@ -108,6 +192,30 @@ garage_transition_result_t garage_sm_process_event(garage_state_machine_t* sm, g
  */
 garage_state_t garage_sm_get_state(const garage_state_machine_t* sm);
 
+/**
+ * @brief The last press of a multi-press sequence was released: the commanded motion starts now
+ *
+ * Restarts the timer, so the position estimate, the overdue and timeout
+ * budgets and the learned travel time count from here. Does nothing unless
+ * a multi-press sequence is pending.
+ *
+ * @param sm Pointer to state machine context
+ */
+void garage_sm_start_motion(garage_state_machine_t* sm);
+
+/**
+ * @brief Obstructions that can no longer be retracted
+ *
+ * obstruction_count includes an overdue close as soon as it is flagged, and
+ * drops it again if the door still reaches the switch. This count leaves it
+ * out until the close ends some other way (timeout, reversal, stop), so a
+ * record made when it goes up is never withdrawn.
+ *
+ * @param sm Pointer to state machine context
+ * @return Confirmed obstructions since init
+ */
+uint32_t garage_sm_confirmed_obstruction_count(const garage_state_machine_t* sm);
+
 /**
  * @brief Update the internal timer (call periodically or for testing)
  * 
@@ -134,6 +242,46 @@ bool garage_sm_is_timer_active(const garage_state_machine_t* sm);
  */
 int garage_sm_get_timer_elapsed(const garage_state_machine_t* sm);
 
+/**
+ * @brief Get the direction the next button press will move the door
+ * @param sm Pointer to state machine context
+ * @return GARAGE_STATE_OPENING or GARAGE_STATE_CLOSING, or GARAGE_STATE_UNKNOWN if it cannot be predicted
+ */
+garage_state_t garage_sm_next_press_direction(const garage_state_machine_t* sm);
+
+/**
+ * @brief Get the estimated door position
+ *
+ * While OPENING or CLOSING the position is interpolated from the timer and the
+ * travel time for that direction, and held within 1..99: only the reed switch,
+ * the distance sensor or the timeout resolves an endpoint. A full close ended by the reed switch
+ * updates the learned close travel time. After a timeout to UNKNOWN the last
+ * estimate is kept.
+ *
+ * @param sm Pointer to state machine context
+ * @return Position in percent (0 closed, 100 open), or GARAGE_POSITION_UNKNOWN
+ */
+int garage_sm_get_position(const garage_state_machine_t* sm);
+
+/**
+ * @brief Format the obstruction attributes as JSON
+ *
+ * {"obstructed":bool,"last_obstruction":"...","obstructions":n,"close_failures":n}
+ *
+ * @param sm Pointer to state machine context
+ * @param buf Output buffer (always NUL-terminated if size > 0)
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer was too small
+ */
+int garage_sm_attributes_to_json(const garage_state_machine_t* sm, char* buf, size_t size);
+
+/**
+ * @brief Convert obstruction evidence to string for publishing
+ * @param obstruction The evidence to convert
+ * @return String representation (lowercase for MQTT)
+ */
+const char* garage_obstruction_to_string(garage_obstruction_t obstruction);
+
 /**
  * @brief Convert state to string for publishing
  * @param state The state to convert
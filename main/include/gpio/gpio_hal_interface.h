@@ -0,0 +1,106 @@
+/**
+ * @file gpio_hal_interface.h
+ * @brief Hardware Abstraction Layer for ESP8266 GPIO functions
+ *
+ * This interface abstracts all GPIO driver calls used by the application
+ * (pin configuration, level reads/writes, edge interrupts and timestamps),
+ * allowing the ISR -> queue -> state machine -> relay path to run on the host
+ * against a simulated implementation without requiring actual hardware.
+ */
+
+#ifndef GPIO_HAL_INTERFACE_H
+#define GPIO_HAL_INTERFACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Interrupt handler signature for GPIO edges
+ * @param arg Argument passed to gpio_hal_isr_handler_add()
+ */
+typedef void (*gpio_hal_isr_t)(void* arg);
+
+/**
+ * @brief Edges that trigger an input interrupt
+ */
+typedef enum {
+    GPIO_HAL_EDGE_NONE = 0,    /**< Interrupt disabled */
+    GPIO_HAL_EDGE_RISING,      /**< Low -> high transitions */
+    GPIO_HAL_EDGE_FALLING,     /**< High -> low transitions */
+    GPIO_HAL_EDGE_ANY          /**< Both transitions */
+} gpio_hal_edge_t;
+
+/* ============================================================================
+ * GPIO Configuration HAL Functions
+ * ============================================================================ */
+
+/**
+ * @brief Configure pins as push-pull outputs with no pulls
+ * @param pin_bit_mask Bit mask of the pins to configure (bit N = GPIO N)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gpio_hal_config_output(uint32_t pin_bit_mask);
+
+/**
+ * @brief Configure pins as inputs
+ * @param pin_bit_mask Bit mask of the pins to configure (bit N = GPIO N)
+ * @param edge Edges that raise an interrupt
+ * @param pull_up Enable the internal pull-up
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gpio_hal_config_input(uint32_t pin_bit_mask, gpio_hal_edge_t edge, bool pull_up);
+
+/**
+ * @brief Install the GPIO interrupt service
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gpio_hal_install_isr_service(void);
+
+/**
+ * @brief Hook an interrupt handler to a pin
+ * @param gpio_num GPIO number
+ * @param handler Handler invoked from interrupt context on every configured edge
+ * @param arg Argument passed to the handler
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gpio_hal_isr_handler_add(int gpio_num, gpio_hal_isr_t handler, void* arg);
+
+/* ============================================================================
+ * GPIO Level HAL Functions
+ * ============================================================================ */
+
+/**
+ * @brief Drive an output pin
+ * @param gpio_num GPIO number
+ * @param level 0 for low, 1 for high
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gpio_hal_set_level(int gpio_num, int level);
+
+/**
+ * @brief Read a pin level
+ * @param gpio_num GPIO number
+ * @return 0 for low, 1 for high
+ */
+int gpio_hal_get_level(int gpio_num);
+
+/* ============================================================================
+ * Time HAL Functions
+ * ============================================================================ */
+
+/**
+ * @brief Get a monotonic timestamp for edge and latency measurements
+ * @return Microseconds since boot (or since simulator reset)
+ */
+int64_t gpio_hal_get_time_us(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPIO_HAL_INTERFACE_H
@@ -0,0 +1,206 @@
+/**
+ * @file history_log.h
+ * @brief Door audit trail in a flash ring - pure C on the flash HAL, no allocation.
+ *
+ * Transitions, commands and faults are appended as fixed 16-byte records to
+ * a dedicated data partition used as a ring of 4 KB sectors. Records are
+ * batched in RAM and programmed together, and a sector is erased only when
+ * the ring wraps into it, so every sector wears at the same rate and an
+ * erase happens once per 256 records. Each record carries a sequence number
+ * and a CRC; on boot the newest valid record is found by reading the first
+ * record of each sector and then scanning one sector, so torn writes from a
+ * power cut are skipped rather than trusted.
+ *
+ * Record layout (little-endian):
+ *
+ *   0..3    seq       1, 2, 3, ... across reboots (0xFFFFFFFF = erased)
+ *   4..7    time_s    Seconds since boot (UTC for HISTORY_CLOCK)
+ *   8..9    boot      Boot number, 1 for the first boot the log has seen
+ *   10      kind      history_kind_t
+ *   11..13  args      Kind specific (see history_kind_t)
+ *   14..15  crc       CRC-16/CCITT-FALSE of bytes 0..13
+ */
+
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORY_RECORD_SIZE     16
+#define HISTORY_BATCH_RECORDS   16      // Records held in RAM before they are programmed
+#define HISTORY_PAGE_MAX        64      // Most records returned by one query
+#define HISTORY_PARTITION_LABEL "history"
+#define HISTORY_CBOR_VERSION    1       // First element of a CBOR page
+
+/**
+ * @brief Record kinds and their arguments
+ */
+typedef enum {
+    HISTORY_BOOT = 1,           // args: reset reason
+    HISTORY_TRANSITION,         // args: from state, to state
+    HISTORY_COMMAND,            // args: garage_input_t, 1 if accepted / 0 if refused, history_source_t
+    HISTORY_FAULT,              // args: history_fault_t, door state
+    HISTORY_CLOCK               // time_s: UTC seconds since 1970; args: seconds since boot, 24-bit little-endian
+} history_kind_t;
+
+/**
+ * @brief Where a command came from
+ */
+typedef enum {
+    HISTORY_SOURCE_REMOTE = 0,  // MQTT, HTTP or UDP (they share one queue)
+    HISTORY_SOURCE_SCHEDULE     // Auto-close rule
+} history_source_t;
+
+/**
+ * @brief Fault codes
+ */
+typedef enum {
+    HISTORY_FAULT_OBSTRUCTION = 1,
+    HISTORY_FAULT_MQTT_LOST
+} history_fault_t;
+
+/**
+ * @brief Decoded record
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t time_s;
+    uint16_t boot;
+    history_kind_t kind;
+    uint8_t args[3];
+} history_record_t;
+
+/**
+ * @brief Log state
+ */
+typedef struct {
+    bool ready;                 // Partition found and recovered
+    uint32_t capacity;          // Records the partition holds
+    uint32_t write_slot;        // Next record slot to program
+    uint32_t next_seq;
+    uint16_t boot;              // Stamped on records appended this boot
+    uint8_t batch[HISTORY_BATCH_RECORDS * HISTORY_RECORD_SIZE];    // Encoded, not yet programmed
+    int batch_count;
+    uint32_t flushes;           // Batches programmed
+    uint32_t write_errors;      // Batches lost to a failed erase or write
+} history_log_t;
+
+/**
+ * @brief Open the partition and recover the write position and sequence number
+ * @param log Log
+ * @param label Partition label
+ * @return ESP_OK, ESP_ERR_NOT_FOUND without the partition, ESP_ERR_INVALID_SIZE if it is under two sectors
+ */
+esp_err_t history_log_init(history_log_t* log, const char* label);
+
+/**
+ * @brief Append a record to the batch, programming the batch once it is full
+ * @param log Log
+ * @param kind Kind
+ * @param time_s Seconds since boot
+ * @param arg0 First argument
+ * @param arg1 Second argument
+ * @param arg2 Third argument
+ * @return Sequence number given to the record, or 0 if the log is not ready
+ */
+uint32_t history_log_append(history_log_t* log, history_kind_t kind, uint32_t time_s,
+                            uint8_t arg0, uint8_t arg1, uint8_t arg2);
+
+/**
+ * @brief Program the batched records
+ *
+ * A sector is erased just before its first record is programmed. If the
+ * erase or write fails the batch is dropped and counted in write_errors.
+ *
+ * @param log Log
+ * @return ESP_OK (also when there was nothing to do), or the flash error
+ */
+esp_err_t history_log_flush(history_log_t* log);
+
+/**
+ * @brief Read records oldest first, including those not yet programmed
+ * @param log Log
+ * @param since_seq First sequence number wanted (older records are skipped)
+ * @param records Receives the records
+ * @param max_records Capacity
+ * @return Number of records written
+ */
+int history_log_read(history_log_t* log, uint32_t since_seq, history_record_t* records, int max_records);
+
+/**
+ * @brief Encode a record with its CRC
+ * @param record Record
+ * @param out 16 bytes
+ */
+void history_record_encode(const history_record_t* record, uint8_t out[HISTORY_RECORD_SIZE]);
+
+/**
+ * @brief Decode and check a record
+ * @param in 16 bytes
+ * @param record Receives the record
+ * @return false for erased flash or a bad CRC
+ */
+bool history_record_decode(const uint8_t in[HISTORY_RECORD_SIZE], history_record_t* record);
+
+/**
+ * @brief Parse a page request: "since=<seq>&n=<count>", either part optional, optionally after "history?"
+ * @param text Request bytes (not NUL-terminated)
+ * @param len Length
+ * @param since_seq Receives the first sequence number (0 if absent)
+ * @param count Receives the page size, 1..HISTORY_PAGE_MAX (HISTORY_PAGE_MAX if absent)
+ * @return false for unknown keys or bad numbers
+ */
+bool history_log_parse_query(const char* text, int len, uint32_t* since_seq, int* count);
+
+/**
+ * @brief Format a record as JSON, e.g. {"seq":7,"boot":2,"t":61,"kind":"transition","from":"closed","to":"opening"}
+ * @param record Record
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer was too small
+ */
+int history_record_to_json(const history_record_t* record, char* buf, size_t size);
+
+/**
+ * @brief Format a page of records as JSON: {"records":[...],"next":N,"last":true}
+ * @param records Records, as history_record_to_json() formats them
+ * @param count Number of records
+ * @param next Sequence number to ask for to carry on
+ * @param last Whether this is the final chunk of the query
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer was too small
+ */
+int history_page_to_json(const history_record_t* records, int count, uint32_t next, bool last,
+                         char* buf, size_t size);
+
+/**
+ * @brief Encode a page of records as CBOR with a fixed positional schema
+ *
+ *   [HISTORY_CBOR_VERSION, next, last, [[seq, boot, time_s, kind, arg0, arg1, arg2], ...]]
+ *
+ * The kind and arguments are the raw record values (see history_kind_t).
+ *
+ * @param records Records
+ * @param count Number of records
+ * @param next Sequence number to ask for to carry on
+ * @param last Whether this is the final chunk of the query
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Bytes written, or -1 if the buffer was too small
+ */
+int history_page_to_cbor(const history_record_t* records, int count, uint32_t next, bool last,
+                         uint8_t* buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_LOG_H
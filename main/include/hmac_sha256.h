@@ -0,0 +1,79 @@
+/**
+ * @file hmac_sha256.h
+ * @brief SHA-256 and HMAC-SHA256 - pure C, no allocation.
+ *
+ * Small enough for frame authentication on the ESP8266 (which has no SHA
+ * hardware) and identical on the host, so signed frames can be checked in
+ * tests byte for byte.
+ */
+
+#ifndef HMAC_SHA256_H
+#define HMAC_SHA256_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SHA256_BLOCK_LEN    64
+#define SHA256_DIGEST_LEN   32
+
+/**
+ * @brief Incremental SHA-256 state
+ */
+typedef struct {
+    uint32_t h[8];
+    uint64_t total_len;                 // Bytes hashed so far
+    uint8_t block[SHA256_BLOCK_LEN];    // Pending partial block
+    size_t block_len;
+} sha256_t;
+
+/**
+ * @brief Start a hash
+ * @param ctx Hash state
+ */
+void sha256_init(sha256_t* ctx);
+
+/**
+ * @brief Hash more bytes
+ * @param ctx Hash state
+ * @param data Bytes
+ * @param len Number of bytes
+ */
+void sha256_update(sha256_t* ctx, const void* data, size_t len);
+
+/**
+ * @brief Finish the hash
+ * @param ctx Hash state (must be re-initialized before reuse)
+ * @param digest Receives the digest
+ */
+void sha256_final(sha256_t* ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+
+/**
+ * @brief Compute HMAC-SHA256 (RFC 2104)
+ * @param key Key bytes (keys longer than a block are hashed first)
+ * @param key_len Key length
+ * @param data Message bytes
+ * @param len Message length
+ * @param mac Receives the MAC
+ */
+void hmac_sha256(const uint8_t* key, size_t key_len, const void* data, size_t len,
+                 uint8_t mac[SHA256_DIGEST_LEN]);
+
+/**
+ * @brief Compare two MACs in time independent of their contents
+ * @param a First MAC
+ * @param b Second MAC
+ * @param len Bytes to compare (a truncated MAC compares its prefix)
+ * @return true if equal
+ */
+bool hmac_sha256_equal(const uint8_t* a, const uint8_t* b, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HMAC_SHA256_H
@@ -0,0 +1,96 @@
+/**
+ * @file http_control.h
+ * @brief LAN HTTP control endpoint - routing and responses, pure C, no allocation.
+ *
+ * Routes a parsed request and formats the complete response into a caller
+ * buffer. Commands are handed to a callback (the app posts them to the same
+ * state machine queue as MQTT commands) and state is read through a snapshot
+ * callback, so the endpoint never touches the controller itself.
+ *
+ *   GET  /state              200 {"state":"open","position":100,"obstructed":false}
+ *   POST /open, /close, /stop 202 when queued, 503 if the queue is full
+ *   GET  /metrics            200 Prometheus text exposition, the metrics registry included
+ *
+ * POST needs "Authorization: Bearer <token>" (401 otherwise); without a
+ * configured token POST is refused with 403. Every response closes the
+ * connection.
+ */
+
+#ifndef HTTP_CONTROL_H
+#define HTTP_CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "garage_controller.h"
+#include "http_request.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_CONTROL_TOKEN_MAX 64      // Longest accepted Bearer token
+
+/**
+ * @brief Hand a command to the controller owner
+ * @return true if queued, false if the queue is full
+ */
+typedef bool (*http_control_command_fn)(garage_input_t input, void* ctx);
+
+/**
+ * @brief Read the latest controller snapshot
+ */
+typedef void (*http_control_snapshot_fn)(garage_controller_snapshot_t* snapshot, void* ctx);
+
+/**
+ * @brief Endpoint configuration
+ */
+typedef struct {
+    const char* token;                      // Bearer token for POST; NULL or "" refuses POST
+    http_control_command_fn on_command;
+    http_control_snapshot_fn get_snapshot;
+    void* ctx;                              // Passed to both callbacks
+} http_control_config_t;
+
+/**
+ * @brief Endpoint state
+ */
+typedef struct {
+    http_control_config_t config;
+    uint32_t requests;              // Responses produced, errors included
+    uint32_t commands;              // Commands queued
+    uint32_t rejected;              // 4xx and 5xx responses
+} http_control_t;
+
+/**
+ * @brief Initialize the endpoint
+ * @param control Endpoint
+ * @param config Configuration (copied; the token must outlive the endpoint)
+ */
+void http_control_init(http_control_t* control, const http_control_config_t* config);
+
+/**
+ * @brief Route a request and format the response
+ * @param control Endpoint
+ * @param req Parsed request
+ * @param out Response buffer
+ * @param size Buffer size
+ * @return Response length, or -1 if the buffer was too small
+ */
+int http_control_handle(http_control_t* control, const http_request_t* req, char* out, size_t size);
+
+/**
+ * @brief Format an error response for a request that could not be parsed or read
+ * @param control Endpoint
+ * @param status 400, 408 or 431 (anything else is sent as 500)
+ * @param out Response buffer
+ * @param size Buffer size
+ * @return Response length, or -1 if the buffer was too small
+ */
+int http_control_error(http_control_t* control, int status, char* out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_CONTROL_H
@@ -0,0 +1,81 @@
+/**
+ * @file http_request.h
+ * @brief HTTP/1.x request parser - pure C, no allocation.
+ *
+ * Parses the request line and headers in place. The request holds slices
+ * pointing into the caller's buffer, so nothing is copied and the buffer must
+ * outlive the request. Only what the control endpoint needs is extracted:
+ * method, path, query, Content-Length and Authorization. Nothing is read past
+ * the given length.
+ */
+
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Request methods the endpoint distinguishes
+ */
+typedef enum {
+    HTTP_METHOD_OTHER = 0,      // Any other valid token (answered with 405)
+    HTTP_METHOD_GET,
+    HTTP_METHOD_POST
+} http_method_t;
+
+/**
+ * @brief Parse outcome
+ */
+typedef enum {
+    HTTP_PARSE_OK = 0,          // Request line and all headers parsed
+    HTTP_PARSE_INCOMPLETE,      // No blank line yet: read more (or give up if the buffer is full)
+    HTTP_PARSE_BAD_REQUEST      // Malformed request line or header
+} http_parse_result_t;
+
+/**
+ * @brief Length-delimited view into the request buffer
+ */
+typedef struct {
+    const char* ptr;
+    size_t len;
+} http_slice_t;
+
+/**
+ * @brief Parsed request
+ */
+typedef struct {
+    http_method_t method;
+    http_slice_t path;              // Target up to '?'
+    http_slice_t query;             // After '?', empty if none
+    http_slice_t authorization;     // Authorization header value, empty if absent
+    long content_length;            // -1 if absent
+    size_t header_len;              // Bytes up to and including the blank line
+} http_request_t;
+
+/**
+ * @brief Parse a request from the start of a buffer
+ * @param buf Received bytes
+ * @param len Number of bytes received so far
+ * @param req Receives the request (valid only for HTTP_PARSE_OK)
+ * @return Parse outcome
+ */
+http_parse_result_t http_request_parse(const char* buf, size_t len, http_request_t* req);
+
+/**
+ * @brief Compare a slice with a NUL-terminated string
+ * @param slice Slice
+ * @param str String
+ * @return true if equal in length and bytes
+ */
+bool http_slice_equals(http_slice_t slice, const char* str);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_REQUEST_H
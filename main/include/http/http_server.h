@@ -0,0 +1,60 @@
+/**
+ * @file http_server.h
+ * @brief Blocking single-connection HTTP server over lwIP (or POSIX) sockets.
+ *
+ * Connections are served one at a time from static request and response
+ * buffers, so nothing is allocated per request and at most one task may call
+ * http_server_serve_one(). A request must fit HTTP_SERVER_REQUEST_MAX bytes
+ * (431 otherwise) and arrive within HTTP_SERVER_REQUEST_TIMEOUT_MS of the
+ * connection being accepted (408), however slowly it trickles in. Request
+ * bodies are not read.
+ */
+
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <stdint.h>
+#include "http_control.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HTTP_SERVER_PORT                80
+#define HTTP_SERVER_REQUEST_MAX         512     // Request line plus headers
+#define HTTP_SERVER_RESPONSE_MAX        5120    // /metrics is the largest response
+#define HTTP_SERVER_REQUEST_TIMEOUT_MS  3000    // Whole request, not each read
+
+/**
+ * @brief Open a listening socket on all interfaces
+ * @param port TCP port (0 picks an ephemeral port)
+ * @return Socket, or -1 on failure
+ */
+int http_server_listen(uint16_t port);
+
+/**
+ * @brief Get the port a listening socket is bound to
+ * @param listen_fd Socket from http_server_listen()
+ * @return Port, or 0 on failure
+ */
+uint16_t http_server_port(int listen_fd);
+
+/**
+ * @brief Accept one connection, answer one request and close the connection
+ * @param listen_fd Socket from http_server_listen()
+ * @param control Endpoint the request is routed to
+ * @return HTTP status sent, 0 if the client closed before sending a request, -1 on socket error
+ */
+int http_server_serve_one(int listen_fd, http_control_t* control);
+
+/**
+ * @brief Close a listening socket
+ * @param listen_fd Socket from http_server_listen()
+ */
+void http_server_close(int listen_fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,94 @@
+/**
+ * @file latency_histogram.h
+ * @brief Fixed-size log-linear latency histogram - pure C, no allocation.
+ *
+ * Values are microseconds. Each power of two is split into 8 linear
+ * sub-buckets, so any recorded value is reported within 12.5% of its true
+ * value; 0..7 us are exact. Values above LATENCY_HISTOGRAM_MAX_US land in the
+ * last bucket and are counted as overflow. Min, max and sum are exact.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LATENCY_HISTOGRAM_SUB_BUCKETS   8
+#define LATENCY_HISTOGRAM_MAX_POW2      26      // Largest tracked power of two (2^27 - 1 us ~ 134 s)
+#define LATENCY_HISTOGRAM_BUCKETS       ((LATENCY_HISTOGRAM_MAX_POW2 - 1) * LATENCY_HISTOGRAM_SUB_BUCKETS)
+#define LATENCY_HISTOGRAM_MAX_US        ((INT64_C(1) << (LATENCY_HISTOGRAM_MAX_POW2 + 1)) - 1)
+
+/**
+ * @brief Histogram state
+ */
+typedef struct {
+    uint32_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t count;         // Recorded values
+    uint32_t overflow;      // Values above LATENCY_HISTOGRAM_MAX_US
+    int64_t min_us;
+    int64_t max_us;
+    int64_t sum_us;
+} latency_histogram_t;
+
+/**
+ * @brief Clear the histogram
+ * @param hist Histogram
+ */
+void latency_histogram_init(latency_histogram_t* hist);
+
+/**
+ * @brief Record one latency
+ * @param hist Histogram
+ * @param value_us Latency in microseconds (negative values are recorded as 0)
+ */
+void latency_histogram_record(latency_histogram_t* hist, int64_t value_us);
+
+/**
+ * @brief Get the bucket index a value falls into
+ * @param value_us Latency in microseconds
+ * @return Bucket index
+ */
+int latency_histogram_bucket(int64_t value_us);
+
+/**
+ * @brief Get the largest value a bucket holds
+ * @param bucket Bucket index
+ * @return Upper bound in microseconds
+ */
+int64_t latency_histogram_bucket_upper_us(int bucket);
+
+/**
+ * @brief Get a percentile
+ * @param hist Histogram
+ * @param per_mille Percentile in tenths of a percent (500 = p50, 999 = p99.9, 1000 = max)
+ * @return Upper bound of the bucket holding the percentile, capped at the exact maximum; 0 if empty
+ */
+int64_t latency_histogram_percentile(const latency_histogram_t* hist, int per_mille);
+
+/**
+ * @brief Get the mean
+ * @param hist Histogram
+ * @return Mean in microseconds, 0 if empty
+ */
+int64_t latency_histogram_mean(const latency_histogram_t* hist);
+
+/**
+ * @brief Format as JSON: summary statistics plus the non-empty buckets as [upper_us, count] pairs
+ * @param hist Histogram
+ * @param name Value of the "name" field
+ * @param buf Output buffer (always NUL-terminated if size > 0)
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer was too small
+ */
+int latency_histogram_to_json(const latency_histogram_t* hist, const char* name, char* buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,78 @@
+/**
+ * @file log_ring.h
+ * @brief In-RAM ring of recent log lines - pure C, no allocation.
+ *
+ * Log output arrives one character at a time, from the SDK's putchar hook.
+ * Characters are collected into a line, and a newline commits the line to
+ * the ring as a length byte followed by the text. Carriage returns and ANSI
+ * colour sequences are dropped, and empty lines are skipped.
+ *
+ * When the ring is full, the oldest lines are overwritten to make room, and
+ * they are counted. A reader that falls behind loses whole lines, never part
+ * of one. Every committed line has a sequence number, so a gap in the numbers
+ * shows how many lines were lost.
+ *
+ * Not thread-safe. Every task logs, so the firmware calls these functions
+ * inside a critical section.
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_RING_SIZE       2048    // Bytes of lines held, with one length byte each
+#define LOG_RING_LINE_MAX   160     // Longer lines are cut (at most 255: the length is one byte)
+
+/**
+ * @brief Ring state
+ */
+typedef struct {
+    uint8_t buf[LOG_RING_SIZE];
+    size_t head;                    // Where the next line is written
+    size_t tail;                    // Oldest line
+    size_t used;                    // Bytes held
+    char line[LOG_RING_LINE_MAX];   // Line being collected
+    size_t line_len;
+    bool line_cut;                  // The line being collected went over LOG_RING_LINE_MAX
+    bool in_escape;                 // Inside an ESC [ ... m sequence
+    uint32_t removed;               // Lines read or overwritten; the oldest held line is number removed + 1
+    uint32_t lines;                 // Lines committed
+    uint32_t overwritten;           // Lines lost to make room before they were read
+    uint32_t cut;                   // Lines cut to LOG_RING_LINE_MAX
+} log_ring_t;
+
+/**
+ * @brief Empty the ring
+ * @param ring Ring
+ */
+void log_ring_init(log_ring_t* ring);
+
+/**
+ * @brief Add one character of log output; a newline commits the line
+ * @param ring Ring
+ * @param ch Character
+ */
+void log_ring_putc(log_ring_t* ring, int ch);
+
+/**
+ * @brief Take the oldest line out of the ring
+ * @param ring Ring
+ * @param out Receives the line, NUL-terminated, without its newline
+ * @param size Buffer size (LOG_RING_LINE_MAX + 1 holds any line; shorter buffers cut it)
+ * @param seq Receives the line's sequence number, 1 for the first line (can be NULL)
+ * @return Length written, or -1 if the ring is empty
+ */
+int log_ring_pop(log_ring_t* ring, char* out, size_t size, uint32_t* seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_RING_H
@@ -0,0 +1,208 @@
+/**
+ * @file metrics.h
+ * @brief Statically declared counters, gauges and histograms - pure C, no allocation.
+ *
+ * Every metric is listed once in METRICS_SCALARS or METRICS_HISTOGRAMS below;
+ * the lists expand into the metric IDs, the storage and the export tables, so
+ * there is no registration at run time. Series sharing a name form one
+ * family, told apart by their labels ("key=value,key=value").
+ *
+ * Each series has exactly one writer: the task or ISR named in its comment.
+ * Where several tasks feed the same thing (a queue, say) each gets its own
+ * series. An update is then a plain read-modify-write of an aligned 32-bit
+ * word that nothing else writes, which is exact and lock-free on the
+ * single-core ESP8266, and readers never see a torn value. A histogram spans
+ * several words, so its writer brackets the update with a sequence count
+ * and readers retry a copy that changed under them (a seqlock with one
+ * writer).
+ *
+ * metrics_to_prometheus(), metrics_to_json() and metrics_to_cbor() export
+ * everything in one pass over the tables, from any task.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Counters and gauges: X(id, type, name, labels)
+ *
+ * The state_entries series follow garage_state_t order (see metrics_state_entries()).
+ */
+#define METRICS_SCALARS(X) \
+    X(WIFI_DISCONNECTS,     COUNTER, "garage_door_wifi_disconnects_total", "")                          /* WiFi event handler */ \
+    X(WIFI_CONNECTED,       GAUGE,   "garage_door_wifi_connected", "")                                  /* WiFi event handler */ \
+    X(MQTT_DISCONNECTS,     COUNTER, "garage_door_mqtt_disconnects_total", "")                          /* MQTT task */ \
+    X(MQTT_CONNECTED,       GAUGE,   "garage_door_mqtt_connected", "")                                  /* MQTT task */ \
+    X(INPUT_FULL_REED,      COUNTER, "garage_door_queue_full_total", "queue=input,source=reed_switch")  /* Reed switch ISR */ \
+    X(INPUT_FULL_MQTT,      COUNTER, "garage_door_queue_full_total", "queue=input,source=mqtt")         /* MQTT task */ \
+    X(INPUT_FULL_HTTP,      COUNTER, "garage_door_queue_full_total", "queue=input,source=http")         /* HTTP task */ \
+    X(INPUT_FULL_UDP,       COUNTER, "garage_door_queue_full_total", "queue=input,source=udp")          /* UDP task */ \
+    X(INPUT_FULL_DISTANCE,  COUNTER, "garage_door_queue_full_total", "queue=input,source=distance")     /* Timer task */ \
+    X(HISTORY_FULL_OWNER,   COUNTER, "garage_door_queue_full_total", "queue=history,source=state_machine") /* State machine task */ \
+    X(HISTORY_FULL_MQTT,    COUNTER, "garage_door_queue_full_total", "queue=history,source=mqtt")       /* MQTT task */ \
+    X(SCHEDULE_FULL_MQTT,   COUNTER, "garage_door_queue_full_total", "queue=schedule,source=mqtt")      /* MQTT task */ \
+    X(STATE_CLOSED,         COUNTER, "garage_door_state_entries_total", "state=closed")                 /* State machine task */ \
+    X(STATE_OPEN,           COUNTER, "garage_door_state_entries_total", "state=open")                   /* State machine task */ \
+    X(STATE_CLOSING,        COUNTER, "garage_door_state_entries_total", "state=closing")                /* State machine task */ \
+    X(STATE_OPENING,        COUNTER, "garage_door_state_entries_total", "state=opening")                /* State machine task */ \
+    X(STATE_UNKNOWN,        COUNTER, "garage_door_state_entries_total", "state=unknown")                /* State machine task */ \
+    X(STATE_STOPPED,        COUNTER, "garage_door_state_entries_total", "state=stopped")                /* State machine task */ \
+    X(SIGNED_ACCEPTED,      COUNTER, "garage_door_signed_commands_total", "result=accepted")            /* MQTT task */ \
+    X(SIGNED_REJECTED,      COUNTER, "garage_door_signed_commands_total", "result=rejected")            /* MQTT task */ \
+    X(LOG_SENT,             COUNTER, "garage_door_log_lines_total", "result=sent")                      /* Syslog task */ \
+    X(LOG_OVERWRITTEN,      COUNTER, "garage_door_log_lines_total", "result=overwritten")               /* Syslog task */ \
+    X(LOG_RATE_LIMITED,     COUNTER, "garage_door_log_lines_total", "result=rate_limited")              /* Syslog task */ \
+    X(LOG_UNSENT,           COUNTER, "garage_door_log_lines_total", "result=unsent")                    /* Syslog task */
+
+/**
+ * Histograms: X(id, name, upper bounds in microseconds, ascending)
+ */
+#define METRICS_HISTOGRAMS(X) \
+    X(INPUT_HANDLING,   "garage_door_input_handling_seconds",                                  /* State machine task */ \
+      200, 500, 1000, 2000, 5000, 10000, 50000, 200000) \
+    X(MQTT_CONNECT,     "garage_door_mqtt_connect_seconds",                                    /* MQTT task */ \
+      100000, 250000, 500000, 1000000, 2000000, 5000000, 10000000, 30000000)
+
+#define METRICS_HISTOGRAM_BOUNDS    8       // Upper bounds per histogram; one more bucket holds the rest
+#define METRICS_CBOR_VERSION        2       // First element of the CBOR payload
+
+/**
+ * @brief Metric kinds
+ */
+typedef enum {
+    METRIC_TYPE_COUNTER = 0,        // Only goes up (wraps at 2^32)
+    METRIC_TYPE_GAUGE               // Set to the current value
+} metric_type_t;
+
+/**
+ * @brief Counter and gauge IDs
+ */
+typedef enum {
+#define METRICS_ID(id, type, name, labels) METRIC_##id,
+    METRICS_SCALARS(METRICS_ID)
+#undef METRICS_ID
+    METRIC_COUNT
+} metric_id_t;
+
+/**
+ * @brief Histogram IDs
+ */
+typedef enum {
+#define METRICS_HISTOGRAM_ID(id, name, b0, b1, b2, b3, b4, b5, b6, b7) METRIC_HISTOGRAM_##id,
+    METRICS_HISTOGRAMS(METRICS_HISTOGRAM_ID)
+#undef METRICS_HISTOGRAM_ID
+    METRIC_HISTOGRAM_COUNT
+} metric_histogram_id_t;
+
+/**
+ * @brief Add one to a counter. Safe from the series' writer only, ISRs included.
+ * @param id Counter
+ */
+void metrics_inc(metric_id_t id);
+
+/**
+ * @brief Set a gauge, or a counter its writer keeps itself. Safe from the series' writer only.
+ * @param id Gauge
+ * @param value New value
+ */
+void metrics_set(metric_id_t id, int32_t value);
+
+/**
+ * @brief Get the counter for entries into a door state
+ * @param state garage_state_t value
+ * @return The state's STATE_* counter (STATE_UNKNOWN if out of range)
+ */
+metric_id_t metrics_state_entries(int state);
+
+/**
+ * @brief Read a counter or gauge
+ * @param id Metric
+ * @return Current value (gauges as the two's complement of their value)
+ */
+uint32_t metrics_get(metric_id_t id);
+
+/**
+ * @brief Record one value in a histogram. Safe from the histogram's writer only.
+ * @param id Histogram
+ * @param value_us Value in microseconds (negative values are recorded as 0)
+ */
+void metrics_observe(metric_histogram_id_t id, int64_t value_us);
+
+/**
+ * @brief Copy a histogram consistently
+ *
+ * A copy the writer changed meanwhile is retried a few times; a reader that
+ * keeps losing (it preempted the writer mid-update) returns the last copy,
+ * which is off by at most the one value being recorded.
+ *
+ * @param id Histogram
+ * @param buckets Receives METRICS_HISTOGRAM_BOUNDS + 1 per-bucket counts
+ * @param sum_us Receives the sum of the recorded values
+ * @return Number of recorded values
+ */
+uint32_t metrics_read_histogram(metric_histogram_id_t id, uint32_t* buckets, uint64_t* sum_us);
+
+/**
+ * @brief Zero every metric. For tests; the firmware never resets.
+ */
+void metrics_reset(void);
+
+/**
+ * @brief Write every metric as Prometheus text exposition
+ *
+ * One TYPE line per family. Histogram bounds and sums are in seconds.
+ *
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Characters written (excluding NUL), or -1 if the buffer is too small
+ */
+int metrics_to_prometheus(char* buf, size_t size);
+
+/**
+ * @brief Write every metric as one JSON object
+ *
+ * Names lose their "garage_door_" prefix. A family with labels becomes an
+ * object keyed by its label values joined with '.':
+ *
+ *   {"wifi_disconnects_total":2,...,"queue_full_total":{"input.mqtt":0,...},
+ *    "input_handling_seconds":{"le_us":[200,...],"buckets":[5,...],"count":9,"sum_us":4100},...}
+ *
+ * Histogram buckets are cumulative as in Prometheus, without the +Inf one
+ * (that is "count").
+ *
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Characters written (excluding NUL), or -1 if the buffer is too small
+ */
+int metrics_to_json(char* buf, size_t size);
+
+/**
+ * @brief Write every metric as CBOR with a fixed positional schema
+ *
+ * The names, labels and bounds are left out; both ends take them from the
+ * lists above, in list order:
+ *
+ *   [METRICS_CBOR_VERSION,
+ *    [scalar, ...],                                    counters unsigned, gauges signed
+ *    [[cumulative bucket x METRICS_HISTOGRAM_BOUNDS, count, sum_us], ...]]
+ *
+ * Adding or reordering series changes the schema, so it needs a new version.
+ *
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Bytes written, or -1 if the buffer is too small
+ */
+int metrics_to_cbor(uint8_t* buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
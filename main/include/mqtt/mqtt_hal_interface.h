@@ -9,6 +9,7 @@
 #ifndef MQTT_HAL_INTERFACE_H
 #define MQTT_HAL_INTERFACE_H
 
+#include <stdint.h>
 #include "esp_err.h"
 #include "esp_event.h"
 #include "mqtt_client.h"
@@ -72,6 +73,28 @@ esp_err_t mqtt_hal_client_register_event(esp_mqtt_client_handle_t client,
                                           esp_event_handler_t event_handler,
                                           void* event_handler_arg);
 
+/* ============================================================================
+ * System HAL Functions
+ * ============================================================================ */
+
+/**
+ * @brief Milliseconds since boot
+ * @return Monotonic time in milliseconds
+ */
+uint32_t mqtt_hal_time_ms(void);
+
+/**
+ * @brief Free heap right now
+ * @return Bytes free
+ */
+uint32_t mqtt_hal_heap_free(void);
+
+/**
+ * @brief Lowest free heap since boot
+ * @return Bytes free at the low-water mark
+ */
+uint32_t mqtt_hal_heap_min_free(void);
+
 /* ============================================================================
  * Logging HAL Functions
  * ============================================================================ */
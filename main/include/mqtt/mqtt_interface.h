@@ -1,23 +1,40 @@
 #ifndef MQTT_IMPL_H
 #define MQTT_IMPL_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "esp_err.h"
 #include "mqtt_client.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 
 /**
  * @brief MQTT configuration structure
  */
 typedef struct {
     const char* broker_address;       /**< MQTT broker hostname or IP */
-    int port;                         /**< MQTT broker port (default: 1883) */
+    int port;                         /**< MQTT broker port (default: 1883, 8883 for TLS) */
     const char* username;             /**< MQTT username (NULL if not required) */
     const char* password;             /**< MQTT password (NULL if not required) */
     const char* lwt_topic;            /**< Last Will and Testament topic */
     const char* lwt_message;          /**< Last Will and Testament message */
+    const char* ca_cert_pem;          /**< Broker CA in PEM; enables TLS and is the only CA trusted (NULL for plain TCP) */
 } mqtt_config_t;
 
+/**
+ * @brief Cost of connecting to the broker
+ *
+ * Timed from the start of a connection attempt to CONNACK, so over TLS it
+ * is dominated by the handshake. The heap figure is the free heap at the
+ * start of the attempt less the lowest free heap seen since boot at CONNACK;
+ * it is an upper bound, exact whenever the connection set a new low.
+ */
+typedef struct {
+    uint32_t connects;                /**< Successful connections since init */
+    uint32_t last_ms;                 /**< Duration of the last successful connection */
+    uint32_t max_ms;                  /**< Longest successful connection */
+    uint32_t last_heap_bytes;         /**< Heap drawn down by the last connection */
+    uint32_t max_heap_bytes;          /**< Most heap drawn down by any connection */
+} mqtt_connect_stats_t;
+
 /**
  * @brief Callback function type for MQTT command received
  * Called when a command is received on the command topic
@@ -37,6 +54,13 @@ typedef void (*mqtt_connected_cb_t)(void);
  */
 typedef void (*mqtt_disconnected_cb_t)(void);
 
+/**
+ * @brief Callback function type for MQTT published event
+ * Called when the broker acknowledges a QoS 1 or 2 publish (QoS 0 publishes are never acknowledged)
+ * @param msg_id Message ID returned by mqtt_publish()
+ */
+typedef void (*mqtt_published_cb_t)(int msg_id);
+
 /**
  * @brief Structure containing MQTT event callbacks
  */
@@ -44,6 +68,7 @@ typedef struct {
     mqtt_connected_cb_t on_connected;       /**< Called when connected to broker */
     mqtt_disconnected_cb_t on_disconnected; /**< Called when disconnected from broker */
     mqtt_command_cb_t on_data;           /**< Called when command is received */
+    mqtt_published_cb_t on_published;       /**< Called when a QoS 1/2 publish is acknowledged (can be NULL) */
 } mqtt_event_callbacks_t;
 
 /**
@@ -69,6 +94,17 @@ void mqtt_start(void);
  */
 int mqtt_publish(const char* topic, const char* data, int qos, bool retain);
 
+/**
+ * @brief Publish a binary payload (which may contain NUL bytes) to an MQTT topic
+ * @param topic Topic to publish to
+ * @param data Payload
+ * @param len Payload length in bytes, at least 1
+ * @param qos Quality of Service (0, 1, or 2)
+ * @param retain Whether to retain the message
+ * @return Message ID, or -1 on error
+ */
+int mqtt_publish_binary(const char* topic, const void* data, int len, int qos, bool retain);
+
 /**
  * @brief Subscribe to an MQTT topic
  * @param topic Topic to subscribe to
@@ -77,6 +113,12 @@ int mqtt_publish(const char* topic, const char* data, int qos, bool retain);
  */
 int mqtt_subscribe(const char* topic, int qos);
 
+/**
+ * @brief Get the connection cost measurements
+ * @param stats Receives the measurements
+ */
+void mqtt_get_connect_stats(mqtt_connect_stats_t* stats);
+
 /**
  * @brief Get the MQTT client handle
  * @return MQTT client handle, or NULL if not initialized
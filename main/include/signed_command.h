@@ -0,0 +1,138 @@
+/**
+ * @file signed_command.h
+ * @brief Signed MQTT commands with replay protection - pure C, no allocation.
+ *
+ * A signed command is sent as text on the command topic:
+ *
+ *   <OPEN|CLOSE|STOP> <counter> <mac>
+ *
+ * counter is decimal, 1..4294967295, and grows with every command the sender
+ * signs. mac is HMAC-SHA256 with the device key over the bytes before the
+ * last space ("OPEN 42"), truncated to 16 bytes and written as 32 hex digits.
+ * The MAC is compared in constant time before the counter is looked at.
+ *
+ * Replay protection keeps the highest accepted counter and a bitmap of the 32
+ * below it, so a command the broker delivers twice or out of order is
+ * accepted at most once. This window lives in RTC memory, which survives
+ * software resets, and carries a check word so a power-on is detected. A
+ * power cut loses it, so a floor is also kept in NVS: before a counter past
+ * the stored floor is accepted, a new floor SIGNED_COMMAND_RESERVE beyond it
+ * is stored. After a cold boot every counter up to the floor is refused, and
+ * NVS is written once per SIGNED_COMMAND_RESERVE commands.
+ */
+
+#ifndef SIGNED_COMMAND_H
+#define SIGNED_COMMAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "garage_controller.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SIGNED_COMMAND_MAC_LEN      16      // Truncated HMAC-SHA256
+#define SIGNED_COMMAND_WINDOW       32      // Counters below the highest that may still arrive late
+#define SIGNED_COMMAND_RESERVE      64      // Counters covered by each floor written to NVS
+#define SIGNED_COMMAND_MAX_LEN      49      // "CLOSE 4294967295 " + 32 hex digits
+
+/**
+ * @brief Verification outcome
+ */
+typedef enum {
+    SIGNED_COMMAND_OK = 0,
+    SIGNED_COMMAND_NO_KEY,          // No device key provisioned
+    SIGNED_COMMAND_MALFORMED,       // Not "<command> <counter> <32 hex digits>"
+    SIGNED_COMMAND_BAD_MAC,
+    SIGNED_COMMAND_REPLAYED,        // Counter already accepted or too far behind
+    SIGNED_COMMAND_STORE_FAILED     // The new floor could not be stored; nothing accepted
+} signed_command_status_t;
+
+/**
+ * @brief Store a new floor (NVS on the device)
+ * @return true once it is durable
+ */
+typedef bool (*signed_command_store_fn)(uint32_t floor, void* ctx);
+
+/**
+ * @brief Replay window, placed in RTC memory by the application
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t last;                  // Highest accepted counter
+    uint32_t seen;                  // Bit n set: counter last - n accepted
+    uint32_t check;                 // Guards the fields above against power-on contents
+} signed_command_window_t;
+
+/**
+ * @brief Verifier state, written only by the task that receives commands
+ */
+typedef struct {
+    const uint8_t* key;             // Device key (must outlive the verifier)
+    size_t key_len;
+    signed_command_window_t* window;
+    uint32_t floor;                 // Stored floor: counters up to it may have been accepted
+    signed_command_store_fn store_floor;
+    void* ctx;                      // Passed to store_floor
+    uint32_t accepted;
+    uint32_t rejected;
+} signed_command_verifier_t;
+
+/**
+ * @brief Set up a verifier, keeping the window if it survived a reset
+ *
+ * A window that fails its check is restarted at stored_floor with every
+ * counter up to it refused.
+ *
+ * @param verifier Verifier
+ * @param key Device key (NULL or empty refuses every signed command)
+ * @param key_len Key length
+ * @param window Window in RTC memory
+ * @param stored_floor Floor read back from NVS (0 if none)
+ * @param store_floor Stores a new floor
+ * @param ctx Passed to store_floor
+ * @return true if the window survived, false if it was restarted
+ */
+bool signed_command_init(signed_command_verifier_t* verifier, const uint8_t* key, size_t key_len,
+                         signed_command_window_t* window, uint32_t stored_floor,
+                         signed_command_store_fn store_floor, void* ctx);
+
+/**
+ * @brief Check a signed command and, if it is good, mark its counter used
+ * @param verifier Verifier
+ * @param data Payload bytes (not NUL-terminated)
+ * @param len Payload length
+ * @param input Receives the command (GARAGE_INPUT_NONE unless accepted)
+ * @param counter Receives the counter (0 unless accepted, may be NULL)
+ * @return Outcome
+ */
+signed_command_status_t signed_command_verify(signed_command_verifier_t* verifier, const char* data, int len,
+                                              garage_input_t* input, uint32_t* counter);
+
+/**
+ * @brief Build a signed command, as a gateway would
+ * @param key Device key
+ * @param key_len Key length
+ * @param input GARAGE_INPUT_COMMAND_OPEN, _CLOSE or _STOP
+ * @param counter Counter, at least 1
+ * @param buf Output buffer (SIGNED_COMMAND_MAX_LEN + 1 always suffices)
+ * @param size Buffer size
+ * @return Length written, or -1 for a bad input or a buffer too small
+ */
+int signed_command_sign(const uint8_t* key, size_t key_len, garage_input_t input, uint32_t counter,
+                        char* buf, size_t size);
+
+/**
+ * @brief Name of an outcome for logs
+ * @param status Outcome
+ * @return Static string
+ */
+const char* signed_command_status_to_string(signed_command_status_t status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIGNED_COMMAND_H
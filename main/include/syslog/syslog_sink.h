@@ -0,0 +1,140 @@
+/**
+ * @file syslog_sink.h
+ * @brief Batching, rate-limited syslog formatter for log lines - pure C, no allocation.
+ *
+ * Each log line becomes one RFC 5424 message. The messages are packed into a
+ * datagram-sized buffer, one per line, and the caller sends the packet when
+ * it is full or when it has nothing more to add. The collector must split a
+ * datagram on newlines (syslog-ng, Vector and Fluent Bit can).
+ *
+ * An ESP_LOG line "I (1234) tag: text" is sent as:
+ *
+ *   <134>1 2026-10-17T08:30:01.234Z garage-door tag - - [meta sequenceId="57" sysUpTime="123"] text
+ *
+ * The priority is facility local0 plus the line's severity. The timestamp is
+ * the line's uptime mapped to UTC (wall_clock.h), or "-" before the first
+ * SNTP sync and for lines without an uptime. The registered meta
+ * SD-ELEMENT carries:
+ * - sequenceId, the log ring's line number, so the collector sees gaps.
+ * - sysUpTime, the uptime in hundredths of a second.
+ *
+ * A token bucket limits the lines sent per second, so a log storm cannot
+ * flood the network. Lines over the limit are dropped and counted.
+ * syslog_sink_add_drop_report() reports the drops in a warning, which is not
+ * rate-limited.
+ */
+
+#ifndef SYSLOG_SINK_H
+#define SYSLOG_SINK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "wall_clock.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYSLOG_PACKET_MAX       1024    // Datagram payload: one Ethernet frame without IP fragmentation
+#define SYSLOG_FACILITY         16      // local0
+#define SYSLOG_HOSTNAME_MAX     32
+
+/**
+ * @brief Sink settings
+ */
+typedef struct {
+    const char* hostname;           // HOSTNAME field: printable ASCII, no spaces (up to SYSLOG_HOSTNAME_MAX)
+    uint32_t rate_per_s;            // Lines per second the bucket refills with
+    uint32_t burst;                 // Bucket size: lines sent back to back after a quiet spell
+} syslog_sink_config_t;
+
+/**
+ * @brief Outcome of adding a line
+ */
+typedef enum {
+    SYSLOG_ADDED = 0,               // In the packet
+    SYSLOG_RATE_LIMITED,            // Dropped and counted
+    SYSLOG_PACKET_FULL              // Not added: send the packet, then add the line again
+} syslog_add_result_t;
+
+/**
+ * @brief Sink state
+ */
+typedef struct {
+    syslog_sink_config_t config;
+    char hostname[SYSLOG_HOSTNAME_MAX + 1];
+    uint32_t tokens_milli;          // Bucket level, in thousandths of a line
+    uint32_t refilled_ms;           // Time of the last refill
+    char packet[SYSLOG_PACKET_MAX + 1];   // Messages separated by newlines (plus room for a NUL)
+    size_t packet_len;
+    int packet_lines;               // Log lines in the packet (a drop report is not one)
+    uint32_t sent_lines;
+    uint32_t sent_packets;
+    uint32_t rate_limited;          // Lines dropped by the bucket
+    uint32_t send_failed;           // Lines in packets that could not be sent
+    uint32_t reported_drops;        // Drops covered by the last drop report
+    wall_clock_t clock;             // For the TIMESTAMP field
+} syslog_sink_t;
+
+/**
+ * @brief Set up a sink with a full bucket and an empty packet
+ * @param sink Sink
+ * @param config Settings (the hostname is copied)
+ * @param now_ms Current time
+ */
+void syslog_sink_init(syslog_sink_t* sink, const syslog_sink_config_t* config, uint32_t now_ms);
+
+/**
+ * @brief Format one log line as an RFC 5424 message
+ * @param hostname HOSTNAME field
+ * @param line Log line, without its newline
+ * @param len Line length
+ * @param seq Line sequence number (0 to leave it out)
+ * @param clock Uptime to UTC mapping for the TIMESTAMP (NULL or not synced: "-")
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer is too small
+ */
+int syslog_format(const char* hostname, const char* line, size_t len, uint32_t seq, const wall_clock_t* clock,
+                  char* buf, size_t size);
+
+/**
+ * @brief Set the uptime to UTC mapping used for the lines added from now on
+ * @param sink Sink
+ * @param clock Mapping (copied)
+ */
+void syslog_sink_set_clock(syslog_sink_t* sink, const wall_clock_t* clock);
+
+/**
+ * @brief Add a log line to the packet, if the rate limit allows
+ * @param sink Sink
+ * @param line Log line, without its newline
+ * @param len Line length
+ * @param seq Line sequence number from the log ring
+ * @param now_ms Current time
+ * @return SYSLOG_ADDED, SYSLOG_RATE_LIMITED, or SYSLOG_PACKET_FULL (nothing changed)
+ */
+syslog_add_result_t syslog_sink_add(syslog_sink_t* sink, const char* line, size_t len, uint32_t seq,
+                                    uint32_t now_ms);
+
+/**
+ * @brief Add a warning with the drop counts, if anything was dropped since the last one
+ * @param sink Sink
+ * @param overwritten Lines the log ring overwrote before they were read (log_ring_t.overwritten)
+ * @return false if the packet is full: send it, then call again
+ */
+bool syslog_sink_add_drop_report(syslog_sink_t* sink, uint32_t overwritten);
+
+/**
+ * @brief Account for the packet and empty it. Call after sending a non-empty packet.
+ * @param sink Sink
+ * @param sent Whether the send succeeded
+ */
+void syslog_sink_packet_done(syslog_sink_t* sink, bool sent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYSLOG_SINK_H
@@ -0,0 +1,46 @@
+/**
+ * @file syslog_udp.h
+ * @brief Syslog collector socket over lwIP (or POSIX).
+ *
+ * A UDP socket connected to the collector, used only by the syslog task.
+ */
+
+#ifndef SYSLOG_UDP_H
+#define SYSLOG_UDP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open a socket to the collector
+ * @param host Collector address, dotted quad
+ * @param port Collector port (514 by convention)
+ * @return Socket, or -1 for a bad address or a socket error
+ */
+int syslog_udp_open(const char* host, uint16_t port);
+
+/**
+ * @brief Send one packet
+ * @param fd Socket from syslog_udp_open()
+ * @param data Packet
+ * @param len Length
+ * @return true if the whole packet was sent
+ */
+bool syslog_udp_send(int fd, const void* data, size_t len);
+
+/**
+ * @brief Close the socket
+ * @param fd Socket
+ */
+void syslog_udp_close(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYSLOG_UDP_H
@@ -0,0 +1,87 @@
+/**
+ * @file timer_wheel.h
+ * @brief Hashed timer wheel - pure C, no allocation.
+ *
+ * Timers are intrusive list nodes owned by the caller and hashed into
+ * TIMER_WHEEL_SLOTS slots by expiry tick, so starting and cancelling a timer
+ * are O(1) whatever the number of timers. One tick source drives the wheel:
+ * timer_wheel_expire() walks the slots up to the current tick and hands back
+ * expired timers one at a time, so the caller may start or cancel timers
+ * (including the one just returned) between calls. Timers further out than
+ * one revolution stay in their slot and are skipped until their tick comes.
+ */
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_WHEEL_SLOTS 64        // Power of two
+
+/**
+ * @brief Timer node (embed it in the object the timer belongs to)
+ */
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer* next;
+    struct timer_wheel_timer* prev;
+    uint32_t expires;               // Absolute tick
+    bool active;
+    void* data;                     // Caller's object, untouched by the wheel
+} timer_wheel_timer_t;
+
+/**
+ * @brief Wheel state
+ */
+typedef struct {
+    timer_wheel_timer_t* slots[TIMER_WHEEL_SLOTS];
+    uint32_t cursor;                // Tick being expired; earlier ticks are done
+    uint32_t active;                // Timers started and not yet expired or cancelled
+} timer_wheel_t;
+
+/**
+ * @brief Initialize an empty wheel
+ * @param wheel Wheel
+ * @param now Current tick
+ */
+void timer_wheel_init(timer_wheel_t* wheel, uint32_t now);
+
+/**
+ * @brief Prepare a timer node (inactive)
+ * @param timer Timer
+ * @param data Caller's object, returned with the timer
+ */
+void timer_wheel_timer_init(timer_wheel_timer_t* timer, void* data);
+
+/**
+ * @brief Start a timer, or restart it if it is already running
+ * @param wheel Wheel
+ * @param timer Timer
+ * @param expires Absolute tick (ticks already expired fire on the next timer_wheel_expire())
+ */
+void timer_wheel_start(timer_wheel_t* wheel, timer_wheel_timer_t* timer, uint32_t expires);
+
+/**
+ * @brief Cancel a timer (no-op if not running)
+ * @param wheel Wheel
+ * @param timer Timer
+ */
+void timer_wheel_cancel(timer_wheel_t* wheel, timer_wheel_timer_t* timer);
+
+/**
+ * @brief Take the next timer that has expired by now
+ * @param wheel Wheel
+ * @param now Current tick
+ * @return Expired timer (now inactive), or NULL once none is left
+ */
+timer_wheel_timer_t* timer_wheel_expire(timer_wheel_t* wheel, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_WHEEL_H
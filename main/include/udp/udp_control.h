@@ -0,0 +1,120 @@
+/**
+ * @file udp_control.h
+ * @brief Broker-less UDP control channel - protocol logic, pure C, no allocation.
+ *
+ * Commands arrive as signed frames (udp_frame.h) and are handed to a callback
+ * that posts them to the state machine queue, exactly like MQTT commands.
+ * Each accepted or rejected command is answered with a unicast reply carrying
+ * the state. State changes go to a multicast group as notifications, plus a
+ * heartbeat so a gateway that restarts learns the session.
+ *
+ * Replay protection: the device picks a random session per boot, and a command
+ * must carry the current session and a counter above the last accepted one. A
+ * correctly signed command for another session gets a RESYNC reply with the
+ * current session and is not executed; a gateway bootstraps by sending QUERY
+ * with session 0. Frames that fail authentication are dropped without a reply.
+ *
+ * Commands are handled by the UDP task and notifications built by the
+ * controller owner; each group of fields below has exactly one writer.
+ */
+
+#ifndef UDP_CONTROL_H
+#define UDP_CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "garage_controller.h"
+#include "udp_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UDP_CONTROL_PORT            47100
+#define UDP_CONTROL_NOTIFY_GROUP    "239.255.71.1"
+#define UDP_CONTROL_HEARTBEAT_MS    30000
+
+/**
+ * @brief Hand a command to the controller owner
+ * @return true if queued, false if the queue is full
+ */
+typedef bool (*udp_control_command_fn)(garage_input_t input, void* ctx);
+
+/**
+ * @brief Read the latest controller snapshot
+ */
+typedef void (*udp_control_snapshot_fn)(garage_controller_snapshot_t* snapshot, void* ctx);
+
+/**
+ * @brief Channel configuration
+ */
+typedef struct {
+    const uint8_t* key;                 // Shared HMAC key (must outlive the channel)
+    size_t key_len;
+    uint32_t session;                   // Random per boot; never 0
+    int position_step_pct;              // Notify when the position moves this far (0 = state changes only)
+    int heartbeat_ms;                   // Notify at least this often (0 = never)
+    udp_control_command_fn on_command;
+    udp_control_snapshot_fn get_snapshot;
+    void* ctx;                          // Passed to both callbacks
+} udp_control_config_t;
+
+/**
+ * @brief Channel state
+ */
+typedef struct {
+    udp_control_config_t config;
+
+    // Written by the task handling commands
+    uint32_t last_command_counter;      // Highest accepted command counter this session
+    uint32_t reply_counter;
+    uint32_t commands;                  // Commands queued
+    uint32_t dropped;                   // Malformed, unauthenticated or replayed frames
+    uint32_t resyncs;                   // RESYNC replies sent
+
+    // Written by the controller owner
+    uint32_t notify_counter;
+    bool notified;                      // A notification has been sent
+    garage_controller_snapshot_t last_notified;
+    int64_t last_notify_ms;
+} udp_control_t;
+
+/**
+ * @brief Initialize the channel
+ * @param ctrl Channel
+ * @param config Configuration (copied)
+ */
+void udp_control_init(udp_control_t* ctrl, const udp_control_config_t* config);
+
+/**
+ * @brief Handle one received datagram
+ * @param ctrl Channel
+ * @param buf Datagram bytes
+ * @param len Datagram length
+ * @param reply Receives the reply frame
+ * @return true if reply should be sent back to the source, false to drop silently
+ */
+bool udp_control_handle(udp_control_t* ctrl, const uint8_t* buf, size_t len, uint8_t reply[UDP_FRAME_LEN]);
+
+/**
+ * @brief Build a notification if one is due
+ *
+ * Due on the first call, when the state or obstruction flag changes, when the
+ * position has moved by position_step_pct or reached an endpoint, and when
+ * heartbeat_ms has passed since the last one.
+ *
+ * @param ctrl Channel
+ * @param snapshot Current controller snapshot
+ * @param now_ms Monotonic time in milliseconds
+ * @param frame Receives the notification
+ * @return true if a notification was built
+ */
+bool udp_control_poll_notification(udp_control_t* ctrl, const garage_controller_snapshot_t* snapshot,
+                                   int64_t now_ms, uint8_t frame[UDP_FRAME_LEN]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDP_CONTROL_H
@@ -0,0 +1,140 @@
+/**
+ * @file udp_frame.h
+ * @brief Fixed-size authenticated frames for the UDP control channel - pure C.
+ *
+ * Every frame is UDP_FRAME_LEN bytes, big-endian:
+ *
+ *   0  magic "GD"        2
+ *   2  version           1
+ *   3  type              1
+ *   4  session           4   Device session, random per boot
+ *   8  counter           4   Sender's counter, increasing per frame
+ *   12 payload           12
+ *   24 mac               16  HMAC-SHA256 over bytes 0..23, truncated
+ *
+ * Command payload: op (1 byte), zero padding.
+ * Reply/notify payload: state, position (int8, -1 unknown), flags (bit 0
+ * obstructed), result, transition count (4), counter of the command answered
+ * (4, 0 for notifications).
+ */
+
+#ifndef UDP_FRAME_H
+#define UDP_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "garage_state_machine.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UDP_FRAME_LEN           40
+#define UDP_FRAME_PAYLOAD_LEN   12
+#define UDP_FRAME_MAC_LEN       16
+#define UDP_FRAME_VERSION       1
+
+/**
+ * @brief Frame types
+ */
+typedef enum {
+    UDP_FRAME_COMMAND = 1,      // Gateway -> device
+    UDP_FRAME_REPLY,            // Device -> gateway, unicast answer to a command
+    UDP_FRAME_NOTIFY            // Device -> multicast group, state change or heartbeat
+} udp_frame_type_t;
+
+/**
+ * @brief Command operations (first payload byte of a command)
+ */
+typedef enum {
+    UDP_OP_OPEN = 1,
+    UDP_OP_CLOSE,
+    UDP_OP_STOP,
+    UDP_OP_QUERY                // Reply with the state, no action
+} udp_op_t;
+
+/**
+ * @brief Outcome reported in replies and notifications
+ */
+typedef enum {
+    UDP_RESULT_NOTIFY = 0,      // Unsolicited notification
+    UDP_RESULT_ACCEPTED,        // Command queued
+    UDP_RESULT_BUSY,            // Queue full, retry
+    UDP_RESULT_STATE,           // Answer to a query
+    UDP_RESULT_RESYNC,          // Wrong session: nothing done, reply carries the current one
+    UDP_RESULT_BAD_OP           // Unknown operation
+} udp_result_t;
+
+/**
+ * @brief Decode outcome
+ */
+typedef enum {
+    UDP_FRAME_OK = 0,
+    UDP_FRAME_BAD_LENGTH,
+    UDP_FRAME_BAD_HEADER,       // Magic, version or type
+    UDP_FRAME_BAD_MAC
+} udp_frame_status_t;
+
+/**
+ * @brief Frame fields (the MAC is computed and checked, not stored)
+ */
+typedef struct {
+    udp_frame_type_t type;
+    uint32_t session;
+    uint32_t counter;
+    uint8_t payload[UDP_FRAME_PAYLOAD_LEN];
+} udp_frame_t;
+
+/**
+ * @brief Reply and notification payload fields
+ */
+typedef struct {
+    garage_state_t state;
+    int position;                   // Percent, or GARAGE_POSITION_UNKNOWN
+    bool obstructed;
+    udp_result_t result;
+    uint32_t transition_count;
+    uint32_t answered_counter;      // Counter of the command answered, 0 for notifications
+} udp_state_payload_t;
+
+/**
+ * @brief Write a reply or notification payload
+ * @param state Fields
+ * @param payload Receives UDP_FRAME_PAYLOAD_LEN bytes
+ */
+void udp_frame_put_state(const udp_state_payload_t* state, uint8_t payload[UDP_FRAME_PAYLOAD_LEN]);
+
+/**
+ * @brief Read a reply or notification payload
+ * @param payload UDP_FRAME_PAYLOAD_LEN bytes
+ * @param state Receives the fields
+ */
+void udp_frame_get_state(const uint8_t payload[UDP_FRAME_PAYLOAD_LEN], udp_state_payload_t* state);
+
+/**
+ * @brief Encode and sign a frame
+ * @param frame Frame fields
+ * @param key HMAC key
+ * @param key_len Key length
+ * @param out Receives UDP_FRAME_LEN bytes
+ */
+void udp_frame_encode(const udp_frame_t* frame, const uint8_t* key, size_t key_len, uint8_t out[UDP_FRAME_LEN]);
+
+/**
+ * @brief Check and decode a received datagram
+ * @param buf Datagram bytes
+ * @param len Datagram length (anything but UDP_FRAME_LEN is rejected)
+ * @param key HMAC key
+ * @param key_len Key length
+ * @param frame Receives the fields (valid only for UDP_FRAME_OK)
+ * @return Decode outcome
+ */
+udp_frame_status_t udp_frame_decode(const uint8_t* buf, size_t len, const uint8_t* key, size_t key_len,
+                                    udp_frame_t* frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDP_FRAME_H
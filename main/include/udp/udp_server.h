@@ -0,0 +1,67 @@
+/**
+ * @file udp_server.h
+ * @brief UDP control channel sockets over lwIP (or POSIX).
+ *
+ * One socket receives commands and sends the replies (UDP task); a second one
+ * sends notifications (controller owner), so no socket is shared between tasks.
+ */
+
+#ifndef UDP_SERVER_H
+#define UDP_SERVER_H
+
+#include <stdint.h>
+#include "udp_control.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open the command socket on all interfaces
+ * @param port UDP port (0 picks an ephemeral port)
+ * @return Socket, or -1 on failure
+ */
+int udp_server_open(uint16_t port);
+
+/**
+ * @brief Get the port a socket is bound to
+ * @param fd Socket from udp_server_open()
+ * @return Port, or 0 on failure
+ */
+uint16_t udp_server_port(int fd);
+
+/**
+ * @brief Wait for one datagram, handle it and send the reply if there is one
+ * @param fd Socket from udp_server_open()
+ * @param ctrl Channel
+ * @return 1 if a reply was sent, 0 if the datagram was dropped, -1 on socket error
+ */
+int udp_server_serve_one(int fd, udp_control_t* ctrl);
+
+/**
+ * @brief Open the notification socket (multicast TTL 1: the LAN only)
+ * @return Socket, or -1 on failure
+ */
+int udp_server_open_notifier(void);
+
+/**
+ * @brief Send a notification frame
+ * @param fd Socket from udp_server_open_notifier()
+ * @param group Destination address, dotted quad (the multicast group, or a unicast address)
+ * @param port Destination port
+ * @param frame Frame to send
+ * @return true if sent
+ */
+bool udp_server_notify(int fd, const char* group, uint16_t port, const uint8_t frame[UDP_FRAME_LEN]);
+
+/**
+ * @brief Close a socket
+ * @param fd Socket
+ */
+void udp_server_close(int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UDP_SERVER_H
@@ -0,0 +1,86 @@
+/**
+ * @file wall_clock.h
+ * @brief Mapping from time since boot to UTC, for timestamps on published events - pure C.
+ *
+ * SNTP sets the system time in the background some time after WiFi is up.
+ * The firmware samples the system time against the monotonic clock, and the
+ * mapping is the difference between the two. Until the first sync the
+ * mapping is unknown and events go out without a time; nothing waits for it.
+ *
+ * Timestamps come from the monotonic clock plus the mapping, so an SNTP
+ * correction moves them only as far as the correction. Events stamped when
+ * they happen keep the right time however late they are delivered.
+ */
+
+#ifndef WALL_CLOCK_H
+#define WALL_CLOCK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WALL_CLOCK_MIN_UTC_S        1577836800      // 2020-01-01: a system time before this has not been set
+#define WALL_CLOCK_STEP_MS          2000            // A change this big is a step, not drift
+#define WALL_CLOCK_TEXT_MAX         24              // "2026-10-17T08:30:00.250Z", without the NUL
+
+/**
+ * @brief Mapping state
+ */
+typedef struct {
+    bool synced;                    // The mapping is known
+    int64_t offset_ms;              // UTC minus time since boot, in milliseconds
+    uint32_t steps;                 // Times the mapping was set or stepped
+} wall_clock_t;
+
+/**
+ * @brief Start with the mapping unknown
+ * @param clock Mapping
+ */
+void wall_clock_init(wall_clock_t* clock);
+
+/**
+ * @brief Take a sample of the system time against the time since boot
+ * @param clock Mapping
+ * @param mono_ms Time since boot
+ * @param utc_ms System time (ignored if before WALL_CLOCK_MIN_UTC_S: not set yet)
+ * @return true if the mapping was just set, or moved by WALL_CLOCK_STEP_MS or more
+ */
+bool wall_clock_update(wall_clock_t* clock, int64_t mono_ms, int64_t utc_ms);
+
+/**
+ * @brief Convert a time since boot to UTC
+ * @param clock Mapping
+ * @param mono_ms Time since boot
+ * @param utc_ms Receives the UTC time in milliseconds since 1970
+ * @return false if the mapping is not known yet
+ */
+bool wall_clock_to_utc_ms(const wall_clock_t* clock, int64_t mono_ms, int64_t* utc_ms);
+
+/**
+ * @brief Format a UTC time as RFC 3339 / ISO 8601 with milliseconds, e.g. "2026-10-17T08:30:00.250Z"
+ * @param utc_ms Milliseconds since 1970 (not negative)
+ * @param buf Output buffer (WALL_CLOCK_TEXT_MAX + 1 bytes hold any time up to year 9999)
+ * @param size Buffer size
+ * @return Length written, or -1 if the buffer is too small or the time out of range
+ */
+int wall_clock_format(int64_t utc_ms, char* buf, size_t size);
+
+/**
+ * @brief Add a "time" member with a UTC time to the end of a JSON object
+ * @param json Object, NUL-terminated, ending in '}'
+ * @param len Its length
+ * @param size Buffer size
+ * @param utc_ms Time to add
+ * @return New length, or len unchanged if it is not an object or the member does not fit
+ */
+int wall_clock_stamp_json(char* json, int len, size_t size, int64_t utc_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WALL_CLOCK_H
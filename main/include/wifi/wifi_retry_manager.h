@@ -21,6 +21,7 @@ typedef struct {
     int retry_interval_ms;        /**< Long retry interval in milliseconds */
     bool is_connected;            /**< Current connection state */
     bool timer_should_be_running; /**< Whether retry timer should be active */
+    bool fail_reported;           /**< FAIL already emitted for the current exhaustion */
 } wifi_retry_state_t;
 
 /**
@@ -54,6 +55,9 @@ void wifi_retry_init(wifi_retry_state_t* state, int max_retries, int retry_inter
 
 /**
  * @brief Process WiFi disconnection event
+ *
+ * FAIL is returned once per exhaustion of the immediate retries; further
+ * disconnects before the next connect or timer expiry return NONE.
  * @param state Pointer to retry state structure
  * @return Result indicating what action to take
  */
@@ -0,0 +1,155 @@
+/**
+ * @file latency_histogram.c
+ * @brief Log-linear latency histogram implementation.
+ */
+
+#include "latency_histogram.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// log2 of LATENCY_HISTOGRAM_SUB_BUCKETS
+#define SUB_BUCKET_BITS 3
+
+void latency_histogram_init(latency_histogram_t* hist)
+{
+    if (hist == NULL) {
+        return;
+    }
+    memset(hist, 0, sizeof(*hist));
+}
+
+static int highest_bit(uint64_t value)
+{
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+}
+
+int latency_histogram_bucket(int64_t value_us)
+{
+    if (value_us < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return value_us < 0 ? 0 : (int) value_us;
+    }
+    if (value_us > LATENCY_HISTOGRAM_MAX_US) {
+        return LATENCY_HISTOGRAM_BUCKETS - 1;
+    }
+    int msb = highest_bit((uint64_t) value_us);
+    int sub = (int) ((uint64_t) value_us >> (msb - SUB_BUCKET_BITS)) - LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return (msb - SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+int64_t latency_histogram_bucket_upper_us(int bucket)
+{
+    if (bucket < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return bucket < 0 ? 0 : bucket;
+    }
+    int msb = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int sub = bucket % LATENCY_HISTOGRAM_SUB_BUCKETS;
+    int64_t width = INT64_C(1) << (msb - SUB_BUCKET_BITS);
+    return (int64_t) (LATENCY_HISTOGRAM_SUB_BUCKETS + sub) * width + width - 1;
+}
+
+void latency_histogram_record(latency_histogram_t* hist, int64_t value_us)
+{
+    if (hist == NULL) {
+        return;
+    }
+    if (value_us < 0) {
+        value_us = 0;
+    }
+
+    hist->counts[latency_histogram_bucket(value_us)]++;
+    if (value_us > LATENCY_HISTOGRAM_MAX_US) {
+        hist->overflow++;
+    }
+    if (hist->count == 0 || value_us < hist->min_us) {
+        hist->min_us = value_us;
+    }
+    if (hist->count == 0 || value_us > hist->max_us) {
+        hist->max_us = value_us;
+    }
+    hist->sum_us += value_us;
+    hist->count++;
+}
+
+int64_t latency_histogram_percentile(const latency_histogram_t* hist, int per_mille)
+{
+    if (hist == NULL || hist->count == 0) {
+        return 0;
+    }
+    if (per_mille >= 1000) {
+        return hist->max_us;
+    }
+    if (per_mille < 0) {
+        per_mille = 0;
+    }
+
+    // Rank of the percentile, 1-based, rounded up
+    uint64_t rank = ((uint64_t) hist->count * (uint64_t) per_mille + 999) / 1000;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= rank) {
+            int64_t upper = latency_histogram_bucket_upper_us(i);
+            return upper < hist->max_us ? upper : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+int64_t latency_histogram_mean(const latency_histogram_t* hist)
+{
+    if (hist == NULL || hist->count == 0) {
+        return 0;
+    }
+    return hist->sum_us / hist->count;
+}
+
+int latency_histogram_to_json(const latency_histogram_t* hist, const char* name, char* buf, size_t size)
+{
+    if (hist == NULL || buf == NULL || size == 0) {
+        return -1;
+    }
+
+    size_t used = 0;
+    int written = snprintf(buf, size,
+                           "{\"name\":\"%s\",\"count\":%u,\"overflow\":%u,\"min_us\":%ld,\"mean_us\":%ld,"
+                           "\"p50_us\":%ld,\"p90_us\":%ld,\"p99_us\":%ld,\"p999_us\":%ld,\"max_us\":%ld,\"buckets\":[",
+                           name != NULL ? name : "", (unsigned) hist->count, (unsigned) hist->overflow,
+                           (long) hist->min_us, (long) latency_histogram_mean(hist),
+                           (long) latency_histogram_percentile(hist, 500),
+                           (long) latency_histogram_percentile(hist, 900),
+                           (long) latency_histogram_percentile(hist, 990),
+                           (long) latency_histogram_percentile(hist, 999), (long) hist->max_us);
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    used = (size_t) written;
+
+    bool first = true;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        if (hist->counts[i] == 0) {
+            continue;
+        }
+        written = snprintf(buf + used, size - used, "%s[%ld,%u]", first ? "" : ",",
+                           (long) latency_histogram_bucket_upper_us(i), (unsigned) hist->counts[i]);
+        if (written < 0 || (size_t) written >= size - used) {
+            return -1;
+        }
+        used += (size_t) written;
+        first = false;
+    }
+
+    written = snprintf(buf + used, size - used, "]}");
+    if (written < 0 || (size_t) written >= size - used) {
+        return -1;
+    }
+    return (int) (used + (size_t) written);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file log_ring.c
+ * @brief In-RAM log line ring implementation.
+ */
+
+#include "log_ring.h"
+#include <string.h>
+
+#define ESC 0x1b
+
+void log_ring_init(log_ring_t* ring)
+{
+    memset(ring, 0, sizeof(*ring));
+}
+
+/// Drop the oldest line
+static void drop_oldest(log_ring_t* ring)
+{
+    size_t len = ring->buf[ring->tail];
+    ring->tail = (ring->tail + 1 + len) % LOG_RING_SIZE;
+    ring->used -= 1 + len;
+    ring->removed++;
+}
+
+static void commit_line(log_ring_t* ring)
+{
+    size_t len = ring->line_len;
+    if (ring->line_cut) {
+        ring->cut++;
+    }
+    ring->line_len = 0;
+    ring->line_cut = false;
+    if (len == 0) {
+        return;
+    }
+
+    while (LOG_RING_SIZE - ring->used < 1 + len) {
+        drop_oldest(ring);
+        ring->overwritten++;
+    }
+    ring->buf[ring->head] = (uint8_t) len;
+    for (size_t i = 0; i < len; i++) {
+        ring->buf[(ring->head + 1 + i) % LOG_RING_SIZE] = (uint8_t) ring->line[i];
+    }
+    ring->head = (ring->head + 1 + len) % LOG_RING_SIZE;
+    ring->used += 1 + len;
+    ring->lines++;
+}
+
+void log_ring_putc(log_ring_t* ring, int ch)
+{
+    if (ring->in_escape) {
+        ring->in_escape = ch != 'm';
+        return;
+    }
+    if (ch == ESC) {
+        ring->in_escape = true;
+        return;
+    }
+    if (ch == '\n') {
+        commit_line(ring);
+        return;
+    }
+    if (ch == '\r') {
+        return;
+    }
+    if (ring->line_len < LOG_RING_LINE_MAX) {
+        ring->line[ring->line_len++] = (char) ch;
+    } else {
+        ring->line_cut = true;
+    }
+}
+
+int log_ring_pop(log_ring_t* ring, char* out, size_t size, uint32_t* seq)
+{
+    if (ring->used == 0 || out == NULL || size == 0) {
+        return -1;
+    }
+    size_t len = ring->buf[ring->tail];
+    size_t copy = len < size - 1 ? len : size - 1;
+    for (size_t i = 0; i < copy; i++) {
+        out[i] = (char) ring->buf[(ring->tail + 1 + i) % LOG_RING_SIZE];
+    }
+    out[copy] = '\0';
+    if (seq != NULL) {
+        *seq = ring->removed + 1;
+    }
+    drop_oldest(ring);
+    return (int) copy;
+}
@@ -0,0 +1,372 @@
+/**
+ * @file metrics.c
+ * @brief Metrics storage and exporters.
+ */
+
+#include "metrics.h"
+#include "cbor_writer.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NAME_PREFIX     "garage_door_"
+#define READ_ATTEMPTS   4       // Histogram copies tried before settling for the last one
+#define LABEL_MAX       64      // Longest label text in the lists
+
+typedef struct {
+    metric_type_t type;
+    const char* name;
+    const char* labels;
+} metric_info_t;
+
+typedef struct {
+    const char* name;
+    uint32_t bounds_us[METRICS_HISTOGRAM_BOUNDS];
+} metric_histogram_info_t;
+
+static const metric_info_t metric_info[METRIC_COUNT] = {
+#define METRICS_INFO(id, type, name, labels) { METRIC_TYPE_##type, name, labels },
+    METRICS_SCALARS(METRICS_INFO)
+#undef METRICS_INFO
+};
+
+static const metric_histogram_info_t histogram_info[METRIC_HISTOGRAM_COUNT] = {
+#define METRICS_HISTOGRAM_INFO(id, name, b0, b1, b2, b3, b4, b5, b6, b7) \
+    { name, { b0, b1, b2, b3, b4, b5, b6, b7 } },
+    METRICS_HISTOGRAMS(METRICS_HISTOGRAM_INFO)
+#undef METRICS_HISTOGRAM_INFO
+};
+
+/**
+ * Histogram storage. The writer makes sequence odd, updates, and makes it even
+ * again; a copy taken with the same even sequence at both ends is consistent.
+ */
+typedef struct {
+    volatile uint32_t sequence;
+    volatile uint32_t buckets[METRICS_HISTOGRAM_BOUNDS + 1];   // Per bucket, not cumulative
+    volatile uint32_t sum_us_low;
+    volatile uint32_t sum_us_high;
+} metric_histogram_t;
+
+static volatile uint32_t values[METRIC_COUNT];
+static metric_histogram_t histograms[METRIC_HISTOGRAM_COUNT];
+
+void metrics_inc(metric_id_t id)
+{
+    values[id] = values[id] + 1;
+}
+
+void metrics_set(metric_id_t id, int32_t value)
+{
+    values[id] = (uint32_t) value;
+}
+
+metric_id_t metrics_state_entries(int state)
+{
+    if (state < 0 || state > METRIC_STATE_STOPPED - METRIC_STATE_CLOSED) {
+        return METRIC_STATE_UNKNOWN;
+    }
+    return (metric_id_t) (METRIC_STATE_CLOSED + state);
+}
+
+uint32_t metrics_get(metric_id_t id)
+{
+    return values[id];
+}
+
+void metrics_observe(metric_histogram_id_t id, int64_t value_us)
+{
+    metric_histogram_t* hist = &histograms[id];
+    const uint32_t* bounds = histogram_info[id].bounds_us;
+    if (value_us < 0) {
+        value_us = 0;
+    }
+
+    int bucket = 0;
+    while (bucket < METRICS_HISTOGRAM_BOUNDS && (uint64_t) value_us > bounds[bucket]) {
+        bucket++;
+    }
+    uint64_t sum = ((uint64_t) hist->sum_us_high << 32 | hist->sum_us_low) + (uint64_t) value_us;
+
+    hist->sequence = hist->sequence + 1;
+    hist->buckets[bucket] = hist->buckets[bucket] + 1;
+    hist->sum_us_low = (uint32_t) sum;
+    hist->sum_us_high = (uint32_t) (sum >> 32);
+    hist->sequence = hist->sequence + 1;
+}
+
+uint32_t metrics_read_histogram(metric_histogram_id_t id, uint32_t* buckets, uint64_t* sum_us)
+{
+    const metric_histogram_t* hist = &histograms[id];
+    for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+        uint32_t before = hist->sequence;
+        for (int i = 0; i <= METRICS_HISTOGRAM_BOUNDS; i++) {
+            buckets[i] = hist->buckets[i];
+        }
+        *sum_us = (uint64_t) hist->sum_us_high << 32 | hist->sum_us_low;
+        if ((before & 1u) == 0 && hist->sequence == before) {
+            break;
+        }
+    }
+
+    uint32_t count = 0;
+    for (int i = 0; i <= METRICS_HISTOGRAM_BOUNDS; i++) {
+        count += buckets[i];
+    }
+    return count;
+}
+
+void metrics_reset(void)
+{
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        values[i] = 0;
+    }
+    for (int i = 0; i < METRIC_HISTOGRAM_COUNT; i++) {
+        metric_histogram_t* hist = &histograms[i];
+        for (int b = 0; b <= METRICS_HISTOGRAM_BOUNDS; b++) {
+            hist->buckets[b] = 0;
+        }
+        hist->sum_us_low = 0;
+        hist->sum_us_high = 0;
+    }
+}
+
+/// Account for one snprintf into buf + *used; false if it did not fit
+static bool advance(size_t* used, int written, size_t size)
+{
+    if (written < 0 || (size_t) written >= size - *used) {
+        return false;
+    }
+    *used += (size_t) written;
+    return true;
+}
+
+/// 64-bit values without %llu, which newlib-nano lacks
+static const char* format_u64(uint64_t value, char digits[21])
+{
+    char* p = digits + 20;
+    *p = '\0';
+    do {
+        *--p = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return p;
+}
+
+/// Whether a series starts a new family (the families are contiguous in the lists)
+static bool family_starts(int id)
+{
+    return id == 0 || strcmp(metric_info[id].name, metric_info[id - 1].name) != 0;
+}
+
+static bool family_ends(int id)
+{
+    return id == METRIC_COUNT - 1 || strcmp(metric_info[id].name, metric_info[id + 1].name) != 0;
+}
+
+/// "a=b,c=d" -> "a=\"b\",c=\"d\"" (Prometheus) or "b.d" (JSON key)
+static void format_labels(const char* labels, bool prometheus, char out[LABEL_MAX])
+{
+    size_t n = 0;
+    bool in_value = false;
+    for (const char* p = labels; *p != '\0' && n < LABEL_MAX - 3; p++) {
+        if (*p == '=') {
+            in_value = true;
+            if (prometheus) {
+                out[n++] = '=';
+                out[n++] = '"';
+            }
+        } else if (*p == ',') {
+            in_value = false;
+            if (prometheus) {
+                out[n++] = '"';
+            }
+            out[n++] = prometheus ? ',' : '.';
+        } else if (prometheus || in_value) {
+            out[n++] = *p;
+        }
+    }
+    if (prometheus && in_value) {
+        out[n++] = '"';
+    }
+    out[n] = '\0';
+}
+
+int metrics_to_prometheus(char* buf, size_t size)
+{
+    if (buf == NULL || size == 0) {
+        return -1;
+    }
+    size_t used = 0;
+    char labels[LABEL_MAX];
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        const metric_info_t* info = &metric_info[id];
+        if (family_starts(id) &&
+            !advance(&used, snprintf(buf + used, size - used, "# TYPE %s %s\n", info->name,
+                                     info->type == METRIC_TYPE_COUNTER ? "counter" : "gauge"), size)) {
+            return -1;
+        }
+        int written;
+        if (info->labels[0] == '\0') {
+            written = info->type == METRIC_TYPE_COUNTER
+                          ? snprintf(buf + used, size - used, "%s %u\n", info->name, (unsigned) values[id])
+                          : snprintf(buf + used, size - used, "%s %d\n", info->name, (int) (int32_t) values[id]);
+        } else {
+            format_labels(info->labels, true, labels);
+            written = info->type == METRIC_TYPE_COUNTER
+                          ? snprintf(buf + used, size - used, "%s{%s} %u\n", info->name, labels,
+                                     (unsigned) values[id])
+                          : snprintf(buf + used, size - used, "%s{%s} %d\n", info->name, labels,
+                                     (int) (int32_t) values[id]);
+        }
+        if (!advance(&used, written, size)) {
+            return -1;
+        }
+    }
+
+    for (int id = 0; id < METRIC_HISTOGRAM_COUNT; id++) {
+        const metric_histogram_info_t* info = &histogram_info[id];
+        uint32_t buckets[METRICS_HISTOGRAM_BOUNDS + 1];
+        uint64_t sum_us;
+        uint32_t count = metrics_read_histogram((metric_histogram_id_t) id, buckets, &sum_us);
+
+        if (!advance(&used, snprintf(buf + used, size - used, "# TYPE %s histogram\n", info->name), size)) {
+            return -1;
+        }
+        uint32_t cumulative = 0;
+        for (int b = 0; b < METRICS_HISTOGRAM_BOUNDS; b++) {
+            cumulative += buckets[b];
+            int written = snprintf(buf + used, size - used, "%s_bucket{le=\"%u.%06u\"} %u\n", info->name,
+                                   (unsigned) (info->bounds_us[b] / 1000000), (unsigned) (info->bounds_us[b] % 1000000),
+                                   (unsigned) cumulative);
+            if (!advance(&used, written, size)) {
+                return -1;
+            }
+        }
+        int written = snprintf(buf + used, size - used,
+                               "%s_bucket{le=\"+Inf\"} %u\n"
+                               "%s_sum %u.%06u\n"
+                               "%s_count %u\n",
+                               info->name, (unsigned) count,
+                               info->name, (unsigned) (sum_us / 1000000), (unsigned) (sum_us % 1000000),
+                               info->name, (unsigned) count);
+        if (!advance(&used, written, size)) {
+            return -1;
+        }
+    }
+    return (int) used;
+}
+
+int metrics_to_json(char* buf, size_t size)
+{
+    if (buf == NULL || size == 0) {
+        return -1;
+    }
+    size_t used = 0;
+    char labels[LABEL_MAX];
+    const size_t prefix_len = strlen(NAME_PREFIX);
+    if (!advance(&used, snprintf(buf, size, "{"), size)) {
+        return -1;
+    }
+
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        const metric_info_t* info = &metric_info[id];
+        const char* name = strncmp(info->name, NAME_PREFIX, prefix_len) == 0 ? info->name + prefix_len : info->name;
+        const char* sep = id == 0 ? "" : ",";
+        int written;
+        if (info->labels[0] == '\0') {
+            written = info->type == METRIC_TYPE_COUNTER
+                          ? snprintf(buf + used, size - used, "%s\"%s\":%u", sep, name, (unsigned) values[id])
+                          : snprintf(buf + used, size - used, "%s\"%s\":%d", sep, name, (int) (int32_t) values[id]);
+        } else {
+            if (family_starts(id) &&
+                !advance(&used, snprintf(buf + used, size - used, "%s\"%s\":{", sep, name), size)) {
+                return -1;
+            }
+            format_labels(info->labels, false, labels);
+            const char* open = family_starts(id) ? "" : ",";
+            const char* close = family_ends(id) ? "}" : "";
+            written = info->type == METRIC_TYPE_COUNTER
+                          ? snprintf(buf + used, size - used, "%s\"%s\":%u%s", open, labels, (unsigned) values[id],
+                                     close)
+                          : snprintf(buf + used, size - used, "%s\"%s\":%d%s", open, labels,
+                                     (int) (int32_t) values[id], close);
+        }
+        if (!advance(&used, written, size)) {
+            return -1;
+        }
+    }
+
+    for (int id = 0; id < METRIC_HISTOGRAM_COUNT; id++) {
+        const metric_histogram_info_t* info = &histogram_info[id];
+        const char* name = strncmp(info->name, NAME_PREFIX, prefix_len) == 0 ? info->name + prefix_len : info->name;
+        uint32_t buckets[METRICS_HISTOGRAM_BOUNDS + 1];
+        uint64_t sum_us;
+        uint32_t count = metrics_read_histogram((metric_histogram_id_t) id, buckets, &sum_us);
+
+        if (!advance(&used, snprintf(buf + used, size - used, ",\"%s\":{\"le_us\":[", name), size)) {
+            return -1;
+        }
+        for (int b = 0; b < METRICS_HISTOGRAM_BOUNDS; b++) {
+            if (!advance(&used, snprintf(buf + used, size - used, b == 0 ? "%u" : ",%u",
+                                         (unsigned) info->bounds_us[b]), size)) {
+                return -1;
+            }
+        }
+        if (!advance(&used, snprintf(buf + used, size - used, "],\"buckets\":["), size)) {
+            return -1;
+        }
+        uint32_t cumulative = 0;
+        for (int b = 0; b < METRICS_HISTOGRAM_BOUNDS; b++) {
+            cumulative += buckets[b];
+            if (!advance(&used, snprintf(buf + used, size - used, b == 0 ? "%u" : ",%u", (unsigned) cumulative),
+                         size)) {
+                return -1;
+            }
+        }
+        char digits[21];
+        if (!advance(&used, snprintf(buf + used, size - used, "],\"count\":%u,\"sum_us\":%s}", (unsigned) count,
+                                     format_u64(sum_us, digits)), size)) {
+            return -1;
+        }
+    }
+
+    if (!advance(&used, snprintf(buf + used, size - used, "}"), size)) {
+        return -1;
+    }
+    return (int) used;
+}
+
+int metrics_to_cbor(uint8_t* buf, size_t size)
+{
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buf, size);
+    cbor_put_array(&writer, 3);
+    cbor_put_uint(&writer, METRICS_CBOR_VERSION);
+
+    cbor_put_array(&writer, METRIC_COUNT);
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        if (metric_info[id].type == METRIC_TYPE_COUNTER) {
+            cbor_put_uint(&writer, values[id]);
+        } else {
+            cbor_put_int(&writer, (int32_t) values[id]);
+        }
+    }
+
+    cbor_put_array(&writer, METRIC_HISTOGRAM_COUNT);
+    for (int id = 0; id < METRIC_HISTOGRAM_COUNT; id++) {
+        uint32_t buckets[METRICS_HISTOGRAM_BOUNDS + 1];
+        uint64_t sum_us;
+        uint32_t count = metrics_read_histogram((metric_histogram_id_t) id, buckets, &sum_us);
+
+        cbor_put_array(&writer, METRICS_HISTOGRAM_BOUNDS + 2);
+        uint32_t cumulative = 0;
+        for (int b = 0; b < METRICS_HISTOGRAM_BOUNDS; b++) {
+            cumulative += buckets[b];
+            cbor_put_uint(&writer, cumulative);
+        }
+        cbor_put_uint(&writer, count);
+        cbor_put_uint(&writer, sum_us);
+    }
+    return cbor_writer_finish(&writer);
+}
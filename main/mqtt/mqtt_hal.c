@@ -8,6 +8,8 @@
 
 #include "mqtt_hal_interface.h"
 #include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
 #include <stdarg.h>
 #include <stdio.h>
 
@@ -52,6 +54,25 @@ esp_err_t mqtt_hal_client_register_event(esp_mqtt_client_handle_t client,
     return esp_mqtt_client_register_event(client, event, event_handler, event_handler_arg);
 }
 
+/* ============================================================================
+ * System HAL Implementation
+ * ============================================================================ */
+
+uint32_t mqtt_hal_time_ms(void)
+{
+    return (uint32_t) (esp_timer_get_time() / 1000);
+}
+
+uint32_t mqtt_hal_heap_free(void)
+{
+    return esp_get_free_heap_size();
+}
+
+uint32_t mqtt_hal_heap_min_free(void)
+{
+    return esp_get_minimum_free_heap_size();
+}
+
 /* ============================================================================
  * Logging HAL Implementation
  * ============================================================================ */
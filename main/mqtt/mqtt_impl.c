@@ -1,16 +1,23 @@
 #include "mqtt_interface.h"
 #include "mqtt_hal_interface.h"
 #include "mqtt_retry_manager.h"
+#include "metrics.h"
 #include "esp_err.h"
 #include <string.h>
 #include <stdio.h>
 
 static const char* MQTT_TAG = "mqtt_client";
 
+#define LOG_EXCERPT_MAX 64  // Longest topic/payload excerpt logged per message
+
 static esp_mqtt_client_handle_t s_mqtt_handle = NULL;
 static mqtt_config_t s_mqtt_config = {0};
 static mqtt_event_callbacks_t s_mqtt_callbacks = {0};
 static mqtt_retry_state_t s_retry_state = {0};
+static mqtt_connect_stats_t s_connect_stats = {0};
+static bool s_attempt_pending = false;      // A connection attempt has started and not yet reached CONNACK
+static uint32_t s_attempt_started_ms = 0;
+static uint32_t s_attempt_heap_free = 0;    // Free heap when the attempt started
 
 void mqtt_start(void) {
     if (s_mqtt_handle != NULL) {
@@ -29,6 +36,17 @@ int mqtt_publish(const char* topic, const char* data, int qos, bool retain) {
     return mqtt_hal_client_publish(s_mqtt_handle, topic, data, 0, qos, retain);
 }
 
+int mqtt_publish_binary(const char* topic, const void* data, int len, int qos, bool retain) {
+    if (s_mqtt_handle == NULL) {
+        mqtt_hal_log_error(MQTT_TAG, "MQTT client not initialized");
+        return -1;
+    }
+    if (len <= 0) {
+        return -1;      // Length 0 would make esp-mqtt take strlen() of binary data
+    }
+    return mqtt_hal_client_publish(s_mqtt_handle, topic, (const char*) data, len, qos, retain);
+}
+
 int mqtt_subscribe(const char* topic, int qos) {
     if (s_mqtt_handle == NULL) {
         mqtt_hal_log_error(MQTT_TAG, "MQTT client not initialized");
@@ -37,18 +55,72 @@ int mqtt_subscribe(const char* topic, int qos) {
     return mqtt_hal_client_subscribe(s_mqtt_handle, topic, qos);
 }
 
+void mqtt_get_connect_stats(mqtt_connect_stats_t* stats) {
+    if (stats != NULL) {
+        *stats = s_connect_stats;
+    }
+}
+
 esp_mqtt_client_handle_t mqtt_get_handle(void) {
     return s_mqtt_handle;
 }
 
+/// @brief Caps a broker-supplied length for use as a %.*s precision.
+/// Logging a large payload in full would cost time proportional to its size.
+static int log_len(int len)
+{
+    return len > LOG_EXCERPT_MAX ? LOG_EXCERPT_MAX : len;
+}
+
+/// @brief Notes the time and free heap as a connection attempt starts.
+/// esp-mqtt raises BEFORE_CONNECT for every attempt, so a failed attempt is simply restarted.
+static void connect_attempt_started(void)
+{
+    s_attempt_pending = true;
+    s_attempt_started_ms = mqtt_hal_time_ms();
+    s_attempt_heap_free = mqtt_hal_heap_free();
+}
+
+/// @brief Records what the attempt that just reached CONNACK cost in time and heap.
+static void connect_attempt_finished(void)
+{
+    if (!s_attempt_pending) {
+        return;
+    }
+    s_attempt_pending = false;
+
+    uint32_t elapsed_ms = mqtt_hal_time_ms() - s_attempt_started_ms;
+    uint32_t min_free = mqtt_hal_heap_min_free();
+    uint32_t heap_bytes = s_attempt_heap_free > min_free ? s_attempt_heap_free - min_free : 0;
+
+    s_connect_stats.connects++;
+    metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, (int64_t) elapsed_ms * 1000);
+    s_connect_stats.last_ms = elapsed_ms;
+    s_connect_stats.last_heap_bytes = heap_bytes;
+    if (elapsed_ms > s_connect_stats.max_ms) {
+        s_connect_stats.max_ms = elapsed_ms;
+    }
+    if (heap_bytes > s_connect_stats.max_heap_bytes) {
+        s_connect_stats.max_heap_bytes = heap_bytes;
+    }
+    mqtt_hal_log_info(MQTT_TAG, "Connected over %s in %u ms, heap peak %u bytes",
+                      s_mqtt_config.ca_cert_pem != NULL ? "TLS" : "TCP",
+                      (unsigned) elapsed_ms, (unsigned) heap_bytes);
+}
+
 /// @brief Callback function for MQTT events.
 /// @param event The MQTT event handle. Will contain ID and data
 /// @return ESP_OK on success, or an error code on failure.
 static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
 {
     switch (event->event_id) {
+        case MQTT_EVENT_BEFORE_CONNECT:
+            connect_attempt_started();
+            break;
         case MQTT_EVENT_CONNECTED:
             mqtt_hal_log_info(MQTT_TAG, "MQTT_EVENT_CONNECTED");
+            connect_attempt_finished();
+            metrics_set(METRIC_MQTT_CONNECTED, 1);
             
             mqtt_retry_result_t result_connect = mqtt_retry_on_connected(&s_retry_state);
             
@@ -58,6 +130,11 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
             break;
         case MQTT_EVENT_DISCONNECTED:
             mqtt_hal_log_info(MQTT_TAG, "MQTT_EVENT_DISCONNECTED");
+            // Failed connect attempts raise this too; only a lost session is counted
+            if (metrics_get(METRIC_MQTT_CONNECTED) != 0) {
+                metrics_set(METRIC_MQTT_CONNECTED, 0);
+                metrics_inc(METRIC_MQTT_DISCONNECTS);
+            }
             
             mqtt_retry_result_t result_disconnect = mqtt_retry_on_disconnect(&s_retry_state);
             
@@ -79,14 +156,25 @@ static esp_err_t mqtt_event_handler_cb(esp_mqtt_event_handle_t event)
             break;
         case MQTT_EVENT_PUBLISHED:
             mqtt_hal_log_info(MQTT_TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+            if (s_mqtt_callbacks.on_published != NULL) {
+                s_mqtt_callbacks.on_published(event->msg_id);
+            }
             break;
         case MQTT_EVENT_DATA:
             mqtt_hal_log_info(MQTT_TAG, "MQTT_EVENT_DATA");
             if (event->topic != NULL && event->topic_len > 0) {
-                mqtt_hal_log_info(MQTT_TAG, "TOPIC=%.*s", event->topic_len, event->topic);
+                mqtt_hal_log_info(MQTT_TAG, "TOPIC=%.*s", log_len(event->topic_len), event->topic);
             }
             if (event->data != NULL && event->data_len > 0) {
-                mqtt_hal_log_info(MQTT_TAG, "DATA=%.*s", event->data_len, event->data);
+                mqtt_hal_log_info(MQTT_TAG, "DATA=%.*s", log_len(event->data_len), event->data);
+            }
+
+            // Payloads larger than the client buffer arrive in chunks; none of ours is that
+            // large, so a chunk is never passed on where it could match a short command.
+            if (event->data_len != event->total_data_len || event->current_data_offset != 0) {
+                mqtt_hal_log_info(MQTT_TAG, "Ignoring fragmented message (%d bytes at offset %d of %d)",
+                                  event->data_len, event->current_data_offset, event->total_data_len);
+                break;
             }
 
             if (s_mqtt_callbacks.on_data != NULL) {
@@ -131,7 +219,10 @@ void mqtt_init(const mqtt_config_t* config, const mqtt_event_callbacks_t* callba
     }
     
     mqtt_retry_init(&s_retry_state, true);
+    memset(&s_connect_stats, 0, sizeof(s_connect_stats));
+    s_attempt_pending = false;
 
+    // With a CA the broker must present a chain to it; the global CA store is never consulted
     esp_mqtt_client_config_t mqtt_cfg = {
         .host = config->broker_address,
         .port = config->port,
@@ -141,6 +232,8 @@ void mqtt_init(const mqtt_config_t* config, const mqtt_event_callbacks_t* callba
         .lwt_qos = 0,
         .lwt_msg = config->lwt_message != NULL ? config->lwt_message : "unavailable",
         .lwt_retain = true,
+        .transport = config->ca_cert_pem != NULL ? MQTT_TRANSPORT_OVER_SSL : MQTT_TRANSPORT_OVER_TCP,
+        .cert_pem = config->ca_cert_pem,
     };
 
     s_mqtt_handle = mqtt_hal_client_init(&mqtt_cfg);
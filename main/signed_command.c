@@ -0,0 +1,244 @@
+/**
+ * @file signed_command.c
+ * @brief Signed MQTT command verification.
+ */
+
+#include "signed_command.h"
+#include <stdio.h>
+#include <string.h>
+#include "garage_command.h"
+#include "hmac_sha256.h"
+
+#define WINDOW_MAGIC    0x53434D44u     // "SCMD"
+#define MAC_HEX_LEN     (2 * SIGNED_COMMAND_MAC_LEN)
+#define COUNTER_DIGITS  10              // 4294967295
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static uint32_t window_check(const signed_command_window_t* window)
+{
+    return (window->magic ^ (window->last * 0x9E3779B1u) ^ window->seen) + 0xA5A5A5A5u;
+}
+
+static bool window_valid(const signed_command_window_t* window)
+{
+    return window->magic == WINDOW_MAGIC && window->check == window_check(window);
+}
+
+static void window_set(signed_command_window_t* window, uint32_t last, uint32_t seen)
+{
+    window->magic = WINDOW_MAGIC;
+    window->last = last;
+    window->seen = seen;
+    window->check = window_check(window);
+}
+
+static const char* command_word(garage_input_t input)
+{
+    switch (input) {
+        case GARAGE_INPUT_COMMAND_OPEN:  return GARAGE_COMMAND_OPEN;
+        case GARAGE_INPUT_COMMAND_CLOSE: return GARAGE_COMMAND_CLOSE;
+        case GARAGE_INPUT_COMMAND_STOP:  return GARAGE_COMMAND_STOP;
+        default:                         return NULL;
+    }
+}
+
+/// Command word at the start of the payload, followed by a space; sets *word_len
+static garage_input_t parse_word(const char* data, int len, int* word_len)
+{
+    static const garage_input_t inputs[] = {
+        GARAGE_INPUT_COMMAND_OPEN, GARAGE_INPUT_COMMAND_CLOSE, GARAGE_INPUT_COMMAND_STOP,
+    };
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+        const char* word = command_word(inputs[i]);
+        int n = (int) strlen(word);
+        if (len > n && memcmp(data, word, (size_t) n) == 0 && data[n] == ' ') {
+            *word_len = n;
+            return inputs[i];
+        }
+    }
+    return GARAGE_INPUT_NONE;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/// Splits "<word> <counter> <mac>"; *signed_len is the length the MAC covers
+static bool parse(const char* data, int len, garage_input_t* input, uint32_t* counter,
+                  uint8_t mac[SIGNED_COMMAND_MAC_LEN], int* signed_len)
+{
+    if (data == NULL || len <= 0 || len > SIGNED_COMMAND_MAX_LEN) {
+        return false;
+    }
+    int word_len;
+    *input = parse_word(data, len, &word_len);
+    if (*input == GARAGE_INPUT_NONE) {
+        return false;
+    }
+
+    int pos = word_len + 1;
+    int digits = 0;
+    uint64_t value = 0;
+    while (pos < len && data[pos] >= '0' && data[pos] <= '9' && digits < COUNTER_DIGITS) {
+        value = value * 10 + (uint64_t) (data[pos] - '0');
+        pos++;
+        digits++;
+    }
+    if (digits == 0 || value == 0 || value > UINT32_MAX || pos >= len || data[pos] != ' ') {
+        return false;
+    }
+    *counter = (uint32_t) value;
+    *signed_len = pos;
+
+    pos++;
+    if (len - pos != MAC_HEX_LEN) {
+        return false;
+    }
+    for (int i = 0; i < SIGNED_COMMAND_MAC_LEN; i++) {
+        int hi = hex_value(data[pos + 2 * i]);
+        int lo = hex_value(data[pos + 2 * i + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        mac[i] = (uint8_t) (hi << 4 | lo);
+    }
+    return true;
+}
+
+bool signed_command_init(signed_command_verifier_t* verifier, const uint8_t* key, size_t key_len,
+                         signed_command_window_t* window, uint32_t stored_floor,
+                         signed_command_store_fn store_floor, void* ctx)
+{
+    memset(verifier, 0, sizeof(*verifier));
+    verifier->key = key;
+    verifier->key_len = key != NULL ? key_len : 0;
+    verifier->window = window;
+    verifier->floor = stored_floor;
+    verifier->store_floor = store_floor;
+    verifier->ctx = ctx;
+
+    if (window_valid(window)) {
+        return true;
+    }
+    // Cold boot: anything up to the floor may have been accepted before the power cut
+    window_set(window, stored_floor, 0xFFFFFFFFu);
+    return false;
+}
+
+/// Whether the counter is new to the window (not yet accepted, not too far behind)
+static bool counter_fresh(const signed_command_window_t* window, uint32_t counter)
+{
+    if (counter > window->last) {
+        return true;
+    }
+    uint32_t behind = window->last - counter;
+    return behind < SIGNED_COMMAND_WINDOW && (window->seen & (1u << behind)) == 0;
+}
+
+static void counter_accept(signed_command_window_t* window, uint32_t counter)
+{
+    if (counter > window->last) {
+        uint32_t ahead = counter - window->last;
+        uint32_t seen = ahead >= SIGNED_COMMAND_WINDOW ? 0 : window->seen << ahead;
+        window_set(window, counter, seen | 1u);
+    } else {
+        window_set(window, window->last, window->seen | (1u << (window->last - counter)));
+    }
+}
+
+signed_command_status_t signed_command_verify(signed_command_verifier_t* verifier, const char* data, int len,
+                                              garage_input_t* input, uint32_t* counter)
+{
+    garage_input_t parsed_input = GARAGE_INPUT_NONE;
+    uint32_t parsed_counter = 0;
+    signed_command_status_t status = SIGNED_COMMAND_OK;
+    uint8_t mac[SIGNED_COMMAND_MAC_LEN];
+    int signed_len = 0;
+
+    *input = GARAGE_INPUT_NONE;
+    if (counter != NULL) {
+        *counter = 0;
+    }
+
+    if (verifier->key_len == 0) {
+        status = SIGNED_COMMAND_NO_KEY;
+    } else if (!parse(data, len, &parsed_input, &parsed_counter, mac, &signed_len)) {
+        status = SIGNED_COMMAND_MALFORMED;
+    } else {
+        uint8_t expected[SHA256_DIGEST_LEN];
+        hmac_sha256(verifier->key, verifier->key_len, data, (size_t) signed_len, expected);
+        if (!hmac_sha256_equal(expected, mac, SIGNED_COMMAND_MAC_LEN)) {
+            status = SIGNED_COMMAND_BAD_MAC;
+        } else if (!counter_fresh(verifier->window, parsed_counter)) {
+            status = SIGNED_COMMAND_REPLAYED;
+        } else if (parsed_counter > verifier->floor) {
+            uint32_t floor = parsed_counter <= UINT32_MAX - SIGNED_COMMAND_RESERVE
+                                 ? parsed_counter + SIGNED_COMMAND_RESERVE : UINT32_MAX;
+            if (verifier->store_floor == NULL || !verifier->store_floor(floor, verifier->ctx)) {
+                status = SIGNED_COMMAND_STORE_FAILED;
+            } else {
+                verifier->floor = floor;
+            }
+        }
+    }
+
+    if (status != SIGNED_COMMAND_OK) {
+        verifier->rejected++;
+        return status;
+    }
+    counter_accept(verifier->window, parsed_counter);
+    verifier->accepted++;
+    *input = parsed_input;
+    if (counter != NULL) {
+        *counter = parsed_counter;
+    }
+    return SIGNED_COMMAND_OK;
+}
+
+int signed_command_sign(const uint8_t* key, size_t key_len, garage_input_t input, uint32_t counter,
+                        char* buf, size_t size)
+{
+    const char* word = command_word(input);
+    if (word == NULL || counter == 0 || buf == NULL) {
+        return -1;
+    }
+    int signed_len = snprintf(buf, size, "%s %lu", word, (unsigned long) counter);
+    if (signed_len < 0 || (size_t) signed_len + 1 + MAC_HEX_LEN >= size) {
+        return -1;
+    }
+
+    uint8_t mac[SHA256_DIGEST_LEN];
+    hmac_sha256(key, key_len, buf, (size_t) signed_len, mac);
+    char* out = buf + signed_len;
+    *out++ = ' ';
+    for (int i = 0; i < SIGNED_COMMAND_MAC_LEN; i++) {
+        *out++ = HEX_DIGITS[mac[i] >> 4];
+        *out++ = HEX_DIGITS[mac[i] & 0x0F];
+    }
+    *out = '\0';
+    return signed_len + 1 + MAC_HEX_LEN;
+}
+
+const char* signed_command_status_to_string(signed_command_status_t status)
+{
+    switch (status) {
+        case SIGNED_COMMAND_OK:             return "ok";
+        case SIGNED_COMMAND_NO_KEY:         return "no key";
+        case SIGNED_COMMAND_MALFORMED:      return "malformed";
+        case SIGNED_COMMAND_BAD_MAC:        return "bad MAC";
+        case SIGNED_COMMAND_REPLAYED:       return "replayed";
+        case SIGNED_COMMAND_STORE_FAILED:   return "floor not stored";
+        default:                            return "unknown";
+    }
+}
@@ -2,15 +2,21 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stddef.h>
+#include <time.h>
+#include <sys/time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
 
 #include "driver/gpio.h"
+#include "gpio_hal_interface.h"
 
 #include "esp_system.h"
+#include "esp_attr.h"
 #include "esp_spi_flash.h"
 #include "esp_log.h"
 #include "esp_netif.h"
@@ -25,6 +31,7 @@
 #include "lwip/sockets.h"
 #include "lwip/dns.h"
 #include "lwip/netdb.h"
+#include "lwip/apps/sntp.h"
 
 #include "wifi_credentials.h"
 #include "mqtt_credentials.h"
@@ -32,6 +39,25 @@
 #include "mqtt_interface.h"
 #include "wifi_interface.h"
 #include "garage_state_machine.h"
+#include "garage_controller.h"
+#include "garage_command.h"
+#include "garage_schedule.h"
+#include "history_log.h"
+#include "metrics.h"
+#include "garage_scenario.h"
+#include "latency_histogram.h"
+#include "http_control.h"
+#include "http_server.h"
+#include "udp_control.h"
+#include "udp_server.h"
+#include "signed_command.h"
+#include "distance_sensor.h"
+#include "distance_hal_interface.h"
+#include "log_ring.h"
+#include "syslog_sink.h"
+#include "syslog_udp.h"
+#include "diag_report.h"
+#include "wall_clock.h"
 
 #define ON_BOARD_LED_PIN GPIO_Pin_2 // D4 pin
 #define ON_BOARD_LED GPIO_NUM_2 // D4
@@ -39,193 +65,1081 @@
 #define REED_SWITCH_INPUT_GPIO GPIO_NUM_4 // D2
 #define RELAY_CONTROL_OUTPUT_PIN GPIO_Pin_5 // D1
 #define RELAY_CONTROL_OUTPUT_GPIO GPIO_NUM_5 // D1
+#define DISTANCE_TRIGGER_GPIO GPIO_NUM_12 // D6
+#define DISTANCE_ECHO_GPIO GPIO_NUM_13 // D7, through a divider: the HC-SR04 answers at 5 V
 
 #define ESP_MAXIMUM_WIFI_RETRY  10
 #define WIFI_RETRY_INTERVAL_MS  (30 * 60 * 1000) // 30 minutes in milliseconds
 
+#define DOOR_TIMEOUT_MS         15000   // OPENING/CLOSING resolve after this long
+#define DOOR_OPEN_TRAVEL_MS     12000   // Measured full travel, used for the position estimate
+#define DOOR_CLOSE_TRAVEL_MS    12000   // Starting point; refined from reed switch closes
+#define POSITION_STEP_PCT       10      // Publish the position every 10% of travel
+
+#define SCHEDULE_RULE_TEXT_MAX  48      // Longest rule payload accepted from the broker
+#define SCHEDULE_QUEUE_WAIT_MS  250     // MQTT task blocks this long on a full rule queue
+#define CLOCK_CHECK_S           60      // Re-read the system time (and the local time of day) this often
+#define CLOCK_WAIT_CHECK_S      1       // ... and this often until SNTP has set it
+
+#define HISTORY_FLUSH_INTERVAL_MS   60000   // Batched history records are programmed at least this often
+#define HISTORY_CHUNK_RECORDS       8       // Records per page publish
+
+#define METRICS_PUBLISH_INTERVAL_MS 60000   // The metrics JSON is published this often
+#define METRICS_JSON_MAX            1280
+
+#define COMMAND_KEY_NAMESPACE   "garage"    // NVS namespace of the signed command key and floor
+#define COMMAND_KEY_NAME        "cmd_key"   // Blob, the HMAC key
+#define COMMAND_FLOOR_NAME      "cmd_floor" // u32, see signed_command.h
+#define COMMAND_KEY_MAX         64
+
+#define DISTANCE_SAMPLE_PERIOD_MS   100     // 10 Hz; the HC-SR04 needs at least 60 ms between pings
+#define DISTANCE_HYSTERESIS_MM      100
+#define DISTANCE_MAX_RANGE_MM       4000    // Rated range of the HC-SR04
+
+#define SYSLOG_RATE_PER_S           20      // Log lines per second sent to the collector, sustained
+#define SYSLOG_BURST                60      // ... and back to back after a quiet spell
+#define SYSLOG_FLUSH_INTERVAL_MS    1000    // The log ring is shipped this often
+
+// Bearer token for POST on the LAN HTTP endpoint. Define it next to the broker credentials
+// in mqtt_credentials.h; without it the endpoint is read-only.
+#ifndef HTTP_CONTROL_TOKEN
+#define HTTP_CONTROL_TOKEN ""
+#endif
+
+// Shared key for the UDP control channel, defined in mqtt_credentials.h like the token above.
+// Without it the UDP channel is not started.
+#ifndef UDP_CONTROL_KEY
+#define UDP_CONTROL_KEY ""
+#endif
+
+// Broker CA certificate (PEM), defined in mqtt_credentials.h like the token above. With it the
+// client connects over TLS to MQTT_TLS_PORT and trusts only this CA; without it, plain TCP.
+#ifndef MQTT_BROKER_CA_PEM
+#define MQTT_BROKER_CA_PEM NULL
+#endif
+#define MQTT_TCP_PORT 1883
+#define MQTT_TLS_PORT 8883
+
+// Set to 1 in mqtt_credentials.h so only signed commands (signed_command.h) and signed UDP frames
+// can move the door. Plain OPEN/CLOSE/STOP and schedule rules over MQTT are then refused, since a
+// rule can close the door or lock out OPEN. The HTTP endpoint's bearer token is not a signature,
+// so HTTP is then read-only.
+#ifndef SIGNED_COMMANDS_REQUIRED
+#define SIGNED_COMMANDS_REQUIRED 0
+#endif
+
+// Syslog collector for the log lines (dotted quad), defined in mqtt_credentials.h like the token
+// above. Without it the lines go to the UART only.
+#ifndef SYSLOG_COLLECTOR
+#define SYSLOG_COLLECTOR ""
+#endif
+#ifndef SYSLOG_PORT
+#define SYSLOG_PORT 514
+#endif
+#ifndef SYSLOG_HOSTNAME
+#define SYSLOG_HOSTNAME "garage-door"
+#endif
+
+// SNTP server and POSIX TZ string for the local time the schedule works in, overridable in
+// mqtt_credentials.h. Payload timestamps are always UTC.
+#ifndef SNTP_SERVER
+#define SNTP_SERVER "pool.ntp.org"
+#endif
+#ifndef LOCAL_TIMEZONE
+#define LOCAL_TIMEZONE "UTC0"
+#endif
+
+// Payload format of the metrics and history page topics, set per topic in mqtt_credentials.h:
+// 0 for JSON, 1 for CBOR with the fixed schemas in metrics.h and history_log.h, at a fraction
+// of the size. test/decode/payload_decode turns the CBOR back into the JSON.
+#ifndef METRICS_PAYLOAD_CBOR
+#define METRICS_PAYLOAD_CBOR 0
+#endif
+#ifndef HISTORY_PAYLOAD_CBOR
+#define HISTORY_PAYLOAD_CBOR 0
+#endif
+
+// Optional ceiling distance sensor, calibrated in mqtt_credentials.h. See distance_sensor.h.
+#ifndef DISTANCE_SENSOR_ENABLED
+#define DISTANCE_SENSOR_ENABLED 0
+#endif
+#ifndef DISTANCE_DOOR_MAX_MM
+#define DISTANCE_DOOR_MAX_MM 600        // Readings up to this are the open door's panel
+#endif
+#ifndef DISTANCE_CAR_MAX_MM
+#define DISTANCE_CAR_MAX_MM 1600        // Readings up to this are a car, beyond it the floor
+#endif
+
 /* Timer handle */
 TimerHandle_t wifi_retry_timer_handle;
-TimerHandle_t state_machine_timer_handle;
 
 static const char* APP_TAG = "app";
-static const char* REED_SWITCH_TAG = "reed_switch";
 static const char* STATE_MACHINE_TAG = "state_machine";
-static const char* TIMER_TAG = "timer";
-static const char* COMMAND_OPEN = "OPEN";
-static const char* COMMAND_CLOSE = "CLOSE";
+static const char* COMMAND_OPEN = GARAGE_COMMAND_OPEN;
+static const char* COMMAND_CLOSE = GARAGE_COMMAND_CLOSE;
+static const char* COMMAND_STOP = GARAGE_COMMAND_STOP;
+
+#if defined(TEST_MODE) && defined(BENCH_MODE)
+#error "TEST_MODE and BENCH_MODE are mutually exclusive"
+#endif
 
 #ifdef TEST_MODE
 #define STATUS_TOPIC "garage_door/status_TEST"
 #define AVAILABILITY_TOPIC "garage_door/availability_TEST"
 #define COMMAND_TOPIC "garage_door/buttonpress_TEST"
+#define POSITION_TOPIC "garage_door/position_TEST"
+#define ATTRIBUTES_TOPIC "garage_door/attributes_TEST"
+#define OCCUPANCY_TOPIC "garage_door/occupancy_TEST"
+#define SCHEDULE_RULES_PREFIX "garage_door/schedule_TEST/rules/"
+#define SCHEDULE_EVENT_TOPIC "garage_door/schedule_TEST/event"
+#define HISTORY_QUERY_TOPIC "garage_door/history_TEST/get"
+#define HISTORY_PAGE_TOPIC "garage_door/history_TEST/page"
+#define METRICS_TOPIC "garage_door/metrics_TEST"
 
 static bool test_mode_wifi_ready = false;
 static bool test_mode_mqtt_ready = false;
-static const char* REED_SWITCH_OPEN_TAG = "OPEN";
-static const char* REED_SWITCH_CLOSE_TAG = "CLOSED";
+#elif defined(BENCH_MODE)
+#define STATUS_TOPIC "garage_door/status_BENCH"
+#define AVAILABILITY_TOPIC "garage_door/availability_BENCH"
+#define COMMAND_TOPIC "garage_door/buttonpress_BENCH"
+#define POSITION_TOPIC "garage_door/position_BENCH"
+#define ATTRIBUTES_TOPIC "garage_door/attributes_BENCH"
+#define OCCUPANCY_TOPIC "garage_door/occupancy_BENCH"
+#define SCHEDULE_RULES_PREFIX "garage_door/schedule_BENCH/rules/"
+#define SCHEDULE_EVENT_TOPIC "garage_door/schedule_BENCH/event"
+#define HISTORY_QUERY_TOPIC "garage_door/history_BENCH/get"
+#define HISTORY_PAGE_TOPIC "garage_door/history_BENCH/page"
+#define METRICS_TOPIC "garage_door/metrics_BENCH"
+#define BENCH_RESULTS_TOPIC "garage_door/bench_BENCH/"    // + histogram name
+
+// The relay output is looped back into this input with a jumper (D1 -> D5).
+// The bench rig must NOT be wired to the opener: every iteration presses the button.
+#define LOOPBACK_INPUT_PIN GPIO_Pin_14 // D5
+#define LOOPBACK_INPUT_GPIO GPIO_NUM_14 // D5
+
+#define BENCH_ITERATIONS        2000
+#define BENCH_RELAY_PULSE_MS    100     // Shorter than a real press; nothing is connected
+#define BENCH_STEP_TIMEOUT_MS   2000    // Counted as a timeout, not recorded
+#define BENCH_SETTLE_MS         200     // Relay pulse and the OPENING status publish finish
+
+static SemaphoreHandle_t bench_relay_edge_sem = NULL;
+static SemaphoreHandle_t bench_published_sem = NULL;
+static volatile int64_t bench_command_rx_us = 0;        // mqtt_data_callback entry for the last command
+static volatile int64_t bench_relay_edge_us = 0;        // Rising edge seen on the loopback input
+static volatile int bench_status_msg_id = -1;           // Last QoS 1 status publish
+static volatile int64_t bench_published_us = 0;
+
+// Recent acknowledgements. A fast PUBACK can arrive before mqtt_publish has returned the
+// status message ID, so acks are kept until the waiter knows which one it wants.
+#define BENCH_ACKS_MAX          4
+static volatile int bench_ack_msg_id[BENCH_ACKS_MAX] = { -1, -1, -1, -1 };
+static volatile int64_t bench_ack_us[BENCH_ACKS_MAX];
+static volatile unsigned bench_ack_next = 0;
 #else
 #define STATUS_TOPIC "garage_door/status"
 #define AVAILABILITY_TOPIC "garage_door/availability"
 #define COMMAND_TOPIC "garage_door/buttonpress"
+#define POSITION_TOPIC "garage_door/position"
+#define ATTRIBUTES_TOPIC "garage_door/attributes"
+#define OCCUPANCY_TOPIC "garage_door/occupancy"
+#define SCHEDULE_RULES_PREFIX "garage_door/schedule/rules/"     // + rule id, retained
+#define SCHEDULE_EVENT_TOPIC "garage_door/schedule/event"
+#define HISTORY_QUERY_TOPIC "garage_door/history/get"
+#define HISTORY_PAGE_TOPIC "garage_door/history/page"
+#define METRICS_TOPIC "garage_door/metrics"
+#endif
+
+// Diagnostics build (the DIAG preset): FreeRTOS keeps run time counters and task state for
+// the reports on the debug topics. The SDK options come from sdkconfig.diag.
+#ifdef DIAG_MODE
+#if !CONFIG_FREERTOS_USE_TRACE_FACILITY || !CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+#error "DIAG_MODE needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS (sdkconfig.diag)"
+#endif
+#define DEBUG_COMMAND_TOPIC "garage_door/debug/cmd"
+#define DEBUG_REPORT_TOPIC "garage_door/debug/report"
 #endif
 
-// State machine instance
-static garage_state_machine_t state_machine;
+// Door controller instance (state machine + relay). Owned by state_machine_handler:
+// no other task may call into it.
+static garage_controller_t controller;
+
+// Copy of the controller fields other tasks read (scenario runner, HTTP endpoint), updated by
+// the owner. The critical section keeps the 64-bit timestamp from tearing.
+static garage_controller_snapshot_t controller_snapshot;
 
 // state machine event queue handle
 static xQueueHandle state_machine_queue = NULL;
 
-/// @brief GPIO interrupt handler for the reed switch input pin.
-/// @param arg Will only be REED_SWITCH_TAG to indicate the source of the interrupt. 
-static void gpio_isr_handler(void *arg)
+// Auto-close, reminder and lockout rules. Owned by state_machine_handler like the controller;
+// rules arrive from the MQTT task through schedule_queue.
+typedef struct {
+    char id[GARAGE_SCHEDULE_ID_MAX];
+    char text[SCHEDULE_RULE_TEXT_MAX];
+    int id_len;
+    int text_len;
+} schedule_rule_msg_t;
+
+static garage_schedule_t schedule;
+static xQueueHandle schedule_queue = NULL;
+
+// Door history in its flash partition. Owned by history_task; other tasks post records and
+// page requests to history_queue and never wait on flash.
+typedef enum {
+    HISTORY_MSG_RECORD = 0,
+    HISTORY_MSG_QUERY
+} history_msg_type_t;
+
+typedef struct {
+    history_msg_type_t type;
+    history_kind_t kind;            // RECORD
+    uint32_t time_s;
+    uint8_t args[3];
+    uint32_t since_seq;             // QUERY
+    int count;
+} history_msg_t;
+
+static history_log_t history_log;
+static xQueueHandle history_queue = NULL;
+
+// UDP control channel. Commands are handled by udp_control_task, notifications are sent by
+// state_machine_handler once the notification socket is open.
+static udp_control_t udp_control;
+static volatile int udp_notify_fd = -1;
+
+// Recent log lines for the syslog collector. Every task logs, so log_capture_putchar adds to the
+// ring inside a critical section; syslog_task is the only reader and the only user of the sink.
+static log_ring_t log_ring;
+static putchar_like_t uart_putchar = NULL;
+static syslog_sink_t syslog_sink;
+
+// Time since boot to UTC, for payload timestamps. Written by the owner as it follows SNTP and read
+// by every publisher; the critical section keeps the 64-bit offset from tearing.
+static wall_clock_t wall_clock;
+
+// Signed command verification, used only by the MQTT task. The replay window is kept in RTC
+// memory so a software reset does not reopen it; signed_command_init detects a power-on.
+static uint8_t command_key[COMMAND_KEY_MAX];
+static RTC_DATA_ATTR signed_command_window_t command_window;
+static signed_command_verifier_t command_verifier;
+
+// Distance sensor pipeline. Owned by distance_timer_callback on the timer daemon task; door
+// edges go to state_machine_queue and the occupancy is left for the owner to publish. The
+// owner starts and stops the timer, and asks for a restart rather than touching the filter.
+static distance_sensor_t distance_sensor;
+static TimerHandle_t distance_timer = NULL;
+static volatile bool distance_restart = false;
+static volatile distance_occupancy_t distance_occupancy = DISTANCE_OCCUPANCY_UNKNOWN;
+
+/// @brief Copies the UTC mapping. Safe from any task.
+static wall_clock_t wall_clock_get(void)
 {
-    char* input = (char*) arg;
-    xQueueSendFromISR(state_machine_queue, &input, NULL);
+    portENTER_CRITICAL();
+    wall_clock_t clock = wall_clock;
+    portEXIT_CRITICAL();
+    return clock;
 }
 
-/// @brief Simulates a garage door button press by toggling the relay control pin.
-/// @param arg Unused, only required for task signature.
-static void button_press_task(void *arg)
+/// @brief Adds the current UTC time to a JSON payload as "time", once SNTP has set the clock.
+/// Safe from any task.
+/// @return New length (unchanged before the first sync)
+static int stamp_json(char* json, int len, size_t size)
 {
-    // Simulate button press by setting relay control pin low for 500ms
-    gpio_set_level(RELAY_CONTROL_OUTPUT_GPIO, 1);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    gpio_set_level(RELAY_CONTROL_OUTPUT_GPIO, 0);
-    vTaskDelete(NULL);
+    wall_clock_t clock = wall_clock_get();
+    int64_t utc_ms;
+    if (len <= 0 || !wall_clock_to_utc_ms(&clock, gpio_hal_get_time_us() / 1000, &utc_ms)) {
+        return len;
+    }
+    return wall_clock_stamp_json(json, len, size, utc_ms);
 }
 
-/// @brief Starts the button press task to simulate a garage door button press.
-static void start_button_press_task()
+/// @brief Queues a history record stamped with the time since boot. Safe from any task; never blocks.
+/// @param full The calling task's own queue_full counter, bumped if the record is dropped
+static void history_note_from(metric_id_t full, history_kind_t kind, uint8_t arg0, uint8_t arg1, uint8_t arg2)
 {
-    xTaskCreate(button_press_task, "button_press_task", 2048, NULL, 15, NULL);
+    history_msg_t msg = {
+        .type = HISTORY_MSG_RECORD,
+        .kind = kind,
+        .time_s = (uint32_t) (gpio_hal_get_time_us() / 1000000),
+        .args = { arg0, arg1, arg2 },
+    };
+    if (history_queue != NULL && xQueueSend(history_queue, &msg, 0) != pdTRUE) {
+        metrics_inc(full);
+        ESP_LOGW(APP_TAG, "History queue full, dropping record");
+    }
 }
 
-/// @brief Timer callback that updates the state machine timer periodically.
-static void state_machine_timer_callback(TimerHandle_t xTimer)
+/// @brief Queues a history record from the owner.
+static void history_note(history_kind_t kind, uint8_t arg0, uint8_t arg1, uint8_t arg2)
 {
-    garage_transition_result_t result = garage_sm_update_timer(&state_machine, 100);
-    
-    if (result.state_changed) {
-        ESP_LOGI(TIMER_TAG, "Timer expired, transitioning to %s", garage_state_to_string(result.new_state));
-        
-        if (result.actions.publish_state) {
-            mqtt_publish(STATUS_TOPIC, garage_state_to_string(result.new_state), 0, 1);
-            ESP_LOGI(STATE_MACHINE_TAG, "Published state due to timer: %s", garage_state_to_string(result.new_state));
-        }
+    history_note_from(METRIC_HISTORY_FULL_OWNER, kind, arg0, arg1, arg2);
+}
+
+/// @brief Records a transition the controller just made, and counts the state entered. Called by the owner only.
+static void history_note_transition(garage_state_t from, const garage_transition_result_t* result)
+{
+    if (result->state_changed) {
+        history_note(HISTORY_TRANSITION, (uint8_t) from, (uint8_t) result->new_state, 0);
+        metrics_inc(metrics_state_entries(result->new_state));
+    }
+}
+
+/// @brief GPIO interrupt handler for the reed switch input pin.
+/// @param arg Unused. The pin level is sampled when the input is handled.
+static void gpio_isr_handler(void *arg)
+{
+    garage_input_t input = GARAGE_INPUT_REED_SWITCH;
+    if (xQueueSendFromISR(state_machine_queue, &input, NULL) != pdTRUE) {
+        metrics_inc(METRIC_INPUT_FULL_REED);
     }
 }
 
-/// @brief Converts input string to garage event type
-/// @param input The input string from the queue
-/// @param sensor_level The GPIO level if input is REED_SWITCH_TAG, otherwise ignored
-/// @return The corresponding garage event
-static garage_event_t input_to_event(const char* input, int sensor_level)
+/// @brief Publishes the obstruction flag and maintenance counts (retained) as JSON attributes,
+/// with the UTC time once it is known.
+static void publish_attributes(void)
 {
-    #ifdef TEST_MODE
-    if (input == REED_SWITCH_OPEN_TAG || input == REED_SWITCH_CLOSE_TAG) {
-    #else
-    if (input == REED_SWITCH_TAG) {
-    #endif
-        return sensor_level == 0 ? GARAGE_EVENT_SENSOR_CLOSED : GARAGE_EVENT_SENSOR_OPEN;
-    } else if (input == COMMAND_OPEN) {
-        return GARAGE_EVENT_COMMAND_OPEN;
-    } else if (input == COMMAND_CLOSE) {
-        return GARAGE_EVENT_COMMAND_CLOSE;
+    char json[160];
+    int len = garage_sm_attributes_to_json(&controller.sm, json, sizeof(json));
+    if (len > 0) {
+        stamp_json(json, len, sizeof(json));
+        ESP_LOGI(STATE_MACHINE_TAG, "Publishing attributes: %s", json);
+        mqtt_publish(ATTRIBUTES_TOPIC, json, 0, 1);
     }
-    return GARAGE_EVENT_NONE;
 }
 
-/// @brief Executes actions returned by state machine
+/// @brief Executes the actions returned by the controller that are not hardware related.
+/// The relay pulse itself is driven by the controller.
 /// @param actions The actions to execute
 /// @param new_state The new state after transition
 static void execute_state_actions(const garage_actions_t* actions, garage_state_t new_state)
 {
     if (actions->trigger_button_press) {
         ESP_LOGI(STATE_MACHINE_TAG, "Triggering button press");
-        start_button_press_task();
     }
     
     if (actions->publish_state) {
         const char* state_str = garage_state_to_string(new_state);
         ESP_LOGI(STATE_MACHINE_TAG, "Publishing state: %s", state_str);
+#ifdef BENCH_MODE
+        // QoS 1 so the broker acknowledges it and MQTT_EVENT_PUBLISHED fires
+        bench_status_msg_id = mqtt_publish(STATUS_TOPIC, state_str, 1, 1);
+        // The ack may already be in; wake the waiter to look for it
+        xSemaphoreGive(bench_published_sem);
+#else
         mqtt_publish(STATUS_TOPIC, state_str, 0, 1);
+#endif
+    }
+
+    // Also on every state change, so the attributes' "time" is when the state last changed
+    if (actions->publish_attributes || actions->publish_state) {
+        publish_attributes();
+    }
+}
+
+/// @brief Publishes the position estimate when it has moved by a step or reached an endpoint.
+/// Rate limiting is done by the controller, so this is cheap to call on every wake-up.
+static void publish_position(void)
+{
+    int position;
+    if (garage_controller_poll_position(&controller, &position)) {
+        char payload[8];
+        snprintf(payload, sizeof(payload), "%d", position);
+        if (mqtt_publish(POSITION_TOPIC, payload, 0, 1) >= 0) {
+            garage_controller_position_published(&controller, position);
+        }
+    }
+}
+
+/// @brief Publishes the controller fields read by other tasks. Called by the owner only.
+static void update_controller_snapshot(void)
+{
+    garage_controller_snapshot_t snapshot;
+    garage_controller_get_snapshot(&controller, &snapshot);
+    portENTER_CRITICAL();
+    controller_snapshot = snapshot;
+    portEXIT_CRITICAL();
+}
+
+/// @brief Multicasts a UDP notification when the state changed or a heartbeat is due. Called by the owner only.
+static void notify_udp(void)
+{
+    int fd = udp_notify_fd;
+    uint8_t frame[UDP_FRAME_LEN];
+    if (fd >= 0 && udp_control_poll_notification(&udp_control, &controller_snapshot,
+                                                 gpio_hal_get_time_us() / 1000, frame)) {
+        udp_server_notify(fd, UDP_CONTROL_NOTIFY_GROUP, UDP_CONTROL_PORT, frame);
+    }
+}
+
+/// @brief Publishes a scheduler event as JSON. Called by the owner only.
+static void publish_schedule_event(const garage_schedule_event_t* event)
+{
+    char json[128];
+    int len = garage_schedule_event_to_json(event, json, sizeof(json));
+    if (len > 0) {
+        stamp_json(json, len, sizeof(json));
+        ESP_LOGI(STATE_MACHINE_TAG, "Schedule: %s", json);
+        mqtt_publish(SCHEDULE_EVENT_TOPIC, json, 0, 0);
+    }
+}
+
+/// @brief Checks a command against the lockout windows, publishing the refusal if it is refused.
+/// @param input Input about to be handed to the controller
+/// @return true if the input may go ahead
+static bool schedule_allows(garage_input_t input)
+{
+    garage_schedule_event_t refused;
+    if (garage_schedule_check_command(&schedule, input, &refused)) {
+        return true;
+    }
+    publish_schedule_event(&refused);
+    return false;
+}
+
+/// @brief Applies rules received over MQTT and reports each outcome on the event topic.
+static void apply_schedule_rules(uint32_t now_s)
+{
+    schedule_rule_msg_t msg;
+    while (xQueueReceive(schedule_queue, &msg, 0)) {
+        garage_schedule_status_t status = garage_schedule_set_rule(&schedule, msg.id, msg.id_len,
+                                                                   msg.text, msg.text_len, now_s);
+        char json[96];
+        int len = snprintf(json, sizeof(json), "{\"rule\":\"%.*s\",\"status\":\"%s\"}", msg.id_len, msg.id,
+                           garage_schedule_status_to_string(status));
+        stamp_json(json, len, sizeof(json));
+        ESP_LOGI(STATE_MACHINE_TAG, "Schedule: %s", json);
+        mqtt_publish(SCHEDULE_EVENT_TOPIC, json, 0, 0);
+    }
+}
+
+/// @brief Follows the system time SNTP sets: every second until the first sync, then once a minute.
+/// Updates the UTC mapping, records it in the history when it is set or steps, and feeds the
+/// local time of day to the lockout windows (unknown until the first sync). Called by the owner only.
+static void update_clock(uint32_t now_s)
+{
+    static bool checked = false;
+    static uint32_t last_check_s;
+    if (checked && now_s - last_check_s < (wall_clock.synced ? CLOCK_CHECK_S : CLOCK_WAIT_CHECK_S)) {
+        return;
+    }
+    checked = true;
+    last_check_s = now_s;
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t mono_ms = gpio_hal_get_time_us() / 1000;
+    wall_clock_t clock = wall_clock;
+    bool stepped = wall_clock_update(&clock, mono_ms, (int64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000);
+    portENTER_CRITICAL();
+    wall_clock = clock;
+    portEXIT_CRITICAL();
+    if (stepped) {
+        // The record's time is UTC and its arguments the uptime (history_log.h)
+        uint32_t up_s = (uint32_t) (mono_ms / 1000);
+        history_msg_t msg = {
+            .type = HISTORY_MSG_RECORD,
+            .kind = HISTORY_CLOCK,
+            .time_s = (uint32_t) tv.tv_sec,
+            .args = { (uint8_t) up_s, (uint8_t) (up_s >> 8), (uint8_t) (up_s >> 16) },
+        };
+        if (xQueueSend(history_queue, &msg, 0) != pdTRUE) {
+            metrics_inc(METRIC_HISTORY_FULL_OWNER);
+        }
+        ESP_LOGI(APP_TAG, "Clock set by SNTP: %u s after boot is %ld UTC", (unsigned) up_s, (long) tv.tv_sec);
+    }
+
+    time_t now = (time_t) tv.tv_sec;
+    struct tm local;
+    int32_t seconds_of_day = GARAGE_SCHEDULE_TIME_UNKNOWN;
+    if (clock.synced && localtime_r(&now, &local) != NULL) {
+        seconds_of_day = local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec;
+    }
+    garage_schedule_set_time_of_day(&schedule, seconds_of_day, now_s);
+}
+
+/// @brief Runs the scheduler on the owner's tick: new rules, the door state, and due timers.
+/// Auto-close goes straight to the controller, so it is not subject to a lockout.
+static void run_schedule(void)
+{
+    uint32_t now_s = (uint32_t) (gpio_hal_get_time_us() / 1000000);
+
+    apply_schedule_rules(now_s);
+    update_clock(now_s);
+    garage_schedule_on_state(&schedule, garage_controller_get_state(&controller), now_s);
+    // No unattended close into an obstruction: wait for a close that stays closed
+    garage_schedule_suspend_auto_close(&schedule, controller.sm.obstructed || controller.sm.close_failures > 0);
+
+    garage_schedule_event_t events[4];
+    int count = garage_schedule_tick(&schedule, now_s, events, 4);
+    for (int i = 0; i < count; i++) {
+        publish_schedule_event(&events[i]);
+        if (events[i].kind == GARAGE_SCHEDULE_EVENT_AUTO_CLOSE) {
+            garage_state_t before = garage_controller_get_state(&controller);
+            garage_transition_result_t result = garage_controller_handle_input(&controller,
+                                                                               GARAGE_INPUT_COMMAND_CLOSE);
+            history_note(HISTORY_COMMAND, GARAGE_INPUT_COMMAND_CLOSE, 1, HISTORY_SOURCE_SCHEDULE);
+            history_note_transition(before, &result);
+            execute_state_actions(&result.actions, result.new_state);
+            garage_schedule_on_state(&schedule, result.new_state, now_s);
+        }
+    }
+}
+
+/// @brief Runs the distance sensor only while it can see something new: in every state but
+/// CLOSED, and for a while after the door closes. Called by the owner only.
+static void update_distance_sampling(void)
+{
+    static bool sampling = false;
+    if (distance_timer == NULL) {
+        return;
+    }
+
+    int64_t now_us = gpio_hal_get_time_us();
+    int64_t ms_in_state = (now_us - garage_controller_get_last_transition_us(&controller)) / 1000;
+    bool needed = distance_sensor_sampling_needed(garage_controller_get_state(&controller), ms_in_state);
+    if (needed && !sampling) {
+        distance_restart = true;
+        sampling = xTimerStart(distance_timer, 0) == pdPASS;
+    } else if (!needed && sampling) {
+        sampling = xTimerStop(distance_timer, 0) != pdPASS;
+    }
+}
+
+// Last occupancy the broker accepted. Owner only; forgotten on connect so a new session gets it.
+static distance_occupancy_t occupancy_published = DISTANCE_OCCUPANCY_UNKNOWN;
+
+/// @brief Publishes the occupancy (retained) when the sampling timer has seen it change, until a
+/// publish succeeds. Called by the owner only.
+static void publish_occupancy(void)
+{
+    distance_occupancy_t occupancy = distance_occupancy;
+    if (occupancy != occupancy_published) {
+        if (mqtt_publish(OCCUPANCY_TOPIC, distance_occupancy_to_string(occupancy), 0, 1) >= 0) {
+            ESP_LOGI(STATE_MACHINE_TAG, "Car %s", distance_occupancy_to_string(occupancy));
+            occupancy_published = occupancy;
+        }
     }
 }
 
-/// @brief State machine handler task that processes events from the state machine queue.
-/// This will read from the state_machine_queue and update the garage door state accordingly.
+/// @brief Reads the snapshot published by the owner. Safe from any task.
+static garage_controller_snapshot_t read_controller_snapshot(void)
+{
+    portENTER_CRITICAL();
+    garage_controller_snapshot_t snapshot = controller_snapshot;
+    portEXIT_CRITICAL();
+    return snapshot;
+}
+
+/// @brief State machine handler task: the single owner of the controller.
+/// Handles inputs from the state_machine_queue and keeps controller time (relay pulse and
+/// state machine timeout) itself, blocking on the queue only until the next tick is due.
+/// Ticking from a timer callback instead would run the state machine concurrently on the
+/// timer daemon task.
 /// @param arg Unused
 static void state_machine_handler(void *arg)
 {
-    char* input;
+    garage_input_t input;
+    uint32_t obstructions_noted = 0;
 
+    update_controller_snapshot();
     for (;;) {
-        // Wait for events from the queue
-        if (xQueueReceive(state_machine_queue, &input, portMAX_DELAY)) {
-            ESP_LOGI(STATE_MACHINE_TAG, "State machine received input: %s", input);
-
-            int sensor_level = 0;
-            #ifdef TEST_MODE
-            if (input == REED_SWITCH_OPEN_TAG) {
-                sensor_level = 1;
-            } else if (input == REED_SWITCH_CLOSE_TAG) {
-                sensor_level = 0;
+        int wait_ms = garage_controller_ms_until_tick(&controller, gpio_hal_get_time_us());
+        TickType_t wait_ticks = pdMS_TO_TICKS(wait_ms);
+        if (wait_ms > 0 && wait_ticks == 0) {
+            wait_ticks = 1;
+        }
+
+        if (xQueueReceive(state_machine_queue, &input, wait_ticks)) {
+            int64_t received_us = gpio_hal_get_time_us();
+            ESP_LOGI(STATE_MACHINE_TAG, "State machine received input: %s", garage_input_to_string(input));
+            if (input == GARAGE_INPUT_MQTT_CONNECTED) {
+                occupancy_published = DISTANCE_OCCUPANCY_UNKNOWN;
+            }
+
+            bool is_command = input == GARAGE_INPUT_COMMAND_OPEN || input == GARAGE_INPUT_COMMAND_CLOSE ||
+                              input == GARAGE_INPUT_COMMAND_STOP;
+            bool allowed;
+            if (is_command && garage_controller_is_pressing(&controller)) {
+                ESP_LOGW(STATE_MACHINE_TAG, "Refusing %s while the button is being pressed",
+                         garage_input_to_string(input));
+                allowed = false;
+            } else {
+                allowed = schedule_allows(input);
             }
-            #else
-            if (input == REED_SWITCH_TAG) {
-                sensor_level = gpio_get_level(REED_SWITCH_INPUT_GPIO);
+            if (is_command) {
+                history_note(HISTORY_COMMAND, (uint8_t) input, allowed ? 1 : 0, HISTORY_SOURCE_REMOTE);
             }
-            #endif
+            if (allowed) {
+                garage_state_t before = garage_controller_get_state(&controller);
+                garage_transition_result_t result = garage_controller_handle_input(&controller, input);
+                history_note_transition(before, &result);
 
-            // Convert input to event and process it
-            garage_event_t event = input_to_event(input, sensor_level);
-            if (event != GARAGE_EVENT_NONE) {
-                garage_transition_result_t result = garage_sm_process_event(&state_machine, event);
-                
                 if (result.state_changed) {
-                    ESP_LOGI(STATE_MACHINE_TAG, "State changed to: %s", 
+                    ESP_LOGI(STATE_MACHINE_TAG, "State changed to: %s",
                             garage_state_to_display_string(result.new_state));
                 }
-                
+
                 execute_state_actions(&result.actions, result.new_state);
             }
+            metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, gpio_hal_get_time_us() - received_us);
+        }
+
+        garage_state_t before = garage_controller_get_state(&controller);
+        garage_transition_result_t result = garage_controller_tick_to(&controller, gpio_hal_get_time_us());
+        history_note_transition(before, &result);
+        if (result.state_changed) {
+            ESP_LOGI(STATE_MACHINE_TAG, "Timer expired, transitioning to %s", garage_state_to_string(result.new_state));
+        }
+        execute_state_actions(&result.actions, result.new_state);
+
+        run_schedule();
+        update_distance_sampling();
+        publish_position();
+        publish_occupancy();
+        update_controller_snapshot();
+        notify_udp();
+
+        // An overdue close is recorded once it can no longer turn out to be just slow
+        uint32_t obstructions = garage_sm_confirmed_obstruction_count(&controller.sm);
+        if (obstructions > obstructions_noted) {
+            history_note(HISTORY_FAULT, HISTORY_FAULT_OBSTRUCTION, (uint8_t) controller_snapshot.state, 0);
         }
+        obstructions_noted = obstructions;
     }
 }
 
+#ifdef BENCH_MODE
+/// @brief GPIO interrupt handler for the loopback input: timestamps the relay edge.
+/// @param arg Unused
+static void bench_loopback_isr_handler(void *arg)
+{
+    bench_relay_edge_us = gpio_hal_get_time_us();
+    xSemaphoreGiveFromISR(bench_relay_edge_sem, NULL);
+}
+#endif
+
 /// @brief Sets up GPIOs for on-board LED, reed switch input (with gpio ISR handler), and relay control output.
 /// @param void.
 void gpio_init(void)
 {
-    // Setup on-board LED
-    gpio_config_t io_conf;
-    io_conf.intr_type = GPIO_INTR_DISABLE;
-    io_conf.mode = GPIO_MODE_OUTPUT;
-    //bit mask of the pins that you want to set,e.g.GPIO15/16
-    // This enables both the on-board LED and the relay control output pin.
-    io_conf.pin_bit_mask = ON_BOARD_LED_PIN | RELAY_CONTROL_OUTPUT_PIN;
-    io_conf.pull_down_en = GPIO_MODE_DISABLE;
-    io_conf.pull_up_en = GPIO_MODE_DISABLE;
-    gpio_config(&io_conf);
-
-    // Setup reed switch input pin
-    // interrupt on rising and falling edge.
-    io_conf.intr_type = GPIO_INTR_ANYEDGE;
-    io_conf.mode = GPIO_MODE_INPUT;
-    // bit mask of the pins that you want to set,e.g.GPIO15/16
-    io_conf.pin_bit_mask = REED_SWITCH_INPUT_PIN;
-    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
-    io_conf.pull_down_en = GPIO_MODE_DISABLE;
-    gpio_config(&io_conf);
+    // Setup on-board LED and the relay control output pin.
+    gpio_hal_config_output(ON_BOARD_LED_PIN | RELAY_CONTROL_OUTPUT_PIN);
+
+    // Setup reed switch input pin, interrupt on rising and falling edge.
+    gpio_hal_config_input(REED_SWITCH_INPUT_PIN, GPIO_HAL_EDGE_ANY, true);
 
     // install gpio isr service
-    gpio_install_isr_service(0);
-    // hook isr handler for relay control pin. This handles reacting to the garage door state.
-    gpio_isr_handler_add(REED_SWITCH_INPUT_GPIO, gpio_isr_handler, (void *) REED_SWITCH_TAG);
+    gpio_hal_install_isr_service();
+    // hook isr handler for the reed switch pin. This handles reacting to the garage door state.
+    gpio_hal_isr_handler_add(REED_SWITCH_INPUT_GPIO, gpio_isr_handler, NULL);
+
+#ifdef BENCH_MODE
+    // Loopback input timestamps the relay edge. No pull-up: the relay output drives it.
+    gpio_hal_config_input(LOOPBACK_INPUT_PIN, GPIO_HAL_EDGE_RISING, false);
+    gpio_hal_isr_handler_add(LOOPBACK_INPUT_GPIO, bench_loopback_isr_handler, NULL);
+#endif
+}
+
+/// @brief Sampling timer callback: reads the ping started one period ago, feeds the filter and
+/// starts the next ping. Door edges are queued to the owner like reed switch edges; one that
+/// finds the queue full is retried on the next period.
+/// @param timer Unused
+static void distance_timer_callback(TimerHandle_t timer)
+{
+    static garage_input_t pending = GARAGE_INPUT_NONE;
+
+    if (distance_restart) {
+        // The ping in flight was started before sampling paused
+        distance_restart = false;
+        pending = GARAGE_INPUT_NONE;
+        distance_sensor_restart(&distance_sensor);
+    } else {
+        int mm = DISTANCE_SENSOR_NO_READING;
+        if (distance_hal_read_mm(&mm) != ESP_OK) {
+            mm = DISTANCE_SENSOR_NO_READING;
+        }
+        distance_sensor_change_t change = distance_sensor_add_sample(&distance_sensor, mm);
+        if (change.door_changed) {
+            pending = distance_sensor_door_open(&distance_sensor) ? GARAGE_INPUT_DISTANCE_OPEN
+                                                                  : GARAGE_INPUT_DISTANCE_CLEAR;
+        }
+        if (change.occupancy_changed) {
+            distance_occupancy = distance_sensor_get_occupancy(&distance_sensor);
+        }
+    }
+
+    if (pending != GARAGE_INPUT_NONE) {
+        if (xQueueSend(state_machine_queue, &pending, 0) == pdTRUE) {
+            pending = GARAGE_INPUT_NONE;
+        } else {
+            metrics_inc(METRIC_INPUT_FULL_DISTANCE);
+        }
+    }
+    distance_hal_start();
+}
+
+/// @brief Sets up the distance sensor and its sampling timer. The owner starts the timer.
+/// Needs the GPIO interrupt service, so it runs after gpio_init().
+static void distance_sensor_setup(void)
+{
+    const distance_sensor_config_t config = {
+        .door_max_mm = DISTANCE_DOOR_MAX_MM,
+        .car_max_mm = DISTANCE_CAR_MAX_MM,
+        .hysteresis_mm = DISTANCE_HYSTERESIS_MM,
+        .max_range_mm = DISTANCE_MAX_RANGE_MM,
+    };
+    distance_sensor_init(&distance_sensor, &config);
+
+    const distance_hal_config_t hal_config = {
+        .trigger_gpio = DISTANCE_TRIGGER_GPIO,
+        .echo_gpio = DISTANCE_ECHO_GPIO,
+    };
+    if (distance_hal_init(&hal_config) != ESP_OK) {
+        ESP_LOGE(APP_TAG, "Distance sensor setup failed, running on the reed switch alone");
+        return;
+    }
+    distance_timer = xTimerCreate("distance", pdMS_TO_TICKS(DISTANCE_SAMPLE_PERIOD_MS), pdTRUE, NULL,
+                                  distance_timer_callback);
+}
+
+/// @brief HTTP endpoint hook: commands join the same queue as MQTT commands.
+/// @return false if the queue is full (answered with 503)
+static bool http_queue_command(garage_input_t input, void* ctx)
+{
+    ESP_LOGI(APP_TAG, "Received %s command over HTTP", garage_input_to_string(input));
+    if (xQueueSend(state_machine_queue, &input, 0) != pdTRUE) {
+        metrics_inc(METRIC_INPUT_FULL_HTTP);
+        return false;
+    }
+    return true;
+}
+
+static void http_read_snapshot(garage_controller_snapshot_t* snapshot, void* ctx)
+{
+    *snapshot = read_controller_snapshot();
+}
+
+static http_control_t http_control;
+
+/// @brief LAN HTTP endpoint task: answers one connection at a time, forever.
+/// @param arg Unused
+static void http_server_task(void *arg)
+{
+    int listen_fd = http_server_listen(HTTP_SERVER_PORT);
+    if (listen_fd < 0) {
+        ESP_LOGE(APP_TAG, "HTTP server could not listen on port %d", HTTP_SERVER_PORT);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(APP_TAG, "HTTP server listening on port %d", HTTP_SERVER_PORT);
+
+    for (;;) {
+        int status = http_server_serve_one(listen_fd, &http_control);
+        if (status >= 400 || status < 0) {
+            ESP_LOGW(APP_TAG, "HTTP request answered with %d", status);
+        }
+    }
+}
+
+/// @brief Starts the HTTP endpoint the first time the station gets an address.
+static void start_http_server(void)
+{
+    static bool started = false;
+    if (started) {
+        return;
+    }
+    started = true;
+
+    const http_control_config_t http_cfg = {
+        .token = SIGNED_COMMANDS_REQUIRED ? "" : HTTP_CONTROL_TOKEN,
+        .on_command = http_queue_command,
+        .get_snapshot = http_read_snapshot,
+        .ctx = NULL,
+    };
+    http_control_init(&http_control, &http_cfg);
+    if (SIGNED_COMMANDS_REQUIRED) {
+        ESP_LOGW(APP_TAG, "SIGNED_COMMANDS_REQUIRED: HTTP endpoint is read-only");
+    } else if (HTTP_CONTROL_TOKEN[0] == '\0') {
+        ESP_LOGW(APP_TAG, "HTTP_CONTROL_TOKEN not set: HTTP endpoint is read-only");
+    }
+    xTaskCreate(http_server_task, "http_server", 3072, NULL, 5, NULL);
+}
+
+/// @brief UDP hook: commands join the same queue as MQTT commands.
+/// @return false if the queue is full (answered with BUSY)
+static bool udp_queue_command(garage_input_t input, void* ctx)
+{
+    ESP_LOGI(APP_TAG, "Received %s command over UDP", garage_input_to_string(input));
+    if (xQueueSend(state_machine_queue, &input, 0) != pdTRUE) {
+        metrics_inc(METRIC_INPUT_FULL_UDP);
+        return false;
+    }
+    return true;
+}
+
+static void udp_read_snapshot(garage_controller_snapshot_t* snapshot, void* ctx)
+{
+    *snapshot = read_controller_snapshot();
+}
+
+/// @brief Sets up the UDP channel with a fresh session. Called before the owner task starts.
+static void udp_control_setup(void)
+{
+    uint32_t session;
+    do {
+        session = esp_random();
+    } while (session == 0);
+
+    const udp_control_config_t udp_cfg = {
+        .key = (const uint8_t*) UDP_CONTROL_KEY,
+        .key_len = sizeof(UDP_CONTROL_KEY) - 1,
+        .session = session,
+        .position_step_pct = POSITION_STEP_PCT,
+        .heartbeat_ms = UDP_CONTROL_HEARTBEAT_MS,
+        .on_command = udp_queue_command,
+        .get_snapshot = udp_read_snapshot,
+        .ctx = NULL,
+    };
+    udp_control_init(&udp_control, &udp_cfg);
+}
+
+/// @brief UDP control task: answers signed commands, forever.
+/// @param arg Unused
+static void udp_control_task(void *arg)
+{
+    int fd = udp_server_open(UDP_CONTROL_PORT);
+    if (fd < 0) {
+        ESP_LOGE(APP_TAG, "UDP control could not bind port %d", UDP_CONTROL_PORT);
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(APP_TAG, "UDP control on port %d, notifications to %s", UDP_CONTROL_PORT, UDP_CONTROL_NOTIFY_GROUP);
+
+    for (;;) {
+        if (udp_server_serve_one(fd, &udp_control) == 0) {
+            ESP_LOGW(APP_TAG, "Dropped UDP datagram (%u so far)", (unsigned) udp_control.dropped);
+        }
+    }
+}
+
+/// @brief Starts the UDP channel the first time the station gets an address, if a key is set.
+static void start_udp_control(void)
+{
+    static bool started = false;
+    if (started) {
+        return;
+    }
+    started = true;
+
+    if (sizeof(UDP_CONTROL_KEY) == 1) {
+        ESP_LOGW(APP_TAG, "UDP_CONTROL_KEY not set: UDP control disabled");
+        return;
+    }
+    udp_notify_fd = udp_server_open_notifier();
+    xTaskCreate(udp_control_task, "udp_control", 2048, NULL, 9, NULL);
+}
+
+/// @brief Log output hook, for every task: each character still goes to the UART and is also
+/// collected into log_ring.
+static int log_capture_putchar(int ch)
+{
+    portENTER_CRITICAL();
+    log_ring_putc(&log_ring, ch);
+    portEXIT_CRITICAL();
+    return uart_putchar != NULL ? uart_putchar(ch) : ch;
+}
+
+/// @brief Sends the sink's packet to the collector and empties it. Called by syslog_task only.
+static void syslog_send_packet(int fd)
+{
+    syslog_sink_packet_done(&syslog_sink, syslog_udp_send(fd, syslog_sink.packet, syslog_sink.packet_len));
+}
+
+/// @brief Syslog task: every SYSLOG_FLUSH_INTERVAL_MS, ships the lines in log_ring to the collector,
+/// batched into packets and rate limited by syslog_sink, then a report of any drops. It logs nothing
+/// itself, so it cannot feed itself.
+/// @param arg Socket from syslog_udp_open
+static void syslog_task(void *arg)
+{
+    int fd = (int) (intptr_t) arg;
+    static char line[LOG_RING_LINE_MAX + 1];
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(SYSLOG_FLUSH_INTERVAL_MS));
+        wall_clock_t clock = wall_clock_get();
+        syslog_sink_set_clock(&syslog_sink, &clock);
+
+        // Only the lines already held, so lines logged meanwhile cannot keep the loop going
+        portENTER_CRITICAL();
+        uint32_t held = log_ring.lines - log_ring.removed;
+        portEXIT_CRITICAL();
+        for (uint32_t i = 0; i < held; i++) {
+            uint32_t seq;
+            portENTER_CRITICAL();
+            int len = log_ring_pop(&log_ring, line, sizeof(line), &seq);
+            portEXIT_CRITICAL();
+            if (len < 0) {
+                break;
+            }
+            uint32_t now_ms = (uint32_t) (gpio_hal_get_time_us() / 1000);
+            if (syslog_sink_add(&syslog_sink, line, (size_t) len, seq, now_ms) == SYSLOG_PACKET_FULL) {
+                syslog_send_packet(fd);
+                syslog_sink_add(&syslog_sink, line, (size_t) len, seq, now_ms);
+            }
+        }
+
+        uint32_t overwritten = log_ring.overwritten;
+        if (!syslog_sink_add_drop_report(&syslog_sink, overwritten)) {
+            syslog_send_packet(fd);
+            syslog_sink_add_drop_report(&syslog_sink, overwritten);
+        }
+        if (syslog_sink.packet_len > 0) {
+            syslog_send_packet(fd);
+        }
+        metrics_set(METRIC_LOG_SENT, (int32_t) syslog_sink.sent_lines);
+        metrics_set(METRIC_LOG_OVERWRITTEN, (int32_t) overwritten);
+        metrics_set(METRIC_LOG_RATE_LIMITED, (int32_t) syslog_sink.rate_limited);
+        metrics_set(METRIC_LOG_UNSENT, (int32_t) syslog_sink.send_failed);
+    }
+}
+
+/// @brief Starts shipping logs the first time the station gets an address, if a collector is set.
+/// Lines logged before then wait in log_ring (the oldest are overwritten if there are too many).
+static void start_syslog(void)
+{
+    static bool started = false;
+    if (started || sizeof(SYSLOG_COLLECTOR) == 1) {
+        return;
+    }
+    started = true;
+
+    int fd = syslog_udp_open(SYSLOG_COLLECTOR, SYSLOG_PORT);
+    if (fd < 0) {
+        ESP_LOGE(APP_TAG, "Syslog collector \"%s\" unusable: remote logging disabled", SYSLOG_COLLECTOR);
+        return;
+    }
+    const syslog_sink_config_t syslog_cfg = {
+        .hostname = SYSLOG_HOSTNAME,
+        .rate_per_s = SYSLOG_RATE_PER_S,
+        .burst = SYSLOG_BURST,
+    };
+    syslog_sink_init(&syslog_sink, &syslog_cfg, (uint32_t) (gpio_hal_get_time_us() / 1000));
+    ESP_LOGI(APP_TAG, "Logging to syslog at %s:%d", SYSLOG_COLLECTOR, SYSLOG_PORT);
+    xTaskCreate(syslog_task, "syslog", 2048, (void*) (intptr_t) fd, 3, NULL);
+}
+
+/// @brief Starts SNTP the first time the station gets an address. lwIP polls the server in the
+/// background and sets the system time; update_clock picks it up, so nothing waits for the sync.
+static void start_sntp(void)
+{
+    static bool started = false;
+    if (started) {
+        return;
+    }
+    started = true;
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, SNTP_SERVER);
+    sntp_init();
+    ESP_LOGI(APP_TAG, "SNTP started with %s", SNTP_SERVER);
+}
+
+/// @brief Publishes one page of history in chunks of HISTORY_CHUNK_RECORDS records, as JSON or, with
+/// HISTORY_PAYLOAD_CBOR, as CBOR. Every chunk carries "next", the sequence number to ask for to carry on;
+/// the final one has "last":true.
+static void history_publish_page(uint32_t since_seq, int count)
+{
+    static history_record_t records[HISTORY_PAGE_MAX];
+    static char payload[HISTORY_CHUNK_RECORDS * 128 + 48];
+
+    int total = history_log_read(&history_log, since_seq, records, count);
+    uint32_t next = since_seq > history_log.next_seq ? since_seq : history_log.next_seq;
+    int start = 0;
+    do {
+        int end = start + HISTORY_CHUNK_RECORDS < total ? start + HISTORY_CHUNK_RECORDS : total;
+        uint32_t chunk_next = end > start ? records[end - 1].seq + 1 : next;
+#if HISTORY_PAYLOAD_CBOR
+        int len = history_page_to_cbor(&records[start], end - start, chunk_next, end == total,
+                                       (uint8_t*) payload, sizeof(payload));
+#else
+        int len = history_page_to_json(&records[start], end - start, chunk_next, end == total,
+                                       payload, sizeof(payload));
+#endif
+        if (len < 0) {
+            ESP_LOGE(APP_TAG, "History records from %u do not fit the page buffer", (unsigned) records[start].seq);
+            return;
+        }
+        mqtt_publish_binary(HISTORY_PAGE_TOPIC, payload, len, 1, 0);
+        start = end;
+    } while (start < total);
+}
+
+/// @brief Publishes every metric as one JSON object (CBOR with METRICS_PAYLOAD_CBOR) while the
+/// broker session is up.
+static void publish_metrics(void)
+{
+    static char payload[METRICS_JSON_MAX + WALL_CLOCK_TEXT_MAX + 16];
+    if (metrics_get(METRIC_MQTT_CONNECTED) == 0) {
+        return;
+    }
+#if METRICS_PAYLOAD_CBOR
+    int len = metrics_to_cbor((uint8_t*) payload, sizeof(payload));
+#else
+    int len = metrics_to_json(payload, METRICS_JSON_MAX);
+    len = stamp_json(payload, len, sizeof(payload));
+#endif
+    if (len < 0) {
+        ESP_LOGE(APP_TAG, "Metrics do not fit %d bytes", METRICS_JSON_MAX);
+        return;
+    }
+    mqtt_publish_binary(METRICS_TOPIC, payload, len, 0, 0);
+}
+
+/// @brief History task: the single owner of the history log. Appends queued records, programs
+/// the batch at least every HISTORY_FLUSH_INTERVAL_MS (faults straight away) and answers page requests.
+/// Being the lowest priority publisher, it also publishes the metrics every METRICS_PUBLISH_INTERVAL_MS.
+/// @param arg Unused
+static void history_task(void *arg)
+{
+    esp_err_t err = history_log_init(&history_log, HISTORY_PARTITION_LABEL);
+    if (err != ESP_OK) {
+        ESP_LOGE(APP_TAG, "History partition \"%s\" unavailable (%d): history disabled",
+                 HISTORY_PARTITION_LABEL, err);
+    } else {
+        ESP_LOGI(APP_TAG, "History: boot %u, next record %u", (unsigned) history_log.boot,
+                 (unsigned) history_log.next_seq);
+    }
+    history_log_append(&history_log, HISTORY_BOOT, 0, (uint8_t) esp_reset_reason(), 0, 0);
+    history_log_flush(&history_log);
+
+    TickType_t last_flush = xTaskGetTickCount();
+    TickType_t last_metrics = last_flush;
+    history_msg_t msg;
+    for (;;) {
+        if (xQueueReceive(history_queue, &msg, pdMS_TO_TICKS(HISTORY_FLUSH_INTERVAL_MS))) {
+            if (msg.type == HISTORY_MSG_QUERY) {
+                history_publish_page(msg.since_seq, msg.count);
+            } else {
+                history_log_append(&history_log, msg.kind, msg.time_s, msg.args[0], msg.args[1], msg.args[2]);
+                if (msg.kind == HISTORY_FAULT) {
+                    history_log_flush(&history_log);
+                }
+            }
+        }
+        if (history_log.batch_count == 0) {
+            last_flush = xTaskGetTickCount();
+        } else if (xTaskGetTickCount() - last_flush >= pdMS_TO_TICKS(HISTORY_FLUSH_INTERVAL_MS)) {
+            if (history_log_flush(&history_log) != ESP_OK) {
+                ESP_LOGW(APP_TAG, "History flush failed (%u batches lost)", (unsigned) history_log.write_errors);
+            }
+            last_flush = xTaskGetTickCount();
+        }
+        if (xTaskGetTickCount() - last_metrics >= pdMS_TO_TICKS(METRICS_PUBLISH_INTERVAL_MS)) {
+            publish_metrics();
+            last_metrics = xTaskGetTickCount();
+        }
+    }
 }
 
 void on_wifi_connected_callback(void) {
-    gpio_set_level(ON_BOARD_LED, 1); // Turn off LED to indicate successful connection
+    gpio_hal_set_level(ON_BOARD_LED, 1); // Turn off LED to indicate successful connection
     mqtt_start();
 #ifdef TEST_MODE
     test_mode_wifi_ready = true;
@@ -234,12 +1148,16 @@ void on_wifi_connected_callback(void) {
 }
 
 void on_wifi_disconnected_callback(const int retry_count) {
-    gpio_set_level(ON_BOARD_LED, 0); // Turn on LED to indicate failure to connect
+    gpio_hal_set_level(ON_BOARD_LED, 0); // Turn on LED to indicate failure to connect
 }
 
 void on_wifi_got_ip_callback(const char* ip_addr) {
-    gpio_set_level(ON_BOARD_LED, 1); // Turn off LED to indicate successful connection
+    gpio_hal_set_level(ON_BOARD_LED, 1); // Turn off LED to indicate successful connection
     ESP_LOGI(APP_TAG, "Got IP: %s", ip_addr);
+    start_http_server();
+    start_udp_control();
+    start_syslog();
+    start_sntp();
 }
 
 static const wifi_event_callbacks_t wifi_callbacks = {
@@ -250,85 +1168,290 @@ static const wifi_event_callbacks_t wifi_callbacks = {
     .on_failed = NULL
 };
 
+static const garage_command_topics_t command_topics = {
+    .command_topic = COMMAND_TOPIC,
+    .status_topic = STATUS_TOPIC,
+    .schedule_prefix = SCHEDULE_RULES_PREFIX,
+    .history_topic = HISTORY_QUERY_TOPIC,
+#ifdef DIAG_MODE
+    .debug_topic = DEBUG_COMMAND_TOPIC,
+#endif
+};
+
+#ifdef DIAG_MODE
+// Diagnostics reports, made by the MQTT task only. CPU shares are measured from the previous
+// task sample, so a report covers the time since the last "tasks" or "all" command.
+static diag_tasks_t diag_previous;
+static diag_tasks_t diag_current;
+static bool diag_have_previous = false;
+static uint32_t diag_reports = 0;
+
+/// @brief Samples every task's state, run time counter and stack headroom.
+/// @return false if there are more than DIAG_TASKS_MAX tasks
+static bool diag_sample_tasks(diag_tasks_t* sample)
+{
+    static TaskStatus_t status[DIAG_TASKS_MAX];
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, DIAG_TASKS_MAX, &total);
+    if (count == 0) {
+        return false;
+    }
+    sample->count = (int) count;
+    sample->total_runtime = total;
+    sample->time_ms = (uint32_t) (gpio_hal_get_time_us() / 1000);
+    for (UBaseType_t i = 0; i < count; i++) {
+        diag_task_t* task = &sample->tasks[i];
+        snprintf(task->name, sizeof(task->name), "%s", status[i].pcTaskName);
+        task->number = (uint32_t) status[i].xTaskNumber;
+        task->state = status[i].eCurrentState == eRunning ? 'X' :
+                      status[i].eCurrentState == eReady ? 'R' :
+                      status[i].eCurrentState == eBlocked ? 'B' :
+                      status[i].eCurrentState == eSuspended ? 'S' : 'D';
+        task->priority = (uint8_t) status[i].uxCurrentPriority;
+        task->runtime = status[i].ulRunTimeCounter;
+        task->stack_free = (uint32_t) status[i].usStackHighWaterMark * sizeof(StackType_t);
+    }
+    return true;
+}
+
+/// @brief Publishes the asked-for sections of a diagnostics report on DEBUG_REPORT_TOPIC, each
+/// chunk at most DIAG_CHUNK_MAX bytes. Called from the MQTT task only.
+/// @param sections diag_section_t flags
+static void diag_publish_report(int sections)
+{
+    static char payload[DIAG_CHUNK_MAX];
+    uint32_t report = ++diag_reports;
+
+    if (sections & DIAG_SECTION_TASKS) {
+        if (!diag_sample_tasks(&diag_current)) {
+            ESP_LOGW(APP_TAG, "More than %d tasks: no task report", DIAG_TASKS_MAX);
+        } else {
+            diag_cpu_shares(diag_have_previous ? &diag_previous : NULL, &diag_current);
+            uint32_t window_ms = diag_have_previous ? diag_current.time_ms - diag_previous.time_ms : 0;
+            int start = 0;
+            do {
+                int len = diag_tasks_to_json(&diag_current, window_ms, report, start, payload, sizeof(payload),
+                                             &start);
+                if (len < 0) {
+                    break;
+                }
+                mqtt_publish_binary(DEBUG_REPORT_TOPIC, payload, len, 1, 0);
+            } while (start < diag_current.count);
+            diag_previous = diag_current;
+            diag_have_previous = true;
+        }
+    }
+    if (sections & DIAG_SECTION_HEAP) {
+        const diag_heap_t heap = { esp_get_free_heap_size(), esp_get_minimum_free_heap_size() };
+        int len = diag_heap_to_json(&heap, report, payload, sizeof(payload));
+        if (len > 0) {
+            mqtt_publish_binary(DEBUG_REPORT_TOPIC, payload, len, 1, 0);
+        }
+    }
+    if (sections & DIAG_SECTION_QUEUES) {
+        const xQueueHandle handles[] = { state_machine_queue, schedule_queue, history_queue };
+        diag_queue_t queues[] = { { "state_machine" }, { "schedule" }, { "history" } };
+        for (size_t i = 0; i < sizeof(queues) / sizeof(queues[0]); i++) {
+            queues[i].waiting = (uint32_t) uxQueueMessagesWaiting(handles[i]);
+            queues[i].size = queues[i].waiting + (uint32_t) uxQueueSpacesAvailable(handles[i]);
+        }
+        int len = diag_queues_to_json(queues, (int) (sizeof(queues) / sizeof(queues[0])), report, payload,
+                                      sizeof(payload));
+        if (len > 0) {
+            mqtt_publish_binary(DEBUG_REPORT_TOPIC, payload, len, 1, 0);
+        }
+    }
+}
+#endif
+
+/// @brief Queues an input for the owner from the MQTT task.
+static void mqtt_queue_input(garage_input_t input)
+{
+    if (xQueueSend(state_machine_queue, &input, 0) != pdTRUE) {
+        metrics_inc(METRIC_INPUT_FULL_MQTT);
+        ESP_LOGW(APP_TAG, "State machine queue full, dropping %s", garage_input_to_string(input));
+    }
+}
+
+/// @brief Handles a message from the broker. Topic and payload are not NUL-terminated
+/// and are classified by garage_command_classify without reading past their lengths.
 void mqtt_data_callback(const char* topic, int topic_len, const char* command, int command_len) {
-    if (topic_len == strlen(COMMAND_TOPIC) && strncmp(topic, COMMAND_TOPIC, topic_len) == 0) {
-        if (command_len == strlen(COMMAND_OPEN) && strncmp(command, COMMAND_OPEN, command_len) == 0) {
-            ESP_LOGI(APP_TAG, "Received OPEN command");
-            xQueueSend(state_machine_queue, &COMMAND_OPEN, 0);
-        } else if (command_len == strlen(COMMAND_CLOSE) && strncmp(command, COMMAND_CLOSE, command_len) == 0) {
-            ESP_LOGI(APP_TAG, "Received CLOSE command");
-            xQueueSend(state_machine_queue, &COMMAND_CLOSE, 0);
-        }
-    } else if (topic_len == strlen(STATUS_TOPIC) && strncmp(topic, STATUS_TOPIC, topic_len) == 0) {
-        ESP_LOGI(APP_TAG, "Received status update");
-        ESP_LOGI(APP_TAG, "Status: %.*s\r\n", command_len, command);
-    } else {
-        ESP_LOGI(APP_TAG, "Received message on unknown topic");
+#ifdef BENCH_MODE
+    bench_command_rx_us = gpio_hal_get_time_us();
+#endif
+    garage_message_t message = garage_command_classify(&command_topics, topic, topic_len, command, command_len);
+    if (SIGNED_COMMANDS_REQUIRED && garage_command_is_unsigned_control(message.kind)) {
+        if (message.kind == GARAGE_MESSAGE_SCHEDULE_RULE) {
+            ESP_LOGW(APP_TAG, "Refusing unsigned schedule rule %.*s", message.rule_id_len, message.rule_id);
+        } else {
+            ESP_LOGW(APP_TAG, "Refusing unsigned %s command", garage_input_to_string(message.input));
+        }
+        return;
+    }
+
+    switch (message.kind) {
+        case GARAGE_MESSAGE_COMMAND:
+            ESP_LOGI(APP_TAG, "Received %s command", garage_input_to_string(message.input));
+            mqtt_queue_input(message.input);
+            break;
+        case GARAGE_MESSAGE_SIGNED_COMMAND: {
+            garage_input_t input;
+            uint32_t counter;
+            signed_command_status_t status =
+                signed_command_verify(&command_verifier, command, command_len, &input, &counter);
+            if (status != SIGNED_COMMAND_OK) {
+                metrics_inc(METRIC_SIGNED_REJECTED);
+                ESP_LOGW(APP_TAG, "Refusing signed command: %s", signed_command_status_to_string(status));
+                break;
+            }
+            metrics_inc(METRIC_SIGNED_ACCEPTED);
+            ESP_LOGI(APP_TAG, "Received signed %s command #%u", garage_input_to_string(input), (unsigned) counter);
+            mqtt_queue_input(input);
+            break;
+        }
+        case GARAGE_MESSAGE_INVALID_COMMAND:
+            ESP_LOGI(APP_TAG, "Ignoring invalid command: %.*s",
+                     garage_command_log_len(command, command_len), command != NULL ? command : "");
+            break;
+        case GARAGE_MESSAGE_STATUS:
+            ESP_LOGI(APP_TAG, "Received status update");
+            ESP_LOGI(APP_TAG, "Status: %.*s\r\n", garage_command_log_len(command, command_len),
+                     command != NULL ? command : "");
+            break;
+        case GARAGE_MESSAGE_SCHEDULE_RULE: {
+            // Copied here because the broker's buffers do not outlive this callback
+            schedule_rule_msg_t msg;
+            if (message.rule_id_len > GARAGE_SCHEDULE_ID_MAX || command_len < 0 ||
+                command_len > SCHEDULE_RULE_TEXT_MAX) {
+                ESP_LOGW(APP_TAG, "Ignoring oversized schedule rule");
+                break;
+            }
+            msg.id_len = message.rule_id_len;
+            msg.text_len = command_len;
+            memcpy(msg.id, message.rule_id, (size_t) msg.id_len);
+            if (command_len > 0) {
+                memcpy(msg.text, command, (size_t) command_len);
+            }
+            // Retained rules arrive in a burst on connect; wait for the owner to drain a few
+            if (xQueueSend(schedule_queue, &msg, pdMS_TO_TICKS(SCHEDULE_QUEUE_WAIT_MS)) != pdTRUE) {
+                metrics_inc(METRIC_SCHEDULE_FULL_MQTT);
+                ESP_LOGW(APP_TAG, "Schedule queue full, dropping rule %.*s", msg.id_len, msg.id);
+            }
+            break;
+        }
+        case GARAGE_MESSAGE_HISTORY_QUERY: {
+            history_msg_t msg = { .type = HISTORY_MSG_QUERY };
+            if (!history_log_parse_query(command, command_len, &msg.since_seq, &msg.count)) {
+                ESP_LOGI(APP_TAG, "Ignoring invalid history query: %.*s",
+                         garage_command_log_len(command, command_len), command != NULL ? command : "");
+            } else if (xQueueSend(history_queue, &msg, 0) != pdTRUE) {
+                metrics_inc(METRIC_HISTORY_FULL_MQTT);
+                ESP_LOGW(APP_TAG, "History queue full, dropping query");
+            }
+            break;
+        }
+#ifdef DIAG_MODE
+        case GARAGE_MESSAGE_DEBUG_COMMAND: {
+            int sections = diag_parse_command(command, command_len);
+            if (sections == 0) {
+                ESP_LOGI(APP_TAG, "Ignoring invalid debug command: %.*s",
+                         garage_command_log_len(command, command_len), command != NULL ? command : "");
+            } else {
+                diag_publish_report(sections);
+            }
+            break;
+        }
+#endif
+        default:
+            ESP_LOGI(APP_TAG, "Received message on unknown topic");
+            break;
     }
 }
 
 #ifdef TEST_MODE
-static int ASSERT(bool condition, const char* testInfo, const char* errorMessage) {
-    if (condition) {
-        ESP_LOGI(APP_TAG, "[PASSED] %s", testInfo);
-        return 0;
+/// @brief Scenario hook: commands go through the broker round trip, sensor readings straight to the queue.
+static void scenario_inject(garage_input_t input, void* ctx)
+{
+    if (input == GARAGE_INPUT_COMMAND_OPEN) {
+        mqtt_publish(COMMAND_TOPIC, COMMAND_OPEN, 0, 1);
+    } else if (input == GARAGE_INPUT_COMMAND_CLOSE) {
+        mqtt_publish(COMMAND_TOPIC, COMMAND_CLOSE, 0, 1);
+    } else if (input == GARAGE_INPUT_COMMAND_STOP) {
+        mqtt_publish(COMMAND_TOPIC, COMMAND_STOP, 0, 1);
     } else {
-        ESP_LOGE(APP_TAG, "[FAILED] %s - %s", testInfo, errorMessage);
-        return 1;
+        xQueueSend(state_machine_queue, &input, 0);
     }
 }
 
-/// @brief Test mode task that simulates various garage door events and commands
+static void scenario_wait_ms(int delay_ms, void* ctx)
+{
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+}
+
+static int64_t scenario_now_us(void* ctx)
+{
+    return gpio_hal_get_time_us();
+}
+
+static garage_state_t scenario_get_state(void* ctx)
+{
+    return read_controller_snapshot().state;
+}
+
+static int64_t scenario_last_transition_us(void* ctx)
+{
+    return read_controller_snapshot().last_transition_us;
+}
+
+static uint32_t scenario_transition_count(void* ctx)
+{
+    return read_controller_snapshot().transition_count;
+}
+
+static const garage_scenario_ops_t scenario_ops = {
+    .inject = scenario_inject,
+    .wait_ms = scenario_wait_ms,
+    .now_us = scenario_now_us,
+    .get_state = scenario_get_state,
+    .last_transition_us = scenario_last_transition_us,
+    .transition_count = scenario_transition_count,
+    .ctx = NULL,
+};
+
+/// @brief Test mode task that runs the built-in scenarios in real time and logs per-step latency
 /// @param arg Unused
 static void test_simulation_task(void *arg)
 {
-    ESP_LOGI(APP_TAG, "*** TEST MODE ACTIVE - Starting simulation ***");
+    // Kept static: the report is too large for the task stack
+    static garage_scenario_report_t report;
     int countFailed = 0;
 
+    ESP_LOGI(APP_TAG, "*** TEST MODE ACTIVE - Running %d scenarios ***", garage_scenario_count);
+
     // Wait 2 seconds for system to stabilize
     vTaskDelay(2000 / portTICK_PERIOD_MS);
-    
-    // Simulate door closed initially
-    ESP_LOGI(APP_TAG, "[TEST] Simulating reed switch: DOOR CLOSED");
-    xQueueSend(state_machine_queue, &REED_SWITCH_CLOSE_TAG, 0);
-    vTaskDelay(3000 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_CLOSED, "Initial door state", "Door state mismatch - expected CLOSED");
-    
-    // Simulate OPEN command
-    ESP_LOGI(APP_TAG, "[TEST] Simulating OPEN command");
-    mqtt_publish(COMMAND_TOPIC, COMMAND_OPEN, 0, 1);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_OPENING, "State after OPEN command", "Door state mismatch - expected OPENING");
-
-    vTaskDelay(16000 / portTICK_PERIOD_MS);
-    ESP_LOGI(APP_TAG, "[TEST] After timeout, door should be OPEN");
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_OPEN, "State after opening timeout", "Door state mismatch - expected OPEN");
-
-    ESP_LOGI(APP_TAG, "[TEST] Simulating CLOSE command");
-    mqtt_publish(COMMAND_TOPIC, COMMAND_CLOSE, 0, 1);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_CLOSING, "State after CLOSE command", "Door state mismatch - expected CLOSING");
-
-    vTaskDelay(8000 / portTICK_PERIOD_MS);
-    xQueueSend(state_machine_queue, &REED_SWITCH_CLOSE_TAG, 0);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_CLOSED, "State after door closed", "Door state mismatch - expected CLOSED");
-
-    xQueueSend(state_machine_queue, &REED_SWITCH_OPEN_TAG, 0);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_OPENING, "State after door opened from sensor", "Door state mismatch - expected OPENING");
-
-    vTaskDelay(16000 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_OPEN, "State after opening timeout from sensor", "Door state mismatch - expected OPEN");
-
-    mqtt_publish(COMMAND_TOPIC, COMMAND_CLOSE, 0, 1);
-    vTaskDelay(16000 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_UNKNOWN, "State after CLOSE command + 15 s", "Door state mismatch - expected UNKNOWN due to timeout");
-    
-    vTaskDelay(2000 / portTICK_PERIOD_MS);
-    xQueueSend(state_machine_queue, &REED_SWITCH_CLOSE_TAG, 0);
-    vTaskDelay(500 / portTICK_PERIOD_MS);
-    countFailed += ASSERT(state_machine.current_state == GARAGE_STATE_CLOSED, "State after door closed from UNKNOWN", "Door state mismatch - expected CLOSED");
+
+    for (int i = 0; i < garage_scenario_count; i++) {
+        const garage_scenario_t* scenario = &garage_scenarios[i];
+        ESP_LOGI(APP_TAG, "[TEST] Scenario %s", scenario->name);
+
+        countFailed += garage_scenario_run(scenario, &scenario_ops, &report);
+
+        for (int step = 0; step < report.steps_run; step++) {
+            const garage_scenario_step_report_t* step_report = &report.steps[step];
+            if (step_report->passed) {
+                ESP_LOGI(APP_TAG, "[PASSED] %s step %d (%s): %s, latency %d ms", scenario->name, step,
+                         garage_input_to_string(scenario->steps[step].input),
+                         garage_state_to_string(step_report->actual_state),
+                         (int) (step_report->latency_us / 1000));
+            } else {
+                ESP_LOGE(APP_TAG, "[FAILED] %s step %d (%s): expected %s, got %s", scenario->name, step,
+                         garage_input_to_string(scenario->steps[step].input),
+                         garage_state_to_string(scenario->steps[step].expected_state),
+                         garage_state_to_string(step_report->actual_state));
+            }
+        }
+    }
 
     ESP_LOGI(APP_TAG, "*** TEST MODE - Simulation complete ***");
     if (countFailed == 0) {
@@ -349,36 +1472,291 @@ static void check_and_start_test_mode()
 }
 #endif
 
+#ifdef BENCH_MODE
+/// @brief Broker acknowledged a QoS 1 publish.
+/// @param msg_id Message ID returned by mqtt_publish
+static void bench_published_callback(int msg_id)
+{
+    int64_t now_us = gpio_hal_get_time_us();
+    portENTER_CRITICAL();
+    unsigned slot = bench_ack_next++ % BENCH_ACKS_MAX;
+    bench_ack_msg_id[slot] = msg_id;
+    bench_ack_us[slot] = now_us;
+    portEXIT_CRITICAL();
+    xSemaphoreGive(bench_published_sem);
+}
+
+/// @brief Looks up the acknowledgement of the last status publish among the recent ones.
+/// @return true if found; bench_published_us holds its time
+static bool bench_find_status_ack(void)
+{
+    bool found = false;
+    portENTER_CRITICAL();
+    int msg_id = bench_status_msg_id;
+    for (int i = 0; msg_id > 0 && i < BENCH_ACKS_MAX; i++) {
+        if (bench_ack_msg_id[i] == msg_id) {
+            bench_published_us = bench_ack_us[i];
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL();
+    return found;
+}
+
+/// @brief Forgets the status publish and the acks seen so far, before the next measurement.
+static void bench_reset_status_ack(void)
+{
+    portENTER_CRITICAL();
+    bench_status_msg_id = -1;
+    for (int i = 0; i < BENCH_ACKS_MAX; i++) {
+        bench_ack_msg_id[i] = -1;
+    }
+    portEXIT_CRITICAL();
+}
+
+/// @brief Waits for the acknowledgement of the last status publish, skipping any others.
+/// Woken by every ack and by the status publish itself, so the order they happen in does not matter.
+/// @param timeout_ms Give up after this long
+/// @return true if acknowledged; bench_published_us holds the time
+static bool bench_wait_status_published(int timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+
+    for (;;) {
+        if (bench_find_status_ack()) {
+            return true;
+        }
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= timeout || xSemaphoreTake(bench_published_sem, timeout - waited) != pdTRUE) {
+            return bench_find_status_ack();
+        }
+    }
+}
+
+/// @brief Publishes one histogram as JSON (retained) and logs its summary.
+static void bench_publish_histogram(const latency_histogram_t* hist, const char* name)
+{
+    // Kept static: too large for the task stack
+    static char json[2048];
+    char topic[64];
+
+    ESP_LOGI(APP_TAG, "[BENCH] %s: n=%u p50=%ld p90=%ld p99=%ld p99.9=%ld max=%ld us", name,
+             (unsigned) hist->count, (long) latency_histogram_percentile(hist, 500),
+             (long) latency_histogram_percentile(hist, 900), (long) latency_histogram_percentile(hist, 990),
+             (long) latency_histogram_percentile(hist, 999), (long) hist->max_us);
+
+    if (latency_histogram_to_json(hist, name, json, sizeof(json)) < 0) {
+        ESP_LOGE(APP_TAG, "[BENCH] %s histogram does not fit the publish buffer", name);
+        return;
+    }
+    snprintf(topic, sizeof(topic), "%s%s", BENCH_RESULTS_TOPIC, name);
+    mqtt_publish(topic, json, 0, 1);
+}
+
+static bool bench_store_floor(uint32_t floor, void* ctx)
+{
+    return true;
+}
+
+/// @brief Times signed command verification alone, with a RAM window and no NVS writes.
+/// It runs in the MQTT task before a command is queued, so it adds to command -> relay.
+static void bench_signed_verify(latency_histogram_t* hist)
+{
+    static const uint8_t key[] = "bench mode command key, 32 bytes";
+    signed_command_window_t window = { 0 };
+    signed_command_verifier_t verifier;
+    char payload[SIGNED_COMMAND_MAX_LEN + 1];
+
+    signed_command_init(&verifier, key, sizeof(key) - 1, &window, 0, bench_store_floor, NULL);
+    for (uint32_t counter = 1; counter <= BENCH_ITERATIONS; counter++) {
+        int len = signed_command_sign(key, sizeof(key) - 1, GARAGE_INPUT_COMMAND_OPEN, counter, payload,
+                                      sizeof(payload));
+        garage_input_t input;
+        int64_t start_us = gpio_hal_get_time_us();
+        signed_command_verify(&verifier, payload, len, &input, NULL);
+        latency_histogram_record(hist, gpio_hal_get_time_us() - start_us);
+    }
+}
+
+/// @brief Bench mode task: measures command receipt -> relay edge and sensor edge -> status acknowledged.
+/// Each iteration injects a closed sensor reading (publishing CLOSED), then sends OPEN through the
+/// broker (pressing the relay and publishing OPENING), so the controller never waits on its timeout.
+/// @param arg Unused
+static void bench_task(void *arg)
+{
+    // Kept static: the histograms are too large for the task stack
+    static latency_histogram_t command_to_relay;
+    static latency_histogram_t sensor_to_published;
+    static latency_histogram_t signed_verify;
+    int timeouts = 0;
+
+    latency_histogram_init(&command_to_relay);
+    latency_histogram_init(&sensor_to_published);
+    latency_histogram_init(&signed_verify);
+
+    ESP_LOGI(APP_TAG, "*** BENCH MODE ACTIVE - %d iterations ***", BENCH_ITERATIONS);
+
+    // Wait 2 seconds for system to stabilize
+    vTaskDelay(2000 / portTICK_PERIOD_MS);
+
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        // Simulated sensor edge -> broker acknowledged the status publish
+        xSemaphoreTake(bench_published_sem, 0);
+        bench_reset_status_ack();
+        garage_input_t input = GARAGE_INPUT_SENSOR_CLOSED;
+        int64_t sensor_edge_us = gpio_hal_get_time_us();
+        xQueueSend(state_machine_queue, &input, 0);
+        if (bench_wait_status_published(BENCH_STEP_TIMEOUT_MS)) {
+            latency_histogram_record(&sensor_to_published, bench_published_us - sensor_edge_us);
+        } else {
+            timeouts++;
+        }
+
+        // mqtt_data_callback receipt -> relay edge on the loopback input
+        xSemaphoreTake(bench_relay_edge_sem, 0);
+        bench_command_rx_us = 0;
+        mqtt_publish(COMMAND_TOPIC, COMMAND_OPEN, 0, 0);
+        if (xSemaphoreTake(bench_relay_edge_sem, pdMS_TO_TICKS(BENCH_STEP_TIMEOUT_MS)) == pdTRUE &&
+            bench_command_rx_us != 0) {
+            latency_histogram_record(&command_to_relay, bench_relay_edge_us - bench_command_rx_us);
+        } else {
+            timeouts++;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS));
+
+        if ((i + 1) % 100 == 0) {
+            ESP_LOGI(APP_TAG, "[BENCH] %d/%d iterations, %d timeouts", i + 1, BENCH_ITERATIONS, timeouts);
+        }
+    }
+
+    bench_signed_verify(&signed_verify);
+
+    ESP_LOGI(APP_TAG, "*** BENCH MODE - Complete, %d timeouts ***", timeouts);
+    bench_publish_histogram(&command_to_relay, "command_to_relay");
+    bench_publish_histogram(&sensor_to_published, "sensor_to_published");
+    bench_publish_histogram(&signed_verify, "signed_verify");
+    vTaskDelete(NULL);
+}
+#endif
+
+// Set while the broker session is up, so a failed reconnect is not logged as another loss
+static volatile bool mqtt_session_up = false;
+
+void mqtt_disconnected_callback(void) {
+    if (mqtt_session_up) {
+        mqtt_session_up = false;
+        history_note_from(METRIC_HISTORY_FULL_MQTT, HISTORY_FAULT, HISTORY_FAULT_MQTT_LOST,
+                          (uint8_t) read_controller_snapshot().state, 0);
+    }
+}
+
 void mqtt_connected_callback(void) {
+    mqtt_session_up = true;
     mqtt_publish(AVAILABILITY_TOPIC, "available", 0, 1);
+    // The owner sends the retained values again; a publish lost while disconnected is not lost for good
+    mqtt_queue_input(GARAGE_INPUT_MQTT_CONNECTED);
     mqtt_subscribe(COMMAND_TOPIC, 0);
     mqtt_subscribe(STATUS_TOPIC, 0);
+    mqtt_subscribe(SCHEDULE_RULES_PREFIX "+", 1);     // Retained rules are redelivered on connect
+    mqtt_subscribe(HISTORY_QUERY_TOPIC, 0);
+#ifdef DIAG_MODE
+    mqtt_subscribe(DEBUG_COMMAND_TOPIC, 0);
+#endif
     
 #ifdef TEST_MODE
     test_mode_mqtt_ready = true;
     ESP_LOGI(APP_TAG, "[TEST MODE] MQTT connected");
     check_and_start_test_mode();
+#elif defined(BENCH_MODE)
+    // Connected implies WiFi is up. Reconnects must not start a second run.
+    static bool bench_started = false;
+    if (!bench_started) {
+        bench_started = true;
+        xTaskCreate(bench_task, "bench", 4096, NULL, 5, NULL);
+    }
 #else
-    xQueueSend(state_machine_queue, &REED_SWITCH_TAG, 0);
+    mqtt_queue_input(GARAGE_INPUT_REED_SWITCH);
 #endif
 }
 
+/// @brief Stores a new signed command floor in NVS. Called from the MQTT task, once per
+/// SIGNED_COMMAND_RESERVE commands.
+static bool store_command_floor(uint32_t floor, void* ctx)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(COMMAND_KEY_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return false;
+    }
+    bool stored = nvs_set_u32(nvs, COMMAND_FLOOR_NAME, floor) == ESP_OK && nvs_commit(nvs) == ESP_OK;
+    nvs_close(nvs);
+    if (!stored) {
+        ESP_LOGE(APP_TAG, "Failed to store signed command floor %u", (unsigned) floor);
+    }
+    return stored;
+}
+
+/// @brief Loads the command key and floor from NVS. Without a key every signed command is refused.
+static void signed_commands_init(void)
+{
+    size_t key_len = 0;
+    uint32_t floor = 0;
+    nvs_handle_t nvs;
+    if (nvs_open(COMMAND_KEY_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        key_len = sizeof(command_key);
+        if (nvs_get_blob(nvs, COMMAND_KEY_NAME, command_key, &key_len) != ESP_OK) {
+            key_len = 0;
+        }
+        uint32_t stored = 0;
+        if (nvs_get_u32(nvs, COMMAND_FLOOR_NAME, &stored) == ESP_OK) {
+            floor = stored;
+        }
+        nvs_close(nvs);
+    }
+
+    bool kept = signed_command_init(&command_verifier, command_key, key_len, &command_window, floor,
+                                    store_command_floor, NULL);
+    if (key_len == 0) {
+        ESP_LOGI(APP_TAG, "No command key in NVS, signed commands are refused");
+    } else {
+        ESP_LOGI(APP_TAG, "Signed commands enabled, replay window %s (floor %u)",
+                 kept ? "kept from before the reset" : "restarted at the NVS floor", (unsigned) floor);
+    }
+}
+
 const mqtt_config_t mqtt_cfg = {
     .broker_address = MQTT_BROKER_ADDRESS,
-    .port = 1883,
+    .port = MQTT_BROKER_CA_PEM != NULL ? MQTT_TLS_PORT : MQTT_TCP_PORT,
     .username = MQTT_USER_NAME,
     .password = MQTT_USER_PASSWORD,
     .lwt_topic = AVAILABILITY_TOPIC,
     .lwt_message = "unavailable",
+    .ca_cert_pem = MQTT_BROKER_CA_PEM,
 };
 const mqtt_event_callbacks_t mqtt_callbacks = {
     .on_data = mqtt_data_callback,
     .on_connected = mqtt_connected_callback,
-    .on_disconnected = NULL
+    .on_disconnected = mqtt_disconnected_callback,
+#ifdef BENCH_MODE
+    .on_published = bench_published_callback,
+#endif
 };
 
 void app_main()
 {
+    // First, so the boot log is kept for the syslog collector too
+    if (sizeof(SYSLOG_COLLECTOR) > 1) {
+        log_ring_init(&log_ring);
+        uart_putchar = esp_log_set_putchar(log_capture_putchar);
+    }
+
+    // The schedule's local time; UTC until SNTP sets the clock
+    setenv("TZ", LOCAL_TIMEZONE, 1);
+    tzset();
+    wall_clock_init(&wall_clock);
+
     /* Print chip information */
     esp_chip_info_t chip_info;
     esp_chip_info(&chip_info);
@@ -405,30 +1783,52 @@ void app_main()
     
     ESP_ERROR_CHECK(nvs_flash_init());
     ESP_ERROR_CHECK(esp_netif_init());
+    signed_commands_init();
 
-    // Initialize state machine
-    garage_sm_init(&state_machine, GARAGE_STATE_UNKNOWN);
+    // Setup event queue before the reed switch interrupt can post to it
+    state_machine_queue = xQueueCreate(5, sizeof(garage_input_t));
+    schedule_queue = xQueueCreate(4, sizeof(schedule_rule_msg_t));
+    history_queue = xQueueCreate(8, sizeof(history_msg_t));
 
-    // Setup interrupt handlers and event queue
-    state_machine_queue = xQueueCreate(5, sizeof(uint32_t));
-    xTaskCreate(state_machine_handler, "state_machine_handler", 2048, NULL, 10, NULL);
-    
-    // Create periodic timer for state machine updates (100ms interval)
-    state_machine_timer_handle = xTimerCreate(
-        "sm_timer",
-        pdMS_TO_TICKS(100),  // 100ms period
-        pdTRUE,              // Auto-reload
-        (void *)0,
-        state_machine_timer_callback
-    );
-    
-    if (state_machine_timer_handle != NULL) {
-        xTimerStart(state_machine_timer_handle, 0);
-    }
+#ifdef BENCH_MODE
+    bench_relay_edge_sem = xSemaphoreCreateBinary();
+    bench_published_sem = xSemaphoreCreateBinary();
+#endif
 
     // Sets up error indicator LED, GPIOs for reed switch and relay control.
     gpio_init();
-    
+
+    // Initialize the controller (state machine + relay). Releases the relay output.
+    const garage_controller_config_t controller_cfg = {
+        .reed_switch_gpio = REED_SWITCH_INPUT_GPIO,
+        .relay_gpio = RELAY_CONTROL_OUTPUT_GPIO,
+#ifdef BENCH_MODE
+        .relay_pulse_ms = BENCH_RELAY_PULSE_MS,
+#else
+        .relay_pulse_ms = GARAGE_RELAY_PULSE_MS,
+#endif
+        .position_step_pct = POSITION_STEP_PCT,
+        .sm_config = {
+            .timeout_ms = DOOR_TIMEOUT_MS,
+            .open_travel_ms = DOOR_OPEN_TRAVEL_MS,
+            .close_travel_ms = DOOR_CLOSE_TRAVEL_MS,
+        },
+    };
+    garage_controller_init(&controller, &controller_cfg, GARAGE_STATE_UNKNOWN);
+    udp_control_setup();
+    if (DISTANCE_SENSOR_ENABLED) {
+        distance_sensor_setup();
+    }
+    garage_schedule_init(&schedule, (uint32_t) (gpio_hal_get_time_us() / 1000000));
+
+    // Before the owner starts, so its first transitions are recorded
+    xTaskCreate(history_task, "history", 2048, NULL, 5, NULL);
+
+    // The handler owns the controller from here on, including its 100 ms ticks. Its deepest path,
+    // an auto-close publishing stamped attributes, formats and logs JSON several frames down; the
+    // diagnostics build reports what is left as stack_free.
+    xTaskCreate(state_machine_handler, "state_machine_handler", 3072, NULL, 10, NULL);
+
     mqtt_init(&mqtt_cfg, &mqtt_callbacks);
 
     // Sets up the wifi
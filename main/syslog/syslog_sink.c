@@ -0,0 +1,198 @@
+/**
+ * @file syslog_sink.c
+ * @brief Syslog formatting, batching and rate limiting.
+ */
+
+#include "syslog_sink.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SEVERITY_ERROR      3
+#define SEVERITY_WARNING    4
+#define SEVERITY_INFO       6
+#define SEVERITY_DEBUG      7
+#define APP_NAME_MAX        48      // RFC 5424 APP-NAME limit
+#define MILLI               1000u
+
+void syslog_sink_init(syslog_sink_t* sink, const syslog_sink_config_t* config, uint32_t now_ms)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->config = *config;
+    snprintf(sink->hostname, sizeof(sink->hostname), "%s",
+             config->hostname != NULL && config->hostname[0] != '\0' ? config->hostname : "-");
+    sink->config.hostname = sink->hostname;
+    sink->tokens_milli = config->burst * MILLI;
+    sink->refilled_ms = now_ms;
+    wall_clock_init(&sink->clock);
+}
+
+void syslog_sink_set_clock(syslog_sink_t* sink, const wall_clock_t* clock)
+{
+    sink->clock = *clock;
+}
+
+/// Severity of an ESP_LOG level letter
+static int severity_of(char level)
+{
+    switch (level) {
+        case 'E': return SEVERITY_ERROR;
+        case 'W': return SEVERITY_WARNING;
+        case 'D':
+        case 'V': return SEVERITY_DEBUG;
+        case 'I':
+        default:  return SEVERITY_INFO;
+    }
+}
+
+int syslog_format(const char* hostname, const char* line, size_t len, uint32_t seq, const wall_clock_t* clock,
+                  char* buf, size_t size)
+{
+    int severity = SEVERITY_INFO;
+    const char* app = "-";
+    size_t app_len = 1;
+    const char* msg = line;
+    size_t msg_len = len;
+    bool has_uptime = false;
+    uint32_t uptime_ms = 0;
+
+    // "L (ms) tag: text", as ESP_LOG writes it; anything else is sent whole at info
+    if (len >= 4 && strchr("EWIDV", line[0]) != NULL && line[1] == ' ' && line[2] == '(') {
+        size_t i = 3;
+        uint32_t ms = 0;
+        while (i < len && line[i] >= '0' && line[i] <= '9' && ms < 429496729u) {
+            ms = ms * 10 + (uint32_t) (line[i] - '0');
+            i++;
+        }
+        if (i > 3 && i + 1 < len && line[i] == ')' && line[i + 1] == ' ') {
+            severity = severity_of(line[0]);
+            has_uptime = true;
+            uptime_ms = ms;
+            msg = line + i + 2;
+            msg_len = len - i - 2;
+            for (size_t t = 0; t + 1 < msg_len && t <= APP_NAME_MAX; t++) {
+                if (msg[t] == ' ') {
+                    break;
+                }
+                if (msg[t] == ':' && msg[t + 1] == ' ' && t > 0) {
+                    app = msg;
+                    app_len = t;
+                    msg += t + 2;
+                    msg_len -= t + 2;
+                    break;
+                }
+            }
+        }
+    }
+
+    char sd[64];
+    if (seq != 0 && has_uptime) {
+        snprintf(sd, sizeof(sd), "[meta sequenceId=\"%u\" sysUpTime=\"%u\"]", (unsigned) seq,
+                 (unsigned) (uptime_ms / 10));
+    } else if (seq != 0) {
+        snprintf(sd, sizeof(sd), "[meta sequenceId=\"%u\"]", (unsigned) seq);
+    } else {
+        snprintf(sd, sizeof(sd), "-");
+    }
+
+    char timestamp[WALL_CLOCK_TEXT_MAX + 1] = "-";
+    int64_t utc_ms;
+    if (has_uptime && clock != NULL && wall_clock_to_utc_ms(clock, uptime_ms, &utc_ms) &&
+        wall_clock_format(utc_ms, timestamp, sizeof(timestamp)) < 0) {
+        snprintf(timestamp, sizeof(timestamp), "-");
+    }
+
+    int written = snprintf(buf, size, "<%d>1 %s %s %.*s - - %s %.*s", SYSLOG_FACILITY * 8 + severity, timestamp,
+                           hostname, (int) app_len, app, sd, (int) msg_len, msg);
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    return written;
+}
+
+/// Append a formatted message to the packet, newline-separated; false if it does not fit
+static bool append(syslog_sink_t* sink, const char* message, size_t len)
+{
+    size_t sep = sink->packet_len > 0 ? 1 : 0;
+    if (sep + len > SYSLOG_PACKET_MAX - sink->packet_len) {
+        return false;
+    }
+    if (sep) {
+        sink->packet[sink->packet_len++] = '\n';
+    }
+    memcpy(sink->packet + sink->packet_len, message, len);
+    sink->packet_len += len;
+    return true;
+}
+
+/// Refill the bucket for the time passed and take one line's worth if there is one
+static bool take_token(syslog_sink_t* sink, uint32_t now_ms)
+{
+    uint64_t full = (uint64_t) sink->config.burst * MILLI;
+    uint64_t level = sink->tokens_milli + (uint64_t) (uint32_t) (now_ms - sink->refilled_ms) * sink->config.rate_per_s;
+    sink->tokens_milli = (uint32_t) (level < full ? level : full);
+    sink->refilled_ms = now_ms;
+    if (sink->tokens_milli < MILLI) {
+        return false;
+    }
+    sink->tokens_milli -= MILLI;
+    return true;
+}
+
+syslog_add_result_t syslog_sink_add(syslog_sink_t* sink, const char* line, size_t len, uint32_t seq,
+                                    uint32_t now_ms)
+{
+    // Formatted in place after the packet, and only kept if the bucket allows
+    size_t sep = sink->packet_len > 0 ? 1 : 0;
+    if (sink->packet_len + sep >= SYSLOG_PACKET_MAX) {
+        return SYSLOG_PACKET_FULL;
+    }
+    size_t room = SYSLOG_PACKET_MAX - sink->packet_len - sep + 1;      // With snprintf's NUL
+    int n = syslog_format(sink->hostname, line, len, seq, &sink->clock, sink->packet + sink->packet_len + sep, room);
+    if (n < 0) {
+        if (sep) {
+            return SYSLOG_PACKET_FULL;
+        }
+        n = (int) room - 1;         // Longer than a whole packet: cut rather than lost
+    }
+    if (!take_token(sink, now_ms)) {
+        sink->rate_limited++;
+        return SYSLOG_RATE_LIMITED;
+    }
+    if (sep) {
+        sink->packet[sink->packet_len] = '\n';
+    }
+    sink->packet_len += sep + (size_t) n;
+    sink->packet_lines++;
+    return SYSLOG_ADDED;
+}
+
+bool syslog_sink_add_drop_report(syslog_sink_t* sink, uint32_t overwritten)
+{
+    uint32_t drops = overwritten + sink->rate_limited + sink->send_failed;
+    if (drops == sink->reported_drops) {
+        return true;
+    }
+    char message[200];
+    int n = snprintf(message, sizeof(message),
+                     "<%d>1 - %s syslog - - - %u log lines dropped: %u overwritten in RAM, %u over the rate limit, "
+                     "%u unsent",
+                     SYSLOG_FACILITY * 8 + SEVERITY_WARNING, sink->hostname, (unsigned) drops,
+                     (unsigned) overwritten, (unsigned) sink->rate_limited, (unsigned) sink->send_failed);
+    if (n < 0 || (size_t) n >= sizeof(message) || !append(sink, message, (size_t) n)) {
+        return false;
+    }
+    sink->reported_drops = drops;
+    return true;
+}
+
+void syslog_sink_packet_done(syslog_sink_t* sink, bool sent)
+{
+    if (sent) {
+        sink->sent_lines += (uint32_t) sink->packet_lines;
+        sink->sent_packets++;
+    } else {
+        sink->send_failed += (uint32_t) sink->packet_lines;
+    }
+    sink->packet_len = 0;
+    sink->packet_lines = 0;
+}
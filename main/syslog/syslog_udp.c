@@ -0,0 +1,43 @@
+/**
+ * @file syslog_udp.c
+ * @brief Syslog collector socket implementation.
+ */
+
+#include "syslog_udp.h"
+#include <string.h>
+#include "lwip/sockets.h"
+
+int syslog_udp_open(const char* host, uint16_t port)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (host == NULL || inet_aton(host, &addr.sin_addr) == 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    // Connected, so every send goes to the collector without an address lookup
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool syslog_udp_send(int fd, const void* data, size_t len)
+{
+    ssize_t sent = send(fd, data, len, 0);
+    return sent == (ssize_t) len;
+}
+
+void syslog_udp_close(int fd)
+{
+    if (fd >= 0) {
+        close(fd);
+    }
+}
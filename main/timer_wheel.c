@@ -0,0 +1,110 @@
+/**
+ * @file timer_wheel.c
+ * @brief Hashed timer wheel implementation.
+ */
+
+#include "timer_wheel.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/// Tick comparison that survives counter wrap
+static bool tick_reached(uint32_t tick, uint32_t now)
+{
+    return (int32_t) (now - tick) >= 0;
+}
+
+void timer_wheel_init(timer_wheel_t* wheel, uint32_t now)
+{
+    if (wheel == NULL) {
+        return;
+    }
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->cursor = now;
+}
+
+void timer_wheel_timer_init(timer_wheel_timer_t* timer, void* data)
+{
+    if (timer == NULL) {
+        return;
+    }
+    memset(timer, 0, sizeof(*timer));
+    timer->data = data;
+}
+
+static void unlink_timer(timer_wheel_t* wheel, timer_wheel_timer_t* timer)
+{
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel->slots[timer->expires & SLOT_MASK] = timer->next;
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+    timer->active = false;
+    wheel->active--;
+}
+
+void timer_wheel_start(timer_wheel_t* wheel, timer_wheel_timer_t* timer, uint32_t expires)
+{
+    if (wheel == NULL || timer == NULL) {
+        return;
+    }
+    if (timer->active) {
+        unlink_timer(wheel, timer);
+    }
+    // Already due: file it under the tick being expired so the next expire call finds it
+    if (tick_reached(expires, wheel->cursor)) {
+        expires = wheel->cursor;
+    }
+
+    timer_wheel_timer_t** slot = &wheel->slots[expires & SLOT_MASK];
+    timer->expires = expires;
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot != NULL) {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+    timer->active = true;
+    wheel->active++;
+}
+
+void timer_wheel_cancel(timer_wheel_t* wheel, timer_wheel_timer_t* timer)
+{
+    if (wheel == NULL || timer == NULL || !timer->active) {
+        return;
+    }
+    unlink_timer(wheel, timer);
+}
+
+timer_wheel_timer_t* timer_wheel_expire(timer_wheel_t* wheel, uint32_t now)
+{
+    if (wheel == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        if (wheel->active == 0) {
+            if (!tick_reached(now, wheel->cursor)) {
+                wheel->cursor = now;                // Nothing to walk past
+            }
+            return NULL;
+        }
+        for (timer_wheel_timer_t* timer = wheel->slots[wheel->cursor & SLOT_MASK]; timer != NULL;
+             timer = timer->next) {
+            if (tick_reached(timer->expires, wheel->cursor)) {
+                unlink_timer(wheel, timer);
+                return timer;
+            }
+        }
+        if (tick_reached(now, wheel->cursor)) {
+            return NULL;                            // Caught up; the cursor stays on now
+        }
+        wheel->cursor++;
+    }
+}
@@ -0,0 +1,146 @@
+/**
+ * @file udp_control.c
+ * @brief Broker-less UDP control channel implementation.
+ */
+
+#include "udp_control.h"
+#include <string.h>
+
+void udp_control_init(udp_control_t* ctrl, const udp_control_config_t* config)
+{
+    if (ctrl == NULL) {
+        return;
+    }
+    memset(ctrl, 0, sizeof(*ctrl));
+    if (config != NULL) {
+        ctrl->config = *config;
+    }
+}
+
+/// Fill a reply or notification payload from a snapshot
+static void state_payload(const garage_controller_snapshot_t* snapshot, udp_result_t result,
+                          uint32_t answered_counter, uint8_t payload[UDP_FRAME_PAYLOAD_LEN])
+{
+    udp_state_payload_t state = {
+        .state = snapshot->state,
+        .position = snapshot->position,
+        .obstructed = snapshot->obstructed,
+        .result = result,
+        .transition_count = snapshot->transition_count,
+        .answered_counter = answered_counter,
+    };
+    udp_frame_put_state(&state, payload);
+}
+
+static void read_snapshot(const udp_control_t* ctrl, garage_controller_snapshot_t* snapshot)
+{
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->state = GARAGE_STATE_UNKNOWN;
+    snapshot->position = GARAGE_POSITION_UNKNOWN;
+    if (ctrl->config.get_snapshot != NULL) {
+        ctrl->config.get_snapshot(snapshot, ctrl->config.ctx);
+    }
+}
+
+static garage_input_t op_to_input(uint8_t op)
+{
+    switch (op) {
+        case UDP_OP_OPEN:  return GARAGE_INPUT_COMMAND_OPEN;
+        case UDP_OP_CLOSE: return GARAGE_INPUT_COMMAND_CLOSE;
+        case UDP_OP_STOP:  return GARAGE_INPUT_COMMAND_STOP;
+        default:           return GARAGE_INPUT_NONE;
+    }
+}
+
+bool udp_control_handle(udp_control_t* ctrl, const uint8_t* buf, size_t len, uint8_t reply[UDP_FRAME_LEN])
+{
+    if (ctrl == NULL || reply == NULL) {
+        return false;
+    }
+
+    udp_frame_t command;
+    if (udp_frame_decode(buf, len, ctrl->config.key, ctrl->config.key_len, &command) != UDP_FRAME_OK ||
+        command.type != UDP_FRAME_COMMAND) {
+        ctrl->dropped++;
+        return false;
+    }
+
+    udp_result_t result;
+    if (command.session != ctrl->config.session) {
+        result = UDP_RESULT_RESYNC;
+        ctrl->resyncs++;
+    } else if (command.counter <= ctrl->last_command_counter) {
+        ctrl->dropped++;                        // Replayed or reordered
+        return false;
+    } else {
+        ctrl->last_command_counter = command.counter;
+        uint8_t op = command.payload[0];
+        garage_input_t input = op_to_input(op);
+        if (op == UDP_OP_QUERY) {
+            result = UDP_RESULT_STATE;
+        } else if (input == GARAGE_INPUT_NONE) {
+            result = UDP_RESULT_BAD_OP;
+        } else if (ctrl->config.on_command != NULL && ctrl->config.on_command(input, ctrl->config.ctx)) {
+            result = UDP_RESULT_ACCEPTED;
+            ctrl->commands++;
+        } else {
+            result = UDP_RESULT_BUSY;
+        }
+    }
+
+    garage_controller_snapshot_t snapshot;
+    read_snapshot(ctrl, &snapshot);
+
+    udp_frame_t answer;
+    answer.type = UDP_FRAME_REPLY;
+    answer.session = ctrl->config.session;
+    answer.counter = ++ctrl->reply_counter;
+    state_payload(&snapshot, result, command.counter, answer.payload);
+    udp_frame_encode(&answer, ctrl->config.key, ctrl->config.key_len, reply);
+    return true;
+}
+
+static bool notification_due(const udp_control_t* ctrl, const garage_controller_snapshot_t* snapshot,
+                             int64_t now_ms)
+{
+    if (!ctrl->notified) {
+        return true;
+    }
+    const garage_controller_snapshot_t* last = &ctrl->last_notified;
+    if (snapshot->state != last->state || snapshot->obstructed != last->obstructed) {
+        return true;
+    }
+    if (snapshot->position != last->position) {
+        int step = ctrl->config.position_step_pct;
+        int moved = snapshot->position - last->position;
+        if (moved < 0) {
+            moved = -moved;
+        }
+        if (snapshot->position == GARAGE_POSITION_CLOSED || snapshot->position == GARAGE_POSITION_OPEN ||
+            snapshot->position == GARAGE_POSITION_UNKNOWN || last->position == GARAGE_POSITION_UNKNOWN ||
+            (step > 0 && moved >= step)) {
+            return true;
+        }
+    }
+    return ctrl->config.heartbeat_ms > 0 && now_ms - ctrl->last_notify_ms >= ctrl->config.heartbeat_ms;
+}
+
+bool udp_control_poll_notification(udp_control_t* ctrl, const garage_controller_snapshot_t* snapshot,
+                                   int64_t now_ms, uint8_t frame[UDP_FRAME_LEN])
+{
+    if (ctrl == NULL || snapshot == NULL || frame == NULL || !notification_due(ctrl, snapshot, now_ms)) {
+        return false;
+    }
+
+    udp_frame_t notify;
+    notify.type = UDP_FRAME_NOTIFY;
+    notify.session = ctrl->config.session;
+    notify.counter = ++ctrl->notify_counter;
+    state_payload(snapshot, UDP_RESULT_NOTIFY, 0, notify.payload);
+    udp_frame_encode(&notify, ctrl->config.key, ctrl->config.key_len, frame);
+
+    ctrl->notified = true;
+    ctrl->last_notified = *snapshot;
+    ctrl->last_notify_ms = now_ms;
+    return true;
+}
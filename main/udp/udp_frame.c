@@ -0,0 +1,84 @@
+/**
+ * @file udp_frame.c
+ * @brief UDP control channel frame encoding.
+ */
+
+#include "udp_frame.h"
+#include <string.h>
+#include "hmac_sha256.h"
+
+#define MAGIC_0         'G'
+#define MAGIC_1         'D'
+#define SIGNED_LEN      (UDP_FRAME_LEN - UDP_FRAME_MAC_LEN)
+
+static void put_u32(uint8_t* p, uint32_t value)
+{
+    p[0] = (uint8_t) (value >> 24);
+    p[1] = (uint8_t) (value >> 16);
+    p[2] = (uint8_t) (value >> 8);
+    p[3] = (uint8_t) value;
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+void udp_frame_put_state(const udp_state_payload_t* state, uint8_t payload[UDP_FRAME_PAYLOAD_LEN])
+{
+    payload[0] = (uint8_t) state->state;
+    payload[1] = (uint8_t) (int8_t) state->position;
+    payload[2] = state->obstructed ? 0x01 : 0x00;
+    payload[3] = (uint8_t) state->result;
+    put_u32(payload + 4, state->transition_count);
+    put_u32(payload + 8, state->answered_counter);
+}
+
+void udp_frame_get_state(const uint8_t payload[UDP_FRAME_PAYLOAD_LEN], udp_state_payload_t* state)
+{
+    state->state = (garage_state_t) payload[0];
+    state->position = (int8_t) payload[1];
+    state->obstructed = (payload[2] & 0x01) != 0;
+    state->result = (udp_result_t) payload[3];
+    state->transition_count = get_u32(payload + 4);
+    state->answered_counter = get_u32(payload + 8);
+}
+
+void udp_frame_encode(const udp_frame_t* frame, const uint8_t* key, size_t key_len, uint8_t out[UDP_FRAME_LEN])
+{
+    uint8_t mac[SHA256_DIGEST_LEN];
+
+    out[0] = MAGIC_0;
+    out[1] = MAGIC_1;
+    out[2] = UDP_FRAME_VERSION;
+    out[3] = (uint8_t) frame->type;
+    put_u32(out + 4, frame->session);
+    put_u32(out + 8, frame->counter);
+    memcpy(out + 12, frame->payload, UDP_FRAME_PAYLOAD_LEN);
+    hmac_sha256(key, key_len, out, SIGNED_LEN, mac);
+    memcpy(out + SIGNED_LEN, mac, UDP_FRAME_MAC_LEN);
+}
+
+udp_frame_status_t udp_frame_decode(const uint8_t* buf, size_t len, const uint8_t* key, size_t key_len,
+                                    udp_frame_t* frame)
+{
+    if (buf == NULL || len != UDP_FRAME_LEN) {
+        return UDP_FRAME_BAD_LENGTH;
+    }
+    if (buf[0] != MAGIC_0 || buf[1] != MAGIC_1 || buf[2] != UDP_FRAME_VERSION ||
+        buf[3] < UDP_FRAME_COMMAND || buf[3] > UDP_FRAME_NOTIFY) {
+        return UDP_FRAME_BAD_HEADER;
+    }
+
+    uint8_t mac[SHA256_DIGEST_LEN];
+    hmac_sha256(key, key_len, buf, SIGNED_LEN, mac);
+    if (!hmac_sha256_equal(mac, buf + SIGNED_LEN, UDP_FRAME_MAC_LEN)) {
+        return UDP_FRAME_BAD_MAC;
+    }
+
+    frame->type = (udp_frame_type_t) buf[3];
+    frame->session = get_u32(buf + 4);
+    frame->counter = get_u32(buf + 8);
+    memcpy(frame->payload, buf + 12, UDP_FRAME_PAYLOAD_LEN);
+    return UDP_FRAME_OK;
+}
@@ -0,0 +1,89 @@
+/**
+ * @file udp_server.c
+ * @brief UDP control channel sockets implementation.
+ */
+
+#include "udp_server.h"
+#include <string.h>
+#include "lwip/sockets.h"
+
+#define NOTIFY_TTL 1
+
+int udp_server_open(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+uint16_t udp_server_port(int fd)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*) &addr, &len) != 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+int udp_server_serve_one(int fd, udp_control_t* ctrl)
+{
+    // One byte more than a frame, so oversized datagrams are seen as such instead of truncated to fit
+    uint8_t request[UDP_FRAME_LEN + 1];
+    uint8_t reply[UDP_FRAME_LEN];
+    struct sockaddr_in source;
+    socklen_t source_len = sizeof(source);
+
+    ssize_t n = recvfrom(fd, request, sizeof(request), 0, (struct sockaddr*) &source, &source_len);
+    if (n < 0) {
+        return -1;
+    }
+    if (!udp_control_handle(ctrl, request, (size_t) n, reply)) {
+        return 0;
+    }
+    ssize_t sent = sendto(fd, reply, sizeof(reply), 0, (struct sockaddr*) &source, source_len);
+    return sent == (ssize_t) sizeof(reply) ? 1 : -1;
+}
+
+int udp_server_open_notifier(void)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unsigned char ttl = NOTIFY_TTL;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    return fd;
+}
+
+bool udp_server_notify(int fd, const char* group, uint16_t port, const uint8_t frame[UDP_FRAME_LEN])
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (group == NULL || inet_aton(group, &addr.sin_addr) == 0) {
+        return false;
+    }
+    ssize_t sent = sendto(fd, frame, UDP_FRAME_LEN, 0, (struct sockaddr*) &addr, sizeof(addr));
+    return sent == UDP_FRAME_LEN;
+}
+
+void udp_server_close(int fd)
+{
+    if (fd >= 0) {
+        close(fd);
+    }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file wall_clock.c
+ * @brief Monotonic to UTC mapping implementation.
+ */
+
+#include "wall_clock.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MS_PER_DAY      86400000LL
+#define MAX_UTC_MS      253402300799999LL       // 9999-12-31T23:59:59.999Z
+
+void wall_clock_init(wall_clock_t* clock)
+{
+    memset(clock, 0, sizeof(*clock));
+}
+
+bool wall_clock_update(wall_clock_t* clock, int64_t mono_ms, int64_t utc_ms)
+{
+    if (utc_ms < (int64_t) WALL_CLOCK_MIN_UTC_S * 1000) {
+        return false;
+    }
+    int64_t offset_ms = utc_ms - mono_ms;
+    int64_t moved = offset_ms - clock->offset_ms;
+    bool step = !clock->synced || moved >= WALL_CLOCK_STEP_MS || moved <= -WALL_CLOCK_STEP_MS;
+    clock->offset_ms = offset_ms;
+    clock->synced = true;
+    if (step) {
+        clock->steps++;
+    }
+    return step;
+}
+
+bool wall_clock_to_utc_ms(const wall_clock_t* clock, int64_t mono_ms, int64_t* utc_ms)
+{
+    if (!clock->synced) {
+        return false;
+    }
+    *utc_ms = clock->offset_ms + mono_ms;
+    return true;
+}
+
+int wall_clock_format(int64_t utc_ms, char* buf, size_t size)
+{
+    if (utc_ms < 0 || utc_ms > MAX_UTC_MS || buf == NULL) {
+        return -1;
+    }
+    int64_t days = utc_ms / MS_PER_DAY;
+    int64_t ms_of_day = utc_ms % MS_PER_DAY;
+
+    // Civil date from days since 1970 (proleptic Gregorian, eras of 400 years from 0000-03-01)
+    int64_t z = days + 719468;
+    int64_t era = z / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int day = (int) (doy - (153 * mp + 2) / 5 + 1);
+    int month = (int) (mp < 10 ? mp + 3 : mp - 9);
+    int year = (int) (yoe + era * 400 + (month <= 2 ? 1 : 0));
+
+    int written = snprintf(buf, size, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ", year, month, day,
+                           (int) (ms_of_day / 3600000), (int) (ms_of_day / 60000 % 60),
+                           (int) (ms_of_day / 1000 % 60), (int) (ms_of_day % 1000));
+    if (written < 0 || (size_t) written >= size) {
+        return -1;
+    }
+    return written;
+}
+
+int wall_clock_stamp_json(char* json, int len, size_t size, int64_t utc_ms)
+{
+    char text[WALL_CLOCK_TEXT_MAX + 1];
+    if (json == NULL || len < 2 || json[len - 1] != '}' || wall_clock_format(utc_ms, text, sizeof(text)) < 0) {
+        return len;
+    }
+    // An empty object takes no comma
+    const char* sep = json[len - 2] == '{' ? "" : ",";
+    int tail = snprintf(NULL, 0, "%s\"time\":\"%s\"}", sep, text);
+    if (tail < 0 || (size_t) (len - 1 + tail) >= size) {
+        return len;
+    }
+    snprintf(json + len - 1, size - (size_t) (len - 1), "%s\"time\":\"%s\"}", sep, text);
+    return len - 1 + tail;
+}
@@ -1,6 +1,7 @@
 #include "wifi_interface.h"
 #include "wifi_hal_interface.h"
 #include "wifi_retry_manager.h"
+#include "metrics.h"
 #include "wifi_credentials.h"  
 #include "esp_wifi.h"
 #include "string.h"
@@ -140,6 +141,11 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
         wifi_hal_log_info(WIFI_TAG, "Disconnected from AP");
+        // Failed reconnect attempts raise this too; only a lost connection is counted
+        if (metrics_get(METRIC_WIFI_CONNECTED) != 0) {
+            metrics_set(METRIC_WIFI_CONNECTED, 0);
+            metrics_inc(METRIC_WIFI_DISCONNECTS);
+        }
         
         wifi_retry_result_t result = wifi_retry_on_disconnect(&s_retry_state);
         
@@ -166,6 +172,7 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         }
         
         wifi_hal_event_group_set_bits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        metrics_set(METRIC_WIFI_CONNECTED, 1);
         
         if (s_event_callbacks.on_got_ip != NULL) {
             s_event_callbacks.on_got_ip(ip_str);
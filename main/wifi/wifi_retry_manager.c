@@ -15,6 +15,7 @@ void wifi_retry_init(wifi_retry_state_t* state, int max_retries, int retry_inter
     state->retry_interval_ms = retry_interval_ms;
     state->is_connected = false;
     state->timer_should_be_running = false;
+    state->fail_reported = false;
 }
 
 wifi_retry_result_t wifi_retry_on_disconnect(wifi_retry_state_t* state)
@@ -33,12 +34,19 @@ wifi_retry_result_t wifi_retry_on_disconnect(wifi_retry_state_t* state)
         result.action = WIFI_RETRY_ACTION_CONNECT;
         result.should_callback_disconnected = true;
         result.callback_retry_count = state->retry_count;
-    } else {
+    } else if (!state->fail_reported) {
         // Max immediate retries exceeded - start long interval timer
         result.action = WIFI_RETRY_ACTION_FAIL;
         result.should_callback_disconnected = true;
+        result.should_callback_failed = true;
         result.callback_retry_count = state->retry_count;
         state->timer_should_be_running = true;
+        state->fail_reported = true;
+    } else {
+        // Already failed - wait for the long interval timer, restarting it would postpone the retry
+        result.action = WIFI_RETRY_ACTION_NONE;
+        result.should_callback_disconnected = true;
+        result.callback_retry_count = state->retry_count;
     }
     
     return result;
@@ -54,6 +62,7 @@ wifi_retry_result_t wifi_retry_on_connected(wifi_retry_state_t* state)
     
     state->is_connected = true;
     state->retry_count = 0;
+    state->fail_reported = false;
     
     if (state->timer_should_be_running) {
         result.action = WIFI_RETRY_ACTION_STOP_TIMER;
@@ -77,6 +86,7 @@ wifi_retry_result_t wifi_retry_on_timer_expired(wifi_retry_state_t* state)
     
     // Timer expired - reset retry count and try again
     state->retry_count = 0;
+    state->fail_reported = false;
     result.action = WIFI_RETRY_ACTION_CONNECT;
     
     return result;
@@ -0,0 +1,108 @@
+/**
+ * @file bench.h
+ * @brief Minimal host micro-benchmark harness
+ *
+ * Benchmarks register themselves with BENCH(name) and loop on
+ * state.keep_running(). The runner grows the iteration count until a run lasts
+ * long enough to time reliably, then reports nanoseconds per iteration, and
+ * the payload size for benchmarks that produce one (state.set_bytes()).
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+class State {
+public:
+    explicit State(uint64_t iterations) : remaining_(iterations), iterations_(iterations) {}
+
+    /// Returns true while iterations remain; starts the clock on the first call
+    bool keep_running()
+    {
+        if (!started_) {
+            started_ = true;
+            start_ = std::chrono::steady_clock::now();
+        }
+        if (remaining_ == 0) {
+            if (!stopped_) {
+                stop_ = std::chrono::steady_clock::now();
+                stopped_ = true;
+            }
+            return false;
+        }
+        remaining_--;
+        return true;
+    }
+
+    /// Exclude setup done inside the loop from the measurement
+    void pause() { pause_start_ = std::chrono::steady_clock::now(); }
+    void resume() { paused_ += std::chrono::steady_clock::now() - pause_start_; }
+
+    uint64_t iterations() const { return iterations_; }
+
+    /// Report the size of what one iteration produces, e.g. a payload's bytes on the wire
+    void set_bytes(uint64_t bytes) { bytes_ = bytes; }
+    uint64_t bytes() const { return bytes_; }
+
+    double elapsed_ns() const
+    {
+        auto end = stopped_ ? stop_ : std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start_ - paused_).count();
+    }
+
+private:
+    uint64_t remaining_;
+    uint64_t iterations_;
+    uint64_t bytes_ = 0;
+    bool started_ = false;
+    bool stopped_ = false;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point stop_;
+    std::chrono::steady_clock::time_point pause_start_;
+    std::chrono::steady_clock::duration paused_ = std::chrono::steady_clock::duration::zero();
+};
+
+typedef void (*Function)(State& state);
+
+struct Entry {
+    const char* name;
+    Function function;
+};
+
+inline std::vector<Entry>& registry()
+{
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+struct Registrar {
+    Registrar(const char* name, Function function) { registry().push_back({ name, function }); }
+};
+
+/// Keep a value alive so the optimizer cannot drop the computation producing it
+template <typename T>
+inline void do_not_optimize(T const& value)
+{
+#if defined(_MSC_VER)
+    static const void* volatile sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#else
+    asm volatile("" : : "r,m"(value) : "memory");
+#endif
+}
+
+} // namespace bench
+
+#define BENCH(fn) static ::bench::Registrar bench_registrar_##fn(#fn, fn)
+
+#endif // BENCH_H
@@ -0,0 +1,72 @@
+/**
+ * @file bench_door_model.cpp
+ * @brief Benchmarks for full door cycles against the physical door model
+ */
+
+#include "bench.h"
+
+extern "C" {
+#include "door_model.h"
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+}
+
+#define REED_GPIO   4
+#define RELAY_GPIO  5
+#define QUEUE_DEPTH 5
+
+static garage_input_t s_queue[QUEUE_DEPTH];
+static int s_queue_count = 0;
+
+static void reed_isr(void* arg)
+{
+    (void) arg;
+    if (s_queue_count < QUEUE_DEPTH) {
+        s_queue[s_queue_count++] = GARAGE_INPUT_REED_SWITCH;
+    }
+}
+
+/// Advance virtual time in 100 ms controller ticks, draining the queue before each tick
+static void run_ticks(garage_controller_t* ctrl, int ticks)
+{
+    for (int i = 0; i < ticks; i++) {
+        gpio_hal_sim_advance_by(100 * 1000);
+        for (int j = 0; j < s_queue_count; j++) {
+            bench::do_not_optimize(garage_controller_handle_input(ctrl, s_queue[j]));
+        }
+        s_queue_count = 0;
+        bench::do_not_optimize(garage_controller_tick(ctrl, 100));
+    }
+}
+
+/// OPEN then CLOSE through relay, door travel and bouncing reed switch: 30 s of virtual time
+static void BM_DoorModel_OpenCloseCycle(bench::State& state)
+{
+    gpio_hal_sim_reset();
+    gpio_hal_config_output(1u << RELAY_GPIO);
+    gpio_hal_config_input(1u << REED_GPIO, GPIO_HAL_EDGE_ANY, true);
+    gpio_hal_install_isr_service();
+    gpio_hal_isr_handler_add(REED_GPIO, reed_isr, NULL);
+    s_queue_count = 0;
+
+    door_model_config_t door_config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+    door_model_t door;
+    door_model_init(&door, &door_config, false);
+    door_model_attach(&door);
+
+    garage_controller_config_t config = {};
+    config.reed_switch_gpio = REED_GPIO;
+    config.relay_gpio = RELAY_GPIO;
+    config.relay_pulse_ms = GARAGE_RELAY_PULSE_MS;
+    config.sm_config.timeout_ms = 15000;
+    garage_controller_t ctrl;
+    garage_controller_init(&ctrl, &config, GARAGE_STATE_CLOSED);
+
+    while (state.keep_running()) {
+        bench::do_not_optimize(garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN));
+        run_ticks(&ctrl, 160);
+        bench::do_not_optimize(garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE));
+        run_ticks(&ctrl, 140);
+    }
+}
+BENCH(BM_DoorModel_OpenCloseCycle);
@@ -0,0 +1,97 @@
+/**
+ * @file bench_gpio_path.cpp
+ * @brief Benchmarks for the ISR -> queue -> state machine -> relay path on the simulated GPIO HAL
+ */
+
+#include "bench.h"
+
+extern "C" {
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+}
+
+#define REED_GPIO   4
+#define RELAY_GPIO  5
+#define QUEUE_DEPTH 5
+
+static garage_input_t s_queue[QUEUE_DEPTH];
+static int s_queue_count = 0;
+
+static void reed_isr(void* arg)
+{
+    (void) arg;
+    if (s_queue_count < QUEUE_DEPTH) {
+        s_queue[s_queue_count++] = GARAGE_INPUT_REED_SWITCH;
+    }
+}
+
+static void setup(garage_controller_t* ctrl)
+{
+    gpio_hal_sim_reset();
+    gpio_hal_config_output(1u << RELAY_GPIO);
+    gpio_hal_config_input(1u << REED_GPIO, GPIO_HAL_EDGE_ANY, true);
+    gpio_hal_install_isr_service();
+    gpio_hal_isr_handler_add(REED_GPIO, reed_isr, NULL);
+    s_queue_count = 0;
+
+    garage_controller_config_t config = {};
+    config.reed_switch_gpio = REED_GPIO;
+    config.relay_gpio = RELAY_GPIO;
+    config.relay_pulse_ms = 500;
+    config.sm_config.timeout_ms = 15000;
+    garage_controller_init(ctrl, &config, GARAGE_STATE_CLOSED);
+}
+
+static void drain(garage_controller_t* ctrl)
+{
+    for (int i = 0; i < s_queue_count; i++) {
+        bench::do_not_optimize(garage_controller_handle_input(ctrl, s_queue[i]));
+    }
+    s_queue_count = 0;
+}
+
+/// One clean reed switch edge: scripted edge -> ISR -> queue -> controller
+static void BM_GpioPath_SingleEdge(bench::State& state)
+{
+    garage_controller_t ctrl;
+    setup(&ctrl);
+    int level = 1;
+    while (state.keep_running()) {
+        gpio_hal_sim_edge_t edge = { gpio_hal_get_time_us() + 10, REED_GPIO, level };
+        gpio_hal_sim_schedule_edges(&edge, 1);
+        gpio_hal_sim_advance_by(10);
+        drain(&ctrl);
+        level = !level;
+    }
+}
+BENCH(BM_GpioPath_SingleEdge);
+
+/// A 32-toggle contact bounce at 20 kHz followed by one handler drain
+static void BM_GpioPath_BounceBurst32(bench::State& state)
+{
+    garage_controller_t ctrl;
+    setup(&ctrl);
+    int final_level = 1;
+    while (state.keep_running()) {
+        gpio_hal_sim_schedule_bounce(REED_GPIO, gpio_hal_get_time_us() + 50, final_level, 32, 50);
+        gpio_hal_sim_advance_by(50 * 34);
+        drain(&ctrl);
+        final_level = !final_level;
+    }
+}
+BENCH(BM_GpioPath_BounceBurst32);
+
+/// OPEN command through the controller including the relay pulse and its release
+static void BM_GpioPath_CommandRelayPulse(bench::State& state)
+{
+    garage_controller_t ctrl;
+    setup(&ctrl);
+    while (state.keep_running()) {
+        bench::do_not_optimize(garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN));
+        for (int i = 0; i < 5; i++) {
+            bench::do_not_optimize(garage_controller_tick(&ctrl, 100));
+        }
+        bench::do_not_optimize(garage_controller_handle_input(&ctrl, GARAGE_INPUT_SENSOR_CLOSED));
+    }
+}
+BENCH(BM_GpioPath_CommandRelayPulse);
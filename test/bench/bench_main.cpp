@@ -0,0 +1,186 @@
+/**
+ * @file bench_main.cpp
+ * @brief Runner for the host micro-benchmarks
+ *
+ * Usage: benchmarks [--filter <substring>] [--min-time-ms <ms>] [--repetitions <n>] [--json <path>]
+ *
+ * With --repetitions each benchmark is calibrated once and then timed n times
+ * at the same iteration count, round-robin across the selected benchmarks;
+ * --json writes every sample for tools/bench_compare.py.
+ */
+
+#include "bench.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct Result {
+    const char* name;
+    uint64_t iterations;
+    uint64_t bytes;                     // Payload size reported with set_bytes(), 0 if none
+    std::vector<double> samples_ns;     // ns/op of each repetition
+    double mean_ns;
+    double stddev_ns;
+};
+
+static double run_fixed(const bench::Entry& entry, uint64_t iterations)
+{
+    bench::State state(iterations);
+    entry.function(state);
+    return state.elapsed_ns() / (double) iterations;
+}
+
+static double run_one(const bench::Entry& entry, double min_time_ns, uint64_t* iterations_out, uint64_t* bytes_out)
+{
+    uint64_t iterations = 1;
+    for (;;) {
+        bench::State state(iterations);
+        entry.function(state);
+        double elapsed = state.elapsed_ns();
+        if (elapsed >= min_time_ns || iterations >= (1ull << 40)) {
+            *iterations_out = iterations;
+            *bytes_out = state.bytes();
+            return elapsed / (double) iterations;
+        }
+        // Aim slightly past the target to avoid one extra round
+        double scale = elapsed > 0 ? (min_time_ns * 1.4) / elapsed : 10.0;
+        if (scale < 2.0) {
+            scale = 2.0;
+        } else if (scale > 100.0) {
+            scale = 100.0;
+        }
+        iterations = (uint64_t) ((double) iterations * scale);
+    }
+}
+
+static void summarize(Result* result)
+{
+    double sum = 0;
+    for (double sample : result->samples_ns) {
+        sum += sample;
+    }
+    size_t n = result->samples_ns.size();
+    result->mean_ns = sum / (double) n;
+
+    double squares = 0;
+    for (double sample : result->samples_ns) {
+        squares += (sample - result->mean_ns) * (sample - result->mean_ns);
+    }
+    result->stddev_ns = n > 1 ? std::sqrt(squares / (double) (n - 1)) : 0.0;
+}
+
+static const char* compiler_name()
+{
+#if defined(__clang__)
+    return "clang " __clang_version__;
+#elif defined(__GNUC__)
+    return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+#define BENCH_STR2(x) #x
+#define BENCH_STR(x) BENCH_STR2(x)
+    return "msvc " BENCH_STR(_MSC_VER);
+#else
+    return "unknown";
+#endif
+}
+
+static bool write_json(const char* path, const std::vector<Result>& results, double min_time_ms, int repetitions)
+{
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return false;
+    }
+#ifdef NDEBUG
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+    fprintf(f, "{\n  \"context\": {\"compiler\": \"%s\", \"build\": \"%s\", \"min_time_ms\": %g, \"repetitions\": %d},\n",
+            compiler_name(), build, min_time_ms, repetitions);
+    fprintf(f, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"iterations\": %llu, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"samples_ns\": [",
+                result.name, (unsigned long long) result.iterations, result.mean_ns, result.stddev_ns);
+        for (size_t s = 0; s < result.samples_ns.size(); s++) {
+            fprintf(f, "%s%.3f", s == 0 ? "" : ", ", result.samples_ns[s]);
+        }
+        fprintf(f, "]");
+        if (result.bytes != 0) {
+            fprintf(f, ", \"bytes\": %llu", (unsigned long long) result.bytes);
+        }
+        fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* filter = NULL;
+    const char* json_path = NULL;
+    double min_time_ms = 200.0;
+    int repetitions = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            min_time_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc) {
+            repetitions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--filter <substring>] [--min-time-ms <ms>] [--repetitions <n>] [--json <path>]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (repetitions < 1) {
+        repetitions = 1;
+    }
+
+    // Calibrate every benchmark first, then time the repetitions round-robin so that
+    // machine drift (frequency scaling, other load) spreads across all of them
+    std::vector<const bench::Entry*> entries;
+    std::vector<Result> results;
+    for (const bench::Entry& entry : bench::registry()) {
+        if (filter != NULL && strstr(entry.name, filter) == NULL) {
+            continue;
+        }
+        Result result;
+        result.name = entry.name;
+        double calibrated_ns = run_one(entry, min_time_ms * 1e6, &result.iterations, &result.bytes);
+        if (repetitions == 1) {
+            result.samples_ns.push_back(calibrated_ns);
+        }
+        entries.push_back(&entry);
+        results.push_back(result);
+    }
+    for (int r = 0; repetitions > 1 && r < repetitions; r++) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            results[i].samples_ns.push_back(run_fixed(*entries[i], results[i].iterations));
+        }
+    }
+
+    printf("%-40s %14s %10s %14s %8s\n", "benchmark", "ns/op", "stddev", "iterations", "bytes");
+    for (Result& result : results) {
+        summarize(&result);
+        printf("%-40s %14.1f %10.1f %14llu ", result.name, result.mean_ns, result.stddev_ns,
+               (unsigned long long) result.iterations);
+        if (result.bytes != 0) {
+            printf("%8llu\n", (unsigned long long) result.bytes);
+        } else {
+            printf("%8s\n", "-");
+        }
+    }
+
+    if (json_path != NULL && !write_json(json_path, results, min_time_ms, repetitions)) {
+        fprintf(stderr, "cannot write %s\n", json_path);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file bench_mqtt_ingress.cpp
+ * @brief Cost of one MQTT data event through mqtt_impl.c's handler and command classification
+ */
+
+#include "bench.h"
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "garage_command.h"
+#include "mqtt_hal_sim.h"
+#include "mqtt_interface.h"
+}
+
+static const garage_command_topics_t s_topics = { "garage_door/buttonpress", "garage_door/status" };
+static int s_commands = 0;
+
+static void on_data(const char* topic, int topic_len, const char* data, int data_len)
+{
+    garage_message_t message = garage_command_classify(&s_topics, topic, topic_len, data, data_len);
+    s_commands += message.kind == GARAGE_MESSAGE_COMMAND;
+}
+
+static void run_data_events(bench::State& state, const std::string& topic_str, size_t payload_len)
+{
+    static const mqtt_event_callbacks_t callbacks = { nullptr, nullptr, on_data, nullptr };
+    static const mqtt_config_t config = { "broker.local", 1883, nullptr, nullptr, "a", "unavailable" };
+    mqtt_hal_sim_reset();
+    mqtt_init(&config, &callbacks);
+
+    std::vector<char> topic(topic_str.begin(), topic_str.end());
+    std::vector<char> data(payload_len, 'A');
+    if (payload_len == 4) {
+        data.assign({'O', 'P', 'E', 'N'});
+    }
+
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_DATA;
+    event.topic = topic.data();
+    event.topic_len = (int) topic.size();
+    event.data = data.data();
+    event.data_len = (int) data.size();
+    event.total_data_len = event.data_len;
+
+    while (state.keep_running()) {
+        mqtt_hal_sim_dispatch(&event);
+    }
+    bench::do_not_optimize(s_commands);
+}
+
+/// OPEN on the command topic
+static void BM_MqttIngress_Command(bench::State& state)
+{
+    run_data_events(state, "garage_door/buttonpress", 4);
+}
+BENCH(BM_MqttIngress_Command);
+
+/// 1 MB payload on the status topic: logging is capped, so this should cost about the same
+static void BM_MqttIngress_Status1MB(bench::State& state)
+{
+    run_data_events(state, "garage_door/status", 1 << 20);
+}
+BENCH(BM_MqttIngress_Status1MB);
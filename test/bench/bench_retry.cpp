@@ -0,0 +1,40 @@
+/**
+ * @file bench_retry.cpp
+ * @brief Benchmarks for the WiFi and MQTT retry managers
+ */
+
+#include "bench.h"
+
+extern "C" {
+#include "mqtt_retry_manager.h"
+#include "wifi_retry_manager.h"
+}
+
+/// Full outage: 10 failed retries, FAIL, timer expiry, reconnect
+static void BM_WifiRetry_OutageCycle(bench::State& state)
+{
+    wifi_retry_state_t retry;
+    wifi_retry_init(&retry, 10, 30 * 60 * 1000);
+    wifi_retry_on_connected(&retry);
+    while (state.keep_running()) {
+        for (int i = 0; i < 12; i++) {
+            bench::do_not_optimize(wifi_retry_on_disconnect(&retry));
+        }
+        bench::do_not_optimize(wifi_retry_on_timer_expired(&retry));
+        bench::do_not_optimize(wifi_retry_on_connected(&retry));
+    }
+}
+BENCH(BM_WifiRetry_OutageCycle);
+
+/// Broker drop and reconnect
+static void BM_MqttRetry_DisconnectConnect(bench::State& state)
+{
+    mqtt_retry_state_t retry;
+    mqtt_retry_init(&retry, true);
+    mqtt_retry_on_connected(&retry);
+    while (state.keep_running()) {
+        bench::do_not_optimize(mqtt_retry_on_disconnect(&retry));
+        bench::do_not_optimize(mqtt_retry_on_connected(&retry));
+    }
+}
+BENCH(BM_MqttRetry_DisconnectConnect);
@@ -0,0 +1,157 @@
+/**
+ * @file bench_serializer.cpp
+ * @brief Benchmarks for payload serialization (status strings, BENCH_MODE histogram JSON, and the
+ *        metrics and history page payloads as JSON and as CBOR, with their sizes on the wire)
+ */
+
+#include "bench.h"
+
+#include <cstdio>
+
+extern "C" {
+#include "garage_controller.h"
+#include "history_log.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+}
+
+/// Status payload for every state, as published on the status topic
+static void BM_Serializer_StatusPayload(bench::State& state)
+{
+    char payload[32];
+    int i = 0;
+    while (state.keep_running()) {
+        garage_state_t s = (garage_state_t) (i++ % (GARAGE_STATE_STOPPED + 1));
+        int len = snprintf(payload, sizeof(payload), "%s", garage_state_to_string(s));
+        bench::do_not_optimize(len);
+        bench::do_not_optimize(payload);
+    }
+}
+BENCH(BM_Serializer_StatusPayload);
+
+/// Histogram of 2000 latencies spread over 200 us - 50 ms, formatted as JSON
+static void BM_Serializer_HistogramJson(bench::State& state)
+{
+    static latency_histogram_t hist;
+    static char json[4096];
+    latency_histogram_init(&hist);
+    uint32_t x = 1;
+    for (int i = 0; i < 2000; i++) {
+        x = x * 1664525u + 1013904223u;
+        latency_histogram_record(&hist, 200 + (x >> 8) % 50000);
+    }
+
+    while (state.keep_running()) {
+        bench::do_not_optimize(latency_histogram_to_json(&hist, "command_to_relay", json, sizeof(json)));
+    }
+}
+BENCH(BM_Serializer_HistogramJson);
+
+/// Recording one latency
+static void BM_Serializer_HistogramRecord(bench::State& state)
+{
+    static latency_histogram_t hist;
+    latency_histogram_init(&hist);
+    int64_t value = 1;
+    while (state.keep_running()) {
+        latency_histogram_record(&hist, value);
+        value = (value * 7 + 13) & 0xfffff;
+    }
+    bench::do_not_optimize(hist.count);
+}
+BENCH(BM_Serializer_HistogramRecord);
+
+/// Metrics after a day or so of use: a few drops and reconnects, both histograms populated
+static void fill_metrics()
+{
+    metrics_reset();
+    metrics_inc(METRIC_WIFI_DISCONNECTS);
+    metrics_set(METRIC_WIFI_CONNECTED, 1);
+    metrics_set(METRIC_MQTT_CONNECTED, 1);
+    metrics_inc(METRIC_INPUT_FULL_MQTT);
+    for (int state = GARAGE_STATE_CLOSED; state <= GARAGE_STATE_STOPPED; state++) {
+        for (int i = 0; i < 40 * state; i++) {
+            metrics_inc(metrics_state_entries(state));
+        }
+    }
+    uint32_t x = 1;
+    for (int i = 0; i < 500; i++) {
+        x = x * 1664525u + 1013904223u;
+        metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 100 + (x >> 8) % 20000);
+        metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 150000 + (x >> 8) % 3000000);
+    }
+}
+
+/// One chunk of a history page: HISTORY_CHUNK_RECORDS (8) records of every kind, late in the log's life
+static int fill_history(history_record_t* records)
+{
+    for (int i = 0; i < 8; i++) {
+        history_record_t* r = &records[i];
+        r->seq = 120000 + (uint32_t) i;
+        r->boot = 42;
+        r->time_s = 250000 + 30 * (uint32_t) i;
+        r->kind = (history_kind_t) (HISTORY_TRANSITION + i % 3);
+        r->args[0] = (uint8_t) (r->kind == HISTORY_COMMAND ? (int) GARAGE_INPUT_COMMAND_OPEN : (int) GARAGE_STATE_CLOSED);
+        r->args[1] = (uint8_t) (r->kind == HISTORY_COMMAND ? 1 : (int) GARAGE_STATE_OPENING);
+        r->args[2] = HISTORY_SOURCE_REMOTE;
+    }
+    return 8;
+}
+
+/// Metrics payload, JSON
+static void BM_Serializer_MetricsJson(bench::State& state)
+{
+    static char json[1280];
+    fill_metrics();
+    int len = 0;
+    while (state.keep_running()) {
+        len = metrics_to_json(json, sizeof(json));
+        bench::do_not_optimize(len);
+    }
+    state.set_bytes((uint64_t) len);
+}
+BENCH(BM_Serializer_MetricsJson);
+
+/// Metrics payload, CBOR
+static void BM_Serializer_MetricsCbor(bench::State& state)
+{
+    static uint8_t cbor[1280];
+    fill_metrics();
+    int len = 0;
+    while (state.keep_running()) {
+        len = metrics_to_cbor(cbor, sizeof(cbor));
+        bench::do_not_optimize(len);
+    }
+    state.set_bytes((uint64_t) len);
+}
+BENCH(BM_Serializer_MetricsCbor);
+
+/// History page chunk, JSON
+static void BM_Serializer_HistoryPageJson(bench::State& state)
+{
+    static char json[8 * 128 + 48];
+    history_record_t records[8];
+    int count = fill_history(records);
+    int len = 0;
+    while (state.keep_running()) {
+        len = history_page_to_json(records, count, records[count - 1].seq + 1, false, json, sizeof(json));
+        bench::do_not_optimize(len);
+    }
+    state.set_bytes((uint64_t) len);
+}
+BENCH(BM_Serializer_HistoryPageJson);
+
+/// History page chunk, CBOR
+static void BM_Serializer_HistoryPageCbor(bench::State& state)
+{
+    static uint8_t cbor[8 * 128 + 48];
+    history_record_t records[8];
+    int count = fill_history(records);
+    int len = 0;
+    while (state.keep_running()) {
+        len = history_page_to_cbor(records, count, records[count - 1].seq + 1, false, cbor, sizeof(cbor));
+        bench::do_not_optimize(len);
+    }
+    state.set_bytes((uint64_t) len);
+}
+BENCH(BM_Serializer_HistoryPageCbor);
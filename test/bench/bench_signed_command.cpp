@@ -0,0 +1,81 @@
+/**
+ * @file bench_signed_command.cpp
+ * @brief Cost of checking a signed command, which sits between the broker and the relay
+ *
+ * A verification is four SHA-256 compressions plus parsing; it must stay far
+ * below GARAGE_RELAY_PULSE_MS on the device. The firmware's bench mode
+ * records the same cost on the ESP8266 as the signed_verify histogram.
+ */
+
+#include "bench.h"
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "signed_command.h"
+}
+
+static const uint8_t KEY[] = "benchmark device key, 32 bytes!";
+
+static bool store_floor(uint32_t floor, void* ctx)
+{
+    (void) floor;
+    (void) ctx;
+    return true;
+}
+
+/// Signed commands with increasing counters, so each one is accepted
+static const std::vector<std::string>& signed_commands()
+{
+    static std::vector<std::string> commands;
+    if (commands.empty()) {
+        char buf[SIGNED_COMMAND_MAX_LEN + 1];
+        for (uint32_t counter = 1; counter <= 4096; counter++) {
+            int len = signed_command_sign(KEY, sizeof(KEY) - 1, GARAGE_INPUT_COMMAND_OPEN, counter, buf, sizeof(buf));
+            commands.emplace_back(buf, (size_t) len);
+        }
+    }
+    return commands;
+}
+
+/// Accepted command: parse, HMAC, constant-time compare and window update
+static void BM_SignedCommand_VerifyAccepted(bench::State& state)
+{
+    const std::vector<std::string>& commands = signed_commands();
+    signed_command_window_t window = {};
+    signed_command_verifier_t verifier;
+    signed_command_init(&verifier, KEY, sizeof(KEY) - 1, &window, 0, store_floor, nullptr);
+
+    size_t next = 0;
+    garage_input_t input;
+    while (state.keep_running()) {
+        if (next == commands.size()) {
+            state.pause();
+            window = {};
+            signed_command_init(&verifier, KEY, sizeof(KEY) - 1, &window, 0, store_floor, nullptr);
+            next = 0;
+            state.resume();
+        }
+        const std::string& command = commands[next++];
+        bench::do_not_optimize(
+            signed_command_verify(&verifier, command.data(), (int) command.size(), &input, nullptr));
+    }
+}
+BENCH(BM_SignedCommand_VerifyAccepted);
+
+/// Forged command: the whole HMAC is still computed before the MAC is refused
+static void BM_SignedCommand_VerifyForged(bench::State& state)
+{
+    std::string forged = signed_commands()[0];
+    forged.back() = forged.back() == '0' ? '1' : '0';
+    signed_command_window_t window = {};
+    signed_command_verifier_t verifier;
+    signed_command_init(&verifier, KEY, sizeof(KEY) - 1, &window, 0, store_floor, nullptr);
+
+    garage_input_t input;
+    while (state.keep_running()) {
+        bench::do_not_optimize(signed_command_verify(&verifier, forged.data(), (int) forged.size(), &input, nullptr));
+    }
+}
+BENCH(BM_SignedCommand_VerifyForged);
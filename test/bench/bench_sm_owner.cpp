@@ -0,0 +1,85 @@
+/**
+ * @file bench_sm_owner.cpp
+ * @brief Per-event cost of the single-owner handler compared with the old split design
+ *
+ * Before, the handler task only handled inputs and a timer callback ticked the
+ * controller concurrently, unsynchronized. The single owner adds two clock
+ * reads and the tick bookkeeping to every event. A mutex shared by the handler
+ * and the timer callback is the alternative that was not taken.
+ */
+
+#include "bench.h"
+
+#include <chrono>
+#include <mutex>
+
+extern "C" {
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+}
+
+static void init_controller(garage_controller_t* ctrl)
+{
+    gpio_hal_sim_reset();
+    garage_controller_config_t config = {};
+    config.reed_switch_gpio = 4;
+    config.relay_gpio = 5;
+    config.relay_pulse_ms = GARAGE_RELAY_PULSE_MS;
+    config.sm_config.timeout_ms = 15000;
+    garage_controller_init(ctrl, &config, GARAGE_STATE_CLOSED);
+}
+
+static int64_t steady_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Every event is a transition: CLOSED -> OPENING (relay press) -> CLOSED
+static const garage_input_t s_inputs[] = { GARAGE_INPUT_COMMAND_OPEN, GARAGE_INPUT_SENSOR_CLOSED };
+
+/// Old handler: input only, ticks happen elsewhere (unsynchronized)
+static void BM_StateMachine_EventUnsynchronized(bench::State& state)
+{
+    garage_controller_t ctrl;
+    init_controller(&ctrl);
+    unsigned i = 0;
+    while (state.keep_running()) {
+        garage_transition_result_t result = garage_controller_handle_input(&ctrl, s_inputs[i++ & 1]);
+        bench::do_not_optimize(result);
+    }
+}
+BENCH(BM_StateMachine_EventUnsynchronized);
+
+/// Single owner: input plus tick check, as state_machine_handler does after every wake-up
+static void BM_StateMachine_EventSingleOwner(bench::State& state)
+{
+    garage_controller_t ctrl;
+    init_controller(&ctrl);
+    ctrl.last_tick_us = steady_now_us();
+    unsigned i = 0;
+    while (state.keep_running()) {
+        int wait_ms = garage_controller_ms_until_tick(&ctrl, steady_now_us());
+        garage_transition_result_t result = garage_controller_handle_input(&ctrl, s_inputs[i++ & 1]);
+        garage_transition_result_t tick = garage_controller_tick_to(&ctrl, steady_now_us());
+        bench::do_not_optimize(wait_ms);
+        bench::do_not_optimize(result);
+        bench::do_not_optimize(tick);
+    }
+}
+BENCH(BM_StateMachine_EventSingleOwner);
+
+/// Rejected alternative: handler and timer callback share a mutex (uncontended here)
+static void BM_StateMachine_EventMutex(bench::State& state)
+{
+    garage_controller_t ctrl;
+    init_controller(&ctrl);
+    std::mutex lock;
+    unsigned i = 0;
+    while (state.keep_running()) {
+        std::lock_guard<std::mutex> guard(lock);
+        garage_transition_result_t result = garage_controller_handle_input(&ctrl, s_inputs[i++ & 1]);
+        bench::do_not_optimize(result);
+    }
+}
+BENCH(BM_StateMachine_EventMutex);
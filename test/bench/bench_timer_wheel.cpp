@@ -0,0 +1,57 @@
+/**
+ * @file bench_timer_wheel.cpp
+ * @brief Timer wheel insert/cancel cost with a loaded wheel, and one scheduler tick
+ */
+
+#include "bench.h"
+
+#include <cstdio>
+#include <vector>
+
+extern "C" {
+#include "garage_schedule.h"
+#include "timer_wheel.h"
+}
+
+/// Start and cancel one timer with 1024 others spread over the wheel: O(1) whatever the load
+static void BM_TimerWheel_StartCancel(bench::State& state)
+{
+    static timer_wheel_t wheel;
+    static std::vector<timer_wheel_timer_t> loaded(1024);
+    timer_wheel_init(&wheel, 0);
+    for (size_t i = 0; i < loaded.size(); i++) {
+        timer_wheel_timer_init(&loaded[i], nullptr);
+        timer_wheel_start(&wheel, &loaded[i], 1000 + (uint32_t) i * 37);
+    }
+
+    timer_wheel_timer_t timer;
+    timer_wheel_timer_init(&timer, nullptr);
+    uint32_t expires = 500;
+    while (state.keep_running()) {
+        timer_wheel_start(&wheel, &timer, expires++);
+        timer_wheel_cancel(&wheel, &timer);
+    }
+    bench::do_not_optimize(wheel.active);
+}
+BENCH(BM_TimerWheel_StartCancel);
+
+/// One-second scheduler tick with a full rule table and (almost always) nothing due
+static void BM_Schedule_IdleTick(bench::State& state)
+{
+    static garage_schedule_t sched;
+    garage_schedule_init(&sched, 0);
+    char id[8];
+    for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES; i++) {
+        int id_len = snprintf(id, sizeof(id), "r%d", i);
+        garage_schedule_set_rule(&sched, id, id_len, "reminder 1440", 13, 0);
+    }
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 0);
+
+    garage_schedule_event_t events[4];
+    uint32_t now_s = 0;
+    while (state.keep_running()) {
+        // Reminders come due once a simulated day, which is noise at this rate
+        bench::do_not_optimize(garage_schedule_tick(&sched, ++now_s, events, 4));
+    }
+}
+BENCH(BM_Schedule_IdleTick);
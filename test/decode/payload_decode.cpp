@@ -0,0 +1,422 @@
+/**
+ * @file payload_decode.cpp
+ * @brief CBOR payload decoding for the host tools and tests
+ */
+
+#include "payload_decode.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "cbor_writer.h"
+#include "history_log.h"
+#include "metrics.h"
+}
+
+namespace payload_decode {
+
+namespace {
+
+const int MAX_DEPTH = 8;        // Deeper than either schema needs
+
+/// One decoded item; arrays keep their elements, maps their keys and values interleaved
+struct Item {
+    int major = 0;
+    uint64_t value = 0;         // Integer argument, length, or simple value
+    std::string bytes;          // Text and byte strings
+    std::vector<Item> items;
+};
+
+class Parser {
+public:
+    Parser(const uint8_t* data, size_t len) : data_(data), len_(len) {}
+
+    bool parse(Item* item, std::string* error)
+    {
+        if (!parse_item(item, 0)) {
+            *error = error_;
+            return false;
+        }
+        if (pos_ != len_) {
+            *error = "trailing bytes after the payload";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(const char* reason)
+    {
+        char at[32];
+        snprintf(at, sizeof(at), " at byte %u", (unsigned) pos_);
+        error_ = std::string(reason) + at;
+        return false;
+    }
+
+    bool parse_item(Item* item, int depth)
+    {
+        if (depth > MAX_DEPTH) {
+            return fail("nesting too deep");
+        }
+        if (pos_ >= len_) {
+            return fail("truncated item");
+        }
+        uint8_t initial = data_[pos_++];
+        item->major = initial >> 5;
+        uint8_t info = initial & 0x1f;
+        if (info < 24) {
+            item->value = info;
+        } else if (info <= 27) {
+            size_t extra = (size_t) 1 << (info - 24);
+            if (len_ - pos_ < extra) {
+                return fail("truncated head");
+            }
+            item->value = 0;
+            for (size_t i = 0; i < extra; i++) {
+                item->value = item->value << 8 | data_[pos_++];
+            }
+        } else {
+            return fail("indefinite or reserved length");
+        }
+
+        switch (item->major) {
+            case CBOR_MAJOR_UINT:
+            case CBOR_MAJOR_NEGINT:
+                return true;
+            case CBOR_MAJOR_BYTES:
+            case CBOR_MAJOR_TEXT:
+                if (item->value > len_ - pos_) {
+                    return fail("truncated string");
+                }
+                item->bytes.assign((const char*) data_ + pos_, (size_t) item->value);
+                pos_ += (size_t) item->value;
+                return true;
+            case CBOR_MAJOR_ARRAY:
+            case CBOR_MAJOR_MAP: {
+                uint64_t count = item->major == CBOR_MAJOR_MAP ? item->value * 2 : item->value;
+                if (count > len_ - pos_) {      // Every item takes at least a byte
+                    return fail("truncated container");
+                }
+                item->items.resize((size_t) count);
+                for (Item& element : item->items) {
+                    if (!parse_item(&element, depth + 1)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case CBOR_MAJOR_SIMPLE:
+                if (initial != CBOR_FALSE && initial != CBOR_TRUE) {
+                    return fail("unsupported simple value or float");
+                }
+                return true;
+            default:
+                return fail("unsupported tag");
+        }
+    }
+
+    const uint8_t* data_;
+    size_t len_;
+    size_t pos_ = 0;
+    std::string error_;
+};
+
+bool set_error(std::string* error, const std::string& reason)
+{
+    if (error != NULL) {
+        *error = reason;
+    }
+    return false;
+}
+
+bool is_array(const Item& item, size_t count)
+{
+    return item.major == CBOR_MAJOR_ARRAY && item.items.size() == count;
+}
+
+bool as_uint(const Item& item, uint64_t max, uint64_t* value)
+{
+    if (item.major != CBOR_MAJOR_UINT || item.value > max) {
+        return false;
+    }
+    *value = item.value;
+    return true;
+}
+
+bool as_int32(const Item& item, int32_t* value)
+{
+    if (item.major == CBOR_MAJOR_UINT && item.value <= (uint64_t) INT32_MAX) {
+        *value = (int32_t) item.value;
+        return true;
+    }
+    if (item.major == CBOR_MAJOR_NEGINT && item.value <= (uint64_t) INT32_MAX) {
+        *value = (int32_t) (-1 - (int64_t) item.value);
+        return true;
+    }
+    return false;
+}
+
+bool as_bool(const Item& item, bool* value)
+{
+    if (item.major != CBOR_MAJOR_SIMPLE) {
+        return false;
+    }
+    *value = item.value == (CBOR_TRUE & 0x1f);
+    return true;
+}
+
+struct ScalarInfo {
+    metric_type_t type;
+    const char* name;
+    const char* labels;
+};
+
+const ScalarInfo scalar_info[METRIC_COUNT] = {
+#define DECODE_SCALAR(id, type, name, labels) { METRIC_TYPE_##type, name, labels },
+    METRICS_SCALARS(DECODE_SCALAR)
+#undef DECODE_SCALAR
+};
+
+struct HistogramInfo {
+    const char* name;
+    uint32_t bounds_us[METRICS_HISTOGRAM_BOUNDS];
+};
+
+const HistogramInfo histogram_info[METRIC_HISTOGRAM_COUNT] = {
+#define DECODE_HISTOGRAM(id, name, b0, b1, b2, b3, b4, b5, b6, b7) { name, { b0, b1, b2, b3, b4, b5, b6, b7 } },
+    METRICS_HISTOGRAMS(DECODE_HISTOGRAM)
+#undef DECODE_HISTOGRAM
+};
+
+/// The JSON key of a metric: its name without the "garage_door_" prefix
+std::string json_name(const char* name)
+{
+    static const char prefix[] = "garage_door_";
+    return strncmp(name, prefix, sizeof(prefix) - 1) == 0 ? name + sizeof(prefix) - 1 : name;
+}
+
+/// "a=b,c=d" -> "b.d"
+std::string label_key(const char* labels)
+{
+    std::string key;
+    bool in_value = false;
+    for (const char* p = labels; *p != '\0'; p++) {
+        if (*p == '=') {
+            in_value = true;
+        } else if (*p == ',') {
+            in_value = false;
+            key += '.';
+        } else if (in_value) {
+            key += *p;
+        }
+    }
+    return key;
+}
+
+bool same_family(int a, int b)
+{
+    return b >= 0 && b < METRIC_COUNT && strcmp(scalar_info[a].name, scalar_info[b].name) == 0;
+}
+
+} // namespace
+
+bool metrics_to_json(const uint8_t* data, size_t len, std::string* json, std::string* error)
+{
+    Item root;
+    std::string reason;
+    if (!Parser(data, len).parse(&root, &reason)) {
+        return set_error(error, reason);
+    }
+    uint64_t version;
+    if (!is_array(root, 3) || !as_uint(root.items[0], UINT32_MAX, &version)) {
+        return set_error(error, "not a metrics payload");
+    }
+    if (version != METRICS_CBOR_VERSION) {
+        return set_error(error, "unknown metrics schema version " + std::to_string(version));
+    }
+    const Item& scalars = root.items[1];
+    const Item& histograms = root.items[2];
+    if (!is_array(scalars, METRIC_COUNT) || !is_array(histograms, METRIC_HISTOGRAM_COUNT)) {
+        return set_error(error, "metric count does not match metrics.h");
+    }
+
+    std::string out = "{";
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        const ScalarInfo& info = scalar_info[id];
+        std::string value;
+        if (info.type == METRIC_TYPE_COUNTER) {
+            uint64_t counter;
+            if (!as_uint(scalars.items[id], UINT32_MAX, &counter)) {
+                return set_error(error, std::string("bad counter ") + info.name);
+            }
+            value = std::to_string(counter);
+        } else {
+            int32_t gauge;
+            if (!as_int32(scalars.items[id], &gauge)) {
+                return set_error(error, std::string("bad gauge ") + info.name);
+            }
+            value = std::to_string(gauge);
+        }
+
+        const char* sep = id == 0 ? "" : ",";
+        if (info.labels[0] == '\0') {
+            out += sep + ("\"" + json_name(info.name) + "\":") + value;
+            continue;
+        }
+        if (!same_family(id, id - 1)) {
+            out += sep + ("\"" + json_name(info.name) + "\":{");
+        } else {
+            out += ",";
+        }
+        out += "\"" + label_key(info.labels) + "\":" + value;
+        if (!same_family(id, id + 1)) {
+            out += "}";
+        }
+    }
+
+    for (int id = 0; id < METRIC_HISTOGRAM_COUNT; id++) {
+        const HistogramInfo& info = histogram_info[id];
+        const Item& hist = histograms.items[id];
+        uint64_t values[METRICS_HISTOGRAM_BOUNDS + 1];
+        uint64_t sum_us;
+        if (!is_array(hist, METRICS_HISTOGRAM_BOUNDS + 2)) {
+            return set_error(error, std::string("bad histogram ") + info.name);
+        }
+        for (int b = 0; b <= METRICS_HISTOGRAM_BOUNDS; b++) {
+            if (!as_uint(hist.items[b], UINT32_MAX, &values[b])) {
+                return set_error(error, std::string("bad histogram ") + info.name);
+            }
+        }
+        if (!as_uint(hist.items[METRICS_HISTOGRAM_BOUNDS + 1], UINT64_MAX, &sum_us)) {
+            return set_error(error, std::string("bad histogram ") + info.name);
+        }
+
+        out += ",\"" + json_name(info.name) + "\":{\"le_us\":[";
+        for (int b = 0; b < METRICS_HISTOGRAM_BOUNDS; b++) {
+            out += (b == 0 ? "" : ",") + std::to_string(info.bounds_us[b]);
+        }
+        out += "],\"buckets\":[";
+        for (int b = 0; b < METRICS_HISTOGRAM_BOUNDS; b++) {
+            out += (b == 0 ? "" : ",") + std::to_string(values[b]);
+        }
+        out += "],\"count\":" + std::to_string(values[METRICS_HISTOGRAM_BOUNDS]) +
+               ",\"sum_us\":" + std::to_string(sum_us) + "}";
+    }
+    *json = out + "}";
+    return true;
+}
+
+bool history_page_to_json(const uint8_t* data, size_t len, std::string* json, std::string* error)
+{
+    Item root;
+    std::string reason;
+    if (!Parser(data, len).parse(&root, &reason)) {
+        return set_error(error, reason);
+    }
+    uint64_t version;
+    uint64_t next;
+    bool last;
+    if (!is_array(root, 4) || !as_uint(root.items[0], UINT32_MAX, &version)) {
+        return set_error(error, "not a history page payload");
+    }
+    if (version != HISTORY_CBOR_VERSION) {
+        return set_error(error, "unknown history schema version " + std::to_string(version));
+    }
+    if (!as_uint(root.items[1], UINT32_MAX, &next) || !as_bool(root.items[2], &last) ||
+        root.items[3].major != CBOR_MAJOR_ARRAY) {
+        return set_error(error, "bad history page header");
+    }
+
+    std::vector<history_record_t> records;
+    for (const Item& item : root.items[3].items) {
+        static const uint64_t max[7] = { UINT32_MAX, UINT16_MAX, UINT32_MAX, UINT8_MAX, UINT8_MAX, UINT8_MAX, UINT8_MAX };
+        uint64_t fields[7];
+        if (!is_array(item, 7)) {
+            return set_error(error, "bad history record");
+        }
+        for (int i = 0; i < 7; i++) {
+            if (!as_uint(item.items[i], max[i], &fields[i])) {
+                return set_error(error, "bad history record");
+            }
+        }
+        history_record_t record;
+        record.seq = (uint32_t) fields[0];
+        record.boot = (uint16_t) fields[1];
+        record.time_s = (uint32_t) fields[2];
+        record.kind = (history_kind_t) fields[3];
+        record.args[0] = (uint8_t) fields[4];
+        record.args[1] = (uint8_t) fields[5];
+        record.args[2] = (uint8_t) fields[6];
+        records.push_back(record);
+    }
+
+    std::vector<char> buf(records.size() * 160 + 64);
+    int written = ::history_page_to_json(records.data(), (int) records.size(), (uint32_t) next, last, buf.data(),
+                                         buf.size());
+    if (written < 0) {
+        return set_error(error, "history page does not format");
+    }
+    json->assign(buf.data(), (size_t) written);
+    return true;
+}
+
+namespace {
+
+void append_diagnostic(const Item& item, std::string* out)
+{
+    switch (item.major) {
+        case CBOR_MAJOR_UINT:
+            *out += std::to_string(item.value);
+            break;
+        case CBOR_MAJOR_NEGINT:
+            *out += item.value == UINT64_MAX ? "-18446744073709551616" : "-" + std::to_string(item.value + 1);
+            break;
+        case CBOR_MAJOR_BYTES: {
+            *out += "h'";
+            char hex[3];
+            for (unsigned char c : item.bytes) {
+                snprintf(hex, sizeof(hex), "%02x", c);
+                *out += hex;
+            }
+            *out += "'";
+            break;
+        }
+        case CBOR_MAJOR_TEXT:
+            *out += "\"" + item.bytes + "\"";
+            break;
+        case CBOR_MAJOR_ARRAY:
+        case CBOR_MAJOR_MAP: {
+            bool map = item.major == CBOR_MAJOR_MAP;
+            *out += map ? "{" : "[";
+            for (size_t i = 0; i < item.items.size(); i++) {
+                if (i > 0) {
+                    *out += map && i % 2 == 1 ? ": " : ", ";
+                }
+                append_diagnostic(item.items[i], out);
+            }
+            *out += map ? "}" : "]";
+            break;
+        }
+        default:
+            *out += item.value == (CBOR_TRUE & 0x1f) ? "true" : "false";
+            break;
+    }
+}
+
+} // namespace
+
+bool diagnostic(const uint8_t* data, size_t len, std::string* text, std::string* error)
+{
+    Item root;
+    std::string reason;
+    if (!Parser(data, len).parse(&root, &reason)) {
+        return set_error(error, reason);
+    }
+    text->clear();
+    append_diagnostic(root, text);
+    return true;
+}
+
+} // namespace payload_decode
@@ -0,0 +1,57 @@
+/**
+ * @file payload_decode.h
+ * @brief Host-side decoder for the CBOR metrics and history page payloads
+ *
+ * Turns a CBOR payload back into exactly the JSON the firmware publishes
+ * when the topic is left in JSON mode, so dashboards and scripts written
+ * against the JSON keep working behind a decoding bridge. The schemas are
+ * positional: the metric names, labels and bounds come from the lists in
+ * metrics.h and the record formatting from history_log.c, both compiled in.
+ *
+ * Decoding is strict: truncated items, indefinite lengths, trailing bytes,
+ * an unknown schema version or a shape that does not match the lists are
+ * errors, not best guesses.
+ */
+
+#ifndef PAYLOAD_DECODE_H
+#define PAYLOAD_DECODE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace payload_decode {
+
+/**
+ * @brief Decode a metrics payload (metrics_to_cbor())
+ * @param data Payload
+ * @param len Length
+ * @param json Receives the metrics_to_json() text
+ * @param error Receives the reason on failure (can be NULL)
+ * @return false if the payload is malformed
+ */
+bool metrics_to_json(const uint8_t* data, size_t len, std::string* json, std::string* error);
+
+/**
+ * @brief Decode a history page payload (history_page_to_cbor())
+ * @param data Payload
+ * @param len Length
+ * @param json Receives the history_page_to_json() text
+ * @param error Receives the reason on failure (can be NULL)
+ * @return false if the payload is malformed
+ */
+bool history_page_to_json(const uint8_t* data, size_t len, std::string* json, std::string* error);
+
+/**
+ * @brief Render any well-formed CBOR item in RFC 8949 diagnostic notation, e.g. [1, [2, -3], true]
+ * @param data Payload
+ * @param len Length
+ * @param text Receives the notation
+ * @param error Receives the reason on failure (can be NULL)
+ * @return false if the payload is malformed
+ */
+bool diagnostic(const uint8_t* data, size_t len, std::string* text, std::string* error);
+
+} // namespace payload_decode
+
+#endif // PAYLOAD_DECODE_H
@@ -0,0 +1,124 @@
+/**
+ * @file payload_decode_main.cpp
+ * @brief Command line decoder for CBOR payloads captured from the broker
+ *
+ * Usage: payload_decode (--metrics | --history | --diag) [--hex <hex digits> | <file> | -]
+ *
+ * Reads the raw payload from a file, stdin ("-" or nothing) or hex on the
+ * command line (spaces allowed), e.g.
+ *
+ *   mosquitto_sub -t garage_door/metrics -C 1 | payload_decode --metrics
+ *
+ * and prints the JSON the firmware would have published in JSON mode, or
+ * with --diag any CBOR item in diagnostic notation.
+ */
+
+#include "payload_decode.h"
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+static bool parse_hex(const char* text, std::vector<uint8_t>* out)
+{
+    int high = -1;
+    for (const char* p = text; *p != '\0'; p++) {
+        if (isspace((unsigned char) *p)) {
+            continue;
+        }
+        if (!isxdigit((unsigned char) *p)) {
+            return false;
+        }
+        int nibble = isdigit((unsigned char) *p) ? *p - '0' : tolower((unsigned char) *p) - 'a' + 10;
+        if (high < 0) {
+            high = nibble;
+        } else {
+            out->push_back((uint8_t) (high << 4 | nibble));
+            high = -1;
+        }
+    }
+    return high < 0;
+}
+
+static bool read_all(FILE* f, std::vector<uint8_t>* out)
+{
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        out->insert(out->end(), chunk, chunk + n);
+    }
+    return !ferror(f);
+}
+
+int main(int argc, char** argv)
+{
+    const char* mode = NULL;
+    const char* hex = NULL;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--metrics") == 0 || strcmp(argv[i], "--history") == 0 ||
+            strcmp(argv[i], "--diag") == 0) {
+            mode = argv[i] + 2;
+        } else if (strcmp(argv[i], "--hex") == 0 && i + 1 < argc) {
+            hex = argv[++i];
+        } else if (path == NULL && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0)) {
+            path = argv[i];
+        } else {
+            mode = NULL;
+            break;
+        }
+    }
+    if (mode == NULL) {
+        fprintf(stderr, "usage: %s (--metrics | --history | --diag) [--hex <hex digits> | <file> | -]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> payload;
+    if (hex != NULL) {
+        if (!parse_hex(hex, &payload)) {
+            fprintf(stderr, "bad hex\n");
+            return 2;
+        }
+    } else if (path == NULL || strcmp(path, "-") == 0) {
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        if (!read_all(stdin, &payload)) {
+            fprintf(stderr, "cannot read stdin\n");
+            return 2;
+        }
+    } else {
+        FILE* f = fopen(path, "rb");
+        bool ok = f != NULL && read_all(f, &payload);
+        if (f != NULL) {
+            fclose(f);
+        }
+        if (!ok) {
+            fprintf(stderr, "cannot read %s\n", path);
+            return 2;
+        }
+    }
+
+    std::string text;
+    std::string error;
+    bool ok;
+    if (strcmp(mode, "metrics") == 0) {
+        ok = payload_decode::metrics_to_json(payload.data(), payload.size(), &text, &error);
+    } else if (strcmp(mode, "history") == 0) {
+        ok = payload_decode::history_page_to_json(payload.data(), payload.size(), &text, &error);
+    } else {
+        ok = payload_decode::diagnostic(payload.data(), payload.size(), &text, &error);
+    }
+    if (!ok) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    printf("%s\n", text.c_str());
+    return 0;
+}
@@ -0,0 +1,726 @@
+/**
+ * @file fleet_sim.cpp
+ * @brief Fleet simulator for broker and Home Assistant load testing
+ *
+ * Runs thousands of simulated openers in one process as a discrete-event
+ * simulation on a virtual clock. Each opener owns the production pure-C
+ * modules: a garage_controller_t (state machine + relay), a wifi_retry_state_t
+ * and an mqtt_retry_state_t. Its MQTT session mirrors the firmware:
+ *   - on connect: publish availability, subscribe to the command and status
+ *     topics (the retained status is delivered back) and sample the reed switch
+ *   - on every transition with publish_state: publish the status (QoS 0, retained);
+ *     the opener is subscribed to its own status topic so it receives the echo
+ *   - on disconnect: the retry manager asks for an immediate reconnect, further
+ *     failed attempts wait for the esp-mqtt reconnect timeout
+ *
+ * The broker is an in-process stand-in: a single FIFO server with a per-message
+ * and per-connect service cost, so queueing delay, message rates and reconnect
+ * storms after a restart can be sized before the campus rollout.
+ *
+ * Usage: fleet_sim [--devices N] [--hours H] [--seed S]
+ *                  [--msg-cost-us US] [--connect-cost-us US]
+ *                  [--broker-restart-at S] [--broker-downtime S]
+ *                  [--reconnect-jitter-ms MS]
+ *                  [--ap-outage-at S] [--ap-outage-s S] [--ap-outage-fraction F]
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <vector>
+
+extern "C" {
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+#include "mqtt_retry_manager.h"
+#include "wifi_retry_manager.h"
+}
+
+#define RELAY_GPIO                  5
+#define REED_GPIO                   4
+#define TICK_MS                     100         // Production state machine timer period
+#define MQTT_RECONNECT_TIMEOUT_MS   10000       // esp-mqtt default reconnect delay
+#define MQTT_KEEPALIVE_S            120         // esp-mqtt default keepalive
+#define WIFI_MAX_RETRY              10          // ESP_MAXIMUM_WIFI_RETRY
+#define WIFI_RETRY_INTERVAL_MS      (30 * 60 * 1000)
+#define WIFI_ATTEMPT_MS             3000        // Time for one failed association attempt
+
+static const int64_t US_PER_MS = 1000;
+static const int64_t US_PER_S = 1000 * 1000;
+
+/* ============================================================================
+ * Configuration
+ * ============================================================================ */
+
+struct FleetConfig {
+    int devices = 2000;
+    double hours = 24.0;
+    uint64_t seed = 1;
+    double msg_cost_us = 15.0;              // Broker CPU per routed message
+    double connect_cost_us = 1500.0;        // Broker CPU per CONNECT (auth, session, retained lookup)
+    double net_latency_ms = 4.0;            // One-way LAN + WiFi latency
+    double net_jitter_ms = 6.0;             // Uniform extra latency
+    double cycles_per_day = 6.0;            // Open/close cycles per door per day
+    double remote_fraction = 0.5;           // Share of cycles started from Home Assistant
+    double broker_restart_at_s = -1.0;      // Negative disables the restart
+    double broker_downtime_s = 5.0;
+    double reconnect_jitter_ms = 0.0;       // Random delay before the first reconnect (mitigation study)
+    double ap_outage_at_s = -1.0;           // Negative disables the access point outage
+    double ap_outage_s = 60.0;
+    double ap_outage_fraction = 0.1;        // Share of devices behind the failing access point
+};
+
+/* ============================================================================
+ * Events
+ * ============================================================================ */
+
+enum EventType {
+    EV_USAGE,               // Someone wants the door cycled (wall button or Home Assistant)
+    EV_BROKER_MESSAGE,      // Message reaches the broker
+    EV_DEVICE_COMMAND,      // Command delivered to an opener
+    EV_HA_STATE,            // Status delivered to Home Assistant
+    EV_DEVICE_ECHO,         // Own status echoed back to an opener
+    EV_DEVICE_TICK,         // 100 ms state machine timer while a timer or relay is active
+    EV_DOOR_SENSOR,         // Reed switch changes as the physical door moves
+    EV_CONNECT_ATTEMPT,     // Opener sends CONNECT
+    EV_CONNACK,             // Broker accepted the connection
+    EV_KEEPALIVE,           // PINGREQ due
+    EV_BROKER_DOWN,
+    EV_BROKER_UP,
+    EV_AP_DOWN,
+    EV_AP_UP,
+    EV_WIFI_ATTEMPT,        // WiFi association attempt finishes
+    EV_WIFI_RETRY_TIMER,    // Long-interval WiFi retry timer fires
+};
+
+enum MessageKind {
+    MSG_STATE,              // Status publish from an opener
+    MSG_AVAILABILITY,
+    MSG_SUBSCRIBE,
+    MSG_PING,
+    MSG_COMMAND,            // Command publish from Home Assistant
+};
+
+struct Event {
+    int64_t time_us;
+    uint64_t seq;           // FIFO tie-break for equal timestamps
+    EventType type;
+    int device;
+    int arg;                // Message kind or door level
+    int payload;            // Command carried by MSG_COMMAND / EV_DEVICE_COMMAND
+    int64_t stamp_us;       // Origin timestamp for latency measurements
+    uint32_t session;       // Connection generation, stale events are dropped
+
+    bool operator>(const Event& other) const
+    {
+        return time_us != other.time_us ? time_us > other.time_us : seq > other.seq;
+    }
+};
+
+/* ============================================================================
+ * Opener model
+ * ============================================================================ */
+
+struct Opener {
+    garage_controller_t ctrl;
+    wifi_retry_state_t wifi;
+    mqtt_retry_state_t mqtt;
+    bool wifi_up = true;
+    bool behind_failed_ap = false;
+    bool connecting = false;
+    uint32_t session = 0;
+    bool tick_scheduled = false;
+    bool door_closed = true;                // Physical door position at the reed switch
+    bool door_moving = false;
+    int64_t pending_command_us = -1;        // Issue time of the command being executed
+};
+
+/* ============================================================================
+ * Statistics
+ * ============================================================================ */
+
+struct Percentiles {
+    std::vector<double> samples;
+
+    void add(double value) { samples.push_back(value); }
+
+    double at(double p)
+    {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        size_t index = (size_t) (p * (double) (samples.size() - 1) + 0.5);
+        std::nth_element(samples.begin(), samples.begin() + (long) index, samples.end());
+        return samples[index];
+    }
+
+    double max() const { return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end()); }
+};
+
+struct PerSecond {
+    std::vector<uint32_t> buckets;
+
+    void add(int64_t time_us)
+    {
+        size_t second = (size_t) (time_us / US_PER_S);
+        if (second >= buckets.size()) {
+            buckets.resize(second + 1, 0);
+        }
+        buckets[second]++;
+    }
+
+    uint64_t total() const
+    {
+        uint64_t sum = 0;
+        for (uint32_t count : buckets) {
+            sum += count;
+        }
+        return sum;
+    }
+
+    uint32_t peak(size_t* second_out) const
+    {
+        uint32_t best = 0;
+        size_t best_second = 0;
+        for (size_t i = 0; i < buckets.size(); i++) {
+            if (buckets[i] > best) {
+                best = buckets[i];
+                best_second = i;
+            }
+        }
+        *second_out = best_second;
+        return best;
+    }
+};
+
+/* ============================================================================
+ * Simulation
+ * ============================================================================ */
+
+class FleetSim {
+public:
+    explicit FleetSim(const FleetConfig& config) : cfg_(config), rng_(config.seed), openers_(config.devices) {}
+
+    void run();
+    void report();
+
+private:
+    FleetConfig cfg_;
+    std::mt19937_64 rng_;
+    std::vector<Opener> openers_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+    uint64_t seq_ = 0;
+    int64_t now_us_ = 0;
+    int64_t end_us_ = 0;
+
+    // Broker stand-in
+    bool broker_up_ = true;
+    int64_t broker_free_at_us_ = 0;
+    int64_t broker_max_backlog_us_ = 0;
+    int64_t restart_us_ = -1;
+    int64_t all_reconnected_us_ = -1;
+
+    // Measurements
+    PerSecond inbound_;
+    PerSecond deliveries_;
+    PerSecond connects_;
+    Percentiles command_latency_ms_;
+    Percentiles state_latency_ms_;
+    uint64_t commands_lost_ = 0;
+    uint64_t states_lost_ = 0;
+    uint64_t messages_dropped_by_broker_ = 0;
+    uint64_t connect_attempts_failed_ = 0;
+    uint64_t events_processed_ = 0;
+    int connected_count_ = 0;
+
+    void push(int64_t time_us, EventType type, int device, int arg = 0, int64_t stamp_us = 0, uint32_t session = 0,
+              int payload = 0)
+    {
+        events_.push(Event{ time_us, seq_++, type, device, arg, payload, stamp_us, session });
+    }
+
+    double uniform(double lo, double hi) { return std::uniform_real_distribution<double>(lo, hi)(rng_); }
+    double exponential(double mean) { return std::exponential_distribution<double>(1.0 / mean)(rng_); }
+    int64_t net_delay_us() { return (int64_t) ((cfg_.net_latency_ms + uniform(0.0, cfg_.net_jitter_ms)) * US_PER_MS); }
+
+    /// Usage follows a morning/evening commute profile; mean rate is cycles_per_day
+    double usage_rate_per_s(int64_t time_us) const;
+    void schedule_next_usage(int device);
+
+    void send_to_broker(int device, MessageKind kind, int64_t stamp_us);
+    int64_t broker_process(double cost_us);
+    void deliver(int64_t time_us, EventType type, int device, int arg, int64_t stamp_us);
+
+    void handle_result(int device, const garage_transition_result_t& result);
+    void ensure_tick(int device);
+    void start_connect(int device, int64_t delay_us);
+    void on_connected(int device);
+    void on_mqtt_disconnect(int device);
+    void on_wifi_lost(int device);
+
+    void dispatch(const Event& ev);
+};
+
+double FleetSim::usage_rate_per_s(int64_t time_us) const
+{
+    double hour = (double) ((time_us / US_PER_S) % 86400) / 3600.0;
+    double weight = 0.2;                            // Night baseline
+    if (hour >= 7.0 && hour < 9.0) {
+        weight = 3.0;                               // Morning departures
+    } else if (hour >= 17.0 && hour < 19.5) {
+        weight = 3.0;                               // Evening arrivals
+    } else if (hour >= 9.0 && hour < 22.0) {
+        weight = 0.8;
+    }
+    // Weights integrate to ~22.2 hours over a day; normalize to cycles_per_day
+    return (cfg_.cycles_per_day / 86400.0) * weight * (24.0 / 22.2);
+}
+
+void FleetSim::schedule_next_usage(int device)
+{
+    // Thinning keeps the non-homogeneous Poisson process exact
+    const double max_rate = usage_rate_per_s(8 * 3600 * US_PER_S);
+    int64_t t = now_us_;
+    for (;;) {
+        t += (int64_t) (exponential(1.0 / max_rate) * US_PER_S);
+        if (t >= end_us_) {
+            return;
+        }
+        if (uniform(0.0, 1.0) <= usage_rate_per_s(t) / max_rate) {
+            push(t, EV_USAGE, device);
+            return;
+        }
+    }
+}
+
+int64_t FleetSim::broker_process(double cost_us)
+{
+    int64_t start = std::max(now_us_, broker_free_at_us_);
+    broker_max_backlog_us_ = std::max(broker_max_backlog_us_, start - now_us_);
+    broker_free_at_us_ = start + (int64_t) cost_us;
+    return broker_free_at_us_;
+}
+
+void FleetSim::deliver(int64_t time_us, EventType type, int device, int arg, int64_t stamp_us)
+{
+    deliveries_.add(time_us);
+    push(time_us + net_delay_us(), type, device, arg, stamp_us, openers_[device].session);
+}
+
+void FleetSim::send_to_broker(int device, MessageKind kind, int64_t stamp_us)
+{
+    push(now_us_ + net_delay_us(), EV_BROKER_MESSAGE, device, kind, stamp_us, openers_[device].session);
+}
+
+void FleetSim::ensure_tick(int device)
+{
+    Opener& op = openers_[device];
+    bool needs_tick = garage_sm_is_timer_active(&op.ctrl.sm) || garage_controller_is_relay_active(&op.ctrl);
+    if (needs_tick && !op.tick_scheduled) {
+        op.tick_scheduled = true;
+        push(now_us_ + TICK_MS * US_PER_MS, EV_DEVICE_TICK, device);
+    }
+}
+
+void FleetSim::handle_result(int device, const garage_transition_result_t& result)
+{
+    Opener& op = openers_[device];
+
+    if (result.actions.trigger_button_press) {
+        if (op.pending_command_us >= 0) {
+            command_latency_ms_.add((double) (now_us_ - op.pending_command_us) / US_PER_MS);
+            op.pending_command_us = -1;
+        }
+        // The opener toggles the physical door; the reed switch follows the motion
+        if (!op.door_moving) {
+            op.door_moving = true;
+            if (op.door_closed) {
+                push(now_us_ + 300 * US_PER_MS, EV_DOOR_SENSOR, device, 1);
+            } else {
+                push(now_us_ + (int64_t) (uniform(11.0, 14.0) * US_PER_S), EV_DOOR_SENSOR, device, 0);
+            }
+        }
+    }
+
+    if (result.actions.publish_state) {
+        if (mqtt_retry_is_connected(&op.mqtt)) {
+            send_to_broker(device, MSG_STATE, now_us_);
+        } else {
+            states_lost_++;     // QoS 0 publish while offline is dropped by esp-mqtt
+        }
+    }
+
+    ensure_tick(device);
+}
+
+void FleetSim::start_connect(int device, int64_t delay_us)
+{
+    Opener& op = openers_[device];
+    if (op.connecting || !op.wifi_up) {
+        return;
+    }
+    op.connecting = true;
+    push(now_us_ + delay_us, EV_CONNECT_ATTEMPT, device, 0, 0, op.session);
+}
+
+void FleetSim::on_connected(int device)
+{
+    Opener& op = openers_[device];
+    op.connecting = false;
+    mqtt_retry_result_t result = mqtt_retry_on_connected(&op.mqtt);
+    if (!result.should_callback_connected) {
+        return;
+    }
+    connected_count_++;
+    if (restart_us_ >= 0 && all_reconnected_us_ < 0 && connected_count_ == cfg_.devices) {
+        all_reconnected_us_ = now_us_;
+    }
+
+    // mqtt_connected_callback(): availability, two subscriptions, then sample the reed switch
+    send_to_broker(device, MSG_AVAILABILITY, now_us_);
+    send_to_broker(device, MSG_SUBSCRIBE, now_us_);
+    send_to_broker(device, MSG_SUBSCRIBE, now_us_);
+    garage_input_t input = op.door_closed ? GARAGE_INPUT_SENSOR_CLOSED : GARAGE_INPUT_SENSOR_OPEN;
+    handle_result(device, garage_controller_handle_input(&op.ctrl, input));
+    push(now_us_ + MQTT_KEEPALIVE_S * US_PER_S, EV_KEEPALIVE, device, 0, 0, op.session);
+}
+
+void FleetSim::on_mqtt_disconnect(int device)
+{
+    Opener& op = openers_[device];
+    if (mqtt_retry_is_connected(&op.mqtt)) {
+        connected_count_--;
+    }
+    op.session++;
+    op.connecting = false;
+    mqtt_retry_result_t result = mqtt_retry_on_disconnect(&op.mqtt);
+    if (result.action == MQTT_RETRY_ACTION_RECONNECT) {
+        int64_t jitter = (int64_t) (uniform(0.0, cfg_.reconnect_jitter_ms) * US_PER_MS);
+        start_connect(device, jitter);
+    }
+}
+
+void FleetSim::on_wifi_lost(int device)
+{
+    Opener& op = openers_[device];
+    op.wifi_up = false;
+    on_mqtt_disconnect(device);
+    push(now_us_ + WIFI_ATTEMPT_MS * US_PER_MS, EV_WIFI_ATTEMPT, device);
+}
+
+void FleetSim::dispatch(const Event& ev)
+{
+    Opener* op = (ev.device >= 0) ? &openers_[ev.device] : nullptr;
+
+    switch (ev.type) {
+        case EV_USAGE: {
+            schedule_next_usage(ev.device);
+            if (uniform(0.0, 1.0) < cfg_.remote_fraction) {
+                // Home Assistant publishes the command through the broker
+                garage_input_t command = op->door_closed ? GARAGE_INPUT_COMMAND_OPEN : GARAGE_INPUT_COMMAND_CLOSE;
+                push(now_us_ + net_delay_us(), EV_BROKER_MESSAGE, ev.device, MSG_COMMAND, now_us_, 0, command);
+            } else if (!op->door_moving) {
+                // Wall button: the door moves without the opener knowing why
+                op->door_moving = true;
+                if (op->door_closed) {
+                    push(now_us_ + 300 * US_PER_MS, EV_DOOR_SENSOR, ev.device, 1);
+                } else {
+                    push(now_us_ + (int64_t) (uniform(11.0, 14.0) * US_PER_S), EV_DOOR_SENSOR, ev.device, 0);
+                }
+            }
+            break;
+        }
+
+        case EV_BROKER_MESSAGE: {
+            if (!broker_up_) {
+                messages_dropped_by_broker_++;
+                if (ev.arg == MSG_COMMAND) {
+                    commands_lost_++;
+                }
+                break;
+            }
+            if (ev.arg != MSG_COMMAND && ev.session != op->session) {
+                break;  // Sent on a connection that no longer exists
+            }
+            inbound_.add(now_us_);
+            int64_t done_us = broker_process(cfg_.msg_cost_us);
+            if (ev.arg == MSG_STATE) {
+                deliver(done_us, EV_HA_STATE, ev.device, 0, ev.stamp_us);
+                deliver(done_us, EV_DEVICE_ECHO, ev.device, 0, ev.stamp_us);
+            } else if (ev.arg == MSG_SUBSCRIBE) {
+                deliver(done_us, EV_DEVICE_ECHO, ev.device, 0, ev.stamp_us);    // Retained status
+            } else if (ev.arg == MSG_COMMAND) {
+                if (mqtt_retry_is_connected(&op->mqtt)) {
+                    push(done_us + net_delay_us(), EV_DEVICE_COMMAND, ev.device, 0, ev.stamp_us, op->session,
+                         ev.payload);
+                    deliveries_.add(done_us);
+                } else {
+                    commands_lost_++;   // No persistent session: QoS 0 command is not queued
+                }
+            }
+            break;
+        }
+
+        case EV_DEVICE_COMMAND: {
+            if (ev.session != op->session) {
+                commands_lost_++;
+                break;
+            }
+            op->pending_command_us = ev.stamp_us;
+            garage_transition_result_t result = garage_controller_handle_input(&op->ctrl, (garage_input_t) ev.payload);
+            if (!result.actions.trigger_button_press) {
+                op->pending_command_us = -1;    // Ignored (e.g. already in that state)
+            }
+            handle_result(ev.device, result);
+            break;
+        }
+
+        case EV_HA_STATE:
+            state_latency_ms_.add((double) (now_us_ - ev.stamp_us) / US_PER_MS);
+            break;
+
+        case EV_DEVICE_ECHO:
+            break;  // mqtt_data_callback() only logs the status topic
+
+        case EV_DEVICE_TICK:
+            op->tick_scheduled = false;
+            handle_result(ev.device, garage_controller_tick(&op->ctrl, TICK_MS));
+            break;
+
+        case EV_DOOR_SENSOR:
+            op->door_closed = (ev.arg == 0);
+            op->door_moving = false;
+            handle_result(ev.device, garage_controller_handle_input(
+                &op->ctrl, op->door_closed ? GARAGE_INPUT_SENSOR_CLOSED : GARAGE_INPUT_SENSOR_OPEN));
+            break;
+
+        case EV_CONNECT_ATTEMPT:
+            if (ev.session != op->session || !op->wifi_up) {
+                break;
+            }
+            connects_.add(now_us_);
+            if (!broker_up_) {
+                connect_attempts_failed_++;
+                op->connecting = false;
+                mqtt_retry_on_disconnect(&op->mqtt);
+                start_connect(ev.device, MQTT_RECONNECT_TIMEOUT_MS * US_PER_MS);
+                break;
+            }
+            inbound_.add(now_us_);
+            push(broker_process(cfg_.connect_cost_us) + net_delay_us(), EV_CONNACK, ev.device, 0, 0, op->session);
+            break;
+
+        case EV_CONNACK:
+            if (ev.session == op->session && op->wifi_up && broker_up_) {
+                on_connected(ev.device);
+            }
+            break;
+
+        case EV_KEEPALIVE:
+            if (ev.session == op->session && mqtt_retry_is_connected(&op->mqtt)) {
+                send_to_broker(ev.device, MSG_PING, now_us_);
+                push(now_us_ + MQTT_KEEPALIVE_S * US_PER_S, EV_KEEPALIVE, ev.device, 0, 0, op->session);
+            }
+            break;
+
+        case EV_BROKER_DOWN:
+            broker_up_ = false;
+            restart_us_ = now_us_;
+            for (int i = 0; i < cfg_.devices; i++) {
+                on_mqtt_disconnect(i);
+            }
+            break;
+
+        case EV_BROKER_UP:
+            broker_up_ = true;
+            broker_free_at_us_ = now_us_;
+            break;
+
+        case EV_AP_DOWN:
+            for (int i = 0; i < cfg_.devices; i++) {
+                if (openers_[i].behind_failed_ap) {
+                    on_wifi_lost(i);
+                }
+            }
+            break;
+
+        case EV_AP_UP:
+            for (int i = 0; i < cfg_.devices; i++) {
+                openers_[i].behind_failed_ap = false;
+            }
+            break;
+
+        case EV_WIFI_ATTEMPT: {
+            if (op->wifi_up) {
+                break;
+            }
+            if (!op->behind_failed_ap) {
+                op->wifi_up = true;
+                wifi_retry_on_connected(&op->wifi);
+                start_connect(ev.device, 0);
+                break;
+            }
+            wifi_retry_result_t result = wifi_retry_on_disconnect(&op->wifi);
+            if (result.action == WIFI_RETRY_ACTION_CONNECT) {
+                push(now_us_ + WIFI_ATTEMPT_MS * US_PER_MS, EV_WIFI_ATTEMPT, ev.device);
+            } else if (result.action == WIFI_RETRY_ACTION_FAIL) {
+                push(now_us_ + (int64_t) WIFI_RETRY_INTERVAL_MS * US_PER_MS, EV_WIFI_RETRY_TIMER, ev.device);
+            }
+            break;
+        }
+
+        case EV_WIFI_RETRY_TIMER:
+            if (!op->wifi_up) {
+                wifi_retry_on_timer_expired(&op->wifi);
+                push(now_us_ + WIFI_ATTEMPT_MS * US_PER_MS, EV_WIFI_ATTEMPT, ev.device);
+            }
+            break;
+    }
+}
+
+void FleetSim::run()
+{
+    end_us_ = (int64_t) (cfg_.hours * 3600.0 * US_PER_S);
+
+    gpio_hal_sim_reset();
+    garage_controller_config_t config = {};
+    config.reed_switch_gpio = REED_GPIO;
+    config.relay_gpio = RELAY_GPIO;
+    config.relay_pulse_ms = GARAGE_RELAY_PULSE_MS;
+    config.sm_config.timeout_ms = 15000;
+
+    for (int i = 0; i < cfg_.devices; i++) {
+        Opener& op = openers_[i];
+        garage_controller_init(&op.ctrl, &config, GARAGE_STATE_UNKNOWN);
+        wifi_retry_init(&op.wifi, WIFI_MAX_RETRY, WIFI_RETRY_INTERVAL_MS);
+        wifi_retry_on_connected(&op.wifi);
+        mqtt_retry_init(&op.mqtt, true);
+        op.behind_failed_ap = uniform(0.0, 1.0) < cfg_.ap_outage_fraction;
+        // Boot is spread over the first minute
+        start_connect(i, (int64_t) (uniform(0.0, 60.0) * US_PER_S));
+        schedule_next_usage(i);
+    }
+
+    if (cfg_.broker_restart_at_s >= 0) {
+        push((int64_t) (cfg_.broker_restart_at_s * US_PER_S), EV_BROKER_DOWN, -1);
+        push((int64_t) ((cfg_.broker_restart_at_s + cfg_.broker_downtime_s) * US_PER_S), EV_BROKER_UP, -1);
+    }
+    if (cfg_.ap_outage_at_s >= 0) {
+        push((int64_t) (cfg_.ap_outage_at_s * US_PER_S), EV_AP_DOWN, -1);
+        push((int64_t) ((cfg_.ap_outage_at_s + cfg_.ap_outage_s) * US_PER_S), EV_AP_UP, -1);
+    } else {
+        for (Opener& op : openers_) {
+            op.behind_failed_ap = false;
+        }
+    }
+
+    while (!events_.empty() && events_.top().time_us <= end_us_) {
+        Event ev = events_.top();
+        events_.pop();
+        now_us_ = ev.time_us;
+        gpio_hal_sim_advance_to(now_us_);
+        dispatch(ev);
+        events_processed_++;
+    }
+}
+
+static void print_rate(const char* label, const PerSecond& counter, double seconds)
+{
+    size_t peak_second = 0;
+    uint32_t peak = counter.peak(&peak_second);
+    printf("%-22s total %10llu  mean %9.2f/s  peak %7u/s at t=%zus\n", label,
+           (unsigned long long) counter.total(), (double) counter.total() / seconds, peak, peak_second);
+}
+
+static void print_latency(const char* label, Percentiles& p)
+{
+    printf("%-22s n=%-8zu p50 %7.1f  p90 %7.1f  p99 %7.1f  p99.9 %7.1f  max %7.1f ms\n", label,
+           p.samples.size(), p.at(0.50), p.at(0.90), p.at(0.99), p.at(0.999), p.max());
+}
+
+void FleetSim::report()
+{
+    double seconds = cfg_.hours * 3600.0;
+    printf("Fleet: %d openers, %.2f h simulated, seed %llu, %llu events\n", cfg_.devices, cfg_.hours,
+           (unsigned long long) cfg_.seed, (unsigned long long) events_processed_);
+    printf("Broker: %.1f us/message, %.1f us/connect, max backlog %.2f ms\n", cfg_.msg_cost_us,
+           cfg_.connect_cost_us, (double) broker_max_backlog_us_ / US_PER_MS);
+    print_rate("Broker inbound", inbound_, seconds);
+    print_rate("Broker deliveries", deliveries_, seconds);
+    print_rate("CONNECT attempts", connects_, seconds);
+    print_latency("Command latency", command_latency_ms_);
+    print_latency("State latency", state_latency_ms_);
+    if (restart_us_ >= 0) {
+        if (all_reconnected_us_ >= 0) {
+            printf("Broker restart at %.0fs: all openers reconnected after %.2f s (%llu refused attempts)\n",
+                   (double) restart_us_ / US_PER_S, (double) (all_reconnected_us_ - restart_us_) / US_PER_S,
+                   (unsigned long long) connect_attempts_failed_);
+        } else {
+            printf("Broker restart at %.0fs: %d of %d openers reconnected by the end\n",
+                   (double) restart_us_ / US_PER_S, connected_count_, cfg_.devices);
+        }
+    }
+    printf("Lost: %llu commands, %llu state publishes while offline, %llu messages during broker downtime\n",
+           (unsigned long long) commands_lost_, (unsigned long long) states_lost_,
+           (unsigned long long) messages_dropped_by_broker_);
+    printf("Connected at end: %d of %d\n", connected_count_, cfg_.devices);
+}
+
+static bool parse_args(int argc, char** argv, FleetConfig* cfg)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char* value = argv[++i];
+        if (strcmp(arg, "--devices") == 0) {
+            cfg->devices = atoi(value);
+        } else if (strcmp(arg, "--hours") == 0) {
+            cfg->hours = atof(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            cfg->seed = strtoull(value, NULL, 10);
+        } else if (strcmp(arg, "--msg-cost-us") == 0) {
+            cfg->msg_cost_us = atof(value);
+        } else if (strcmp(arg, "--connect-cost-us") == 0) {
+            cfg->connect_cost_us = atof(value);
+        } else if (strcmp(arg, "--broker-restart-at") == 0) {
+            cfg->broker_restart_at_s = atof(value);
+        } else if (strcmp(arg, "--broker-downtime") == 0) {
+            cfg->broker_downtime_s = atof(value);
+        } else if (strcmp(arg, "--reconnect-jitter-ms") == 0) {
+            cfg->reconnect_jitter_ms = atof(value);
+        } else if (strcmp(arg, "--ap-outage-at") == 0) {
+            cfg->ap_outage_at_s = atof(value);
+        } else if (strcmp(arg, "--ap-outage-s") == 0) {
+            cfg->ap_outage_s = atof(value);
+        } else if (strcmp(arg, "--ap-outage-fraction") == 0) {
+            cfg->ap_outage_fraction = atof(value);
+        } else {
+            return false;
+        }
+    }
+    return cfg->devices > 0 && cfg->hours > 0;
+}
+
+int main(int argc, char** argv)
+{
+    FleetConfig cfg;
+    if (!parse_args(argc, argv, &cfg)) {
+        fprintf(stderr,
+                "usage: %s [--devices N] [--hours H] [--seed S] [--msg-cost-us US] [--connect-cost-us US]\n"
+                "          [--broker-restart-at S] [--broker-downtime S] [--reconnect-jitter-ms MS]\n"
+                "          [--ap-outage-at S] [--ap-outage-s S] [--ap-outage-fraction F]\n",
+                argv[0]);
+        return 2;
+    }
+
+    FleetSim sim(cfg);
+    sim.run();
+    sim.report();
+    return 0;
+}
@@ -0,0 +1,195 @@
+/**
+ * @file fuzz_main.cpp
+ * @brief Standalone driver for the fuzz targets when libFuzzer is not available (GCC, MSVC)
+ *
+ * Runs the built-in seeds, any files given on the command line (e.g. a
+ * libFuzzer corpus as corpus/x), then --runs random inputs mutated from them. Build with the
+ * sanitizers enabled so out-of-bounds reads abort the run.
+ *
+ * Usage: fuzz_mqtt_ingress [--runs <n>] [--seed <n>] [--max-len <bytes>] [<file> ...]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+uint32_t fuzz_mqtt_ingress_commands(void);
+
+typedef std::vector<uint8_t> Input;
+
+static Input make_input(uint8_t event_id, uint8_t flags, const std::string& topic, const std::string& payload)
+{
+    Input input = { event_id, flags, (uint8_t) (topic.size() & 0xff), (uint8_t) (topic.size() >> 8) };
+    input.insert(input.end(), topic.begin(), topic.end());
+    input.insert(input.end(), payload.begin(), payload.end());
+    return input;
+}
+
+/// Hand-written cases: valid commands, near misses, embedded NULs, bad lengths, large payloads
+static std::vector<Input> builtin_seeds(void)
+{
+    const uint8_t DATA = 6;             // MQTT_EVENT_DATA
+    const uint8_t COMMAND = 1 << 5;
+    const uint8_t STATUS = 2 << 5;
+    std::vector<Input> seeds;
+
+    seeds.push_back(make_input(DATA, 0, "garage_door/buttonpress", "OPEN"));
+    seeds.push_back(make_input(DATA, 0, "garage_door/buttonpress", "CLOSE"));
+    seeds.push_back(make_input(DATA, 0, "garage_door/buttonpress", "OPEN 17 0123456789abcdef0123456789ABCDEF"));
+    seeds.push_back(make_input(DATA, 0, "garage_door/status", "open"));
+    seeds.push_back(make_input(DATA, 0, "garage_door/schedule/rules/evening", "auto_close 10"));
+    seeds.push_back(make_input(DATA, 0, "garage_door/history/get", "history?since=120&n=16"));
+    seeds.push_back(make_input(DATA, COMMAND, "", std::string("OPEN\0", 5)));
+    seeds.push_back(make_input(DATA, COMMAND, "", std::string("OP\0N", 4)));
+    seeds.push_back(make_input(DATA, COMMAND, "", "OPE"));
+    seeds.push_back(make_input(DATA, COMMAND, "", "OPENCLOSE"));
+    seeds.push_back(make_input(DATA, 0, std::string("garage_door/buttonpress\0", 24), "OPEN"));
+    seeds.push_back(make_input(DATA, 0, "garage_door/buttonpres", "OPEN"));
+    seeds.push_back(make_input(DATA, COMMAND | 0x02, "", "OPEN"));
+    seeds.push_back(make_input(DATA, STATUS | 0x02, "", "closed"));
+    seeds.push_back(make_input(DATA, 0x01, "garage_door/status", "x"));
+    seeds.push_back(make_input(DATA, COMMAND | 0x08, "", "OPEN"));
+    seeds.push_back(make_input(DATA, 0x04, "garage_door/buttonpress", "OPEN"));
+    seeds.push_back(make_input(DATA, COMMAND | 0x10, "", "OPEN"));
+    seeds.push_back(make_input(DATA, STATUS, "", std::string(1 << 20, 'A')));
+    seeds.push_back(make_input(DATA, COMMAND, "", std::string(1 << 20, '\0')));
+    seeds.push_back(make_input(DATA, 0, std::string(60000, '/'), "OPEN"));
+    for (uint8_t event_id = 0; event_id < 8; event_id++) {
+        seeds.push_back(make_input(event_id, 0, "t", "d"));
+    }
+    return seeds;
+}
+
+static bool read_file(const std::string& path, Input* out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        return false;
+    }
+    out->clear();
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        out->insert(out->end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static uint32_t next_random(uint64_t* state)
+{
+    // splitmix64
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return (uint32_t) ((z ^ (z >> 31)) >> 32);
+}
+
+/// Byte flips, inserts, deletes and header rewrites; occasionally grows the payload to max_len
+static Input mutate(const Input& base, uint64_t* rng, size_t max_len)
+{
+    Input input = base;
+    int edits = 1 + (int) (next_random(rng) % 8);
+    for (int i = 0; i < edits; i++) {
+        uint32_t r = next_random(rng);
+        size_t pos = input.empty() ? 0 : next_random(rng) % input.size();
+        switch (r % 6) {
+            case 0:
+                if (!input.empty()) {
+                    input[pos] ^= (uint8_t) (1u << (r >> 8) % 8);
+                }
+                break;
+            case 1:
+                if (!input.empty()) {
+                    input[pos] = (uint8_t) (r >> 8);
+                }
+                break;
+            case 2:
+                if (input.size() < max_len) {
+                    input.insert(input.begin() + (long) pos, (uint8_t) (r >> 8));
+                }
+                break;
+            case 3:
+                if (!input.empty()) {
+                    input.erase(input.begin() + (long) pos);
+                }
+                break;
+            case 4:
+                if (input.size() >= 2) {
+                    input[r % 2] = (uint8_t) (r >> 8);  // Event id or flags
+                }
+                break;
+            default:
+                if ((r >> 8) % 64 == 0) {
+                    input.resize(max_len, (uint8_t) (r >> 16));
+                }
+                break;
+        }
+    }
+    if (input.size() > max_len) {
+        input.resize(max_len);
+    }
+    return input;
+}
+
+int main(int argc, char** argv)
+{
+    long runs = 100000;
+    uint64_t seed = 1;
+    size_t max_len = 4096;
+    std::vector<Input> corpus = builtin_seeds();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-len") == 0 && i + 1 < argc) {
+            max_len = (size_t) atol(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--runs <n>] [--seed <n>] [--max-len <bytes>] [<file> ...]\n", argv[0]);
+            return 2;
+        } else {
+            Input input;
+            if (!read_file(argv[i], &input)) {
+                fprintf(stderr, "cannot read %s\n", argv[i]);
+                return 2;
+            }
+            corpus.push_back(input);
+        }
+    }
+
+    typedef std::chrono::steady_clock clock;
+    double slowest_us = 0;
+    size_t slowest_size = 0;
+    auto run = [&](const Input& input) {
+        auto start = clock::now();
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+        double us = std::chrono::duration<double, std::micro>(clock::now() - start).count();
+        if (us > slowest_us) {
+            slowest_us = us;
+            slowest_size = input.size();
+        }
+    };
+
+    for (const Input& input : corpus) {
+        run(input);
+    }
+
+    uint64_t rng = seed;
+    auto start = clock::now();
+    for (long i = 0; i < runs; i++) {
+        run(mutate(corpus[next_random(&rng) % corpus.size()], &rng, max_len));
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+    printf("%zu seeds, %ld random runs in %.2f s (%.0f exec/s), %u commands accepted\n", corpus.size(), runs,
+           seconds, seconds > 0 ? (double) runs / seconds : 0.0, (unsigned) fuzz_mqtt_ingress_commands());
+    printf("slowest input: %.1f us (%zu bytes)\n", slowest_us, slowest_size);
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file fuzz_mqtt_ingress.cpp
+ * @brief Fuzz target for the MQTT ingress path
+ *
+ * Each input becomes one esp_mqtt_event_t dispatched through the simulated
+ * MQTT HAL into mqtt_impl.c's event handler, whose on_data callback does what
+ * the firmware's mqtt_data_callback does: classify with garage_command_classify
+ * and log topic/payload excerpts with %.*s. Topic and payload are copied into
+ * allocations of exactly their length, with no NUL terminator, so any read past
+ * the reported length is caught by AddressSanitizer.
+ *
+ * Input layout:
+ *   [0]     event id (modulo the esp-mqtt event count)
+ *   [1]     flags: bit0 negative topic_len, bit1 negative data_len, bit2 NULL topic,
+ *           bit3 NULL data, bit4 chunked (total_data_len > data_len),
+ *           bits5-6 topic: 0 from input, 1 command topic, 2 status topic
+ *   [2..3]  topic length, little endian (capped at what is left)
+ *   [4..]   topic bytes, then payload bytes
+ *
+ * Built with -fsanitize=fuzzer this is a libFuzzer target; otherwise
+ * fuzz_main.cpp drives it.
+ */
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+extern "C" {
+#include "diag_report.h"
+#include "garage_command.h"
+#include "history_log.h"
+#include "mqtt_hal_sim.h"
+#include "mqtt_interface.h"
+#include "signed_command.h"
+}
+
+#define COMMAND_TOPIC "garage_door/buttonpress"
+#define STATUS_TOPIC "garage_door/status"
+#define SCHEDULE_PREFIX "garage_door/schedule/rules/"
+#define HISTORY_TOPIC "garage_door/history/get"
+#define DEBUG_TOPIC "garage_door/debug/cmd"
+
+static const garage_command_topics_t s_topics = { COMMAND_TOPIC, STATUS_TOPIC, SCHEDULE_PREFIX, HISTORY_TOPIC,
+                                                  DEBUG_TOPIC };
+static uint32_t s_commands = 0;
+
+static const uint8_t s_key[] = "fuzz key";
+static signed_command_window_t s_window;
+static signed_command_verifier_t s_verifier;
+
+/// The MAC may be sent in either case
+static bool equal_ignoring_case(const char* a, const char* b, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (tolower((unsigned char) a[i]) != tolower((unsigned char) b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool store_floor(uint32_t floor, void* ctx)
+{
+    (void) floor;
+    (void) ctx;
+    return true;
+}
+
+static bool buffer_is(const char* buf, int len, const char* str)
+{
+    return buf != nullptr && len >= 0 && (size_t) len == strlen(str) && memcmp(buf, str, (size_t) len) == 0;
+}
+
+/// Log excerpt length, checked: glibc ignores a negative %.*s precision, but newlib on the
+/// device reads up to a NUL, so ASan on the host would not catch one
+static int checked_log_len(const char* data, int data_len)
+{
+    int len = garage_command_log_len(data, data_len);
+    if (len < 0 || len > GARAGE_COMMAND_LOG_MAX || (data_len < 0 && len != 0) || (data_len >= 0 && len > data_len)) {
+        fprintf(stderr, "Log excerpt length %d for a buffer of %d bytes\n", len, data_len);
+        abort();
+    }
+    return len;
+}
+
+/// Mirror of the firmware's mqtt_data_callback, with the invariants it relies on checked
+static void on_data(const char* topic, int topic_len, const char* data, int data_len)
+{
+    char log[MQTT_HAL_SIM_LOG_BUFFER_SIZE];
+    garage_message_t message = garage_command_classify(&s_topics, topic, topic_len, data, data_len);
+
+    switch (message.kind) {
+        case GARAGE_MESSAGE_COMMAND:
+            if (!buffer_is(topic, topic_len, COMMAND_TOPIC) ||
+                !(buffer_is(data, data_len, GARAGE_COMMAND_OPEN) || buffer_is(data, data_len, GARAGE_COMMAND_CLOSE) ||
+                  buffer_is(data, data_len, GARAGE_COMMAND_STOP)) ||
+                (message.input != GARAGE_INPUT_COMMAND_OPEN && message.input != GARAGE_INPUT_COMMAND_CLOSE &&
+                 message.input != GARAGE_INPUT_COMMAND_STOP)) {
+                fprintf(stderr, "Accepted a command that is not exactly OPEN/CLOSE/STOP on the command topic\n");
+                abort();
+            }
+            s_commands++;
+            break;
+        case GARAGE_MESSAGE_SIGNED_COMMAND: {
+            garage_input_t input;
+            uint32_t counter;
+            if (!buffer_is(topic, topic_len, COMMAND_TOPIC)) {
+                fprintf(stderr, "Signed command on a topic other than the command topic\n");
+                abort();
+            }
+            if (signed_command_verify(&s_verifier, data, data_len, &input, &counter) == SIGNED_COMMAND_OK) {
+                // Only a payload the key holder could have produced may pass
+                char expected[SIGNED_COMMAND_MAX_LEN + 1];
+                int len = signed_command_sign(s_key, sizeof(s_key) - 1, input, counter, expected, sizeof(expected));
+                if (len != data_len || !equal_ignoring_case(expected, data, (size_t) len)) {
+                    fprintf(stderr, "Accepted a signed command that does not match its signature\n");
+                    abort();
+                }
+                s_commands++;
+            } else if (input != GARAGE_INPUT_NONE) {
+                fprintf(stderr, "Refused signed command left an input set\n");
+                abort();
+            }
+            break;
+        }
+        case GARAGE_MESSAGE_INVALID_COMMAND:
+            snprintf(log, sizeof(log), "Ignoring invalid command: %.*s", checked_log_len(data, data_len),
+                     data != nullptr ? data : "");
+            break;
+        case GARAGE_MESSAGE_STATUS:
+            snprintf(log, sizeof(log), "Status: %.*s\r\n", checked_log_len(data, data_len),
+                     data != nullptr ? data : "");
+            break;
+        case GARAGE_MESSAGE_SCHEDULE_RULE: {
+            const size_t prefix_len = sizeof(SCHEDULE_PREFIX) - 1;
+            if (topic == nullptr || message.rule_id != topic + prefix_len || message.rule_id_len <= 0 ||
+                (size_t) message.rule_id_len + prefix_len != (size_t) topic_len ||
+                memchr(message.rule_id, '/', (size_t) message.rule_id_len) != nullptr) {
+                fprintf(stderr, "Rule id is not the single topic level after the schedule prefix\n");
+                abort();
+            }
+            break;
+        }
+        case GARAGE_MESSAGE_HISTORY_QUERY: {
+            uint32_t since;
+            int count;
+            if (!buffer_is(topic, topic_len, HISTORY_TOPIC)) {
+                fprintf(stderr, "History query on a topic other than the history topic\n");
+                abort();
+            }
+            if (history_log_parse_query(data, data_len, &since, &count) && (count < 1 || count > HISTORY_PAGE_MAX)) {
+                fprintf(stderr, "History page size outside 1..HISTORY_PAGE_MAX\n");
+                abort();
+            }
+            break;
+        }
+        case GARAGE_MESSAGE_DEBUG_COMMAND: {
+            if (!buffer_is(topic, topic_len, DEBUG_TOPIC)) {
+                fprintf(stderr, "Debug command on a topic other than the debug topic\n");
+                abort();
+            }
+            int sections = diag_parse_command(data, data_len);
+            if ((sections & ~DIAG_SECTION_ALL) != 0) {
+                fprintf(stderr, "Debug command asked for an unknown section\n");
+                abort();
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (message.kind != GARAGE_MESSAGE_SCHEDULE_RULE && message.rule_id != nullptr) {
+        fprintf(stderr, "Rule id set on a message that is not a schedule rule\n");
+        abort();
+    }
+    if (message.kind != GARAGE_MESSAGE_COMMAND && message.input != GARAGE_INPUT_NONE) {
+        fprintf(stderr, "Input set on a message that is not a command\n");
+        abort();
+    }
+}
+
+static void on_published(int msg_id)
+{
+    (void) msg_id;
+}
+
+static const mqtt_event_callbacks_t s_callbacks = { nullptr, nullptr, on_data, on_published };
+
+static const mqtt_config_t s_config = {
+    "broker.local", 1883, nullptr, nullptr, "garage_door/availability", "unavailable",
+};
+
+/// Copy into an allocation of exactly len bytes (nothing readable past the end)
+static std::unique_ptr<char[]> exact_copy(const uint8_t* bytes, size_t len)
+{
+    std::unique_ptr<char[]> copy(new char[len]);
+    if (len > 0) {
+        memcpy(copy.get(), bytes, len);
+    }
+    return copy;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    static bool initialized = false;
+    if (!initialized) {
+        mqtt_hal_sim_reset();
+        mqtt_init(&s_config, &s_callbacks);
+        signed_command_init(&s_verifier, s_key, sizeof(s_key) - 1, &s_window, 0, store_floor, nullptr);
+        initialized = true;
+    }
+    if (size < 4) {
+        return 0;
+    }
+
+    uint8_t event_id = data[0];
+    uint8_t flags = data[1];
+    size_t topic_len = (size_t) data[2] | ((size_t) data[3] << 8);
+    data += 4;
+    size -= 4;
+
+    const char* fixed_topic = nullptr;
+    if (((flags >> 5) & 3) == 1) {
+        fixed_topic = COMMAND_TOPIC;
+    } else if (((flags >> 5) & 3) == 2) {
+        fixed_topic = STATUS_TOPIC;
+    }
+
+    std::unique_ptr<char[]> topic;
+    if (fixed_topic != nullptr) {
+        topic_len = strlen(fixed_topic);
+        topic = exact_copy((const uint8_t*) fixed_topic, topic_len);
+    } else {
+        if (topic_len > size) {
+            topic_len = size;
+        }
+        topic = exact_copy(data, topic_len);
+        data += topic_len;
+        size -= topic_len;
+    }
+    std::unique_ptr<char[]> payload = exact_copy(data, size);
+
+    esp_mqtt_event_t event = {};
+    event.event_id = (esp_mqtt_event_id_t) (event_id % (MQTT_EVENT_BEFORE_CONNECT + 1));
+    event.topic = (flags & 0x04) ? nullptr : topic.get();
+    event.topic_len = (flags & 0x01) ? -(int) topic_len - 1 : (int) topic_len;
+    event.data = (flags & 0x08) ? nullptr : payload.get();
+    event.data_len = (flags & 0x02) ? -(int) size - 1 : (int) size;
+    event.total_data_len = (flags & 0x10) ? event.data_len + 1 : event.data_len;
+    event.current_data_offset = 0;
+    event.msg_id = (int) size;
+
+    mqtt_hal_sim_dispatch(&event);
+    return 0;
+}
+
+/// Commands accepted so far (for the standalone driver's report)
+uint32_t fuzz_mqtt_ingress_commands(void)
+{
+    return s_commands;
+}
@@ -0,0 +1,181 @@
+/**
+ * @file property.h
+ * @brief Minimal property-based test harness for event-sequence state machines
+ *
+ * A case is an integer parameter (e.g. max retries) plus a sequence of
+ * operations. check() generates random cases, runs the property on each and,
+ * on the first failure, shrinks the case by deleting chunks of operations,
+ * simplifying single operations and lowering the parameter until no smaller
+ * case still fails.
+ *
+ * Properties return an empty string when they hold and a description of the
+ * violated invariant otherwise. Cases are reused between runs so the hot loop
+ * does not allocate.
+ */
+
+#ifndef PROPERTY_H
+#define PROPERTY_H
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace prop {
+
+struct Config {
+    uint64_t seed = 0x5eed;
+    int runs = 20000;                   // Random cases to try
+    int max_ops = 64;                   // Longest generated sequence
+    int param_min = 0;                  // Parameter range, inclusive
+    int param_max = 0;
+};
+
+template <typename Op>
+struct Case {
+    int param = 0;
+    std::vector<Op> ops;
+};
+
+template <typename Op>
+struct Result {
+    bool passed = true;
+    int runs = 0;                       // Cases executed before failing (or all of them)
+    int shrink_steps = 0;               // Successful shrinks applied to the counterexample
+    double seconds = 0.0;               // Generation + checking time, shrinking excluded
+    Case<Op> counterexample;
+    std::string message;                // Property message for the shrunk counterexample
+
+    double runs_per_second() const { return seconds > 0.0 ? (double) runs / seconds : 0.0; }
+};
+
+/**
+ * @brief Shrink a failing case; ops are simplified towards Op(0)
+ */
+template <typename Op, typename Property>
+int shrink(Case<Op>* failing, std::string* message, int param_min, Property property)
+{
+    int steps = 0;
+    Case<Op> candidate;
+    bool progress = true;
+
+    while (progress) {
+        progress = false;
+
+        // Delete chunks, largest first
+        for (size_t chunk = failing->ops.size(); chunk >= 1 && !progress; chunk /= 2) {
+            for (size_t start = 0; start + chunk <= failing->ops.size(); start += chunk) {
+                candidate.param = failing->param;
+                candidate.ops.assign(failing->ops.begin(), failing->ops.begin() + (long) start);
+                candidate.ops.insert(candidate.ops.end(), failing->ops.begin() + (long) (start + chunk),
+                                     failing->ops.end());
+                std::string result = property(candidate);
+                if (!result.empty()) {
+                    *failing = candidate;
+                    *message = result;
+                    steps++;
+                    progress = true;
+                    break;
+                }
+            }
+        }
+        if (progress) {
+            continue;
+        }
+
+        // Simplify single operations
+        for (size_t i = 0; i < failing->ops.size() && !progress; i++) {
+            for (int simpler = 0; simpler < (int) failing->ops[i] && !progress; simpler++) {
+                candidate = *failing;
+                candidate.ops[i] = (Op) simpler;
+                std::string result = property(candidate);
+                if (!result.empty()) {
+                    *failing = candidate;
+                    *message = result;
+                    steps++;
+                    progress = true;
+                }
+            }
+        }
+        if (progress) {
+            continue;
+        }
+
+        // Lower the parameter
+        for (int param = param_min; param < failing->param; param++) {
+            candidate = *failing;
+            candidate.param = param;
+            std::string result = property(candidate);
+            if (!result.empty()) {
+                *failing = candidate;
+                *message = result;
+                steps++;
+                progress = true;
+                break;
+            }
+        }
+    }
+    return steps;
+}
+
+/**
+ * @brief Check a property against random cases
+ * @param config Run configuration
+ * @param gen_op Callable taking std::mt19937_64& and returning a random Op
+ * @param property Callable taking const Case<Op>& and returning "" if the property holds
+ */
+template <typename Op, typename GenOp, typename Property>
+Result<Op> check(const Config& config, GenOp gen_op, Property property)
+{
+    Result<Op> result;
+    std::mt19937_64 rng(config.seed);
+    std::uniform_int_distribution<int> length(0, config.max_ops);
+    std::uniform_int_distribution<int> param(config.param_min, config.param_max);
+    Case<Op> current;
+    current.ops.reserve((size_t) config.max_ops);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < config.runs; run++) {
+        current.param = param(rng);
+        current.ops.clear();
+        int count = length(rng);
+        for (int i = 0; i < count; i++) {
+            current.ops.push_back(gen_op(rng));
+        }
+
+        result.runs++;
+        std::string message = property(current);
+        if (!message.empty()) {
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            result.passed = false;
+            result.counterexample = current;
+            result.message = message;
+            result.shrink_steps = shrink(&result.counterexample, &result.message, config.param_min, property);
+            return result;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/**
+ * @brief Human-readable counterexample, e.g. "param=2 [disconnect, connect]: message"
+ */
+template <typename Op, typename OpName>
+std::string describe(const Result<Op>& result, OpName op_name)
+{
+    std::ostringstream out;
+    out << "param=" << result.counterexample.param << " [";
+    for (size_t i = 0; i < result.counterexample.ops.size(); i++) {
+        out << (i ? ", " : "") << op_name(result.counterexample.ops[i]);
+    }
+    out << "]: " << result.message << " (after " << result.runs << " runs, " << result.shrink_steps
+        << " shrinks)";
+    return out.str();
+}
+
+} // namespace prop
+
+#endif /* PROPERTY_H */
@@ -0,0 +1,397 @@
+/**
+ * @file door_model.c
+ * @brief Physical garage door model on the simulated GPIO clock
+ *
+ * The door is evaluated lazily from its current run (start position, start
+ * time, drawn travel time, pending reversal). Whenever the run changes, the
+ * reed switch edges it implies are rescheduled in the GPIO sim, so the
+ * controller sees the magnet pass the switch at the right virtual time
+ * without the model needing a clock of its own.
+ */
+
+#include "door_model.h"
+#include "gpio_hal_sim.h"
+#include <stddef.h>
+#include <string.h>
+
+door_model_config_t door_model_default_config(int relay_gpio, int reed_gpio)
+{
+    door_model_config_t config = {
+        .relay_gpio = relay_gpio,
+        .reed_gpio = reed_gpio,
+        .open_travel_ms = 12000,
+        .close_travel_ms = 13000,
+        .travel_variance_pct = 5,
+        .min_press_ms = 50,
+        .press_while_moving = DOOR_MODEL_PRESS_IGNORED,
+        .reed_threshold_permille = 20,
+        .reed_bounce_count = 8,
+        .reed_bounce_period_us = 300,
+        .reverse_delay_ms = 300,
+        .seed = 1,
+    };
+    return config;
+}
+
+/* ============================================================================
+ * Run evaluation
+ * ============================================================================ */
+
+static int64_t draw_travel_us(door_model_run_t* run, int nominal_ms, int variance_pct)
+{
+    // xorshift32
+    uint32_t x = run->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    run->rng = x;
+
+    int64_t nominal_us = (int64_t) nominal_ms * 1000;
+    if (variance_pct <= 0) {
+        return nominal_us;
+    }
+    // Uniform offset in basis points within +/- variance_pct
+    int64_t span = (int64_t) variance_pct * 200 + 1;
+    int64_t offset_bp = (int64_t) (x % (uint32_t) span) - (int64_t) variance_pct * 100;
+    return nominal_us + nominal_us * offset_bp / 10000;
+}
+
+static int segment_position(int start, door_model_motion_t motion, int64_t start_us, int64_t travel_us, int64_t t)
+{
+    if (motion == DOOR_MODEL_STOPPED || t <= start_us || travel_us <= 0) {
+        return start;
+    }
+    int64_t delta = (t - start_us) * DOOR_MODEL_POSITION_OPEN / travel_us;
+    int64_t position = (motion == DOOR_MODEL_OPENING) ? start + delta : start - delta;
+    if (position < 0) {
+        position = 0;
+    }
+    if (position > DOOR_MODEL_POSITION_OPEN) {
+        position = DOOR_MODEL_POSITION_OPEN;
+    }
+    return (int) position;
+}
+
+static int64_t segment_end_us(int start, door_model_motion_t motion, int64_t start_us, int64_t travel_us)
+{
+    int remaining = (motion == DOOR_MODEL_OPENING) ? DOOR_MODEL_POSITION_OPEN - start : start;
+    return start_us + (int64_t) remaining * travel_us / DOOR_MODEL_POSITION_OPEN;
+}
+
+static int64_t run_end_us(const door_model_run_t* run)
+{
+    return segment_end_us(run->start_position, run->motion, run->motion_start_us, run->travel_us);
+}
+
+static bool reversal_pending(const door_model_run_t* run)
+{
+    return run->motion == DOOR_MODEL_CLOSING && run->reverse_at_us >= 0 && run->reverse_at_us < run_end_us(run);
+}
+
+static int position_at(const door_model_run_t* run, int64_t t)
+{
+    if (reversal_pending(run) && t >= run->reverse_at_us) {
+        int turn = segment_position(run->start_position, run->motion, run->motion_start_us, run->travel_us,
+                                    run->reverse_at_us);
+        return segment_position(turn, DOOR_MODEL_OPENING, run->reverse_at_us, run->reverse_travel_us, t);
+    }
+    return segment_position(run->start_position, run->motion, run->motion_start_us, run->travel_us, t);
+}
+
+static door_model_motion_t motion_at(const door_model_run_t* run, int64_t t)
+{
+    if (run->motion == DOOR_MODEL_STOPPED || t < run->motion_start_us) {
+        return DOOR_MODEL_STOPPED;
+    }
+    if (reversal_pending(run) && t >= run->reverse_at_us) {
+        int turn = position_at(run, run->reverse_at_us);
+        int64_t end = segment_end_us(turn, DOOR_MODEL_OPENING, run->reverse_at_us, run->reverse_travel_us);
+        return (t < end) ? DOOR_MODEL_OPENING : DOOR_MODEL_STOPPED;
+    }
+    return (t < run_end_us(run)) ? run->motion : DOOR_MODEL_STOPPED;
+}
+
+/**
+ * @brief Fold everything that has happened by time t into the run
+ */
+static void advance(door_model_run_t* run, int64_t t)
+{
+    if (reversal_pending(run) && run->reverse_at_us <= t) {
+        int turn = position_at(run, run->reverse_at_us);
+        run->motion = DOOR_MODEL_OPENING;
+        run->start_position = turn;
+        run->motion_start_us = run->reverse_at_us;
+        run->travel_us = run->reverse_travel_us;
+        run->reverse_at_us = -1;
+        run->last_direction = DOOR_MODEL_OPENING;
+        run->reversals++;
+    }
+    if (run->motion != DOOR_MODEL_STOPPED && run_end_us(run) <= t) {
+        run->start_position = (run->motion == DOOR_MODEL_OPENING) ? DOOR_MODEL_POSITION_OPEN : 0;
+        run->motion = DOOR_MODEL_STOPPED;
+        run->reverse_at_us = -1;
+    }
+}
+
+static void schedule_reversal(door_model_t* door, int64_t at_us)
+{
+    door->run.reverse_at_us = at_us;
+    door->run.reverse_travel_us = draw_travel_us(&door->run, door->config.open_travel_ms,
+                                                 door->config.travel_variance_pct);
+}
+
+static void start_motion(door_model_t* door, door_model_motion_t motion, int64_t t)
+{
+    door_model_run_t* run = &door->run;
+    run->start_position = position_at(run, t);
+    run->motion = motion;
+    run->last_direction = motion;
+    run->motion_start_us = t;
+    run->travel_us = draw_travel_us(run, motion == DOOR_MODEL_OPENING ? door->config.open_travel_ms
+                                                                      : door->config.close_travel_ms,
+                                    door->config.travel_variance_pct);
+    run->reverse_at_us = -1;
+    if (motion == DOOR_MODEL_CLOSING && door->obstructed) {
+        schedule_reversal(door, t + (int64_t) door->config.reverse_delay_ms * 1000);
+    }
+}
+
+static void apply_press(door_model_t* door, int64_t t)
+{
+    door_model_run_t* run = &door->run;
+    advance(run, t);
+    run->presses++;
+
+    if (run->motion != DOOR_MODEL_STOPPED) {
+        switch (door->config.press_while_moving) {
+            case DOOR_MODEL_PRESS_REVERSES:
+                start_motion(door, run->motion == DOOR_MODEL_OPENING ? DOOR_MODEL_CLOSING : DOOR_MODEL_OPENING, t);
+                break;
+            case DOOR_MODEL_PRESS_STOPS:
+                run->start_position = position_at(run, t);
+                run->motion = DOOR_MODEL_STOPPED;
+                run->motion_start_us = t;
+                run->reverse_at_us = -1;
+                run->stops++;
+                break;
+            case DOOR_MODEL_PRESS_IGNORED:
+            default:
+                run->ignored_presses++;
+                break;
+        }
+        return;
+    }
+
+    door_model_motion_t next;
+    if (run->start_position >= DOOR_MODEL_POSITION_OPEN) {
+        next = DOOR_MODEL_CLOSING;
+    } else if (run->start_position <= 0) {
+        next = DOOR_MODEL_OPENING;
+    } else {
+        next = run->last_direction == DOOR_MODEL_OPENING ? DOOR_MODEL_CLOSING : DOOR_MODEL_OPENING;
+    }
+    start_motion(door, next, t);
+}
+
+/* ============================================================================
+ * Reed switch
+ * ============================================================================ */
+
+/**
+ * @brief Run that describes the door at time t (the pre-press run until a tentative press registers)
+ */
+static const door_model_run_t* run_for(const door_model_t* door, int64_t t)
+{
+    return (door->press_at_us >= 0 && t < door->press_at_us) ? &door->before_press : &door->run;
+}
+
+static int reed_level(const door_model_t* door, int64_t t)
+{
+    return position_at(run_for(door, t), t) <= door->config.reed_threshold_permille ? 0 : 1;
+}
+
+/**
+ * @brief Time a segment passes the reed threshold, or -1 if it does not
+ */
+static int64_t threshold_crossing_us(const door_model_t* door, int start, door_model_motion_t motion,
+                                     int64_t start_us, int64_t travel_us)
+{
+    int threshold = door->config.reed_threshold_permille;
+    int64_t distance;
+    if (motion == DOOR_MODEL_OPENING && start <= threshold) {
+        distance = threshold - start + 1;
+    } else if (motion == DOOR_MODEL_CLOSING && start > threshold) {
+        distance = start - threshold;
+    } else {
+        return -1;
+    }
+    return start_us + (distance * travel_us + DOOR_MODEL_POSITION_OPEN - 1) / DOOR_MODEL_POSITION_OPEN;
+}
+
+static void schedule_crossing(const door_model_t* door, int64_t crossing_us, int level, int64_t from_us,
+                              int64_t until_us)
+{
+    if (crossing_us > from_us && crossing_us <= until_us) {
+        gpio_hal_sim_schedule_bounce(door->config.reed_gpio, crossing_us, level, door->config.reed_bounce_count,
+                                     door->config.reed_bounce_period_us);
+    }
+}
+
+/**
+ * @brief Schedule the reed switch crossings of a run that fall in (from_us, until_us]
+ */
+static void schedule_run_crossings(const door_model_t* door, const door_model_run_t* run, int64_t from_us,
+                                   int64_t until_us)
+{
+    if (run->motion == DOOR_MODEL_STOPPED) {
+        return;
+    }
+
+    bool reverses = reversal_pending(run);
+    int64_t segment_until = reverses && run->reverse_at_us < until_us ? run->reverse_at_us : until_us;
+    int64_t crossing = threshold_crossing_us(door, run->start_position, run->motion, run->motion_start_us,
+                                             run->travel_us);
+    schedule_crossing(door, crossing, run->motion == DOOR_MODEL_OPENING ? 1 : 0, from_us, segment_until);
+
+    if (reverses) {
+        int turn = position_at(run, run->reverse_at_us);
+        crossing = threshold_crossing_us(door, turn, DOOR_MODEL_OPENING, run->reverse_at_us, run->reverse_travel_us);
+        schedule_crossing(door, crossing, 1, from_us, until_us);
+    }
+}
+
+/**
+ * @brief Replace the reed switch edges from from_us on with the ones the door's runs imply
+ */
+static void reschedule_reed(door_model_t* door, int64_t from_us)
+{
+    int reed = door->config.reed_gpio;
+
+    gpio_hal_sim_cancel_edges(reed, from_us);
+
+    // Pin the level at from_us so a cut-off bounce cannot leave the switch on the wrong side
+    gpio_hal_sim_edge_t settle = { .time_us = from_us, .gpio_num = reed, .level = reed_level(door, from_us) };
+    gpio_hal_sim_schedule_edges(&settle, 1);
+
+    if (door->press_at_us >= 0 && from_us < door->press_at_us) {
+        schedule_run_crossings(door, &door->before_press, from_us, door->press_at_us);
+        schedule_run_crossings(door, &door->run, door->press_at_us, INT64_MAX);
+    } else {
+        schedule_run_crossings(door, &door->run, from_us, INT64_MAX);
+    }
+}
+
+/* ============================================================================
+ * Public API
+ * ============================================================================ */
+
+void door_model_init(door_model_t* door, const door_model_config_t* config, bool start_open)
+{
+    if (door == NULL || config == NULL) {
+        return;
+    }
+
+    memset(door, 0, sizeof(*door));
+    door->config = *config;
+    door->run.motion = DOOR_MODEL_STOPPED;
+    door->run.start_position = start_open ? DOOR_MODEL_POSITION_OPEN : 0;
+    door->run.motion_start_us = gpio_hal_get_time_us();
+    door->run.reverse_at_us = -1;
+    door->run.rng = config->seed != 0 ? config->seed : 0x2545F491u;
+    door->press_at_us = -1;
+
+    gpio_hal_sim_set_input_level(config->reed_gpio, start_open ? 1 : 0);
+}
+
+void door_model_attach(door_model_t* door)
+{
+    gpio_hal_sim_set_output_observer(door_model_on_output, door);
+}
+
+void door_model_on_output(int gpio_num, int level, int64_t time_us, void* ctx)
+{
+    door_model_t* door = (door_model_t*) ctx;
+    if (door == NULL || gpio_num != door->config.relay_gpio) {
+        return;
+    }
+
+    if (level) {
+        // Apply the press as if it will be held long enough; undone on an early release
+        door->before_press = door->run;
+        door->press_at_us = time_us + (int64_t) door->config.min_press_ms * 1000;
+        apply_press(door, door->press_at_us);
+        reschedule_reed(door, time_us);
+        return;
+    }
+
+    if (door->press_at_us >= 0 && time_us < door->press_at_us) {
+        door->run = door->before_press;
+        door->short_presses++;
+        reschedule_reed(door, time_us);
+    }
+    door->press_at_us = -1;
+}
+
+void door_model_set_obstruction(door_model_t* door, bool present)
+{
+    if (door == NULL) {
+        return;
+    }
+
+    int64_t now = gpio_hal_get_time_us();
+    bool press_pending = door->press_at_us >= 0 && now < door->press_at_us;
+    if (press_pending) {
+        door->run = door->before_press;
+    }
+
+    advance(&door->run, now);
+    door->obstructed = present;
+    if (present) {
+        if (door->run.motion == DOOR_MODEL_CLOSING && door->run.reverse_at_us < 0) {
+            int64_t detect_us = now > door->run.motion_start_us ? now : door->run.motion_start_us;
+            schedule_reversal(door, detect_us + (int64_t) door->config.reverse_delay_ms * 1000);
+        }
+    } else if (door->run.reverse_at_us > now) {
+        door->run.reverse_at_us = -1;     // Cleared before the opener reacted
+    }
+
+    if (press_pending) {
+        door->before_press = door->run;
+        apply_press(door, door->press_at_us);
+    }
+    reschedule_reed(door, now);
+}
+
+/**
+ * @brief Fold the run up to now (keeps the counters current) and return the run describing now
+ */
+static const door_model_run_t* current_run(door_model_t* door, int64_t now)
+{
+    if (door->press_at_us < 0 || now >= door->press_at_us) {
+        advance(&door->run, now);
+    }
+    return run_for(door, now);
+}
+
+door_model_motion_t door_model_get_motion(door_model_t* door)
+{
+    if (door == NULL) {
+        return DOOR_MODEL_STOPPED;
+    }
+    int64_t now = gpio_hal_get_time_us();
+    return motion_at(current_run(door, now), now);
+}
+
+int door_model_get_position(door_model_t* door)
+{
+    if (door == NULL) {
+        return 0;
+    }
+    int64_t now = gpio_hal_get_time_us();
+    return position_at(current_run(door, now), now);
+}
+
+bool door_model_is_closed(door_model_t* door)
+{
+    return door_model_get_position(door) == 0;
+}
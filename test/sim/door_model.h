@@ -0,0 +1,162 @@
+/**
+ * @file door_model.h
+ * @brief Physical garage door model for host simulation
+ *
+ * Plugs into the simulated GPIO HAL: it watches the relay output through the
+ * output observer and drives the reed switch input by scheduling edges (with
+ * contact bounce) at the virtual times the magnet passes the switch. The door
+ * travels with per-run variance, a closing door reverses to fully open when
+ * obstructed, and the opener needs a minimum press length and can be set to
+ * ignore, reverse on or stop on presses while the door is moving. A door
+ * stopped part way moves against its last direction on the next press.
+ *
+ * Position is in permille of full travel: 0 = closed, 1000 = fully open.
+ */
+
+#ifndef DOOR_MODEL_H
+#define DOOR_MODEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DOOR_MODEL_POSITION_OPEN 1000
+
+/**
+ * @brief Door motion
+ */
+typedef enum {
+    DOOR_MODEL_STOPPED = 0,     // At rest (fully closed or fully open)
+    DOOR_MODEL_OPENING,
+    DOOR_MODEL_CLOSING
+} door_model_motion_t;
+
+/**
+ * @brief What the opener does with a press while the door is moving
+ */
+typedef enum {
+    DOOR_MODEL_PRESS_IGNORED = 0,
+    DOOR_MODEL_PRESS_REVERSES,
+    DOOR_MODEL_PRESS_STOPS          // Press cycle open -> stop -> close -> stop
+} door_model_press_action_t;
+
+/**
+ * @brief Door and opener parameters
+ */
+typedef struct {
+    int relay_gpio;                 // Output watched for button presses
+    int reed_gpio;                  // Input driven by the door (0 = closed, pull-up when open)
+    int open_travel_ms;             // Nominal full-travel time upwards
+    int close_travel_ms;            // Nominal full-travel time downwards
+    int travel_variance_pct;        // Each run is nominal +/- up to this percentage
+    int min_press_ms;               // Shorter relay closures are not registered by the opener
+    door_model_press_action_t press_while_moving;
+    int reed_threshold_permille;    // Reed switch is closed while position <= this
+    int reed_bounce_count;          // Contact toggles before the reed switch settles
+    int reed_bounce_period_us;      // Spacing of the bounce toggles
+    int reverse_delay_ms;           // Obstruction detected -> door reverses
+    uint32_t seed;                  // Travel variance random seed (0 picks a fixed default)
+} door_model_config_t;
+
+/**
+ * @brief Current run of the door and everything a press can change
+ */
+typedef struct {
+    door_model_motion_t motion;
+    door_model_motion_t last_direction; // OPENING or CLOSING: the most recent motion
+    int start_position;             // Position when the current motion started
+    int64_t motion_start_us;        // Virtual time the current motion started (may be ahead of now)
+    int64_t travel_us;              // Full-travel time drawn for the current motion
+    int64_t reverse_at_us;          // Pending obstruction reversal, -1 if none
+    int64_t reverse_travel_us;      // Full-travel time drawn for the reopening run
+    uint32_t rng;                   // Travel variance generator state
+    uint32_t presses;               // Presses registered by the opener
+    uint32_t ignored_presses;       // Registered presses ignored mid-travel
+    uint32_t stops;                 // Registered presses that stopped the door mid-travel
+    uint32_t reversals;             // Obstruction reversals (folded in by the getters)
+} door_model_run_t;
+
+/**
+ * @brief Door model state
+ *
+ * A relay closure is applied tentatively min_press_ms after it starts so the
+ * reed switch edges of the resulting motion can be scheduled ahead of time;
+ * if the relay opens earlier the run is restored from before_press.
+ */
+typedef struct {
+    door_model_config_t config;
+    door_model_run_t run;
+    door_model_run_t before_press;  // Run before the tentative press
+    int64_t press_at_us;            // Tentative press registration time, -1 if none pending
+    bool obstructed;
+    uint32_t short_presses;         // Relay closures shorter than min_press_ms
+} door_model_t;
+
+/**
+ * @brief Default parameters: 12 s up, 13 s down, +/-5%, 50 ms press, presses ignored mid-travel
+ * @param relay_gpio Relay output
+ * @param reed_gpio Reed switch input
+ * @return Configuration
+ */
+door_model_config_t door_model_default_config(int relay_gpio, int reed_gpio);
+
+/**
+ * @brief Initialize the door at rest and set the reed switch level to match
+ * @param door Door model
+ * @param config Parameters (copied)
+ * @param start_open true to start fully open, false to start closed
+ */
+void door_model_init(door_model_t* door, const door_model_config_t* config, bool start_open);
+
+/**
+ * @brief Register the door as the simulated GPIO output observer
+ * @param door Door model (must outlive the attachment)
+ */
+void door_model_attach(door_model_t* door);
+
+/**
+ * @brief Output observer entry point (called by the GPIO sim on relay changes)
+ */
+void door_model_on_output(int gpio_num, int level, int64_t time_us, void* ctx);
+
+/**
+ * @brief Place or remove an obstruction at the current virtual time
+ *
+ * A closing door reverses to fully open reverse_delay_ms after the obstruction
+ * is detected; a door that starts closing while obstructed reverses
+ * reverse_delay_ms after it starts.
+ *
+ * @param door Door model
+ * @param present true while something blocks the door
+ */
+void door_model_set_obstruction(door_model_t* door, bool present);
+
+/**
+ * @brief Get the door motion at the current virtual time
+ * @param door Door model
+ * @return Motion
+ */
+door_model_motion_t door_model_get_motion(door_model_t* door);
+
+/**
+ * @brief Get the door position at the current virtual time
+ * @param door Door model
+ * @return Position in permille (0 closed, 1000 open)
+ */
+int door_model_get_position(door_model_t* door);
+
+/**
+ * @brief Check whether the door is fully closed at the current virtual time
+ * @param door Door model
+ * @return true if closed
+ */
+bool door_model_is_closed(door_model_t* door);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DOOR_MODEL_H
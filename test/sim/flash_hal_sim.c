@@ -0,0 +1,141 @@
+/**
+ * @file flash_hal_sim.c
+ * @brief Simulated NOR flash partition implementation
+ */
+
+#include "flash_hal_sim.h"
+#include <stdbool.h>
+#include <string.h>
+
+#define SIM_SECTORS (FLASH_HAL_SIM_MAX_SIZE / FLASH_HAL_SECTOR_SIZE)
+
+static uint8_t s_image[FLASH_HAL_SIM_MAX_SIZE];
+static uint32_t s_size = FLASH_HAL_SIM_MAX_SIZE;
+static uint32_t s_erase_counts[SIM_SECTORS];
+static uint32_t s_write_count = 0;
+static uint32_t s_violations = 0;
+static bool s_power_limited = false;
+static uint32_t s_power_budget = 0;     // Bytes left before the cut
+static bool s_power_off = false;
+
+void flash_hal_sim_reset(uint32_t size)
+{
+    if (size == 0 || size > FLASH_HAL_SIM_MAX_SIZE) {
+        size = FLASH_HAL_SIM_MAX_SIZE;
+    }
+    s_size = size - size % FLASH_HAL_SECTOR_SIZE;
+    memset(s_image, 0xFF, sizeof(s_image));
+    memset(s_erase_counts, 0, sizeof(s_erase_counts));
+    s_write_count = 0;
+    s_violations = 0;
+    s_power_limited = false;
+    s_power_off = false;
+}
+
+uint8_t* flash_hal_sim_image(void)
+{
+    return s_image;
+}
+
+uint32_t flash_hal_sim_size(void)
+{
+    return s_size;
+}
+
+uint32_t flash_hal_sim_erase_count(uint32_t sector)
+{
+    return sector < SIM_SECTORS ? s_erase_counts[sector] : 0;
+}
+
+uint32_t flash_hal_sim_write_count(void)
+{
+    return s_write_count;
+}
+
+uint32_t flash_hal_sim_violations(void)
+{
+    return s_violations;
+}
+
+void flash_hal_sim_cut_power_after(uint32_t bytes)
+{
+    s_power_limited = true;
+    s_power_budget = bytes;
+}
+
+void flash_hal_sim_power_on(void)
+{
+    s_power_limited = false;
+    s_power_off = false;
+}
+
+static bool in_range(uint32_t offset, size_t len)
+{
+    return offset <= s_size && len <= s_size - offset;
+}
+
+/* ============================================================================
+ * flash_hal_interface.h implementation
+ * ============================================================================ */
+
+esp_err_t flash_hal_open(const char* label, uint32_t* size)
+{
+    if (label == NULL || strcmp(label, FLASH_HAL_SIM_LABEL) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (size != NULL) {
+        *size = s_size;
+    }
+    return ESP_OK;
+}
+
+esp_err_t flash_hal_read(uint32_t offset, void* buf, size_t len)
+{
+    if (buf == NULL || !in_range(offset, len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(buf, s_image + offset, len);
+    return ESP_OK;
+}
+
+esp_err_t flash_hal_write(uint32_t offset, const void* buf, size_t len)
+{
+    if (buf == NULL || !in_range(offset, len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_power_off) {
+        return ESP_FAIL;
+    }
+    s_write_count++;
+
+    size_t programmed = len;
+    if (s_power_limited && len > s_power_budget) {
+        programmed = s_power_budget;
+        s_power_off = true;
+    }
+    if (s_power_limited) {
+        s_power_budget -= (uint32_t) programmed;
+    }
+
+    const uint8_t* data = (const uint8_t*) buf;
+    for (size_t i = 0; i < programmed; i++) {
+        if ((data[i] & ~s_image[offset + i]) != 0) {
+            s_violations++;
+        }
+        s_image[offset + i] &= data[i];
+    }
+    return s_power_off ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t flash_hal_erase_sector(uint32_t offset)
+{
+    if (offset % FLASH_HAL_SECTOR_SIZE != 0 || !in_range(offset, FLASH_HAL_SECTOR_SIZE)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_power_off) {
+        return ESP_FAIL;
+    }
+    memset(s_image + offset, 0xFF, FLASH_HAL_SECTOR_SIZE);
+    s_erase_counts[offset / FLASH_HAL_SECTOR_SIZE]++;
+    return ESP_OK;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file flash_hal_sim.h
+ * @brief Simulated NOR flash partition for host tests
+ *
+ * Implements flash_hal_interface.h on a RAM image. Programming ANDs the data
+ * into the image like real NOR flash, and a write that would need to set a
+ * bit is counted as a violation so tests can prove the caller always erases
+ * first. Per-sector erase counts show how evenly wear is spread, and a power
+ * cut can be injected to leave a write half done.
+ */
+
+#ifndef FLASH_HAL_SIM_H
+#define FLASH_HAL_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "flash_hal_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLASH_HAL_SIM_MAX_SIZE      (64 * 1024)
+#define FLASH_HAL_SIM_LABEL         "history"
+
+/**
+ * @brief Reset to an erased partition of the given size (counts cleared)
+ * @param size Partition size, a multiple of FLASH_HAL_SECTOR_SIZE up to FLASH_HAL_SIM_MAX_SIZE
+ */
+void flash_hal_sim_reset(uint32_t size);
+
+/**
+ * @brief Get the partition image (tests may corrupt it directly)
+ * @return Image of flash_hal_sim_size() bytes
+ */
+uint8_t* flash_hal_sim_image(void);
+
+/**
+ * @brief Get the partition size
+ * @return Bytes
+ */
+uint32_t flash_hal_sim_size(void);
+
+/**
+ * @brief Get how often a sector has been erased since reset
+ * @param sector Sector index
+ * @return Erase count
+ */
+uint32_t flash_hal_sim_erase_count(uint32_t sector);
+
+/**
+ * @brief Get the number of flash_hal_write() calls since reset
+ * @return Write count
+ */
+uint32_t flash_hal_sim_write_count(void);
+
+/**
+ * @brief Get the number of writes that tried to set an already cleared bit
+ * @return Violation count
+ */
+uint32_t flash_hal_sim_violations(void);
+
+/**
+ * @brief Cut the power part way through a future write
+ *
+ * The write that brings the total programmed bytes past the limit stores
+ * only the bytes up to it and fails, as do all later writes and erases,
+ * until the next flash_hal_sim_power_on().
+ *
+ * @param bytes Bytes that may still be programmed
+ */
+void flash_hal_sim_cut_power_after(uint32_t bytes);
+
+/**
+ * @brief Restore power (the image is kept)
+ */
+void flash_hal_sim_power_on(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLASH_HAL_SIM_H
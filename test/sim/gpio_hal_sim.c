@@ -0,0 +1,303 @@
+/**
+ * @file gpio_hal_sim.c
+ * @brief Simulated GPIO HAL implementation on a virtual microsecond clock
+ *
+ * Single-threaded by design: ISRs run synchronously inside gpio_hal_sim_advance_to(),
+ * in timestamp order, exactly like edges arriving on a single-core part.
+ */
+
+#include "gpio_hal_sim.h"
+#include <string.h>
+
+typedef struct {
+    int level;
+    bool is_output;
+    gpio_hal_edge_t edge;
+    gpio_hal_isr_t handler;
+    void* handler_arg;
+    uint32_t isr_count;
+} sim_pin_t;
+
+static sim_pin_t s_pins[GPIO_HAL_SIM_MAX_PINS];
+static int64_t s_now_us = 0;
+static bool s_isr_service_installed = false;
+
+// Pending scripted edges, sorted by time; [s_sched_head, s_sched_count) are live
+static gpio_hal_sim_edge_t s_scheduled[GPIO_HAL_SIM_MAX_SCHEDULED];
+static size_t s_sched_head = 0;
+static size_t s_sched_count = 0;
+
+static gpio_hal_sim_edge_t s_recorded[GPIO_HAL_SIM_MAX_RECORDED];
+static size_t s_recorded_count = 0;
+
+static gpio_hal_sim_output_cb_t s_output_cb = NULL;
+static void* s_output_ctx = NULL;
+
+static bool valid_pin(int gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < GPIO_HAL_SIM_MAX_PINS;
+}
+
+/* ============================================================================
+ * gpio_hal_interface.h implementation
+ * ============================================================================ */
+
+esp_err_t gpio_hal_config_output(uint32_t pin_bit_mask)
+{
+    for (int i = 0; i < GPIO_HAL_SIM_MAX_PINS; i++) {
+        if (pin_bit_mask & (1u << i)) {
+            s_pins[i].is_output = true;
+            s_pins[i].edge = GPIO_HAL_EDGE_NONE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_hal_config_input(uint32_t pin_bit_mask, gpio_hal_edge_t edge, bool pull_up)
+{
+    for (int i = 0; i < GPIO_HAL_SIM_MAX_PINS; i++) {
+        if (pin_bit_mask & (1u << i)) {
+            s_pins[i].is_output = false;
+            s_pins[i].edge = edge;
+            if (pull_up) {
+                s_pins[i].level = 1;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_hal_install_isr_service(void)
+{
+    s_isr_service_installed = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_hal_isr_handler_add(int gpio_num, gpio_hal_isr_t handler, void* arg)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_isr_service_installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_pins[gpio_num].handler = handler;
+    s_pins[gpio_num].handler_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_hal_set_level(int gpio_num, int level)
+{
+    if (!valid_pin(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    level = level ? 1 : 0;
+    if (s_pins[gpio_num].level == level) {
+        return ESP_OK;
+    }
+    s_pins[gpio_num].level = level;
+
+    if (s_recorded_count < GPIO_HAL_SIM_MAX_RECORDED) {
+        s_recorded[s_recorded_count].time_us = s_now_us;
+        s_recorded[s_recorded_count].gpio_num = gpio_num;
+        s_recorded[s_recorded_count].level = level;
+        s_recorded_count++;
+    }
+    if (s_output_cb != NULL) {
+        s_output_cb(gpio_num, level, s_now_us, s_output_ctx);
+    }
+    return ESP_OK;
+}
+
+int gpio_hal_get_level(int gpio_num)
+{
+    return valid_pin(gpio_num) ? s_pins[gpio_num].level : 0;
+}
+
+int64_t gpio_hal_get_time_us(void)
+{
+    return s_now_us;
+}
+
+/* ============================================================================
+ * Simulation control
+ * ============================================================================ */
+
+void gpio_hal_sim_reset(void)
+{
+    memset(s_pins, 0, sizeof(s_pins));
+    s_now_us = 0;
+    s_isr_service_installed = false;
+    s_sched_head = 0;
+    s_sched_count = 0;
+    s_recorded_count = 0;
+    s_output_cb = NULL;
+    s_output_ctx = NULL;
+}
+
+void gpio_hal_sim_set_input_level(int gpio_num, int level)
+{
+    if (valid_pin(gpio_num)) {
+        s_pins[gpio_num].level = level ? 1 : 0;
+    }
+}
+
+/**
+ * @brief Insert one edge after any pending edge with the same or an earlier timestamp
+ */
+static void insert_edge(const gpio_hal_sim_edge_t* edge)
+{
+    size_t lo = s_sched_head;
+    size_t hi = s_sched_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (s_scheduled[mid].time_us <= edge->time_us) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    memmove(&s_scheduled[lo + 1], &s_scheduled[lo], (s_sched_count - lo) * sizeof(s_scheduled[0]));
+    s_scheduled[lo] = *edge;
+    s_sched_count++;
+}
+
+esp_err_t gpio_hal_sim_schedule_edges(const gpio_hal_sim_edge_t* edges, size_t count)
+{
+    if (edges == NULL && count > 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (gpio_hal_sim_pending_edges() + count > GPIO_HAL_SIM_MAX_SCHEDULED) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Compact so that every new edge fits behind the live window
+    if (s_sched_head > 0) {
+        memmove(&s_scheduled[0], &s_scheduled[s_sched_head],
+                (s_sched_count - s_sched_head) * sizeof(s_scheduled[0]));
+        s_sched_count -= s_sched_head;
+        s_sched_head = 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (!valid_pin(edges[i].gpio_num)) {
+            continue;
+        }
+        insert_edge(&edges[i]);
+    }
+    return ESP_OK;
+}
+
+int64_t gpio_hal_sim_schedule_bounce(int gpio_num, int64_t start_us, int final_level,
+                                     int bounce_count, int64_t bounce_period_us)
+{
+    if (bounce_count < 0) {
+        bounce_count = 0;
+    }
+    if ((size_t) bounce_count + 1 > GPIO_HAL_SIM_MAX_SCHEDULED - gpio_hal_sim_pending_edges()) {
+        return -1;
+    }
+
+    // Toggles alternate so that the contact lands on final_level after the last one
+    gpio_hal_sim_edge_t edge = { .time_us = start_us, .gpio_num = gpio_num, .level = 0 };
+    int level = (bounce_count % 2 == 0) ? final_level : !final_level;
+    for (int i = 0; i <= bounce_count; i++) {
+        edge.level = (i == bounce_count) ? final_level : level;
+        if (gpio_hal_sim_schedule_edges(&edge, 1) != ESP_OK) {
+            return -1;
+        }
+        level = !level;
+        edge.time_us += bounce_period_us;
+    }
+    return start_us + (int64_t) bounce_count * bounce_period_us;
+}
+
+size_t gpio_hal_sim_cancel_edges(int gpio_num, int64_t from_us)
+{
+    size_t kept = s_sched_head;
+    for (size_t i = s_sched_head; i < s_sched_count; i++) {
+        if (s_scheduled[i].gpio_num == gpio_num && s_scheduled[i].time_us >= from_us) {
+            continue;
+        }
+        s_scheduled[kept++] = s_scheduled[i];
+    }
+    size_t dropped = s_sched_count - kept;
+    s_sched_count = kept;
+    return dropped;
+}
+
+static bool edge_raises_interrupt(gpio_hal_edge_t edge, int old_level, int new_level)
+{
+    switch (edge) {
+        case GPIO_HAL_EDGE_RISING:  return old_level == 0 && new_level == 1;
+        case GPIO_HAL_EDGE_FALLING: return old_level == 1 && new_level == 0;
+        case GPIO_HAL_EDGE_ANY:     return old_level != new_level;
+        case GPIO_HAL_EDGE_NONE:
+        default:                    return false;
+    }
+}
+
+void gpio_hal_sim_advance_to(int64_t time_us)
+{
+    while (s_sched_head < s_sched_count && s_scheduled[s_sched_head].time_us <= time_us) {
+        gpio_hal_sim_edge_t edge = s_scheduled[s_sched_head++];
+        sim_pin_t* pin = &s_pins[edge.gpio_num];
+        int new_level = edge.level ? 1 : 0;
+        int old_level = pin->level;
+
+        if (edge.time_us > s_now_us) {
+            s_now_us = edge.time_us;
+        }
+        pin->level = new_level;
+
+        if (pin->handler != NULL && edge_raises_interrupt(pin->edge, old_level, new_level)) {
+            pin->isr_count++;
+            pin->handler(pin->handler_arg);
+        }
+    }
+
+    if (s_sched_head == s_sched_count) {
+        s_sched_head = 0;
+        s_sched_count = 0;
+    }
+    if (time_us > s_now_us) {
+        s_now_us = time_us;
+    }
+}
+
+void gpio_hal_sim_advance_by(int64_t delta_us)
+{
+    gpio_hal_sim_advance_to(s_now_us + delta_us);
+}
+
+size_t gpio_hal_sim_pending_edges(void)
+{
+    return s_sched_count - s_sched_head;
+}
+
+int64_t gpio_hal_sim_next_edge_time(void)
+{
+    return (s_sched_head < s_sched_count) ? s_scheduled[s_sched_head].time_us : -1;
+}
+
+uint32_t gpio_hal_sim_isr_count(int gpio_num)
+{
+    return valid_pin(gpio_num) ? s_pins[gpio_num].isr_count : 0;
+}
+
+size_t gpio_hal_sim_output_edge_count(void)
+{
+    return s_recorded_count;
+}
+
+const gpio_hal_sim_edge_t* gpio_hal_sim_output_edge(size_t index)
+{
+    return (index < s_recorded_count) ? &s_recorded[index] : NULL;
+}
+
+void gpio_hal_sim_set_output_observer(gpio_hal_sim_output_cb_t callback, void* ctx)
+{
+    s_output_cb = callback;
+    s_output_ctx = ctx;
+}
@@ -0,0 +1,147 @@
+/**
+ * @file gpio_hal_sim.h
+ * @brief Simulated GPIO HAL for host tests and benchmarks
+ *
+ * Implements gpio_hal_interface.h on a virtual microsecond clock. Input edges
+ * are scripted with exact timestamps and delivered to the registered ISR in
+ * time order as the clock is advanced; output level changes (e.g. the relay)
+ * are recorded with the virtual time at which they happened.
+ */
+
+#ifndef GPIO_HAL_SIM_H
+#define GPIO_HAL_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "gpio_hal_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPIO_HAL_SIM_MAX_PINS           17      // GPIO0..GPIO16 on the ESP8266
+#define GPIO_HAL_SIM_MAX_SCHEDULED      4096    // Pending scripted input edges
+#define GPIO_HAL_SIM_MAX_RECORDED       1024    // Recorded output edges
+
+/**
+ * @brief A level change on a pin at a virtual timestamp
+ */
+typedef struct {
+    int64_t time_us;    // Virtual time of the change
+    int gpio_num;       // GPIO number
+    int level;          // Level after the change (0 or 1)
+} gpio_hal_sim_edge_t;
+
+/**
+ * @brief Observer for output level changes (e.g. a door model watching the relay)
+ * @param gpio_num GPIO number that changed
+ * @param level New level
+ * @param time_us Virtual time of the change
+ * @param ctx Context passed to gpio_hal_sim_set_output_observer()
+ */
+typedef void (*gpio_hal_sim_output_cb_t)(int gpio_num, int level, int64_t time_us, void* ctx);
+
+/**
+ * @brief Reset all pins, handlers, scripts and recordings; the clock restarts at 0
+ */
+void gpio_hal_sim_reset(void);
+
+/**
+ * @brief Set a pin level immediately without raising an interrupt (initial conditions)
+ * @param gpio_num GPIO number
+ * @param level Level (0 or 1)
+ */
+void gpio_hal_sim_set_input_level(int gpio_num, int level);
+
+/**
+ * @brief Script input edges; they may be given in any order and are merged with pending ones
+ * @param edges Edges to schedule (timestamps in the past are applied on the next advance)
+ * @param count Number of edges
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the script is full (nothing is scheduled)
+ */
+esp_err_t gpio_hal_sim_schedule_edges(const gpio_hal_sim_edge_t* edges, size_t count);
+
+/**
+ * @brief Script a bouncing transition to a final level
+ *
+ * Schedules bounce_count toggles spaced bounce_period_us apart starting at
+ * start_us, followed by the settled final level.
+ *
+ * @param gpio_num GPIO number
+ * @param start_us Virtual time of the first edge
+ * @param final_level Level once the contact settles
+ * @param bounce_count Number of toggles before settling (0 for a clean edge)
+ * @param bounce_period_us Spacing between edges in microseconds
+ * @return Virtual time of the settling edge, or -1 if the script is full
+ */
+int64_t gpio_hal_sim_schedule_bounce(int gpio_num, int64_t start_us, int final_level,
+                                     int bounce_count, int64_t bounce_period_us);
+
+/**
+ * @brief Drop scripted edges for a pin that have not been delivered yet
+ *
+ * Lets a model revise its future (e.g. a closing door that reverses before
+ * it reaches the reed switch).
+ *
+ * @param gpio_num GPIO number
+ * @param from_us Only edges at or after this virtual time are dropped
+ * @return Number of edges dropped
+ */
+size_t gpio_hal_sim_cancel_edges(int gpio_num, int64_t from_us);
+
+/**
+ * @brief Advance the virtual clock, delivering every scripted edge due up to time_us
+ * @param time_us Target virtual time (ignored if in the past)
+ */
+void gpio_hal_sim_advance_to(int64_t time_us);
+
+/**
+ * @brief Advance the virtual clock by a relative amount
+ * @param delta_us Microseconds to advance
+ */
+void gpio_hal_sim_advance_by(int64_t delta_us);
+
+/**
+ * @brief Get the number of scripted edges not yet delivered
+ * @return Pending edge count
+ */
+size_t gpio_hal_sim_pending_edges(void);
+
+/**
+ * @brief Get the virtual time of the next scripted edge
+ * @return Timestamp in microseconds, or -1 if nothing is scheduled
+ */
+int64_t gpio_hal_sim_next_edge_time(void);
+
+/**
+ * @brief Get the number of ISR invocations for a pin since reset
+ * @param gpio_num GPIO number
+ * @return Interrupt count
+ */
+uint32_t gpio_hal_sim_isr_count(int gpio_num);
+
+/**
+ * @brief Get the number of recorded output edges since reset
+ * @return Recorded edge count (capped at GPIO_HAL_SIM_MAX_RECORDED)
+ */
+size_t gpio_hal_sim_output_edge_count(void);
+
+/**
+ * @brief Get a recorded output edge
+ * @param index Index in recording order
+ * @return Pointer to the edge, or NULL if out of range
+ */
+const gpio_hal_sim_edge_t* gpio_hal_sim_output_edge(size_t index);
+
+/**
+ * @brief Register an observer for output level changes
+ * @param callback Observer (NULL to remove)
+ * @param ctx Context passed to the observer
+ */
+void gpio_hal_sim_set_output_observer(gpio_hal_sim_output_cb_t callback, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GPIO_HAL_SIM_H
@@ -0,0 +1,199 @@
+/**
+ * @file mqtt_hal_sim.c
+ * @brief Simulated MQTT HAL implementation.
+ */
+
+#include "mqtt_hal_sim.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+// Stands in for the client the SDK would allocate; only its address is used
+static int s_client_storage;
+#define SIM_CLIENT ((esp_mqtt_client_handle_t) (void*) &s_client_storage)
+
+static esp_event_handler_t s_handler = NULL;
+static void* s_handler_arg = NULL;
+static int s_next_msg_id = 1;
+static bool s_echo = false;
+static mqtt_hal_sim_stats_t s_stats;
+static uint32_t s_time_ms = 0;
+static uint32_t s_heap_free = 0;
+static uint32_t s_heap_min_free = 0;
+
+void mqtt_hal_sim_reset(void)
+{
+    s_handler = NULL;
+    s_handler_arg = NULL;
+    s_next_msg_id = 1;
+    s_time_ms = 0;
+    s_heap_free = 0;
+    s_heap_min_free = 0;
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+void mqtt_hal_sim_set_echo(bool enabled)
+{
+    s_echo = enabled;
+}
+
+void mqtt_hal_sim_set_time_ms(uint32_t ms)
+{
+    s_time_ms = ms;
+}
+
+void mqtt_hal_sim_set_heap(uint32_t free_bytes, uint32_t min_free_bytes)
+{
+    s_heap_free = free_bytes;
+    s_heap_min_free = min_free_bytes;
+}
+
+esp_err_t mqtt_hal_sim_dispatch(esp_mqtt_event_t* event)
+{
+    if (s_handler == NULL || event == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    event->client = SIM_CLIENT;
+    s_handler(s_handler_arg, "MQTT_EVENTS", event->event_id, event);
+    return ESP_OK;
+}
+
+const mqtt_hal_sim_stats_t* mqtt_hal_sim_get_stats(void)
+{
+    return &s_stats;
+}
+
+/* ============================================================================
+ * MQTT HAL Implementation
+ * ============================================================================ */
+
+esp_mqtt_client_handle_t mqtt_hal_client_init(const esp_mqtt_client_config_t *config)
+{
+    if (config == NULL) {
+        return NULL;
+    }
+    s_stats.config = *config;
+    return SIM_CLIENT;
+}
+
+esp_err_t mqtt_hal_client_start(esp_mqtt_client_handle_t client)
+{
+    if (client == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_stats.starts++;
+    return ESP_OK;
+}
+
+int mqtt_hal_client_publish(esp_mqtt_client_handle_t client,
+                             const char *topic,
+                             const char *data,
+                             int len,
+                             int qos,
+                             int retain)
+{
+    if (client == NULL || topic == NULL) {
+        return -1;
+    }
+    if (data == NULL) {
+        data = "";
+    }
+    size_t data_len = len > 0 ? (size_t) len : strlen(data);
+    if (data_len >= sizeof(s_stats.last_data)) {
+        data_len = sizeof(s_stats.last_data) - 1;
+    }
+
+    snprintf(s_stats.last_topic, sizeof(s_stats.last_topic), "%s", topic);
+    memcpy(s_stats.last_data, data, data_len);
+    s_stats.last_data[data_len] = '\0';
+    s_stats.last_len = data_len;
+    s_stats.last_qos = qos;
+    s_stats.last_retain = retain;
+    s_stats.publishes++;
+    return qos > 0 ? s_next_msg_id++ : 0;
+}
+
+int mqtt_hal_client_subscribe(esp_mqtt_client_handle_t client,
+                               const char *topic,
+                               int qos)
+{
+    if (client == NULL || topic == NULL) {
+        return -1;
+    }
+    s_stats.subscribes++;
+    return s_next_msg_id++;
+}
+
+esp_err_t mqtt_hal_client_register_event(esp_mqtt_client_handle_t client,
+                                          esp_mqtt_event_id_t event,
+                                          esp_event_handler_t event_handler,
+                                          void* event_handler_arg)
+{
+    if (client == NULL || event_handler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_handler = event_handler;
+    s_handler_arg = event_handler_arg;
+    return ESP_OK;
+}
+
+/* ============================================================================
+ * System HAL Implementation
+ * ============================================================================ */
+
+uint32_t mqtt_hal_time_ms(void)
+{
+    return s_time_ms;
+}
+
+uint32_t mqtt_hal_heap_free(void)
+{
+    return s_heap_free;
+}
+
+uint32_t mqtt_hal_heap_min_free(void)
+{
+    return s_heap_min_free;
+}
+
+/* ============================================================================
+ * Logging HAL Implementation
+ * ============================================================================ */
+
+static void sim_log(const char* level, const char* tag, const char* format, va_list args)
+{
+    char buffer[MQTT_HAL_SIM_LOG_BUFFER_SIZE];
+    int written = vsnprintf(buffer, sizeof(buffer), format, args);
+    s_stats.log_lines++;
+    if (written > 0) {
+        s_stats.log_bytes += (uint64_t) written;
+    }
+    if (s_echo) {
+        printf("%s (%s): %s\n", level, tag, buffer);
+    }
+}
+
+void mqtt_hal_log_info(const char* tag, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    sim_log("I", tag, format, args);
+    va_end(args);
+}
+
+void mqtt_hal_log_error(const char* tag, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    sim_log("E", tag, format, args);
+    va_end(args);
+}
+
+void mqtt_hal_log_debug(const char* tag, const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    sim_log("D", tag, format, args);
+    va_end(args);
+}
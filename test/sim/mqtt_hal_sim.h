@@ -0,0 +1,88 @@
+/**
+ * @file mqtt_hal_sim.h
+ * @brief Simulated MQTT HAL for host tests, fuzzing and benchmarks
+ *
+ * Implements mqtt_hal_interface.h without a broker. The event handler that
+ * mqtt_impl.c registers is kept so events can be dispatched to it as the
+ * esp-mqtt event loop would; publishes and subscribes are counted and the
+ * last publish is kept, as is the client configuration. The clock and heap
+ * figures that mqtt_impl.c samples around a connection are set by the test. Log calls are formatted into a fixed buffer exactly
+ * as the production HAL does, so %.*s handling is exercised, but nothing is
+ * printed unless echo is enabled.
+ */
+
+#ifndef MQTT_HAL_SIM_H
+#define MQTT_HAL_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mqtt_hal_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MQTT_HAL_SIM_LOG_BUFFER_SIZE    256     // Same as the production HAL
+#define MQTT_HAL_SIM_MAX_TOPIC          128     // Longest recorded publish topic
+#define MQTT_HAL_SIM_MAX_DATA           256     // Longest recorded publish payload
+
+/**
+ * @brief Counters and the last publish
+ */
+typedef struct {
+    uint32_t starts;
+    uint32_t publishes;
+    uint32_t subscribes;
+    uint32_t log_lines;
+    uint64_t log_bytes;                         // Formatted log output, before truncation
+    char last_topic[MQTT_HAL_SIM_MAX_TOPIC];
+    char last_data[MQTT_HAL_SIM_MAX_DATA];      // NUL-terminated after last_len bytes
+    size_t last_len;
+    int last_qos;
+    int last_retain;
+    esp_mqtt_client_config_t config;            // Passed to the last client init
+} mqtt_hal_sim_stats_t;
+
+/**
+ * @brief Forget the registered handler and clear the counters
+ */
+void mqtt_hal_sim_reset(void);
+
+/**
+ * @brief Print formatted log lines to stdout
+ * @param enabled true to print
+ */
+void mqtt_hal_sim_set_echo(bool enabled);
+
+/**
+ * @brief Set the time returned by mqtt_hal_time_ms()
+ * @param ms Milliseconds since boot
+ */
+void mqtt_hal_sim_set_time_ms(uint32_t ms);
+
+/**
+ * @brief Set the figures returned by mqtt_hal_heap_free() and mqtt_hal_heap_min_free()
+ * @param free_bytes Free heap now
+ * @param min_free_bytes Lowest free heap since boot
+ */
+void mqtt_hal_sim_set_heap(uint32_t free_bytes, uint32_t min_free_bytes);
+
+/**
+ * @brief Deliver an event to the registered handler, as the esp-mqtt event loop would
+ * @param event Event (its client field is filled in)
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if no handler is registered
+ */
+esp_err_t mqtt_hal_sim_dispatch(esp_mqtt_event_t* event);
+
+/**
+ * @brief Get the counters and the last publish
+ * @return Statistics
+ */
+const mqtt_hal_sim_stats_t* mqtt_hal_sim_get_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MQTT_HAL_SIM_H
@@ -0,0 +1,73 @@
+/**
+ * @file scenario_sim.c
+ * @brief Virtual-time scenario runner hooks for the host
+ */
+
+#include "scenario_sim.h"
+#include "gpio_hal_sim.h"
+#include <stddef.h>
+
+void scenario_sim_init(scenario_sim_t* sim, garage_controller_t* ctrl)
+{
+    sim->ctrl = ctrl;
+    sim->next_tick_us = gpio_hal_get_time_us() + SCENARIO_SIM_TICK_MS * 1000;
+    sim->inputs_injected = 0;
+}
+
+void scenario_sim_wait_ms(scenario_sim_t* sim, int delay_ms)
+{
+    int64_t target_us = gpio_hal_get_time_us() + (int64_t) delay_ms * 1000;
+    while (sim->next_tick_us <= target_us) {
+        gpio_hal_sim_advance_to(sim->next_tick_us);
+        garage_controller_tick(sim->ctrl, SCENARIO_SIM_TICK_MS);
+        sim->next_tick_us += SCENARIO_SIM_TICK_MS * 1000;
+    }
+    gpio_hal_sim_advance_to(target_us);
+}
+
+static void sim_inject(garage_input_t input, void* ctx)
+{
+    scenario_sim_t* sim = (scenario_sim_t*) ctx;
+    sim->inputs_injected++;
+    garage_controller_handle_input(sim->ctrl, input);
+}
+
+static void sim_wait_ms(int delay_ms, void* ctx)
+{
+    scenario_sim_wait_ms((scenario_sim_t*) ctx, delay_ms);
+}
+
+static int64_t sim_now_us(void* ctx)
+{
+    (void) ctx;
+    return gpio_hal_get_time_us();
+}
+
+static garage_state_t sim_get_state(void* ctx)
+{
+    return garage_controller_get_state(((scenario_sim_t*) ctx)->ctrl);
+}
+
+static int64_t sim_last_transition_us(void* ctx)
+{
+    return garage_controller_get_last_transition_us(((scenario_sim_t*) ctx)->ctrl);
+}
+
+static uint32_t sim_transition_count(void* ctx)
+{
+    return garage_controller_get_transition_count(((scenario_sim_t*) ctx)->ctrl);
+}
+
+garage_scenario_ops_t scenario_sim_ops(scenario_sim_t* sim)
+{
+    garage_scenario_ops_t ops = {
+        .inject = sim_inject,
+        .wait_ms = sim_wait_ms,
+        .now_us = sim_now_us,
+        .get_state = sim_get_state,
+        .last_transition_us = sim_last_transition_us,
+        .transition_count = sim_transition_count,
+        .ctx = sim,
+    };
+    return ops;
+}
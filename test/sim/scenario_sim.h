@@ -0,0 +1,56 @@
+/**
+ * @file scenario_sim.h
+ * @brief Virtual-time scenario runner hooks for the host
+ *
+ * Drives a garage_controller_t on the simulated GPIO clock: injected inputs are
+ * handled immediately and waits advance the clock in 100 ms controller ticks,
+ * matching the production timer period, so a 16 s step costs microseconds.
+ */
+
+#ifndef SCENARIO_SIM_H
+#define SCENARIO_SIM_H
+
+#include <stdint.h>
+#include "garage_scenario.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCENARIO_SIM_TICK_MS 100
+
+/**
+ * @brief Virtual-time runner context
+ */
+typedef struct {
+    garage_controller_t* ctrl;
+    int64_t next_tick_us;       // Virtual time of the next controller tick
+    uint32_t inputs_injected;
+} scenario_sim_t;
+
+/**
+ * @brief Bind the runner to a controller; ticks are phased from the current virtual time
+ * @param sim Runner context
+ * @param ctrl Controller driven by the scenario
+ */
+void scenario_sim_init(scenario_sim_t* sim, garage_controller_t* ctrl);
+
+/**
+ * @brief Get scenario hooks that run on the virtual clock
+ * @param sim Runner context
+ * @return Hooks for garage_scenario_run()
+ */
+garage_scenario_ops_t scenario_sim_ops(scenario_sim_t* sim);
+
+/**
+ * @brief Advance virtual time, ticking the controller on every period boundary
+ * @param sim Runner context
+ * @param delay_ms Milliseconds to advance
+ */
+void scenario_sim_wait_ms(scenario_sim_t* sim, int delay_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCENARIO_SIM_H
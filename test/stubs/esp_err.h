@@ -0,0 +1,25 @@
+/**
+ * @file esp_err.h
+ * @brief Host stand-in for the ESP SDK error codes
+ *
+ * Only the definitions used by the HAL interfaces are provided, so that
+ * HAL-based modules and their simulated implementations build on the host.
+ */
+
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+#include <stdint.h>
+
+typedef int32_t esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_TIMEOUT         0x107
+
+#endif // ESP_ERR_H
@@ -0,0 +1,21 @@
+/**
+ * @file esp_event.h
+ * @brief Host stand-in for the ESP SDK event loop types
+ *
+ * Only the definitions used by the HAL interfaces are provided.
+ */
+
+#ifndef ESP_EVENT_H
+#define ESP_EVENT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef const char* esp_event_base_t;
+
+typedef void (*esp_event_handler_t)(void* event_handler_arg, esp_event_base_t event_base,
+                                    int32_t event_id, void* event_data);
+
+#define ESP_EVENT_ANY_ID -1
+
+#endif // ESP_EVENT_H
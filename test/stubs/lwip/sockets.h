@@ -0,0 +1,19 @@
+/**
+ * @file sockets.h
+ * @brief Host stand-in for the lwIP BSD socket API
+ *
+ * lwIP mirrors the POSIX socket calls, so socket-based modules build on the
+ * host against the system headers.
+ */
+
+#ifndef LWIP_SOCKETS_H
+#define LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#endif // LWIP_SOCKETS_H
@@ -0,0 +1,22 @@
+/**
+ * @file sys.h
+ * @brief Host stand-in for the lwIP system abstraction
+ *
+ * Only sys_now() is provided: milliseconds from a monotonic clock, wrapping
+ * at 32 bits like lwIP's.
+ */
+
+#ifndef LWIP_SYS_H
+#define LWIP_SYS_H
+
+#include <stdint.h>
+#include <time.h>
+
+static uint32_t sys_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t) ((uint64_t) now.tv_sec * 1000 + (uint64_t) now.tv_nsec / 1000000);
+}
+
+#endif // LWIP_SYS_H
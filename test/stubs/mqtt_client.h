@@ -0,0 +1,68 @@
+/**
+ * @file mqtt_client.h
+ * @brief Host stand-in for the esp-mqtt client types
+ *
+ * Mirrors the esp_mqtt_event_t layout of the ESP8266 RTOS SDK so mqtt_impl.c
+ * builds on the host against the simulated MQTT HAL. Only the definitions
+ * used by the HAL interface and mqtt_impl.c are provided.
+ */
+
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+typedef struct esp_mqtt_client* esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ANY = -1,
+    MQTT_EVENT_ERROR = 0,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    esp_mqtt_event_id_t event_id;
+    esp_mqtt_client_handle_t client;
+    void* user_context;
+    char* data;                 // Not NUL-terminated
+    int data_len;
+    int total_data_len;         // Whole payload; larger than data_len for chunked payloads
+    int current_data_offset;    // Offset of this chunk in the payload
+    char* topic;                // Not NUL-terminated
+    int topic_len;
+    int msg_id;
+    int session_present;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t* esp_mqtt_event_handle_t;
+
+typedef enum {
+    MQTT_TRANSPORT_UNKNOWN = 0,
+    MQTT_TRANSPORT_OVER_TCP,
+    MQTT_TRANSPORT_OVER_SSL,
+    MQTT_TRANSPORT_OVER_WS,
+    MQTT_TRANSPORT_OVER_WSS,
+} esp_mqtt_transport_t;
+
+typedef struct {
+    const char* host;
+    int port;
+    const char* username;
+    const char* password;
+    const char* lwt_topic;
+    const char* lwt_msg;
+    int lwt_qos;
+    int lwt_retain;
+    const char* cert_pem;
+    esp_mqtt_transport_t transport;
+} esp_mqtt_client_config_t;
+
+#endif // MQTT_CLIENT_H
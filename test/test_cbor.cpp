@@ -0,0 +1,283 @@
+/**
+ * @file test_cbor.cpp
+ * @brief Unit tests for the CBOR writer and the compact metrics and history payloads
+ *
+ * Every CBOR payload is decoded with decode/payload_decode.cpp and must give
+ * back exactly the JSON the firmware publishes in JSON mode.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "payload_decode.h"
+
+extern "C" {
+#include "cbor_writer.h"
+#include "garage_controller.h"
+#include "history_log.h"
+#include "metrics.h"
+}
+
+static std::string hex(const uint8_t* data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < len; i++) {
+        out += digits[data[i] >> 4];
+        out += digits[data[i] & 0xf];
+    }
+    return out;
+}
+
+/// Encode with one writer call and return the bytes as hex
+template <typename Put>
+static std::string encode(Put put)
+{
+    uint8_t buf[64];
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buf, sizeof(buf));
+    put(&writer);
+    int len = cbor_writer_finish(&writer);
+    EXPECT_GE(len, 0);
+    return len >= 0 ? hex(buf, (size_t) len) : std::string();
+}
+
+/**
+ * Test: Integers, booleans, strings and containers match the RFC 8949 Appendix A examples
+ */
+TEST(CborWriterTest, RfcExamples)
+{
+    struct { uint64_t value; const char* bytes; } uints[] = {
+        { 0, "00" }, { 23, "17" }, { 24, "1818" }, { 100, "1864" }, { 1000, "1903e8" },
+        { 1000000, "1a000f4240" }, { 1000000000000ULL, "1b000000e8d4a51000" },
+        { UINT64_MAX, "1bffffffffffffffff" },
+    };
+    for (const auto& example : uints) {
+        EXPECT_EQ(example.bytes, encode([&](cbor_writer_t* w) { cbor_put_uint(w, example.value); }));
+    }
+
+    struct { int64_t value; const char* bytes; } ints[] = {
+        { -1, "20" }, { -10, "29" }, { -100, "3863" }, { -1000, "3903e7" }, { 10, "0a" },
+        { INT64_MIN, "3b7fffffffffffffff" },
+    };
+    for (const auto& example : ints) {
+        EXPECT_EQ(example.bytes, encode([&](cbor_writer_t* w) { cbor_put_int(w, example.value); }));
+    }
+
+    EXPECT_EQ("f4", encode([](cbor_writer_t* w) { cbor_put_bool(w, false); }));
+    EXPECT_EQ("f5", encode([](cbor_writer_t* w) { cbor_put_bool(w, true); }));
+    EXPECT_EQ("60", encode([](cbor_writer_t* w) { cbor_put_text(w, ""); }));
+    EXPECT_EQ("6449455446", encode([](cbor_writer_t* w) { cbor_put_text(w, "IETF"); }));
+    EXPECT_EQ("80", encode([](cbor_writer_t* w) { cbor_put_array(w, 0); }));
+    EXPECT_EQ("8301820203820405", encode([](cbor_writer_t* w) {
+        cbor_put_array(w, 3);
+        cbor_put_uint(w, 1);
+        cbor_put_array(w, 2);
+        cbor_put_uint(w, 2);
+        cbor_put_uint(w, 3);
+        cbor_put_array(w, 2);
+        cbor_put_uint(w, 4);
+        cbor_put_uint(w, 5);
+    }));
+    EXPECT_EQ("a26161016162820203", encode([](cbor_writer_t* w) {
+        cbor_put_map(w, 2);
+        cbor_put_text(w, "a");
+        cbor_put_uint(w, 1);
+        cbor_put_text(w, "b");
+        cbor_put_array(w, 2);
+        cbor_put_uint(w, 2);
+        cbor_put_uint(w, 3);
+    }));
+    EXPECT_EQ("9819", encode([](cbor_writer_t* w) { cbor_put_array(w, 25); }));
+}
+
+/**
+ * Test: An item that does not fit is not written in part, and the overflow sticks
+ */
+TEST(CborWriterTest, Overflow)
+{
+    uint8_t buf[8];
+    memset(buf, 0xAA, sizeof(buf));
+    cbor_writer_t writer;
+    cbor_writer_init(&writer, buf, 4);
+    cbor_put_uint(&writer, 1);                  // 1 byte
+    cbor_put_uint(&writer, 1000000);            // 5 bytes: refused
+    cbor_put_uint(&writer, 2);                  // Would fit, but the payload is already lost
+    EXPECT_EQ(-1, cbor_writer_finish(&writer));
+    EXPECT_EQ(0x01, buf[0]);
+    EXPECT_EQ(0xAA, buf[1]);
+
+    cbor_writer_init(&writer, buf, 5);
+    cbor_put_text(&writer, "IETF");
+    EXPECT_EQ(5, cbor_writer_finish(&writer));
+    cbor_put_text(&writer, "");
+    EXPECT_EQ(-1, cbor_writer_finish(&writer));
+
+    cbor_writer_init(&writer, NULL, 100);
+    cbor_put_bool(&writer, true);
+    EXPECT_EQ(-1, cbor_writer_finish(&writer));
+}
+
+class CompactPayloadTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        metrics_reset();
+    }
+
+    static std::string metrics_json()
+    {
+        std::vector<char> buf(4096);
+        int len = metrics_to_json(buf.data(), buf.size());
+        EXPECT_GT(len, 0);
+        return len > 0 ? std::string(buf.data(), (size_t) len) : std::string();
+    }
+
+    static std::vector<uint8_t> metrics_cbor()
+    {
+        std::vector<uint8_t> buf(4096);
+        int len = metrics_to_cbor(buf.data(), buf.size());
+        EXPECT_GT(len, 0);
+        buf.resize(len > 0 ? (size_t) len : 0);
+        return buf;
+    }
+
+    static history_record_t record(uint32_t seq, history_kind_t kind, uint8_t a0, uint8_t a1, uint8_t a2)
+    {
+        history_record_t r;
+        r.seq = seq;
+        r.boot = 3;
+        r.time_s = 86400 + seq;
+        r.kind = kind;
+        r.args[0] = a0;
+        r.args[1] = a1;
+        r.args[2] = a2;
+        return r;
+    }
+};
+
+/**
+ * Test: The CBOR metrics decode to exactly the JSON export, in at most half the bytes
+ */
+TEST_F(CompactPayloadTest, MetricsRoundTrip)
+{
+    metrics_inc(METRIC_WIFI_DISCONNECTS);
+    metrics_set(METRIC_WIFI_CONNECTED, -1);
+    metrics_set(METRIC_MQTT_CONNECTED, 1);
+    metrics_inc(METRIC_INPUT_FULL_UDP);
+    metrics_inc(metrics_state_entries(GARAGE_STATE_OPENING));
+    metrics_inc(METRIC_SIGNED_ACCEPTED);
+    for (int i = 0; i < 50; i++) {
+        metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 150 + i * 97);
+    }
+    metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 5000000000LL);
+
+    std::string json = metrics_json();
+    std::vector<uint8_t> cbor = metrics_cbor();
+    std::string decoded;
+    std::string error;
+    ASSERT_TRUE(payload_decode::metrics_to_json(cbor.data(), cbor.size(), &decoded, &error)) << error;
+    EXPECT_EQ(json, decoded);
+    EXPECT_LE(cbor.size() * 2, json.size()) << cbor.size() << " CBOR bytes vs " << json.size() << " JSON";
+}
+
+/**
+ * Test: The widest values still round-trip and fit the firmware's buffer
+ */
+TEST_F(CompactPayloadTest, MetricsWorstCase)
+{
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        metrics_set((metric_id_t) id, id % 2 == 0 ? -1 : INT32_MIN);
+    }
+    for (int i = 0; i < 1000; i++) {
+        metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 4000000000000LL);
+        metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 4000000000000LL);
+    }
+
+    std::vector<uint8_t> buf(1280);                                         // METRICS_JSON_MAX
+    int len = metrics_to_cbor(buf.data(), buf.size());
+    ASSERT_GT(len, 0);
+    EXPECT_EQ(-1, metrics_to_cbor(buf.data(), (size_t) len - 1));
+
+    std::string decoded;
+    ASSERT_TRUE(payload_decode::metrics_to_json(buf.data(), (size_t) len, &decoded, NULL));
+    EXPECT_EQ(metrics_json(), decoded);
+}
+
+/**
+ * Test: A CBOR history page decodes to the JSON page, in at most half the bytes
+ */
+TEST_F(CompactPayloadTest, HistoryPageRoundTrip)
+{
+    const history_record_t records[] = {
+        record(7, HISTORY_BOOT, 1, 0, 0),
+        record(8, HISTORY_TRANSITION, GARAGE_STATE_CLOSED, GARAGE_STATE_OPENING, 0),
+        record(9, HISTORY_COMMAND, GARAGE_INPUT_COMMAND_CLOSE, 1, HISTORY_SOURCE_SCHEDULE),
+        record(69999, HISTORY_CLOCK, 0x70, 0x11, 0x01),
+        record(70000, HISTORY_FAULT, HISTORY_FAULT_OBSTRUCTION, GARAGE_STATE_CLOSING, 0),
+        record(70001, (history_kind_t) 200, 0, 0, 0),
+    };
+    const int count = (int) (sizeof(records) / sizeof(records[0]));
+
+    char json[1024];
+    uint8_t cbor[256];
+    int json_len = history_page_to_json(records, count, 70002, false, json, sizeof(json));
+    int cbor_len = history_page_to_cbor(records, count, 70002, false, cbor, sizeof(cbor));
+    ASSERT_GT(json_len, 0);
+    ASSERT_GT(cbor_len, 0);
+
+    std::string decoded;
+    std::string error;
+    ASSERT_TRUE(payload_decode::history_page_to_json(cbor, (size_t) cbor_len, &decoded, &error)) << error;
+    EXPECT_EQ(std::string(json, (size_t) json_len), decoded);
+    EXPECT_LE(cbor_len * 2, json_len);
+
+    json_len = history_page_to_json(NULL, 0, 12, true, json, sizeof(json));
+    EXPECT_STREQ("{\"records\":[],\"next\":12,\"last\":true}", json);
+    cbor_len = history_page_to_cbor(NULL, 0, 12, true, cbor, sizeof(cbor));
+    EXPECT_EQ("84010cf580", hex(cbor, (size_t) cbor_len));
+    ASSERT_TRUE(payload_decode::history_page_to_json(cbor, (size_t) cbor_len, &decoded, NULL));
+    EXPECT_EQ(std::string(json, (size_t) json_len), decoded);
+
+    EXPECT_EQ(-1, history_page_to_json(records, count, 70002, false, json, 100));
+    EXPECT_EQ(-1, history_page_to_cbor(records, count, 70002, false, cbor, 20));
+}
+
+/**
+ * Test: Malformed or mismatched payloads are refused with a reason
+ */
+TEST_F(CompactPayloadTest, DecoderRejectsMalformed)
+{
+    std::vector<uint8_t> cbor = metrics_cbor();
+    std::string out;
+    std::string error;
+
+    std::vector<uint8_t> truncated(cbor.begin(), cbor.end() - 1);
+    EXPECT_FALSE(payload_decode::metrics_to_json(truncated.data(), truncated.size(), &out, &error));
+    EXPECT_NE(std::string::npos, error.find("truncated")) << error;
+
+    std::vector<uint8_t> trailing = cbor;
+    trailing.push_back(0x00);
+    EXPECT_FALSE(payload_decode::metrics_to_json(trailing.data(), trailing.size(), &out, &error));
+
+    std::vector<uint8_t> version = cbor;
+    version[1] = METRICS_CBOR_VERSION + 1;
+    EXPECT_FALSE(payload_decode::metrics_to_json(version.data(), version.size(), &out, &error));
+    EXPECT_NE(std::string::npos, error.find("version")) << error;
+
+    const uint8_t page[] = { 0x84, 0x01, 0x0c, 0xf5, 0x80 };
+    EXPECT_FALSE(payload_decode::metrics_to_json(page, sizeof(page), &out, &error));
+    EXPECT_TRUE(payload_decode::history_page_to_json(page, sizeof(page), &out, &error));
+
+    const uint8_t indefinite[] = { 0x9f, 0x01, 0xff };
+    EXPECT_FALSE(payload_decode::diagnostic(indefinite, sizeof(indefinite), &out, &error));
+    const uint8_t huge_array[] = { 0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    EXPECT_FALSE(payload_decode::diagnostic(huge_array, sizeof(huge_array), &out, &error));
+    const uint8_t bad_arg[] = { 0x84, 0x01, 0x0c, 0xf5, 0x81, 0x87, 0x01, 0x01, 0x01, 0x19, 0x01, 0x00, 0, 0, 0 };
+    EXPECT_FALSE(payload_decode::history_page_to_json(bad_arg, sizeof(bad_arg), &out, &error));
+
+    ASSERT_TRUE(payload_decode::diagnostic(page, sizeof(page), &out, &error));
+    EXPECT_EQ("[1, 12, true, []]", out);
+}
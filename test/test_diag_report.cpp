@@ -0,0 +1,167 @@
+/**
+ * @file test_diag_report.cpp
+ * @brief Tests for the DIAG_MODE report: command parsing, CPU shares and bounded chunks
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+extern "C" {
+#include "diag_report.h"
+}
+
+static diag_task_t task(const char* name, uint32_t number, uint32_t runtime, uint32_t stack_free = 512)
+{
+    diag_task_t t = {};
+    snprintf(t.name, sizeof(t.name), "%s", name);
+    t.number = number;
+    t.state = 'B';
+    t.priority = 5;
+    t.runtime = runtime;
+    t.stack_free = stack_free;
+    return t;
+}
+
+/**
+ * Test: Only the exact section names are commands
+ */
+TEST(DiagReportTest, ParsesCommands)
+{
+    EXPECT_EQ(DIAG_SECTION_TASKS, diag_parse_command("tasks", 5));
+    EXPECT_EQ(DIAG_SECTION_HEAP, diag_parse_command("heap", 4));
+    EXPECT_EQ(DIAG_SECTION_QUEUES, diag_parse_command("queues", 6));
+    EXPECT_EQ(DIAG_SECTION_ALL, diag_parse_command("all", 3));
+    EXPECT_EQ(0, diag_parse_command("tasks", 4));
+    EXPECT_EQ(0, diag_parse_command("tasks ", 6));
+    EXPECT_EQ(0, diag_parse_command("ALL", 3));
+    EXPECT_EQ(0, diag_parse_command(nullptr, 3));
+    EXPECT_EQ(0, diag_parse_command("all", -1));
+}
+
+/**
+ * Test: Shares cover the time since the previous sample, new tasks count whole, and the busiest comes first
+ */
+TEST(DiagReportTest, CpuSharesSincePreviousSample)
+{
+    diag_tasks_t previous = {};
+    previous.tasks[0] = task("IDLE", 1, 900000);
+    previous.tasks[1] = task("wifi", 2, 50000);
+    previous.tasks[2] = task("mqtt_task", 3, 50000);
+    previous.count = 3;
+    previous.total_runtime = 1000000;
+
+    // 100000 more: wifi took 60%, a task started since took 10%, idle the rest
+    diag_tasks_t current = previous;
+    current.tasks[0].runtime = 930000;
+    current.tasks[1].runtime = 110000;
+    current.tasks[3] = task("syslog", 7, 10000);
+    current.count = 4;
+    current.total_runtime = 1100000;
+    diag_cpu_shares(&previous, &current);
+
+    EXPECT_STREQ("wifi", current.tasks[0].name);
+    EXPECT_EQ(600, current.tasks[0].cpu_permille);
+    EXPECT_STREQ("IDLE", current.tasks[1].name);
+    EXPECT_EQ(300, current.tasks[1].cpu_permille);
+    EXPECT_STREQ("syslog", current.tasks[2].name);
+    EXPECT_EQ(100, current.tasks[2].cpu_permille);
+    EXPECT_STREQ("mqtt_task", current.tasks[3].name);
+    EXPECT_EQ(0, current.tasks[3].cpu_permille);
+
+    // Since boot, and across a counter wrap
+    diag_tasks_t boot = previous;
+    diag_cpu_shares(nullptr, &boot);
+    EXPECT_EQ(900, boot.tasks[0].cpu_permille);
+
+    diag_tasks_t wrapped = previous;
+    wrapped.total_runtime = 0xffffff00u;
+    wrapped.tasks[1].runtime = 0xffffff00u;
+    diag_tasks_t after = wrapped;
+    after.total_runtime = 0x00000100u;
+    after.tasks[1].runtime = 0x00000080u;
+    diag_cpu_shares(&wrapped, &after);
+    EXPECT_STREQ("wifi", after.tasks[0].name);
+    EXPECT_EQ(750, after.tasks[0].cpu_permille);
+}
+
+/**
+ * Test: The task list is split into chunks within the buffer size that together list every task once
+ */
+TEST(DiagReportTest, TaskChunksAreBounded)
+{
+    diag_tasks_t current = {};
+    for (int i = 0; i < DIAG_TASKS_MAX; i++) {
+        current.tasks[i] = task(("task_with_long" + std::to_string(i)).c_str(), (uint32_t) i + 1, 1000, 4096);
+    }
+    current.count = DIAG_TASKS_MAX;
+    current.total_runtime = DIAG_TASKS_MAX * 1000;
+    diag_cpu_shares(nullptr, &current);
+
+    char buf[DIAG_CHUNK_MAX];
+    int start = 0;
+    int chunks = 0;
+    std::string all;
+    while (start < current.count) {
+        int next = -1;
+        int len = diag_tasks_to_json(&current, 5000, 3, start, buf, sizeof(buf), &next);
+        ASSERT_GT(len, 0);
+        ASSERT_LT((size_t) len, sizeof(buf));
+        ASSERT_GT(next, start);
+        std::string chunk(buf, len);
+        EXPECT_EQ(0u, chunk.find("{\"report\":3,\"section\":\"tasks\",\"window_ms\":5000,\"first\":" +
+                                 std::to_string(start) + ",\"tasks\":["));
+        EXPECT_EQ(next == current.count, chunk.find("\"last\":true}") != std::string::npos) << chunk;
+        all += chunk;
+        start = next;
+        chunks++;
+    }
+    EXPECT_GT(chunks, 1);
+    for (int i = 0; i < DIAG_TASKS_MAX; i++) {
+        std::string name = "\"name\":\"task_with_long" + std::to_string(i) + "\"";
+        size_t at = all.find(name);
+        ASSERT_NE(std::string::npos, at) << name;
+        EXPECT_EQ(std::string::npos, all.find(name, at + 1)) << name;
+    }
+
+    const char* expected = "{\"name\":\"task_with_long0\",\"num\":1,\"state\":\"B\",\"prio\":5,\"cpu_pm\":50,"
+                           "\"stack_free\":4096}";
+    EXPECT_NE(std::string::npos, all.find(expected)) << all;
+
+    // Too small for even one task
+    int next = -1;
+    EXPECT_EQ(-1, diag_tasks_to_json(&current, 0, 1, 0, buf, 100, &next));
+}
+
+/**
+ * Test: Heap and queue sections, and task names that would break the JSON
+ */
+TEST(DiagReportTest, HeapQueuesAndNames)
+{
+    char buf[DIAG_CHUNK_MAX];
+    diag_heap_t heap = { 21000, 17500 };
+    int len = diag_heap_to_json(&heap, 4, buf, sizeof(buf));
+    EXPECT_EQ("{\"report\":4,\"section\":\"heap\",\"free\":21000,\"min_free\":17500}", std::string(buf, len));
+
+    const diag_queue_t queues[] = { { "state_machine", 2, 5 }, { "history", 0, 8 } };
+    len = diag_queues_to_json(queues, 2, 4, buf, sizeof(buf));
+    EXPECT_EQ("{\"report\":4,\"section\":\"queues\",\"queues\":[{\"name\":\"state_machine\",\"waiting\":2,\"size\":5},"
+              "{\"name\":\"history\",\"waiting\":0,\"size\":8}]}",
+              std::string(buf, len));
+    EXPECT_EQ(-1, diag_queues_to_json(queues, 2, 4, buf, 40));
+
+    diag_tasks_t current = {};
+    current.tasks[0] = task("a\"b\\c\n", 1, 0);
+    current.count = 1;
+    int next = -1;
+    len = diag_tasks_to_json(&current, 0, 1, 0, buf, sizeof(buf), &next);
+    ASSERT_GT(len, 0);
+    EXPECT_NE(std::string::npos, std::string(buf, len).find("\"name\":\"a?b?c?\"")) << buf;
+    EXPECT_EQ(1, next);
+
+    // No tasks: one empty, final chunk
+    current.count = 0;
+    len = diag_tasks_to_json(&current, 0, 1, 0, buf, sizeof(buf), &next);
+    EXPECT_NE(std::string::npos, std::string(buf, len).find("\"tasks\":[],\"last\":true}"));
+    EXPECT_EQ(0, next);
+}
@@ -0,0 +1,182 @@
+/**
+ * @file test_distance_sensor.cpp
+ * @brief Unit tests for distance sensor filtering, zones and sampling control
+ */
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "distance_sensor.h"
+}
+
+#define DOOR_MM  300    // Open door panel under the sensor
+#define CAR_MM   1200   // Car roof
+#define FLOOR_MM 2400   // Empty bay
+
+class DistanceSensorTest : public ::testing::Test {
+protected:
+    distance_sensor_t sensor;
+    int door_changes = 0;
+    int occupancy_changes = 0;
+
+    void SetUp() override
+    {
+        distance_sensor_config_t config = { 600, 1600, 100, 4000, 0 };
+        distance_sensor_init(&sensor, &config);
+    }
+
+    void feed(int mm, int count = 1)
+    {
+        for (int i = 0; i < count; i++) {
+            distance_sensor_change_t change = distance_sensor_add_sample(&sensor, mm);
+            door_changes += change.door_changed ? 1 : 0;
+            occupancy_changes += change.occupancy_changed ? 1 : 0;
+        }
+    }
+};
+
+/**
+ * Test: Nothing is reported until the median window has filled
+ */
+TEST_F(DistanceSensorTest, ReportsOnceWindowFills)
+{
+    feed(FLOOR_MM, DISTANCE_SENSOR_MEDIAN_WINDOW - 1);
+    EXPECT_EQ(DISTANCE_SENSOR_UNKNOWN, distance_sensor_get_mm(&sensor));
+    EXPECT_EQ(DISTANCE_ZONE_UNKNOWN, sensor.zone);
+    EXPECT_EQ(0, door_changes);
+
+    feed(FLOOR_MM);
+    EXPECT_EQ(FLOOR_MM, distance_sensor_get_mm(&sensor));
+    EXPECT_EQ(1, door_changes) << "First zone is reported at once";
+    EXPECT_FALSE(distance_sensor_door_open(&sensor));
+    EXPECT_EQ(DISTANCE_OCCUPANCY_ABSENT, distance_sensor_get_occupancy(&sensor));
+    EXPECT_EQ(1, occupancy_changes);
+}
+
+/**
+ * Test: Single spikes and missing echoes leave the filtered distance alone
+ */
+TEST_F(DistanceSensorTest, MedianDropsSpikes)
+{
+    feed(FLOOR_MM, DISTANCE_SENSOR_MEDIAN_WINDOW);
+    for (int i = 0; i < 20; i++) {
+        feed(i % 3 == 0 ? 150 : FLOOR_MM);      // Stray echo off a rafter every third ping
+        feed(DISTANCE_SENSOR_NO_READING);
+        feed(9000);                             // Past the range
+    }
+    EXPECT_EQ(FLOOR_MM, distance_sensor_get_mm(&sensor));
+    EXPECT_EQ(1, door_changes);
+    EXPECT_EQ(40u, sensor.dropped);
+    EXPECT_EQ(DISTANCE_SENSOR_MEDIAN_WINDOW + 60u, sensor.samples);
+}
+
+/**
+ * Test: The EWMA smooths a small step; a large one is taken at once
+ */
+TEST_F(DistanceSensorTest, EwmaFollowsStep)
+{
+    feed(2200, DISTANCE_SENSOR_MEDIAN_WINDOW);
+    feed(2400, 2);
+    EXPECT_EQ(2200, distance_sensor_get_mm(&sensor)) << "Median holds until most of the window moved";
+
+    int previous = distance_sensor_get_mm(&sensor);
+    feed(2400);
+    EXPECT_EQ(2250, distance_sensor_get_mm(&sensor)) << "A quarter of the way";
+    for (int i = 0; i < 30; i++) {
+        feed(2400);
+        int mm = distance_sensor_get_mm(&sensor);
+        EXPECT_GE(mm, previous);
+        EXPECT_LE(mm, 2400);
+        previous = mm;
+    }
+    EXPECT_NEAR(2400, previous, 1);
+
+    feed(CAR_MM, 3);
+    EXPECT_EQ(CAR_MM, distance_sensor_get_mm(&sensor)) << "Past the step limit";
+}
+
+/**
+ * Test: Noise around a threshold does not flap the zone
+ */
+TEST_F(DistanceSensorTest, HysteresisHoldsZone)
+{
+    feed(CAR_MM, DISTANCE_SENSOR_MEDIAN_WINDOW);
+    ASSERT_EQ(DISTANCE_OCCUPANCY_PRESENT, distance_sensor_get_occupancy(&sensor));
+    for (int i = 0; i < 50; i++) {
+        feed(i % 2 ? 1560 : 1680);              // Around the 1600 mm car threshold
+    }
+    EXPECT_EQ(DISTANCE_OCCUPANCY_PRESENT, distance_sensor_get_occupancy(&sensor));
+    EXPECT_EQ(1, occupancy_changes);
+
+    feed(1800, 30);
+    EXPECT_EQ(DISTANCE_OCCUPANCY_ABSENT, distance_sensor_get_occupancy(&sensor));
+    EXPECT_EQ(2, occupancy_changes);
+}
+
+/**
+ * Test: The door passing over an empty bay never reads as a car
+ */
+TEST_F(DistanceSensorTest, DoorLeavingSweepIgnored)
+{
+    feed(FLOOR_MM, DISTANCE_SENSOR_MEDIAN_WINDOW);
+    feed(DOOR_MM, 20);
+    EXPECT_TRUE(distance_sensor_door_open(&sensor));
+    EXPECT_EQ(2, door_changes);
+
+    feed(FLOOR_MM, 30);
+    EXPECT_FALSE(distance_sensor_door_open(&sensor));
+    EXPECT_EQ(3, door_changes);
+    EXPECT_EQ(DISTANCE_OCCUPANCY_ABSENT, distance_sensor_get_occupancy(&sensor));
+    EXPECT_EQ(1, occupancy_changes) << "Never passed through present";
+}
+
+/**
+ * Test: Occupancy is held while the door hides the bay, and updated once it is back in view
+ */
+TEST_F(DistanceSensorTest, OccupancyHeldUnderDoor)
+{
+    feed(FLOOR_MM, 20);
+    feed(DOOR_MM, 20);                          // Door opens, car drives in unseen
+    EXPECT_EQ(DISTANCE_OCCUPANCY_ABSENT, distance_sensor_get_occupancy(&sensor));
+
+    feed(CAR_MM, 20);                           // Door closes over the car
+    EXPECT_EQ(DISTANCE_OCCUPANCY_PRESENT, distance_sensor_get_occupancy(&sensor));
+    EXPECT_EQ(2, occupancy_changes);
+
+    distance_sensor_restart(&sensor);           // Sampling paused while closed
+    EXPECT_EQ(DISTANCE_SENSOR_UNKNOWN, distance_sensor_get_mm(&sensor));
+    EXPECT_EQ(DISTANCE_OCCUPANCY_PRESENT, distance_sensor_get_occupancy(&sensor));
+    feed(CAR_MM, DISTANCE_SENSOR_MEDIAN_WINDOW);
+    EXPECT_EQ(4, door_changes) << "Zone reported again after the restart";
+    EXPECT_EQ(2, occupancy_changes);
+}
+
+/**
+ * Test: Without a car threshold everything past the door is the floor
+ */
+TEST(DistanceSensor, NoOccupancyThreshold)
+{
+    distance_sensor_t sensor;
+    distance_sensor_config_t config = { 600, 0, 100, 0, 3 };
+    distance_sensor_init(&sensor, &config);
+    for (int i = 0; i < 20; i++) {
+        distance_sensor_add_sample(&sensor, CAR_MM);
+    }
+    EXPECT_EQ(DISTANCE_ZONE_FLOOR, sensor.zone);
+    EXPECT_EQ(DISTANCE_OCCUPANCY_ABSENT, distance_sensor_get_occupancy(&sensor));
+    EXPECT_STREQ("absent", distance_occupancy_to_string(DISTANCE_OCCUPANCY_ABSENT));
+}
+
+/**
+ * Test: Sampling stops once the door has been closed for the settle time, and only then
+ */
+TEST(DistanceSensor, SamplingOnlyWhenUseful)
+{
+    EXPECT_TRUE(distance_sensor_sampling_needed(GARAGE_STATE_CLOSED, 0));
+    EXPECT_TRUE(distance_sensor_sampling_needed(GARAGE_STATE_CLOSED, DISTANCE_SENSOR_SETTLE_MS - 1));
+    EXPECT_FALSE(distance_sensor_sampling_needed(GARAGE_STATE_CLOSED, DISTANCE_SENSOR_SETTLE_MS));
+    for (garage_state_t state : { GARAGE_STATE_OPEN, GARAGE_STATE_OPENING, GARAGE_STATE_CLOSING,
+                                  GARAGE_STATE_STOPPED, GARAGE_STATE_UNKNOWN }) {
+        EXPECT_TRUE(distance_sensor_sampling_needed(state, 3600000)) << state;
+    }
+}
@@ -0,0 +1,402 @@
+/**
+ * @file test_door_model.cpp
+ * @brief Host tests for the controller against the physical door model
+ *
+ * The door model answers relay presses with travel, variance, obstruction
+ * reversal and reed switch bounce, so these tests check timeout tuning and
+ * command handling against realistic physics rather than scripted sensor edges.
+ */
+
+#include <gtest/gtest.h>
+
+extern "C" {
+#include "door_model.h"
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+}
+
+#define REED_GPIO   4
+#define RELAY_GPIO  5
+#define QUEUE_DEPTH 5
+#define TIMEOUT_MS  15000   // Production garage_controller timeout
+
+class DoorModelTest : public ::testing::Test {
+protected:
+    garage_controller_t ctrl;
+    door_model_t door;
+    garage_input_t queue[QUEUE_DEPTH];
+    int queue_count = 0;
+    int64_t next_tick_us = 0;
+
+    static void reed_isr(void* arg)
+    {
+        DoorModelTest* self = static_cast<DoorModelTest*>(arg);
+        if (self->queue_count < QUEUE_DEPTH) {
+            self->queue[self->queue_count++] = GARAGE_INPUT_REED_SWITCH;
+        }
+    }
+
+    void SetUp() override
+    {
+        start(door_model_default_config(RELAY_GPIO, REED_GPIO), false);
+    }
+
+    /// Reset the rig with the door at rest and the controller synced to the reed switch
+    void start(const door_model_config_t& config, bool door_open)
+    {
+        gpio_hal_sim_reset();
+        gpio_hal_config_output(1u << RELAY_GPIO);
+        gpio_hal_config_input(1u << REED_GPIO, GPIO_HAL_EDGE_ANY, true);
+        gpio_hal_install_isr_service();
+        gpio_hal_isr_handler_add(REED_GPIO, reed_isr, this);
+        queue_count = 0;
+
+        door_model_init(&door, &config, door_open);
+        door_model_attach(&door);
+
+        garage_controller_config_t ctrl_config = {};
+        ctrl_config.reed_switch_gpio = REED_GPIO;
+        ctrl_config.relay_gpio = RELAY_GPIO;
+        ctrl_config.relay_pulse_ms = GARAGE_RELAY_PULSE_MS;
+        ctrl_config.sm_config.timeout_ms = TIMEOUT_MS;
+        garage_controller_init(&ctrl, &ctrl_config, GARAGE_STATE_UNKNOWN);
+        garage_controller_handle_input(&ctrl, door_open ? GARAGE_INPUT_SENSOR_OPEN : GARAGE_INPUT_SENSOR_CLOSED);
+        garage_controller_tick(&ctrl, TIMEOUT_MS);     // Settle an initial OPENING into OPEN
+        next_tick_us = 100 * 1000;
+    }
+
+    /// Run the system for duration_ms: 1 ms handler drains and 100 ms controller ticks
+    void run_ms(int64_t duration_ms)
+    {
+        int64_t end = gpio_hal_get_time_us() + duration_ms * 1000;
+        while (gpio_hal_get_time_us() < end) {
+            gpio_hal_sim_advance_by(1000);
+            for (int i = 0; i < queue_count; i++) {
+                garage_controller_handle_input(&ctrl, queue[i]);
+            }
+            queue_count = 0;
+            while (next_tick_us <= gpio_hal_get_time_us()) {
+                garage_controller_tick(&ctrl, 100);
+                next_tick_us += 100 * 1000;
+            }
+        }
+    }
+
+    /// Close the relay for press_ms directly, like a wall button wired across the same terminals
+    void manual_press(int press_ms)
+    {
+        gpio_hal_set_level(RELAY_GPIO, 1);
+        run_ms(press_ms);
+        gpio_hal_set_level(RELAY_GPIO, 0);
+    }
+};
+
+/**
+ * Test: OPEN command moves the door; the reed switch opens early and the timeout resolves to OPEN
+ */
+TEST_F(DoorModelTest, OpenCommandOpensDoor)
+{
+    ASSERT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(1000);
+    EXPECT_EQ(DOOR_MODEL_OPENING, door_model_get_motion(&door));
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl));
+    EXPECT_EQ(1, gpio_hal_get_level(REED_GPIO)) << "Magnet leaves the switch within the first second";
+
+    run_ms(TIMEOUT_MS);
+    EXPECT_EQ(DOOR_MODEL_POSITION_OPEN, door_model_get_position(&door));
+    EXPECT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl));
+    EXPECT_EQ(1u, door.run.presses);
+}
+
+/**
+ * Test: Every reed switch crossing bounces before settling
+ */
+TEST_F(DoorModelTest, ReedSwitchBouncesOnCrossing)
+{
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(2000);
+
+    EXPECT_EQ((uint32_t) door.config.reed_bounce_count + 1, gpio_hal_sim_isr_count(REED_GPIO));
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl)) << "Bounce settles on the open level";
+}
+
+/**
+ * Test: The 15 s timeout covers the slowest close the variance allows, across many seeds
+ */
+TEST_F(DoorModelTest, CloseFinishesBeforeTimeoutAcrossVariance)
+{
+    for (uint32_t seed = 1; seed <= 50; seed++) {
+        door_model_config_t config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+        config.seed = seed;
+        start(config, true);
+        ASSERT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl));
+
+        garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+        run_ms(TIMEOUT_MS - 200);
+
+        ASSERT_TRUE(door_model_is_closed(&door)) << "seed " << seed;
+        ASSERT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl)) << "seed " << seed;
+    }
+}
+
+/**
+ * Test: An obstruction reverses a closing door; the controller times out to UNKNOWN
+ */
+TEST_F(DoorModelTest, ObstructionReversesClosingDoor)
+{
+    start(door_model_default_config(RELAY_GPIO, REED_GPIO), true);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    run_ms(4000);
+    ASSERT_EQ(DOOR_MODEL_CLOSING, door_model_get_motion(&door));
+
+    door_model_set_obstruction(&door, true);
+    run_ms(500);
+    EXPECT_EQ(DOOR_MODEL_OPENING, door_model_get_motion(&door)) << "Door should reverse";
+    EXPECT_EQ(1u, door.run.reversals);
+
+    run_ms(TIMEOUT_MS);
+    EXPECT_EQ(DOOR_MODEL_POSITION_OPEN, door_model_get_position(&door));
+    EXPECT_EQ(1, gpio_hal_get_level(REED_GPIO)) << "Reed switch never closed";
+    EXPECT_EQ(GARAGE_STATE_UNKNOWN, garage_controller_get_state(&ctrl)) << "Close timed out";
+}
+
+/**
+ * Test: Removing the obstruction before the opener reacts lets the door close
+ */
+TEST_F(DoorModelTest, ObstructionClearedBeforeReversal)
+{
+    start(door_model_default_config(RELAY_GPIO, REED_GPIO), true);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    run_ms(2000);
+
+    door_model_set_obstruction(&door, true);
+    run_ms(100);
+    door_model_set_obstruction(&door, false);
+    run_ms(13000);
+
+    EXPECT_EQ(0u, door.run.reversals);
+    EXPECT_TRUE(door_model_is_closed(&door));
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+}
+
+/**
+ * Test: The opener ignores presses while the door is travelling
+ */
+TEST_F(DoorModelTest, PressIgnoredMidTravel)
+{
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(3000);
+
+    manual_press(200);
+    run_ms(12000);
+
+    EXPECT_EQ(2u, door.run.presses);
+    EXPECT_EQ(1u, door.run.ignored_presses);
+    EXPECT_EQ(DOOR_MODEL_POSITION_OPEN, door_model_get_position(&door));
+}
+
+/**
+ * Test: An opener that honours presses mid-travel reverses and the controller follows the reed switch
+ */
+TEST_F(DoorModelTest, PressMidTravelReversesWhenNotIgnored)
+{
+    door_model_config_t config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+    config.press_while_moving = DOOR_MODEL_PRESS_REVERSES;
+    start(config, false);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(3000);
+    manual_press(200);
+    run_ms(500);
+    EXPECT_EQ(DOOR_MODEL_CLOSING, door_model_get_motion(&door));
+
+    run_ms(5000);
+    EXPECT_TRUE(door_model_is_closed(&door));
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl)) << "Reed switch closing wins";
+}
+
+/**
+ * Test: A relay closure shorter than the opener's minimum press does nothing
+ */
+TEST_F(DoorModelTest, ShortPressNotRegistered)
+{
+    manual_press(20);
+    run_ms(2000);
+
+    EXPECT_EQ(1u, door.short_presses);
+    EXPECT_EQ(0u, door.run.presses);
+    EXPECT_TRUE(door_model_is_closed(&door));
+    EXPECT_EQ(0u, gpio_hal_sim_isr_count(REED_GPIO)) << "No reed switch activity";
+}
+
+/**
+ * Test: After a few closes the learned travel time keeps the position estimate near the door
+ */
+TEST_F(DoorModelTest, PositionEstimateTracksDoorAfterLearning)
+{
+    start(door_model_default_config(RELAY_GPIO, REED_GPIO), true);
+    int initial_close_travel_ms = ctrl.sm.close_travel_ms;
+
+    for (int i = 0; i < 8; i++) {
+        garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+        run_ms(TIMEOUT_MS);
+        ASSERT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl)) << "cycle " << i;
+        garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+        run_ms(TIMEOUT_MS + 1000);
+        ASSERT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl)) << "cycle " << i;
+    }
+    EXPECT_GT(ctrl.sm.close_travel_ms, initial_close_travel_ms) << "Default 13 s close is slower than 12 s";
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    for (int i = 0; i < 6; i++) {
+        run_ms(2000);
+        int actual = door_model_get_position(&door) / 10;
+        EXPECT_NEAR(actual, garage_sm_get_position(&ctrl.sm), 10) << "after " << (i + 1) * 2 << " s";
+    }
+}
+
+/**
+ * Test: STOP halts an opener that stops on presses; CLOSE then needs one press
+ */
+TEST_F(DoorModelTest, StopMidTravelThenClose)
+{
+    door_model_config_t config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+    config.press_while_moving = DOOR_MODEL_PRESS_STOPS;
+    start(config, false);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(4000);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    run_ms(TIMEOUT_MS);
+    EXPECT_EQ(DOOR_MODEL_STOPPED, door_model_get_motion(&door));
+    EXPECT_EQ(1u, door.run.stops);
+    EXPECT_EQ(GARAGE_STATE_STOPPED, garage_controller_get_state(&ctrl)) << "No timeout to OPEN";
+    int stopped_at = door_model_get_position(&door);
+    EXPECT_GT(stopped_at, 0);
+    EXPECT_LT(stopped_at, DOOR_MODEL_POSITION_OPEN);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    run_ms(8000);
+    EXPECT_TRUE(door_model_is_closed(&door));
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+    EXPECT_EQ(3u, ctrl.relay_press_count);
+}
+
+/**
+ * Test: OPEN from a door stopped while opening sends the three-press sequence and opens
+ */
+TEST_F(DoorModelTest, OpenAfterStopTurnsDoorAround)
+{
+    door_model_config_t config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+    config.press_while_moving = DOOR_MODEL_PRESS_STOPS;
+    start(config, false);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(6000);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    run_ms(1000);
+    ASSERT_EQ(DOOR_MODEL_STOPPED, door_model_get_motion(&door));
+
+    // The timeout counts from the last press of the sequence, 2.5 s in
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_ms(TIMEOUT_MS + 3500);
+    EXPECT_EQ(5u, ctrl.relay_press_count);
+    EXPECT_EQ(5u, door.run.presses) << "Every press of the sequence registered";
+    EXPECT_EQ(DOOR_MODEL_POSITION_OPEN, door_model_get_position(&door));
+    EXPECT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl));
+}
+
+/**
+ * Test: CLOSE from a door stopped while closing times the close from the end of the three-press sequence
+ */
+TEST_F(DoorModelTest, CloseAfterStopTimedFromLastPress)
+{
+    door_model_config_t config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+    config.press_while_moving = DOOR_MODEL_PRESS_STOPS;
+    config.close_travel_ms = 12000;
+    config.travel_variance_pct = 0;
+    start(config, true);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    run_ms(6000);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    run_ms(1000);
+    ASSERT_EQ(DOOR_MODEL_STOPPED, door_model_get_motion(&door));
+    ASSERT_EQ(GARAGE_STATE_STOPPED, garage_controller_get_state(&ctrl));
+    int stopped_at = garage_sm_get_position(&ctrl.sm);
+    EXPECT_NEAR(50, stopped_at, 5);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    run_ms(2000);
+    EXPECT_EQ(stopped_at, garage_sm_get_position(&ctrl.sm)) << "Sequence still being sent";
+
+    // Past the overdue budget counted from the first press of the sequence
+    while (garage_controller_get_state(&ctrl) == GARAGE_STATE_CLOSING) {
+        run_ms(100);
+        ASSERT_FALSE(ctrl.sm.obstructed) << "at door position " << door_model_get_position(&door);
+        int actual = door_model_get_position(&door) / 10;
+        EXPECT_NEAR(actual, garage_sm_get_position(&ctrl.sm), 10);
+    }
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+    run_ms(1000);
+    EXPECT_TRUE(door_model_is_closed(&door));
+    EXPECT_EQ(0u, ctrl.sm.obstruction_count);
+    EXPECT_EQ(5u, ctrl.relay_press_count);
+}
+
+/**
+ * Test: An obstruction just above the floor reverses the door off the reed switch; flagged at once
+ */
+TEST_F(DoorModelTest, FloorReversalFlaggedAsObstruction)
+{
+    door_model_config_t config = door_model_default_config(RELAY_GPIO, REED_GPIO);
+    config.reverse_delay_ms = 100;
+    start(config, true);
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    for (int i = 0; i < TIMEOUT_MS && garage_controller_get_state(&ctrl) != GARAGE_STATE_CLOSED; i++) {
+        run_ms(1);
+    }
+    ASSERT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+    door_model_set_obstruction(&door, true);
+    run_ms(500);
+
+    EXPECT_EQ(DOOR_MODEL_OPENING, door_model_get_motion(&door));
+    EXPECT_EQ(1u, door.run.reversals);
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl));
+    EXPECT_TRUE(ctrl.sm.obstructed);
+    EXPECT_EQ(GARAGE_OBSTRUCTION_FLOOR_REVERSAL, ctrl.sm.last_obstruction);
+}
+
+/**
+ * Test: Reed switch bounce on every close is never taken for a reversal
+ */
+TEST_F(DoorModelTest, BouncingClosesAreNotObstructions)
+{
+    start(door_model_default_config(RELAY_GPIO, REED_GPIO), true);
+    for (int i = 0; i < 5; i++) {
+        garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+        run_ms(TIMEOUT_MS);
+        garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+        run_ms(TIMEOUT_MS + 1000);
+    }
+    EXPECT_EQ(0u, ctrl.sm.obstruction_count) << garage_obstruction_to_string(ctrl.sm.last_obstruction);
+}
+
+/**
+ * Test: A mid-travel reversal is flagged when the close runs overdue, before the timeout
+ */
+TEST_F(DoorModelTest, MidTravelReversalFlaggedBeforeTimeout)
+{
+    start(door_model_default_config(RELAY_GPIO, REED_GPIO), true);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_CLOSE);
+    run_ms(4000);
+    door_model_set_obstruction(&door, true);
+
+    run_ms(14700 - 4000);
+    EXPECT_EQ(GARAGE_STATE_CLOSING, garage_controller_get_state(&ctrl)) << "Timeout not reached";
+    EXPECT_TRUE(ctrl.sm.obstructed);
+    EXPECT_EQ(GARAGE_OBSTRUCTION_CLOSE_OVERDUE, ctrl.sm.last_obstruction);
+}
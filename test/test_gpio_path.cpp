@@ -0,0 +1,306 @@
+/**
+ * @file test_gpio_path.cpp
+ * @brief Host tests for the ISR -> queue -> state machine -> relay path using the simulated GPIO HAL
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+}
+
+#define REED_GPIO   4
+#define RELAY_GPIO  5
+#define QUEUE_DEPTH 5   // Same depth as the production state_machine_queue
+
+/**
+ * @brief Mirrors the production wiring: the reed switch ISR posts into a bounded
+ * queue which the handler drains into the controller, and a 100 ms tick drives
+ * the relay pulse and the state machine timer.
+ */
+class GpioPathTest : public ::testing::Test {
+protected:
+    garage_controller_t ctrl;
+    garage_input_t queue[QUEUE_DEPTH];
+    int queue_count = 0;
+    int queue_drops = 0;
+    int64_t next_tick_us = 0;
+
+    static void reed_isr(void* arg)
+    {
+        GpioPathTest* self = static_cast<GpioPathTest*>(arg);
+        if (self->queue_count < QUEUE_DEPTH) {
+            self->queue[self->queue_count++] = GARAGE_INPUT_REED_SWITCH;
+        } else {
+            self->queue_drops++;
+        }
+    }
+
+    void SetUp() override
+    {
+        gpio_hal_sim_reset();
+        gpio_hal_config_output(1u << RELAY_GPIO);
+        gpio_hal_config_input(1u << REED_GPIO, GPIO_HAL_EDGE_ANY, true);
+        gpio_hal_install_isr_service();
+        gpio_hal_isr_handler_add(REED_GPIO, reed_isr, this);
+
+        garage_controller_config_t config = {};
+        config.reed_switch_gpio = REED_GPIO;
+        config.relay_gpio = RELAY_GPIO;
+        config.relay_pulse_ms = 500;
+        config.sm_config.timeout_ms = 15000;
+        garage_controller_init(&ctrl, &config, GARAGE_STATE_UNKNOWN);
+        next_tick_us = 100 * 1000;
+    }
+
+    void drain()
+    {
+        for (int i = 0; i < queue_count; i++) {
+            garage_controller_handle_input(&ctrl, queue[i]);
+        }
+        queue_count = 0;
+    }
+
+    /// Run the system for duration_us, letting the handler drain every drain_period_us
+    void run_for(int64_t duration_us, int64_t drain_period_us = 1000)
+    {
+        int64_t end = gpio_hal_get_time_us() + duration_us;
+        while (gpio_hal_get_time_us() < end) {
+            int64_t step_end = gpio_hal_get_time_us() + drain_period_us;
+            if (step_end > end) {
+                step_end = end;
+            }
+            gpio_hal_sim_advance_to(step_end);
+            drain();
+            while (next_tick_us <= gpio_hal_get_time_us()) {
+                garage_controller_tick(&ctrl, 100);
+                next_tick_us += 100 * 1000;
+            }
+        }
+    }
+};
+
+/**
+ * Test: A clean reed switch closing edge reaches CLOSED through the ISR
+ */
+TEST_F(GpioPathTest, CleanClosingEdgeReachesClosed)
+{
+    gpio_hal_sim_edge_t edge = { 1000, REED_GPIO, 0 };
+    ASSERT_EQ(ESP_OK, gpio_hal_sim_schedule_edges(&edge, 1));
+
+    run_for(10 * 1000);
+
+    EXPECT_EQ(1u, gpio_hal_sim_isr_count(REED_GPIO)) << "One edge should raise one interrupt";
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl)) << "Door should be CLOSED";
+    EXPECT_EQ(0u, gpio_hal_sim_output_edge_count()) << "Sensor input must not drive the relay";
+}
+
+/**
+ * Test: An OPEN command pulses the relay for the configured hold time
+ */
+TEST_F(GpioPathTest, CommandPulsesRelay)
+{
+    gpio_hal_sim_set_input_level(REED_GPIO, 0);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_REED_SWITCH);
+    ASSERT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+
+    run_for(50 * 1000);
+    garage_transition_result_t result = garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    EXPECT_TRUE(result.actions.trigger_button_press) << "OPEN from CLOSED presses the button";
+    EXPECT_TRUE(garage_controller_is_relay_active(&ctrl)) << "Relay should be held";
+
+    run_for(1000 * 1000);
+
+    ASSERT_EQ(2u, gpio_hal_sim_output_edge_count()) << "Relay should rise and fall once";
+    const gpio_hal_sim_edge_t* press = gpio_hal_sim_output_edge(0);
+    const gpio_hal_sim_edge_t* release = gpio_hal_sim_output_edge(1);
+    EXPECT_EQ(RELAY_GPIO, press->gpio_num);
+    EXPECT_EQ(1, press->level);
+    EXPECT_EQ(50 * 1000, press->time_us) << "Relay should close when the command is handled";
+    EXPECT_EQ(0, release->level);
+    EXPECT_GE(release->time_us - press->time_us, 400 * 1000) << "Pulse must last at least 4 ticks";
+    EXPECT_LE(release->time_us - press->time_us, 500 * 1000) << "Pulse must not exceed the hold time";
+    EXPECT_FALSE(garage_controller_is_relay_active(&ctrl));
+}
+
+/**
+ * Test: STOP during the OPEN pulse is refused, so the state machine and the opener both count one press
+ */
+TEST_F(GpioPathTest, StopDuringOpenPulseRefused)
+{
+    gpio_hal_sim_set_input_level(REED_GPIO, 0);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_REED_SWITCH);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    ASSERT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl));
+
+    run_for(200 * 1000);
+    ASSERT_TRUE(garage_controller_is_pressing(&ctrl));
+    garage_transition_result_t result = garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    EXPECT_FALSE(result.state_changed);
+    EXPECT_FALSE(result.actions.trigger_button_press);
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl)) << "The door keeps opening";
+
+    run_for(500 * 1000);
+    EXPECT_EQ(2u, gpio_hal_sim_output_edge_count()) << "One press, not extended by the STOP";
+    EXPECT_EQ(1u, ctrl.relay_press_count);
+
+    // Once released, STOP is a press of its own
+    ASSERT_FALSE(garage_controller_is_pressing(&ctrl));
+    result = garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    EXPECT_TRUE(result.actions.trigger_button_press);
+    EXPECT_EQ(GARAGE_STATE_STOPPED, garage_controller_get_state(&ctrl));
+    EXPECT_EQ(2u, ctrl.relay_press_count);
+}
+
+/**
+ * Test: A command during a press sequence is refused until the last press is released
+ */
+TEST_F(GpioPathTest, CommandDuringPressSequenceRefused)
+{
+    gpio_hal_sim_set_input_level(REED_GPIO, 0);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_REED_SWITCH);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    run_for(1000 * 1000);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    run_for(1000 * 1000);
+    ASSERT_EQ(GARAGE_STATE_STOPPED, garage_controller_get_state(&ctrl));
+
+    // The next press would close, so OPEN takes a sequence
+    garage_transition_result_t result = garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    ASSERT_GT(result.actions.button_presses, 1);
+    uint32_t expected = ctrl.relay_press_count + (uint32_t) result.actions.button_presses - 1;
+
+    run_for(700 * 1000);    // In the gap after the first press
+    ASSERT_FALSE(garage_controller_is_relay_active(&ctrl));
+    ASSERT_TRUE(garage_controller_is_pressing(&ctrl));
+    result = garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_STOP);
+    EXPECT_FALSE(result.actions.trigger_button_press);
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl));
+
+    run_for(5000 * 1000);
+    EXPECT_EQ(expected, ctrl.relay_press_count) << "The sequence is sent as modelled";
+}
+
+/**
+ * Test: A bouncing opening edge settles on the final level without pressing the relay
+ */
+TEST_F(GpioPathTest, BouncingEdgeSettlesOnFinalLevel)
+{
+    gpio_hal_sim_set_input_level(REED_GPIO, 0);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_REED_SWITCH);
+    ASSERT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl));
+
+    int64_t settle_us = gpio_hal_sim_schedule_bounce(REED_GPIO, 2000, 1, 20, 200);
+    ASSERT_GT(settle_us, 0);
+
+    run_for(100 * 1000);
+
+    EXPECT_EQ(21u, gpio_hal_sim_isr_count(REED_GPIO)) << "Every toggle raises an interrupt";
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl)) << "Settled open level means OPENING";
+    EXPECT_EQ(0u, ctrl.relay_press_count) << "Bounce must never press the relay";
+}
+
+/**
+ * Test: High-rate bounce overflows the queue but the sampled level still converges
+ */
+TEST_F(GpioPathTest, HighRateBounceOverflowsQueueButConverges)
+{
+    gpio_hal_sim_set_input_level(REED_GPIO, 1);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_REED_SWITCH);
+    ASSERT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl));
+
+    gpio_hal_sim_schedule_bounce(REED_GPIO, 1000, 0, 200, 50);
+
+    // Slow handler: drains every 5 ms while edges arrive every 50 us
+    run_for(200 * 1000, 5000);
+
+    EXPECT_GT(queue_drops, 0) << "A 5-deep queue cannot absorb a 20 kHz burst";
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_controller_get_state(&ctrl)) << "Final sampled level wins";
+    EXPECT_EQ(0u, gpio_hal_sim_pending_edges());
+}
+
+/**
+ * Test: The opening timeout is reached through the controller tick
+ */
+TEST_F(GpioPathTest, OpeningTimeoutThroughTick)
+{
+    gpio_hal_sim_set_input_level(REED_GPIO, 0);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_REED_SWITCH);
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    gpio_hal_sim_schedule_bounce(REED_GPIO, 300 * 1000, 1, 5, 500);
+
+    run_for(14 * 1000 * 1000, 10 * 1000);
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_controller_get_state(&ctrl)) << "Still inside the timeout";
+
+    run_for(2 * 1000 * 1000, 10 * 1000);
+    EXPECT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl)) << "Timeout should resolve to OPEN";
+    EXPECT_EQ(1u, ctrl.relay_press_count) << "Only the command pressed the relay";
+}
+
+/**
+ * Test: Position publishes are rate limited to the configured step, endpoints always go out
+ */
+TEST_F(GpioPathTest, PositionPublishedInSteps)
+{
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_SENSOR_CLOSED);
+    int position = -1;
+    ASSERT_TRUE(garage_controller_poll_position(&ctrl, &position));
+    EXPECT_EQ(GARAGE_POSITION_CLOSED, position);
+    garage_controller_position_published(&ctrl, position);
+    EXPECT_FALSE(garage_controller_poll_position(&ctrl, &position)) << "Unchanged";
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    std::vector<int> published;
+    for (int t = 0; t < 16000; t += GARAGE_TICK_PERIOD_MS) {
+        garage_controller_tick(&ctrl, GARAGE_TICK_PERIOD_MS);
+        if (garage_controller_poll_position(&ctrl, &position)) {
+            garage_controller_position_published(&ctrl, position);
+            published.push_back(position);
+        }
+    }
+
+    ASSERT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl));
+    ASSERT_GE(published.size(), 2u);
+    EXPECT_EQ(GARAGE_POSITION_OPEN, published.back());
+    for (size_t i = 1; i + 1 < published.size(); i++) {
+        EXPECT_GE(published[i] - published[i - 1], GARAGE_POSITION_STEP_PCT) << "publish " << i;
+    }
+    EXPECT_LE(published.size(), (size_t) (100 / GARAGE_POSITION_STEP_PCT + 1));
+}
+
+/**
+ * Test: A position that failed to publish stays due, and a new broker session gets the position again
+ */
+TEST_F(GpioPathTest, PositionRepublishedAfterFailureAndConnect)
+{
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_SENSOR_CLOSED);
+    int position = -1;
+    ASSERT_TRUE(garage_controller_poll_position(&ctrl, &position));
+    ASSERT_TRUE(garage_controller_poll_position(&ctrl, &position)) << "Not recorded: the publish failed";
+    EXPECT_EQ(GARAGE_POSITION_CLOSED, position);
+    garage_controller_position_published(&ctrl, position);
+    EXPECT_FALSE(garage_controller_poll_position(&ctrl, &position));
+
+    garage_transition_result_t result = garage_controller_handle_input(&ctrl, GARAGE_INPUT_MQTT_CONNECTED);
+    EXPECT_FALSE(result.state_changed);
+    EXPECT_FALSE(result.actions.trigger_button_press);
+    ASSERT_TRUE(garage_controller_poll_position(&ctrl, &position)) << "New session";
+    EXPECT_EQ(GARAGE_POSITION_CLOSED, position);
+}
+
+/**
+ * Test: Input conversion matches the reed switch polarity
+ */
+TEST(GarageController, InputToEvent)
+{
+    EXPECT_EQ(GARAGE_EVENT_SENSOR_CLOSED, garage_input_to_event(GARAGE_INPUT_REED_SWITCH, 0));
+    EXPECT_EQ(GARAGE_EVENT_SENSOR_OPEN, garage_input_to_event(GARAGE_INPUT_REED_SWITCH, 1));
+    EXPECT_EQ(GARAGE_EVENT_SENSOR_CLOSED, garage_input_to_event(GARAGE_INPUT_SENSOR_CLOSED, 1));
+    EXPECT_EQ(GARAGE_EVENT_SENSOR_OPEN, garage_input_to_event(GARAGE_INPUT_SENSOR_OPEN, 0));
+    EXPECT_EQ(GARAGE_EVENT_COMMAND_OPEN, garage_input_to_event(GARAGE_INPUT_COMMAND_OPEN, 0));
+    EXPECT_EQ(GARAGE_EVENT_COMMAND_CLOSE, garage_input_to_event(GARAGE_INPUT_COMMAND_CLOSE, 0));
+    EXPECT_EQ(GARAGE_EVENT_NONE, garage_input_to_event(GARAGE_INPUT_NONE, 0));
+    EXPECT_EQ(GARAGE_EVENT_NONE, garage_input_to_event(GARAGE_INPUT_MQTT_CONNECTED, 0));
+}
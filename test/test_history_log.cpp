@@ -0,0 +1,273 @@
+/**
+ * @file test_history_log.cpp
+ * @brief Unit tests for the flash history ring on the simulated NOR flash
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "flash_hal_sim.h"
+#include "garage_controller.h"
+#include "history_log.h"
+}
+
+#define SECTORS 4
+#define PER_SECTOR (FLASH_HAL_SECTOR_SIZE / HISTORY_RECORD_SIZE)
+
+class HistoryLogTest : public ::testing::Test {
+protected:
+    history_log_t log;
+
+    void SetUp() override
+    {
+        flash_hal_sim_reset(SECTORS * FLASH_HAL_SECTOR_SIZE);
+        ASSERT_EQ(ESP_OK, history_log_init(&log, FLASH_HAL_SIM_LABEL));
+    }
+
+    /// Append n transitions stamped with their index
+    void append(int n)
+    {
+        for (int i = 0; i < n; i++) {
+            ASSERT_NE(0u, history_log_append(&log, HISTORY_TRANSITION, (uint32_t) i, 0, 1, 0));
+        }
+    }
+
+    std::vector<history_record_t> read(uint32_t since, int max = HISTORY_PAGE_MAX)
+    {
+        std::vector<history_record_t> records((size_t) max);
+        int count = history_log_read(&log, since, records.data(), max);
+        records.resize((size_t) count);
+        return records;
+    }
+
+    void reboot()
+    {
+        ASSERT_EQ(ESP_OK, history_log_init(&log, FLASH_HAL_SIM_LABEL));
+    }
+};
+
+/**
+ * Test: Records encode to 16 bytes with a CRC that catches any flipped bit
+ */
+TEST_F(HistoryLogTest, RecordEncoding)
+{
+    history_record_t record = { 0x01020304, 3600, 7, HISTORY_COMMAND, { 4, 1, 0 } };
+    uint8_t raw[HISTORY_RECORD_SIZE];
+    history_record_encode(&record, raw);
+
+    history_record_t decoded;
+    ASSERT_TRUE(history_record_decode(raw, &decoded));
+    EXPECT_EQ(record.seq, decoded.seq);
+    EXPECT_EQ(record.time_s, decoded.time_s);
+    EXPECT_EQ(record.boot, decoded.boot);
+    EXPECT_EQ(record.kind, decoded.kind);
+    EXPECT_EQ(0, memcmp(record.args, decoded.args, sizeof(record.args)));
+
+    for (int bit = 0; bit < HISTORY_RECORD_SIZE * 8; bit++) {
+        uint8_t flipped[HISTORY_RECORD_SIZE];
+        memcpy(flipped, raw, sizeof(raw));
+        flipped[bit / 8] ^= (uint8_t) (1 << (bit % 8));
+        EXPECT_FALSE(history_record_decode(flipped, &decoded)) << bit;
+    }
+
+    uint8_t erased[HISTORY_RECORD_SIZE];
+    memset(erased, 0xFF, sizeof(erased));
+    EXPECT_FALSE(history_record_decode(erased, &decoded));
+}
+
+/**
+ * Test: Records are batched in RAM and programmed in one write when the batch fills
+ */
+TEST_F(HistoryLogTest, WritesAreBatched)
+{
+    append(HISTORY_BATCH_RECORDS - 1);
+    EXPECT_EQ(0u, flash_hal_sim_write_count());
+    EXPECT_EQ((size_t) HISTORY_BATCH_RECORDS - 1, read(0).size());    // Unflushed records are readable
+
+    append(1);
+    EXPECT_EQ(1u, flash_hal_sim_write_count());
+    EXPECT_EQ(1u, flash_hal_sim_erase_count(0));
+    EXPECT_EQ(0, log.batch_count);
+
+    EXPECT_EQ(ESP_OK, history_log_flush(&log));     // Nothing to do
+    EXPECT_EQ(1u, flash_hal_sim_write_count());
+}
+
+/**
+ * Test: Sequence numbers, boot numbers and the write position survive a reboot
+ */
+TEST_F(HistoryLogTest, RecoversAfterReboot)
+{
+    append(20);
+    history_log_flush(&log);
+    reboot();
+    EXPECT_EQ(21u, log.next_seq);
+    EXPECT_EQ(2, log.boot);
+    EXPECT_EQ(20u, log.write_slot);
+
+    EXPECT_EQ(21u, history_log_append(&log, HISTORY_BOOT, 0, 0, 0, 0));
+    history_log_flush(&log);
+    std::vector<history_record_t> records = read(0);
+    ASSERT_EQ(21u, records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(i + 1, records[i].seq);
+    }
+    EXPECT_EQ(2, records[20].boot);
+    EXPECT_EQ(0u, flash_hal_sim_violations());
+}
+
+/**
+ * Test: Batched records that were never flushed are lost on reboot, nothing else
+ */
+TEST_F(HistoryLogTest, UnflushedRecordsLostOnReboot)
+{
+    append(HISTORY_BATCH_RECORDS + 3);
+    reboot();
+    EXPECT_EQ((uint32_t) HISTORY_BATCH_RECORDS + 1, log.next_seq);
+    EXPECT_EQ((size_t) HISTORY_BATCH_RECORDS, read(0).size());
+}
+
+/**
+ * Test: Wrapping erases the oldest sector only, and wear stays even across sectors
+ */
+TEST_F(HistoryLogTest, WrapsWithEvenWear)
+{
+    const int total = 10 * SECTORS * PER_SECTOR + 37;
+    append(total);
+    history_log_flush(&log);
+
+    for (uint32_t s = 0; s < SECTORS; s++) {
+        uint32_t erases = flash_hal_sim_erase_count(s);
+        EXPECT_GE(erases, 10u) << s;
+        EXPECT_LE(erases, 11u) << s;
+    }
+    EXPECT_EQ(0u, flash_hal_sim_violations());
+
+    // The newest full sectors plus the part-filled one survive, in order
+    std::vector<history_record_t> all = read(0, HISTORY_PAGE_MAX);
+    ASSERT_EQ((size_t) HISTORY_PAGE_MAX, all.size());
+    uint32_t oldest = all[0].seq;
+    EXPECT_EQ((uint32_t) total - (SECTORS - 1) * PER_SECTOR - 37 + 1, oldest);
+    for (size_t i = 1; i < all.size(); i++) {
+        EXPECT_EQ(all[i - 1].seq + 1, all[i].seq);
+    }
+
+    reboot();
+    EXPECT_EQ((uint32_t) total + 1, log.next_seq);
+}
+
+/**
+ * Test: Paging from a sequence number returns that record onwards, across flash and RAM
+ */
+TEST_F(HistoryLogTest, PagedReads)
+{
+    append(3 * PER_SECTOR + 5);     // Last 5 still batched
+    std::vector<history_record_t> page = read(500, 10);
+    ASSERT_EQ(10u, page.size());
+    EXPECT_EQ(500u, page[0].seq);
+    EXPECT_EQ(509u, page[9].seq);
+
+    page = read(3 * PER_SECTOR + 2, HISTORY_PAGE_MAX);
+    ASSERT_EQ(4u, page.size());
+    EXPECT_EQ((uint32_t) 3 * PER_SECTOR + 5, page.back().seq);
+
+    EXPECT_TRUE(read(100000).empty());
+}
+
+/**
+ * Test: A write torn by a power cut is skipped on recovery and never reused
+ */
+TEST_F(HistoryLogTest, TornWriteSkipped)
+{
+    append(HISTORY_BATCH_RECORDS);      // One batch on flash
+    append(HISTORY_BATCH_RECORDS - 1);
+    flash_hal_sim_cut_power_after(5 * HISTORY_RECORD_SIZE + 7);
+    EXPECT_NE(ESP_OK, history_log_flush(&log));
+    EXPECT_EQ(1u, log.write_errors);
+    flash_hal_sim_power_on();
+
+    reboot();
+    EXPECT_EQ((uint32_t) HISTORY_BATCH_RECORDS + 6, log.next_seq);     // 5 whole records made it
+    EXPECT_EQ((uint32_t) HISTORY_BATCH_RECORDS + 6, log.write_slot);   // Past the torn one
+
+    append(1);
+    history_log_flush(&log);
+    EXPECT_EQ(0u, flash_hal_sim_violations());
+    std::vector<history_record_t> records = read(0);
+    ASSERT_EQ((size_t) HISTORY_BATCH_RECORDS + 6, records.size());
+    EXPECT_EQ((uint32_t) HISTORY_BATCH_RECORDS + 6, records.back().seq);
+}
+
+/**
+ * Test: A partition that is missing or too small is reported, and the log then stays inert
+ */
+TEST_F(HistoryLogTest, MissingPartition)
+{
+    EXPECT_EQ(ESP_ERR_NOT_FOUND, history_log_init(&log, "nope"));
+    EXPECT_EQ(0u, history_log_append(&log, HISTORY_BOOT, 0, 0, 0, 0));
+    EXPECT_TRUE(read(0).empty());
+
+    flash_hal_sim_reset(FLASH_HAL_SECTOR_SIZE);
+    EXPECT_EQ(ESP_ERR_INVALID_SIZE, history_log_init(&log, FLASH_HAL_SIM_LABEL));
+}
+
+/**
+ * Test: Page requests parse with defaults, limits and rejection of anything else
+ */
+TEST(HistoryQueryTest, Parse)
+{
+    uint32_t since;
+    int count;
+    auto parse = [&](const std::string& s) {
+        return history_log_parse_query(s.data(), (int) s.size(), &since, &count);
+    };
+
+    ASSERT_TRUE(parse(""));
+    EXPECT_EQ(0u, since);
+    EXPECT_EQ(HISTORY_PAGE_MAX, count);
+
+    ASSERT_TRUE(parse("history?since=120&n=16"));
+    EXPECT_EQ(120u, since);
+    EXPECT_EQ(16, count);
+
+    ASSERT_TRUE(parse("n=1000&since=4294967295"));
+    EXPECT_EQ(4294967295u, since);
+    EXPECT_EQ(HISTORY_PAGE_MAX, count);
+
+    for (const char* bad : { "since=", "since=-1", "since=4294967296", "n=0", "n=x", "limit=5", "since",
+                             "since=1&&n=2" }) {
+        EXPECT_FALSE(parse(bad)) << bad;
+    }
+}
+
+/**
+ * Test: Each kind formats as JSON
+ */
+TEST(HistoryQueryTest, Json)
+{
+    char buf[160];
+    history_record_t transition = { 7, 61, 2, HISTORY_TRANSITION, { GARAGE_STATE_CLOSED, GARAGE_STATE_OPENING, 0 } };
+    ASSERT_GT(history_record_to_json(&transition, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"seq\":7,\"boot\":2,\"t\":61,\"kind\":\"transition\",\"from\":\"closed\",\"to\":\"opening\"}", buf);
+
+    history_record_t command = { 8, 62, 2, HISTORY_COMMAND,
+                                 { GARAGE_INPUT_COMMAND_CLOSE, 1, HISTORY_SOURCE_SCHEDULE } };
+    ASSERT_GT(history_record_to_json(&command, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"seq\":8,\"boot\":2,\"t\":62,\"kind\":\"command\",\"command\":\"CLOSE\",\"accepted\":true,"
+                 "\"source\":\"schedule\"}", buf);
+
+    history_record_t fault = { 9, 63, 2, HISTORY_FAULT, { HISTORY_FAULT_OBSTRUCTION, GARAGE_STATE_OPENING, 0 } };
+    ASSERT_GT(history_record_to_json(&fault, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"seq\":9,\"boot\":2,\"t\":63,\"kind\":\"fault\",\"fault\":\"obstruction\",\"state\":\"opening\"}",
+                 buf);
+
+    // 70000 s = 0x011170 after boot, the clock read 2026-10-17T08:30:00Z
+    history_record_t clock = { 10, 1792225800u, 2, HISTORY_CLOCK, { 0x70, 0x11, 0x01 } };
+    ASSERT_GT(history_record_to_json(&clock, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"seq\":10,\"boot\":2,\"t\":70000,\"kind\":\"clock\",\"utc\":1792225800}", buf);
+
+    EXPECT_EQ(-1, history_record_to_json(&fault, buf, 20));
+}
@@ -0,0 +1,108 @@
+/**
+ * @file test_hmac_sha256.cpp
+ * @brief Tests for SHA-256 and HMAC-SHA256 against the FIPS 180-4 and RFC 4231 vectors
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "hmac_sha256.h"
+}
+
+static std::string hex(const uint8_t* bytes, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < len; i++) {
+        out += digits[bytes[i] >> 4];
+        out += digits[bytes[i] & 0x0f];
+    }
+    return out;
+}
+
+static std::string sha256_hex(const std::string& message)
+{
+    sha256_t ctx;
+    uint8_t digest[SHA256_DIGEST_LEN];
+    sha256_init(&ctx);
+    sha256_update(&ctx, message.data(), message.size());
+    sha256_final(&ctx, digest);
+    return hex(digest, sizeof(digest));
+}
+
+static std::string hmac_hex(const std::vector<uint8_t>& key, const std::string& message)
+{
+    uint8_t mac[SHA256_DIGEST_LEN];
+    hmac_sha256(key.data(), key.size(), message.data(), message.size(), mac);
+    return hex(mac, sizeof(mac));
+}
+
+/**
+ * Test: FIPS 180-4 vectors, including a message that needs a second padding block
+ */
+TEST(Sha256Test, KnownVectors)
+{
+    EXPECT_EQ("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855", sha256_hex(""));
+    EXPECT_EQ("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", sha256_hex("abc"));
+    EXPECT_EQ("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+              sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"));
+    EXPECT_EQ("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+              sha256_hex(std::string(1000000, 'a')));
+}
+
+/**
+ * Test: Feeding the message in uneven pieces gives the same digest
+ */
+TEST(Sha256Test, IncrementalMatchesOneShot)
+{
+    std::string message;
+    for (int i = 0; i < 300; i++) {
+        message += (char) (i * 7);
+    }
+    sha256_t ctx;
+    uint8_t digest[SHA256_DIGEST_LEN];
+    sha256_init(&ctx);
+    for (size_t pos = 0, piece = 1; pos < message.size(); pos += piece, piece = piece * 3 % 71 + 1) {
+        sha256_update(&ctx, message.data() + pos, std::min(piece, message.size() - pos));
+    }
+    sha256_final(&ctx, digest);
+    EXPECT_EQ(sha256_hex(message), hex(digest, sizeof(digest)));
+}
+
+/**
+ * Test: RFC 4231 test cases 1, 2, 4 and 6 (short, text, 25-byte and over-long keys)
+ */
+TEST(HmacSha256Test, Rfc4231Vectors)
+{
+    EXPECT_EQ("b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+              hmac_hex(std::vector<uint8_t>(20, 0x0b), "Hi There"));
+
+    std::string jefe = "Jefe";
+    EXPECT_EQ("5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+              hmac_hex(std::vector<uint8_t>(jefe.begin(), jefe.end()), "what do ya want for nothing?"));
+
+    std::vector<uint8_t> key4;
+    for (uint8_t i = 1; i <= 25; i++) {
+        key4.push_back(i);
+    }
+    EXPECT_EQ("82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b",
+              hmac_hex(key4, std::string(50, '\xcd')));
+
+    EXPECT_EQ("60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+              hmac_hex(std::vector<uint8_t>(131, 0xaa), "Test Using Larger Than Block-Size Key - Hash Key First"));
+}
+
+/**
+ * Test: MAC comparison covers every byte of the compared length
+ */
+TEST(HmacSha256Test, EqualComparesAllBytes)
+{
+    uint8_t a[16] = { 0 };
+    uint8_t b[16] = { 0 };
+    EXPECT_TRUE(hmac_sha256_equal(a, b, sizeof(a)));
+    b[15] = 1;
+    EXPECT_FALSE(hmac_sha256_equal(a, b, sizeof(a)));
+    EXPECT_TRUE(hmac_sha256_equal(a, b, 15));
+}
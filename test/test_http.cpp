@@ -0,0 +1,445 @@
+/**
+ * @file test_http.cpp
+ * @brief Tests for the LAN HTTP control endpoint: request parser, routing and the socket server
+ *
+ * Requests are copied into buffers of exactly their length with no NUL
+ * terminator, as they arrive from recv(). The server tests run
+ * http_server_serve_one() on a thread against a loopback client.
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "http_control.h"
+#include "http_request.h"
+#include "metrics.h"
+}
+
+/// Exact-length, unterminated copy of the request; kept until the next call as the slices point into it
+static http_parse_result_t parse(const std::string& text, http_request_t* req)
+{
+    static std::vector<char> buf;
+    buf.assign(text.begin(), text.end());
+    return http_request_parse(buf.data(), buf.size(), req);
+}
+
+static std::string str(http_slice_t slice)
+{
+    return std::string(slice.ptr, slice.len);
+}
+
+/**
+ * Test: Request line, query and the headers the endpoint uses are extracted
+ */
+TEST(HttpRequestTest, ParsesRequestLineAndHeaders)
+{
+    std::string text = "POST /open?source=panel HTTP/1.1\r\n"
+                       "Host: garage.local\r\n"
+                       "authorization:   Bearer s3cret \r\n"
+                       "CONTENT-LENGTH: 12\r\n"
+                       "\r\n"
+                       "ignored body";
+    std::vector<char> buf(text.begin(), text.end());
+    http_request_t req;
+    ASSERT_EQ(HTTP_PARSE_OK, http_request_parse(buf.data(), buf.size(), &req));
+
+    EXPECT_EQ(HTTP_METHOD_POST, req.method);
+    EXPECT_EQ("/open", str(req.path));
+    EXPECT_EQ("source=panel", str(req.query));
+    EXPECT_EQ("Bearer s3cret", str(req.authorization));
+    EXPECT_EQ(12, req.content_length);
+    EXPECT_EQ(text.size() - 12, req.header_len);
+}
+
+/**
+ * Test: Missing headers are reported as absent, other methods as HTTP_METHOD_OTHER
+ */
+TEST(HttpRequestTest, DefaultsForAbsentFields)
+{
+    http_request_t req;
+    ASSERT_EQ(HTTP_PARSE_OK, parse("GET /state HTTP/1.0\r\n\r\n", &req));
+    EXPECT_EQ(HTTP_METHOD_GET, req.method);
+    EXPECT_EQ("/state", str(req.path));
+    EXPECT_EQ(0u, req.query.len);
+    EXPECT_EQ(0u, req.authorization.len);
+    EXPECT_EQ(-1, req.content_length);
+
+    ASSERT_EQ(HTTP_PARSE_OK, parse("DELETE /state HTTP/1.1\r\n\r\n", &req));
+    EXPECT_EQ(HTTP_METHOD_OTHER, req.method);
+}
+
+/**
+ * Test: Every strict prefix of a valid request is incomplete, not malformed
+ */
+TEST(HttpRequestTest, PrefixesAreIncomplete)
+{
+    std::string text = "GET /metrics HTTP/1.1\r\nHost: x\r\nAccept: */*\r\n\r\n";
+    for (size_t len = 0; len < text.size(); len++) {
+        http_request_t req;
+        EXPECT_EQ(HTTP_PARSE_INCOMPLETE, parse(text.substr(0, len), &req)) << "length " << len;
+    }
+}
+
+/**
+ * Test: Malformed request lines and headers are rejected
+ */
+TEST(HttpRequestTest, RejectsMalformedRequests)
+{
+    const char* bad[] = {
+        "\r\n\r\n",
+        "GET\r\n\r\n",
+        "GET /state\r\n\r\n",
+        "GET state HTTP/1.1\r\n\r\n",
+        "GET /state HTTP/2\r\n\r\n",
+        "GET  /state HTTP/1.1\r\n\r\n",
+        "G(T /state HTTP/1.1\r\n\r\n",
+        "GET /st\x01te HTTP/1.1\r\n\r\n",
+        "GET /state HTTP/1.1\r\nNoColon\r\n\r\n",
+        "GET /state HTTP/1.1\r\n: empty-name\r\n\r\n",
+        "GET /state HTTP/1.1\r\nBad Name: x\r\n\r\n",
+        "GET /state HTTP/1.1\r\nHost: a\nb\r\n\r\n",
+        "GET /state HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+        "GET /state HTTP/1.1\r\nContent-Length:\r\n\r\n",
+        "GET /state HTTP/1.1\r\nContent-Length: 99999999999999999999\r\n\r\n",
+        "GET /state HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 1\r\n\r\n",
+    };
+    for (const char* text : bad) {
+        http_request_t req;
+        EXPECT_EQ(HTTP_PARSE_BAD_REQUEST, parse(text, &req)) << text;
+    }
+}
+
+/// Stand-in for the app: records queued commands and serves a fixed snapshot
+struct FakeOwner {
+    std::vector<garage_input_t> queued;
+    bool queue_full = false;
+    garage_controller_snapshot_t snapshot = {};
+};
+
+static bool fake_command(garage_input_t input, void* ctx)
+{
+    FakeOwner* owner = static_cast<FakeOwner*>(ctx);
+    if (owner->queue_full) {
+        return false;
+    }
+    owner->queued.push_back(input);
+    return true;
+}
+
+static void fake_snapshot(garage_controller_snapshot_t* snapshot, void* ctx)
+{
+    *snapshot = static_cast<FakeOwner*>(ctx)->snapshot;
+}
+
+class HttpControlTest : public ::testing::Test {
+protected:
+    FakeOwner owner;
+    http_control_t control;
+
+    void SetUp() override
+    {
+        owner.snapshot.state = GARAGE_STATE_OPEN;
+        owner.snapshot.position = GARAGE_POSITION_OPEN;
+        owner.snapshot.transition_count = 7;
+        owner.snapshot.relay_press_count = 3;
+        owner.snapshot.obstruction_count = 1;
+        init("s3cret");
+    }
+
+    void init(const char* token)
+    {
+        http_control_config_t config = { token, fake_command, fake_snapshot, &owner };
+        http_control_init(&control, &config);
+    }
+
+    std::string handle(const std::string& text)
+    {
+        http_request_t req;
+        EXPECT_EQ(HTTP_PARSE_OK, parse(text, &req));
+        char out[5120];
+        int len = http_control_handle(&control, &req, out, sizeof(out));
+        EXPECT_GT(len, 0);
+        return len > 0 ? std::string(out, (size_t) len) : std::string();
+    }
+
+    static std::string body(const std::string& response)
+    {
+        size_t end = response.find("\r\n\r\n");
+        return end == std::string::npos ? std::string() : response.substr(end + 4);
+    }
+};
+
+/**
+ * Test: GET /state reports the snapshot as JSON with a correct Content-Length
+ */
+TEST_F(HttpControlTest, StateReportsSnapshot)
+{
+    owner.snapshot.obstructed = true;
+    std::string response = handle("GET /state HTTP/1.1\r\n\r\n");
+
+    EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+    EXPECT_NE(std::string::npos, response.find("Content-Type: application/json\r\n"));
+    EXPECT_NE(std::string::npos, response.find("Connection: close\r\n"));
+    std::string json = body(response);
+    EXPECT_EQ("{\"state\":\"open\",\"position\":100,\"obstructed\":true}", json);
+    EXPECT_NE(std::string::npos, response.find("Content-Length: " + std::to_string(json.size()) + "\r\n"));
+}
+
+/**
+ * Test: POST commands need the Bearer token and are queued once accepted
+ */
+TEST_F(HttpControlTest, CommandsNeedToken)
+{
+    EXPECT_EQ(0u, handle("POST /open HTTP/1.1\r\n\r\n").find("HTTP/1.1 401 "));
+    EXPECT_EQ(0u, handle("POST /open HTTP/1.1\r\nAuthorization: Bearer wrong!\r\n\r\n").find("HTTP/1.1 401 "));
+    EXPECT_EQ(0u, handle("POST /open HTTP/1.1\r\nAuthorization: Basic s3cret\r\n\r\n").find("HTTP/1.1 401 "));
+    EXPECT_TRUE(owner.queued.empty());
+
+    std::string response = handle("POST /close HTTP/1.1\r\nAuthorization: Bearer s3cret\r\n\r\n");
+    EXPECT_EQ(0u, response.find("HTTP/1.1 202 Accepted\r\n"));
+    EXPECT_EQ("{\"accepted\":\"CLOSE\"}", body(response));
+    handle("POST /stop HTTP/1.1\r\nAuthorization: Bearer s3cret\r\n\r\n");
+    handle("POST /open HTTP/1.1\r\nAuthorization: Bearer s3cret\r\n\r\n");
+
+    std::vector<garage_input_t> expected = { GARAGE_INPUT_COMMAND_CLOSE, GARAGE_INPUT_COMMAND_STOP,
+                                             GARAGE_INPUT_COMMAND_OPEN };
+    EXPECT_EQ(expected, owner.queued);
+    EXPECT_EQ(3u, control.commands);
+    EXPECT_EQ(3u, control.rejected);
+}
+
+/**
+ * Test: Without a configured token POST is refused outright
+ */
+TEST_F(HttpControlTest, NoTokenRefusesCommands)
+{
+    init("");
+    EXPECT_EQ(0u, handle("POST /open HTTP/1.1\r\nAuthorization: Bearer \r\n\r\n").find("HTTP/1.1 403 "));
+    init(NULL);
+    EXPECT_EQ(0u, handle("POST /open HTTP/1.1\r\n\r\n").find("HTTP/1.1 403 "));
+    EXPECT_TRUE(owner.queued.empty());
+    EXPECT_EQ(0u, handle("GET /state HTTP/1.1\r\n\r\n").find("HTTP/1.1 200 "));
+}
+
+/**
+ * Test: A full state machine queue is reported as 503 so the client can retry
+ */
+TEST_F(HttpControlTest, FullQueueIsServiceUnavailable)
+{
+    owner.queue_full = true;
+    std::string response = handle("POST /open HTTP/1.1\r\nAuthorization: Bearer s3cret\r\n\r\n");
+    EXPECT_EQ(0u, response.find("HTTP/1.1 503 "));
+    EXPECT_NE(std::string::npos, response.find("Retry-After: 1\r\n"));
+    EXPECT_EQ(0u, control.commands);
+}
+
+/**
+ * Test: Unknown paths are 404, known paths with the wrong method 405 with Allow
+ */
+TEST_F(HttpControlTest, RoutingErrors)
+{
+    EXPECT_EQ(0u, handle("GET /nope HTTP/1.1\r\n\r\n").find("HTTP/1.1 404 "));
+    EXPECT_EQ(0u, handle("GET /state/ HTTP/1.1\r\n\r\n").find("HTTP/1.1 404 "));
+
+    std::string get_open = handle("GET /open HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(0u, get_open.find("HTTP/1.1 405 "));
+    EXPECT_NE(std::string::npos, get_open.find("Allow: POST\r\n"));
+
+    std::string post_state = handle("POST /state HTTP/1.1\r\nAuthorization: Bearer s3cret\r\n\r\n");
+    EXPECT_EQ(0u, post_state.find("HTTP/1.1 405 "));
+    EXPECT_NE(std::string::npos, post_state.find("Allow: GET\r\n"));
+    EXPECT_TRUE(owner.queued.empty());
+}
+
+/**
+ * Test: GET /metrics exposes the controller counters, its own request counts and the metrics registry
+ */
+TEST_F(HttpControlTest, MetricsExposition)
+{
+    metrics_reset();
+    metrics_inc(METRIC_MQTT_DISCONNECTS);
+    handle("GET /nope HTTP/1.1\r\n\r\n");
+    std::string response = handle("GET /metrics HTTP/1.1\r\n\r\n");
+    EXPECT_EQ(0u, response.find("HTTP/1.1 200 OK\r\n"));
+    EXPECT_NE(std::string::npos, response.find("Content-Type: text/plain; version=0.0.4\r\n"));
+
+    std::string text = body(response);
+    EXPECT_NE(std::string::npos, text.find("garage_door_state{state=\"open\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_state{state=\"closed\"} 0\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_state{state=\"stopped\"} 0\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_position_percent 100\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_transitions_total 7\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_relay_presses_total 3\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_obstructions_total 1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_http_requests_total 2\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_http_rejected_total 1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_mqtt_disconnects_total 1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_input_handling_seconds_count 0\n"));
+}
+
+/**
+ * Test: /metrics fits the server's response buffer with every value at its widest
+ */
+TEST_F(HttpControlTest, MetricsWorstCaseFits)
+{
+    owner.snapshot.transition_count = UINT32_MAX;
+    owner.snapshot.relay_press_count = UINT32_MAX;
+    owner.snapshot.obstruction_count = UINT32_MAX;
+    control.requests = UINT32_MAX - 1;
+    control.commands = UINT32_MAX;
+    control.rejected = UINT32_MAX;
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        metrics_set((metric_id_t) id, id % 2 == 0 ? -1 : INT32_MIN);
+    }
+    for (int i = 0; i < 1000; i++) {
+        metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 4000000000000LL);
+        metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 4000000000000LL);
+    }
+
+    http_request_t req;
+    ASSERT_EQ(HTTP_PARSE_OK, parse("GET /metrics HTTP/1.1\r\n\r\n", &req));
+    std::vector<char> out(5120);                                    // HTTP_SERVER_RESPONSE_MAX
+    EXPECT_GT(http_control_handle(&control, &req, out.data(), out.size()), 0);
+    metrics_reset();
+}
+
+/**
+ * Test: A response that does not fit is reported instead of being truncated
+ */
+TEST_F(HttpControlTest, SmallBufferFails)
+{
+    http_request_t req;
+    ASSERT_EQ(HTTP_PARSE_OK, parse("GET /metrics HTTP/1.1\r\n\r\n", &req));
+    char out[256];
+    EXPECT_EQ(-1, http_control_handle(&control, &req, out, sizeof(out)));
+    EXPECT_EQ(-1, http_control_error(&control, 400, out, 16));
+    EXPECT_GT(http_control_error(&control, 400, out, sizeof(out)), 0);
+}
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+extern "C" {
+#include "http_server.h"
+}
+
+/// Send a request over loopback and read the response until the server closes
+static std::string round_trip(uint16_t port, const std::string& request)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return std::string();
+    }
+
+    // Sent in two pieces so the server has to reassemble the headers
+    size_t half = request.size() / 2;
+    send(fd, request.data(), half, 0);
+    send(fd, request.data() + half, request.size() - half, 0);
+
+    std::string response;
+    char buf[256];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, (size_t) n);
+    }
+    close(fd);
+    return response;
+}
+
+/**
+ * Test: The server answers real clients over loopback, command included
+ */
+TEST_F(HttpControlTest, ServerAnswersLoopbackClients)
+{
+    int listen_fd = http_server_listen(0);
+    ASSERT_GE(listen_fd, 0);
+    uint16_t port = http_server_port(listen_fd);
+    ASSERT_NE(0, port);
+
+    std::vector<int> statuses;
+    std::thread server([&] {
+        for (int i = 0; i < 4; i++) {
+            statuses.push_back(http_server_serve_one(listen_fd, &control));
+        }
+    });
+
+    std::string state = round_trip(port, "GET /state HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    std::string open = round_trip(port, "POST /open HTTP/1.1\r\nAuthorization: Bearer s3cret\r\n"
+                                      "Content-Length: 4\r\n\r\nOPEN");
+    std::string bad = round_trip(port, "GARBAGE\r\n\r\n");
+    std::string huge = round_trip(port, "GET /state HTTP/1.1\r\nX-Pad: " +
+                                          std::string(HTTP_SERVER_REQUEST_MAX, 'a') + "\r\n\r\n");
+    server.join();
+    http_server_close(listen_fd);
+
+    EXPECT_EQ(0u, state.find("HTTP/1.1 200 OK\r\n"));
+    EXPECT_EQ("{\"state\":\"open\",\"position\":100,\"obstructed\":false}", body(state));
+    EXPECT_EQ(0u, open.find("HTTP/1.1 202 Accepted\r\n"));
+    EXPECT_EQ(0u, bad.find("HTTP/1.1 400 "));
+    EXPECT_EQ(0u, huge.find("HTTP/1.1 431 "));
+
+    std::vector<int> expected = { 200, 202, 400, 431 };
+    EXPECT_EQ(expected, statuses);
+    ASSERT_EQ(1u, owner.queued.size());
+    EXPECT_EQ(GARAGE_INPUT_COMMAND_OPEN, owner.queued[0]);
+}
+
+/**
+ * Test: A client trickling its request in a byte at a time is cut off at the request deadline
+ */
+TEST_F(HttpControlTest, SlowClientHitsRequestDeadline)
+{
+    int listen_fd = http_server_listen(0);
+    ASSERT_GE(listen_fd, 0);
+    uint16_t port = http_server_port(listen_fd);
+    ASSERT_NE(0, port);
+
+    int status = 0;
+    std::thread server([&] { status = http_server_serve_one(listen_fd, &control); });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+
+    // Every byte well within the old per-read timeout; the whole request would take 10 s
+    const std::string request = "GET /state HTTP/1.1\r\nHost: localhost\r\nX-Slow: " + std::string(20, 'a') +
+                                "\r\n\r\n";
+    auto start = std::chrono::steady_clock::now();
+    std::string response;
+    for (size_t i = 0; i < request.size() && response.empty(); i++) {
+        if (send(fd, request.data() + i, 1, MSG_NOSIGNAL) != 1) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        char buf[256];
+        ssize_t n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (n > 0) {
+            response.append(buf, (size_t) n);
+        }
+    }
+    server.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    close(fd);
+    http_server_close(listen_fd);
+
+    EXPECT_EQ(408, status);
+    EXPECT_EQ(0u, response.find("HTTP/1.1 408 ")) << response;
+    EXPECT_GE(elapsed, std::chrono::milliseconds(HTTP_SERVER_REQUEST_TIMEOUT_MS - 200));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(HTTP_SERVER_REQUEST_TIMEOUT_MS + 1500));
+}
+#endif
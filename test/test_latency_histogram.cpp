@@ -0,0 +1,144 @@
+/**
+ * @file test_latency_histogram.cpp
+ * @brief Unit tests for the latency histogram used by BENCH_MODE
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+
+extern "C" {
+#include "latency_histogram.h"
+}
+
+class LatencyHistogramTest : public ::testing::Test {
+protected:
+    latency_histogram_t hist;
+
+    void SetUp() override
+    {
+        latency_histogram_init(&hist);
+    }
+};
+
+/**
+ * Test: An empty histogram reports zeros
+ */
+TEST_F(LatencyHistogramTest, EmptyHistogram)
+{
+    EXPECT_EQ(0u, hist.count);
+    EXPECT_EQ(0, latency_histogram_percentile(&hist, 500));
+    EXPECT_EQ(0, latency_histogram_mean(&hist));
+}
+
+/**
+ * Test: Values below the sub-bucket count get their own bucket
+ */
+TEST_F(LatencyHistogramTest, SmallValuesAreExact)
+{
+    for (int64_t v = 0; v < LATENCY_HISTOGRAM_SUB_BUCKETS; v++) {
+        EXPECT_EQ(v, latency_histogram_bucket(v));
+        EXPECT_EQ(v, latency_histogram_bucket_upper_us(latency_histogram_bucket(v)));
+    }
+}
+
+/**
+ * Test: Every value lands in a bucket whose upper bound is within 12.5% above it
+ */
+TEST_F(LatencyHistogramTest, BucketErrorBounded)
+{
+    int previous = -1;
+    for (int64_t v = 0; v <= LATENCY_HISTOGRAM_MAX_US; v += 1 + v / 97) {
+        int bucket = latency_histogram_bucket(v);
+        ASSERT_GE(bucket, previous) << "Buckets must be monotonic, value " << v;
+        ASSERT_LT(bucket, LATENCY_HISTOGRAM_BUCKETS);
+        int64_t upper = latency_histogram_bucket_upper_us(bucket);
+        ASSERT_GE(upper, v);
+        ASSERT_LE(upper - v, v / 8) << "value " << v;
+        previous = bucket;
+    }
+    EXPECT_EQ(LATENCY_HISTOGRAM_BUCKETS - 1, latency_histogram_bucket(LATENCY_HISTOGRAM_MAX_US));
+    EXPECT_EQ(LATENCY_HISTOGRAM_MAX_US, latency_histogram_bucket_upper_us(LATENCY_HISTOGRAM_BUCKETS - 1));
+}
+
+/**
+ * Test: Percentiles of a uniform 1..10000 us run are within the bucket error
+ */
+TEST_F(LatencyHistogramTest, PercentilesOfUniformData)
+{
+    for (int64_t v = 1; v <= 10000; v++) {
+        latency_histogram_record(&hist, v);
+    }
+
+    EXPECT_EQ(10000u, hist.count);
+    EXPECT_EQ(1, hist.min_us);
+    EXPECT_EQ(10000, hist.max_us);
+    EXPECT_EQ(5000, latency_histogram_mean(&hist));
+
+    const int per_mille[] = {500, 900, 990, 999};
+    for (int p : per_mille) {
+        int64_t expected = 10 * p;
+        int64_t actual = latency_histogram_percentile(&hist, p);
+        EXPECT_GE(actual, expected) << "p" << p;
+        EXPECT_LE(actual, expected + expected / 8) << "p" << p;
+    }
+    EXPECT_EQ(10000, latency_histogram_percentile(&hist, 1000));
+}
+
+/**
+ * Test: Percentiles never exceed the exact maximum
+ */
+TEST_F(LatencyHistogramTest, PercentileCappedAtMax)
+{
+    latency_histogram_record(&hist, 1000);
+    EXPECT_EQ(1000, latency_histogram_percentile(&hist, 500));
+    EXPECT_EQ(1000, latency_histogram_percentile(&hist, 999));
+}
+
+/**
+ * Test: Negative values clamp to zero and huge values count as overflow
+ */
+TEST_F(LatencyHistogramTest, OutOfRangeValues)
+{
+    latency_histogram_record(&hist, -5);
+    latency_histogram_record(&hist, LATENCY_HISTOGRAM_MAX_US * 4);
+
+    EXPECT_EQ(1u, hist.counts[0]);
+    EXPECT_EQ(1u, hist.counts[LATENCY_HISTOGRAM_BUCKETS - 1]);
+    EXPECT_EQ(1u, hist.overflow);
+    EXPECT_EQ(0, hist.min_us);
+    EXPECT_EQ(LATENCY_HISTOGRAM_MAX_US * 4, hist.max_us);
+}
+
+/**
+ * Test: JSON holds the summary and the non-empty buckets
+ */
+TEST_F(LatencyHistogramTest, JsonOutput)
+{
+    latency_histogram_record(&hist, 3);
+    latency_histogram_record(&hist, 3);
+    latency_histogram_record(&hist, 100);
+
+    char buf[512];
+    int len = latency_histogram_to_json(&hist, "relay", buf, sizeof(buf));
+    ASSERT_GT(len, 0);
+    EXPECT_EQ((size_t) len, strlen(buf));
+
+    std::string json(buf);
+    EXPECT_EQ(0u, json.find("{\"name\":\"relay\",\"count\":3,\"overflow\":0,\"min_us\":3,\"mean_us\":35,"));
+    EXPECT_NE(std::string::npos, json.find("\"max_us\":100,"));
+    EXPECT_NE(std::string::npos, json.find("\"buckets\":[[3,2],[103,1]]}"));
+}
+
+/**
+ * Test: A buffer too small for the output fails cleanly
+ */
+TEST_F(LatencyHistogramTest, JsonTruncationFails)
+{
+    for (int64_t v = 1; v < 100000; v *= 2) {
+        latency_histogram_record(&hist, v);
+    }
+
+    char buf[64];
+    EXPECT_EQ(-1, latency_histogram_to_json(&hist, "relay", buf, sizeof(buf)));
+    EXPECT_EQ(-1, latency_histogram_to_json(&hist, "relay", buf, 0));
+}
@@ -0,0 +1,170 @@
+/**
+ * @file test_metrics.cpp
+ * @brief Unit tests for the metrics registry and its Prometheus and JSON exporters
+ */
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "garage_state_machine.h"
+#include "metrics.h"
+}
+
+class MetricsTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        metrics_reset();
+    }
+
+    static std::string prometheus()
+    {
+        std::vector<char> buf(8192);
+        int len = metrics_to_prometheus(buf.data(), buf.size());
+        EXPECT_GT(len, 0);
+        return len > 0 ? std::string(buf.data(), (size_t) len) : std::string();
+    }
+
+    static std::string json()
+    {
+        std::vector<char> buf(4096);
+        int len = metrics_to_json(buf.data(), buf.size());
+        EXPECT_GT(len, 0);
+        return len > 0 ? std::string(buf.data(), (size_t) len) : std::string();
+    }
+
+    static size_t occurrences(const std::string& text, const std::string& pattern)
+    {
+        size_t count = 0;
+        for (size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+            count++;
+        }
+        return count;
+    }
+};
+
+/**
+ * Test: Counters, gauges and labelled series are exposed with one TYPE line per family
+ */
+TEST_F(MetricsTest, PrometheusScalars)
+{
+    metrics_inc(METRIC_WIFI_DISCONNECTS);
+    metrics_inc(METRIC_WIFI_DISCONNECTS);
+    metrics_set(METRIC_MQTT_CONNECTED, 1);
+    metrics_set(METRIC_WIFI_CONNECTED, -1);
+    metrics_inc(METRIC_INPUT_FULL_HTTP);
+    EXPECT_EQ(2u, metrics_get(METRIC_WIFI_DISCONNECTS));
+
+    std::string text = prometheus();
+    EXPECT_NE(std::string::npos, text.find("# TYPE garage_door_wifi_disconnects_total counter\n"
+                                           "garage_door_wifi_disconnects_total 2\n"));
+    EXPECT_NE(std::string::npos, text.find("# TYPE garage_door_mqtt_connected gauge\n"
+                                           "garage_door_mqtt_connected 1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_wifi_connected -1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_queue_full_total{queue=\"input\",source=\"http\"} 1\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_queue_full_total{queue=\"schedule\",source=\"mqtt\"} 0\n"));
+    EXPECT_EQ(1u, occurrences(text, "# TYPE garage_door_queue_full_total counter\n"));
+    EXPECT_EQ(1u, occurrences(text, "# TYPE garage_door_state_entries_total counter\n"));
+}
+
+/**
+ * Test: Every door state has its own entry counter, labelled with the state's name
+ */
+TEST_F(MetricsTest, StateEntriesFollowStates)
+{
+    for (int state = GARAGE_STATE_CLOSED; state <= GARAGE_STATE_STOPPED; state++) {
+        for (int i = 0; i <= state; i++) {
+            metrics_inc(metrics_state_entries(state));
+        }
+    }
+    std::string text = prometheus();
+    for (int state = GARAGE_STATE_CLOSED; state <= GARAGE_STATE_STOPPED; state++) {
+        std::string line = std::string("garage_door_state_entries_total{state=\"") +
+                           garage_state_to_string((garage_state_t) state) + "\"} " + std::to_string(state + 1) + "\n";
+        EXPECT_NE(std::string::npos, text.find(line)) << line;
+    }
+    EXPECT_EQ(METRIC_STATE_UNKNOWN, metrics_state_entries(-1));
+    EXPECT_EQ(METRIC_STATE_UNKNOWN, metrics_state_entries(GARAGE_STATE_STOPPED + 1));
+}
+
+/**
+ * Test: Histogram buckets are cumulative, bounds inclusive, and sums kept beyond 32 bits
+ */
+TEST_F(MetricsTest, HistogramBuckets)
+{
+    metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 100);
+    metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 200);         // On the bound: the le="0.0002" bucket
+    metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 201);
+    metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, -5);          // Recorded as 0
+    metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 5000000000LL);
+
+    uint32_t buckets[METRICS_HISTOGRAM_BOUNDS + 1];
+    uint64_t sum_us;
+    EXPECT_EQ(5u, metrics_read_histogram(METRIC_HISTOGRAM_INPUT_HANDLING, buckets, &sum_us));
+    EXPECT_EQ(3u, buckets[0]);
+    EXPECT_EQ(1u, buckets[1]);
+    EXPECT_EQ(1u, buckets[METRICS_HISTOGRAM_BOUNDS]);
+    EXPECT_EQ(5000000501ULL, sum_us);
+
+    std::string text = prometheus();
+    EXPECT_NE(std::string::npos, text.find("# TYPE garage_door_input_handling_seconds histogram\n"
+                                           "garage_door_input_handling_seconds_bucket{le=\"0.000200\"} 3\n"
+                                           "garage_door_input_handling_seconds_bucket{le=\"0.000500\"} 4\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_input_handling_seconds_bucket{le=\"0.200000\"} 4\n"
+                                           "garage_door_input_handling_seconds_bucket{le=\"+Inf\"} 5\n"
+                                           "garage_door_input_handling_seconds_sum 5000.000501\n"
+                                           "garage_door_input_handling_seconds_count 5\n"));
+    EXPECT_NE(std::string::npos, text.find("garage_door_mqtt_connect_seconds_count 0\n"));
+}
+
+/**
+ * Test: The JSON export nests labelled families and carries histograms in microseconds
+ */
+TEST_F(MetricsTest, JsonShape)
+{
+    metrics_inc(METRIC_MQTT_DISCONNECTS);
+    metrics_inc(METRIC_INPUT_FULL_REED);
+    metrics_inc(metrics_state_entries(GARAGE_STATE_OPEN));
+    metrics_inc(METRIC_SIGNED_REJECTED);
+    metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 300000);
+    metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 4294967296LL);
+
+    std::string text = json();
+    EXPECT_EQ(0u, text.find("{\"wifi_disconnects_total\":0,\"wifi_connected\":0,\"mqtt_disconnects_total\":1,"));
+    EXPECT_NE(std::string::npos, text.find("\"queue_full_total\":{\"input.reed_switch\":1,\"input.mqtt\":0,"));
+    EXPECT_NE(std::string::npos, text.find("\"schedule.mqtt\":0},\"state_entries_total\":{\"closed\":0,\"open\":1,"));
+    EXPECT_NE(std::string::npos, text.find("\"signed_commands_total\":{\"accepted\":0,\"rejected\":1}"));
+    EXPECT_NE(std::string::npos,
+              text.find("\"mqtt_connect_seconds\":{\"le_us\":[100000,250000,500000,1000000,2000000,5000000,"
+                        "10000000,30000000],\"buckets\":[0,0,1,1,1,1,1,1],\"count\":2,\"sum_us\":4295267296}}"));
+    EXPECT_EQ('}', text.back());
+    EXPECT_EQ(occurrences(text, "{"), occurrences(text, "}"));
+    EXPECT_EQ(occurrences(text, "["), occurrences(text, "]"));
+}
+
+/**
+ * Test: The worst case fits the firmware's buffers, and a short buffer is refused rather than cut
+ */
+TEST_F(MetricsTest, BufferLimits)
+{
+    for (int id = 0; id < METRIC_COUNT; id++) {
+        metrics_set((metric_id_t) id, id % 2 == 0 ? -1 : INT32_MIN);       // Widest counter and gauge values
+    }
+    for (int i = 0; i < 1000; i++) {
+        metrics_observe(METRIC_HISTOGRAM_INPUT_HANDLING, 4000000000000LL);
+        metrics_observe(METRIC_HISTOGRAM_MQTT_CONNECT, 4000000000000LL);
+    }
+
+    std::vector<char> buf(4096);
+    int json_len = metrics_to_json(buf.data(), 1280);                       // METRICS_JSON_MAX
+    EXPECT_GT(json_len, 0);
+    EXPECT_EQ(-1, metrics_to_json(buf.data(), (size_t) json_len));
+    EXPECT_EQ(json_len, metrics_to_json(buf.data(), (size_t) json_len + 1));
+
+    int text_len = metrics_to_prometheus(buf.data(), buf.size());          // All of /metrics: test_http.cpp
+    EXPECT_GT(text_len, 0);
+    EXPECT_EQ(-1, metrics_to_prometheus(buf.data(), (size_t) text_len));
+    EXPECT_EQ(-1, metrics_to_prometheus(nullptr, 100));
+}
@@ -0,0 +1,462 @@
+/**
+ * @file test_mqtt_ingress.cpp
+ * @brief Tests for the MQTT ingress path: command classification and mqtt_impl.c's event handler
+ *
+ * Broker buffers are copied into allocations of exactly their length with no
+ * NUL terminator, as esp-mqtt delivers them. fuzz/fuzz_mqtt_ingress.cpp covers
+ * the same path with generated input.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "garage_command.h"
+#include "metrics.h"
+#include "mqtt_hal_sim.h"
+#include "mqtt_interface.h"
+}
+
+#define COMMAND_TOPIC "garage_door/buttonpress"
+#define STATUS_TOPIC "garage_door/status"
+#define SCHEDULE_PREFIX "garage_door/schedule/rules/"
+#define HISTORY_TOPIC "garage_door/history/get"
+#define DEBUG_TOPIC "garage_door/debug/cmd"
+
+static const garage_command_topics_t topics = { COMMAND_TOPIC, STATUS_TOPIC, SCHEDULE_PREFIX, HISTORY_TOPIC,
+                                                DEBUG_TOPIC };
+
+/// Exact-length, unterminated copy of a broker buffer
+static std::vector<char> buffer(const std::string& s)
+{
+    return std::vector<char>(s.begin(), s.end());
+}
+
+static garage_message_t classify(const std::string& topic, const std::string& data)
+{
+    std::vector<char> t = buffer(topic);
+    std::vector<char> d = buffer(data);
+    return garage_command_classify(&topics, t.data(), (int) t.size(), d.data(), (int) d.size());
+}
+
+/**
+ * Test: OPEN, CLOSE and STOP on the command topic become commands
+ */
+TEST(GarageCommandTest, ValidCommands)
+{
+    garage_message_t open = classify(COMMAND_TOPIC, "OPEN");
+    EXPECT_EQ(GARAGE_MESSAGE_COMMAND, open.kind);
+    EXPECT_EQ(GARAGE_INPUT_COMMAND_OPEN, open.input);
+
+    garage_message_t close = classify(COMMAND_TOPIC, "CLOSE");
+    EXPECT_EQ(GARAGE_MESSAGE_COMMAND, close.kind);
+    EXPECT_EQ(GARAGE_INPUT_COMMAND_CLOSE, close.input);
+
+    garage_message_t stop = classify(COMMAND_TOPIC, "STOP");
+    EXPECT_EQ(GARAGE_MESSAGE_COMMAND, stop.kind);
+    EXPECT_EQ(GARAGE_INPUT_COMMAND_STOP, stop.input);
+}
+
+/**
+ * Test: Prefixes, suffixes, case changes and embedded NULs do not match
+ */
+TEST(GarageCommandTest, NearMissesAreInvalid)
+{
+    const std::string payloads[] = {
+        "", "OPE", "OPENX", "open", "OPEN ", std::string("OPEN\0", 5), std::string("OP\0N", 4), "CLOSEOPEN", "stop",
+    };
+    for (const std::string& payload : payloads) {
+        garage_message_t message = classify(COMMAND_TOPIC, payload);
+        EXPECT_EQ(GARAGE_MESSAGE_INVALID_COMMAND, message.kind) << "payload size " << payload.size();
+        EXPECT_EQ(GARAGE_INPUT_NONE, message.input);
+    }
+
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify("garage_door/buttonpres", "OPEN").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify(std::string(COMMAND_TOPIC "\0", 24), "OPEN").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify("garage_door/buttonpress/x", "OPEN").kind);
+}
+
+/**
+ * Test: A command word, a space and more is passed on for signature checks, never as a command
+ */
+TEST(GarageCommandTest, SignedCommandShape)
+{
+    for (const char* payload : { "OPEN 1 00", "CLOSE x", "STOP 42 0123456789abcdef0123456789abcdef" }) {
+        garage_message_t message = classify(COMMAND_TOPIC, payload);
+        EXPECT_EQ(GARAGE_MESSAGE_SIGNED_COMMAND, message.kind) << payload;
+        EXPECT_EQ(GARAGE_INPUT_NONE, message.input);
+    }
+    EXPECT_EQ(GARAGE_MESSAGE_INVALID_COMMAND, classify(COMMAND_TOPIC, "OPEN ").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_INVALID_COMMAND, classify(COMMAND_TOPIC, "OPENX 1 00").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_STATUS, classify(STATUS_TOPIC, "OPEN 1 00").kind);
+}
+
+/**
+ * Test: The status topic is recognized regardless of payload
+ */
+TEST(GarageCommandTest, StatusTopic)
+{
+    EXPECT_EQ(GARAGE_MESSAGE_STATUS, classify(STATUS_TOPIC, "closed").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_STATUS, classify(STATUS_TOPIC, "").kind);
+    EXPECT_EQ(GARAGE_INPUT_NONE, classify(STATUS_TOPIC, "OPEN").input);
+}
+
+/**
+ * Test: Topics one level below the schedule prefix carry a rule, with the id pointing into the topic
+ */
+TEST(GarageCommandTest, ScheduleRuleTopics)
+{
+    std::vector<char> topic = buffer(SCHEDULE_PREFIX "evening");
+    std::vector<char> rule = buffer("auto_close 10");
+    garage_message_t message = garage_command_classify(&topics, topic.data(), (int) topic.size(), rule.data(),
+                                                       (int) rule.size());
+    EXPECT_EQ(GARAGE_MESSAGE_SCHEDULE_RULE, message.kind);
+    EXPECT_EQ(topic.data() + strlen(SCHEDULE_PREFIX), message.rule_id);
+    EXPECT_EQ(7, message.rule_id_len);
+    EXPECT_EQ(GARAGE_INPUT_NONE, message.input);
+
+    EXPECT_EQ(GARAGE_MESSAGE_SCHEDULE_RULE, classify(SCHEDULE_PREFIX "x", "").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify(SCHEDULE_PREFIX, "auto_close 10").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify(SCHEDULE_PREFIX "a/b", "auto_close 10").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify("garage_door/schedule/rule/x", "auto_close 10").kind);
+
+    const garage_command_topics_t no_schedule = { COMMAND_TOPIC, STATUS_TOPIC, NULL };
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC,
+              garage_command_classify(&no_schedule, topic.data(), (int) topic.size(), rule.data(), 13).kind);
+}
+
+/**
+ * Test: Page requests are recognised by exact topic; the query itself is parsed by the history log
+ */
+TEST(GarageCommandTest, HistoryQueryTopic)
+{
+    EXPECT_EQ(GARAGE_MESSAGE_HISTORY_QUERY, classify(HISTORY_TOPIC, "since=10&n=5").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_HISTORY_QUERY, classify(HISTORY_TOPIC, "").kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify(HISTORY_TOPIC "/", "").kind);
+    EXPECT_EQ(GARAGE_INPUT_NONE, classify(HISTORY_TOPIC, "OPEN").input);
+}
+
+/**
+ * Test: Messages on the debug topic are report requests; without a debug topic they are unknown
+ */
+TEST(GarageCommandTest, DebugCommandTopic)
+{
+    EXPECT_EQ(GARAGE_MESSAGE_DEBUG_COMMAND, classify(DEBUG_TOPIC, "tasks").kind);
+    EXPECT_EQ(GARAGE_INPUT_NONE, classify(DEBUG_TOPIC, "OPEN").input);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, classify(DEBUG_TOPIC "x", "tasks").kind);
+
+    const garage_command_topics_t no_debug = { COMMAND_TOPIC, STATUS_TOPIC, SCHEDULE_PREFIX, HISTORY_TOPIC, NULL };
+    std::vector<char> topic = buffer(DEBUG_TOPIC);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC,
+              garage_command_classify(&no_debug, topic.data(), (int) topic.size(), "all", 3).kind);
+}
+
+/**
+ * Test: NULL buffers and negative lengths are rejected without reading
+ */
+TEST(GarageCommandTest, InvalidBuffers)
+{
+    std::vector<char> topic = buffer(COMMAND_TOPIC);
+    std::vector<char> open = buffer("OPEN");
+
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, garage_command_classify(&topics, NULL, 23, open.data(), 4).kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, garage_command_classify(&topics, topic.data(), -23, open.data(), 4).kind);
+    EXPECT_EQ(GARAGE_MESSAGE_INVALID_COMMAND, garage_command_classify(&topics, topic.data(), 23, NULL, 4).kind);
+    EXPECT_EQ(GARAGE_MESSAGE_INVALID_COMMAND, garage_command_classify(&topics, topic.data(), 23, open.data(), -4).kind);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC, garage_command_classify(NULL, topic.data(), 23, open.data(), 4).kind);
+}
+
+/**
+ * Test: Plain commands and schedule rules are the unsigned messages that can move the door
+ */
+TEST(GarageCommandTest, UnsignedControl)
+{
+    EXPECT_TRUE(garage_command_is_unsigned_control(classify(COMMAND_TOPIC, "CLOSE").kind));
+    EXPECT_TRUE(garage_command_is_unsigned_control(classify(SCHEDULE_PREFIX "evening", "auto_close 1").kind));
+    EXPECT_TRUE(garage_command_is_unsigned_control(classify(SCHEDULE_PREFIX "night", "lockout 00:00 23:59").kind));
+    EXPECT_TRUE(garage_command_is_unsigned_control(classify(SCHEDULE_PREFIX "evening", "").kind)) << "Deleting one too";
+
+    EXPECT_FALSE(garage_command_is_unsigned_control(classify(COMMAND_TOPIC, "OPEN 43 5f0c1e").kind));
+    EXPECT_FALSE(garage_command_is_unsigned_control(classify(COMMAND_TOPIC, "OPENX").kind));
+    EXPECT_FALSE(garage_command_is_unsigned_control(classify(STATUS_TOPIC, "open").kind));
+    EXPECT_FALSE(garage_command_is_unsigned_control(classify(HISTORY_TOPIC, "since=10&n=5").kind));
+    EXPECT_FALSE(garage_command_is_unsigned_control(classify(DEBUG_TOPIC, "tasks").kind));
+}
+
+/**
+ * Test: Log excerpt lengths are never negative and are capped
+ */
+TEST(GarageCommandTest, LogLength)
+{
+    const char* data = "x";
+    EXPECT_EQ(0, garage_command_log_len(NULL, 10));
+    EXPECT_EQ(0, garage_command_log_len(data, -1));
+    EXPECT_EQ(1, garage_command_log_len(data, 1));
+    EXPECT_EQ(GARAGE_COMMAND_LOG_MAX, garage_command_log_len(data, 1 << 30));
+}
+
+class MqttIngressTest : public ::testing::Test {
+protected:
+    struct Received {
+        int count = 0;
+        const char* topic = nullptr;
+        int topic_len = 0;
+        const char* data = nullptr;
+        int data_len = 0;
+        int published_msg_id = 0;
+    };
+    static Received received;
+
+    static void on_data(const char* topic, int topic_len, const char* data, int data_len)
+    {
+        received.count++;
+        received.topic = topic;
+        received.topic_len = topic_len;
+        received.data = data;
+        received.data_len = data_len;
+    }
+
+    static void on_published(int msg_id)
+    {
+        received.published_msg_id = msg_id;
+    }
+
+    void SetUp() override
+    {
+        static const mqtt_event_callbacks_t callbacks = { nullptr, nullptr, on_data, on_published };
+        static const mqtt_config_t config = {
+            "broker.local", 1883, nullptr, nullptr, "garage_door/availability", "unavailable",
+        };
+        received = Received();
+        mqtt_hal_sim_reset();
+        mqtt_init(&config, &callbacks);
+    }
+
+    static esp_mqtt_event_t data_event(std::vector<char>& topic, std::vector<char>& data)
+    {
+        esp_mqtt_event_t event = {};
+        event.event_id = MQTT_EVENT_DATA;
+        event.topic = topic.data();
+        event.topic_len = (int) topic.size();
+        event.data = data.data();
+        event.data_len = (int) data.size();
+        event.total_data_len = event.data_len;
+        return event;
+    }
+};
+
+MqttIngressTest::Received MqttIngressTest::received;
+
+/**
+ * Test: A data event reaches on_data with the broker's buffers and lengths unchanged
+ */
+TEST_F(MqttIngressTest, DataEventReachesCallback)
+{
+    std::vector<char> topic = buffer(COMMAND_TOPIC);
+    std::vector<char> data = buffer("OPEN");
+    esp_mqtt_event_t event = data_event(topic, data);
+
+    ASSERT_EQ(ESP_OK, mqtt_hal_sim_dispatch(&event));
+    EXPECT_EQ(1, received.count);
+    EXPECT_EQ(topic.data(), received.topic);
+    EXPECT_EQ(23, received.topic_len);
+    EXPECT_EQ(data.data(), received.data);
+    EXPECT_EQ(4, received.data_len);
+}
+
+/**
+ * Test: Chunks of a payload larger than the client buffer are not passed on
+ */
+TEST_F(MqttIngressTest, ChunkedPayloadIgnored)
+{
+    std::vector<char> topic = buffer(COMMAND_TOPIC);
+    std::vector<char> data = buffer("OPEN");
+    esp_mqtt_event_t event = data_event(topic, data);
+    event.total_data_len = 4096;
+
+    mqtt_hal_sim_dispatch(&event);
+    event.topic = nullptr;
+    event.topic_len = 0;
+    event.current_data_offset = 4092;
+    mqtt_hal_sim_dispatch(&event);
+
+    EXPECT_EQ(0, received.count);
+}
+
+/**
+ * Test: Logging a huge payload costs a bounded excerpt, not the whole payload
+ */
+TEST_F(MqttIngressTest, HugePayloadLogIsBounded)
+{
+    std::vector<char> topic = buffer(STATUS_TOPIC);
+    std::vector<char> data(1 << 20, 'A');
+    esp_mqtt_event_t event = data_event(topic, data);
+
+    mqtt_hal_sim_dispatch(&event);
+    EXPECT_EQ(1, received.count);
+    EXPECT_LT(mqtt_hal_sim_get_stats()->log_bytes, 512u);
+}
+
+/**
+ * Test: Negative lengths are passed through but never used as a %.*s precision
+ */
+TEST_F(MqttIngressTest, NegativeLengthsNotLogged)
+{
+    std::vector<char> topic = buffer(STATUS_TOPIC);
+    std::vector<char> data = buffer("closed");
+    esp_mqtt_event_t event = data_event(topic, data);
+    event.topic_len = -1;
+    event.data_len = -1;
+    event.total_data_len = -1;
+
+    mqtt_hal_sim_dispatch(&event);
+    EXPECT_EQ(1, received.count);
+    EXPECT_EQ(GARAGE_MESSAGE_UNKNOWN_TOPIC,
+              garage_command_classify(&topics, received.topic, received.topic_len, received.data, received.data_len).kind);
+    EXPECT_LT(mqtt_hal_sim_get_stats()->log_bytes, 64u) << "Only the MQTT_EVENT_DATA line is logged";
+}
+
+/**
+ * Test: A publish acknowledgement is forwarded with its message ID
+ */
+TEST_F(MqttIngressTest, PublishedEventForwarded)
+{
+    int msg_id = mqtt_publish(STATUS_TOPIC, "open", 1, true);
+    ASSERT_GT(msg_id, 0);
+
+    esp_mqtt_event_t event = {};
+    event.event_id = MQTT_EVENT_PUBLISHED;
+    event.msg_id = msg_id;
+    mqtt_hal_sim_dispatch(&event);
+
+    EXPECT_EQ(msg_id, received.published_msg_id);
+    EXPECT_STREQ("open", mqtt_hal_sim_get_stats()->last_data);
+}
+
+/**
+ * Test: A binary publish passes its length through, so NUL bytes do not cut the payload
+ */
+TEST_F(MqttIngressTest, BinaryPublishKeepsLength)
+{
+    const uint8_t payload[] = { 0x83, 0x01, 0x00, 0x80 };
+    EXPECT_EQ(0, mqtt_publish_binary("garage_door/metrics", payload, (int) sizeof(payload), 0, false));
+    ASSERT_EQ(sizeof(payload), mqtt_hal_sim_get_stats()->last_len);
+    EXPECT_EQ(0, memcmp(payload, mqtt_hal_sim_get_stats()->last_data, sizeof(payload)));
+
+    uint32_t publishes = mqtt_hal_sim_get_stats()->publishes;
+    EXPECT_EQ(-1, mqtt_publish_binary("garage_door/metrics", payload, 0, 0, false));
+    EXPECT_EQ(publishes, mqtt_hal_sim_get_stats()->publishes);
+}
+
+/**
+ * Test: Without a CA the client connects over plain TCP
+ */
+TEST_F(MqttIngressTest, PlainTcpWithoutCa)
+{
+    const esp_mqtt_client_config_t& config = mqtt_hal_sim_get_stats()->config;
+    EXPECT_EQ(MQTT_TRANSPORT_OVER_TCP, config.transport);
+    EXPECT_EQ(nullptr, config.cert_pem);
+    EXPECT_EQ(1883, config.port);
+}
+
+/**
+ * Test: A CA switches to TLS and is passed through as the only trusted certificate
+ */
+TEST(MqttTlsTest, CaEnablesTls)
+{
+    static const char ca[] = "-----BEGIN CERTIFICATE-----\nMIIB\n-----END CERTIFICATE-----\n";
+    static const mqtt_config_t config = {
+        "broker.local", 8883, nullptr, nullptr, "garage_door/availability", "unavailable", ca,
+    };
+    mqtt_hal_sim_reset();
+    mqtt_init(&config, nullptr);
+
+    const esp_mqtt_client_config_t& client = mqtt_hal_sim_get_stats()->config;
+    EXPECT_EQ(MQTT_TRANSPORT_OVER_SSL, client.transport);
+    EXPECT_EQ(ca, client.cert_pem);
+    EXPECT_EQ(8883, client.port);
+}
+
+/**
+ * Test: Connection time and heap draw are measured from the start of the attempt that succeeded
+ */
+TEST_F(MqttIngressTest, ConnectCostMeasured)
+{
+    esp_mqtt_event_t before = {};
+    before.event_id = MQTT_EVENT_BEFORE_CONNECT;
+    esp_mqtt_event_t connected = {};
+    connected.event_id = MQTT_EVENT_CONNECTED;
+    mqtt_connect_stats_t stats;
+
+    mqtt_hal_sim_set_time_ms(1000);
+    mqtt_hal_sim_set_heap(40000, 35000);
+    mqtt_hal_sim_dispatch(&before);
+    mqtt_hal_sim_set_time_ms(3500);
+    mqtt_hal_sim_set_heap(30000, 12000);
+    mqtt_hal_sim_dispatch(&connected);
+
+    mqtt_get_connect_stats(&stats);
+    EXPECT_EQ(1u, stats.connects);
+    EXPECT_EQ(2500u, stats.last_ms);
+    EXPECT_EQ(28000u, stats.last_heap_bytes);
+
+    // A failed attempt is superseded by the retry; the old low-water mark bounds the heap figure
+    mqtt_hal_sim_set_time_ms(10000);
+    mqtt_hal_sim_set_heap(39000, 12000);
+    mqtt_hal_sim_dispatch(&before);
+    mqtt_hal_sim_set_time_ms(20000);
+    mqtt_hal_sim_dispatch(&before);
+    mqtt_hal_sim_set_time_ms(20300);
+    mqtt_hal_sim_dispatch(&connected);
+
+    mqtt_get_connect_stats(&stats);
+    EXPECT_EQ(2u, stats.connects);
+    EXPECT_EQ(300u, stats.last_ms);
+    EXPECT_EQ(2500u, stats.max_ms);
+    EXPECT_EQ(27000u, stats.last_heap_bytes);
+    EXPECT_EQ(28000u, stats.max_heap_bytes);
+
+    // CONNECTED without a started attempt is not counted
+    mqtt_hal_sim_dispatch(&connected);
+    mqtt_get_connect_stats(&stats);
+    EXPECT_EQ(2u, stats.connects);
+}
+
+/**
+ * Test: Connect times reach the metrics histogram; only a lost session counts as a disconnect
+ */
+TEST_F(MqttIngressTest, SessionMetrics)
+{
+    esp_mqtt_event_t before = {};
+    before.event_id = MQTT_EVENT_BEFORE_CONNECT;
+    esp_mqtt_event_t connected = {};
+    connected.event_id = MQTT_EVENT_CONNECTED;
+    esp_mqtt_event_t disconnected = {};
+    disconnected.event_id = MQTT_EVENT_DISCONNECTED;
+    metrics_reset();
+
+    mqtt_hal_sim_set_time_ms(1000);
+    mqtt_hal_sim_dispatch(&before);
+    mqtt_hal_sim_set_time_ms(1400);
+    mqtt_hal_sim_dispatch(&connected);
+    EXPECT_EQ(1u, metrics_get(METRIC_MQTT_CONNECTED));
+
+    uint32_t buckets[METRICS_HISTOGRAM_BOUNDS + 1];
+    uint64_t sum_us;
+    EXPECT_EQ(1u, metrics_read_histogram(METRIC_HISTOGRAM_MQTT_CONNECT, buckets, &sum_us));
+    EXPECT_EQ(400000u, sum_us);
+    EXPECT_EQ(1u, buckets[2]);                  // 250..500 ms
+
+    mqtt_hal_sim_dispatch(&disconnected);
+    EXPECT_EQ(0u, metrics_get(METRIC_MQTT_CONNECTED));
+    EXPECT_EQ(1u, metrics_get(METRIC_MQTT_DISCONNECTS));
+
+    // Failed reconnect attempts raise DISCONNECTED as well
+    mqtt_hal_sim_dispatch(&before);
+    mqtt_hal_sim_dispatch(&disconnected);
+    mqtt_hal_sim_dispatch(&before);
+    mqtt_hal_sim_dispatch(&disconnected);
+    EXPECT_EQ(1u, metrics_get(METRIC_MQTT_DISCONNECTS));
+}
@@ -0,0 +1,266 @@
+/**
+ * @file test_retry_properties.cpp
+ * @brief Property-based tests for the WiFi and MQTT retry managers
+ *
+ * Random interleavings of disconnect, connect and timer-expiry events are run
+ * against the retry managers and every step is checked against the
+ * invariants below. Failing sequences are shrunk to a minimal counterexample
+ * by the harness in property/property.h.
+ */
+
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+#include "property/property.h"
+
+extern "C" {
+#include "wifi_retry_manager.h"
+#include "mqtt_retry_manager.h"
+}
+
+enum RetryOp {
+    OP_DISCONNECT,
+    OP_CONNECT,
+    OP_TIMER_EXPIRED,
+    OP_COUNT
+};
+
+static const char* op_name(RetryOp op)
+{
+    switch (op) {
+        case OP_DISCONNECT:    return "disconnect";
+        case OP_CONNECT:       return "connect";
+        case OP_TIMER_EXPIRED: return "timer_expired";
+        default:               return "?";
+    }
+}
+
+static RetryOp random_op(std::mt19937_64& rng)
+{
+    return (RetryOp) (rng() % OP_COUNT);
+}
+
+static std::string at_step(size_t step, const char* what)
+{
+    return "step " + std::to_string(step) + ": " + what;
+}
+
+static prop::Config retry_config()
+{
+    prop::Config config;
+    config.param_min = 0;
+    config.param_max = 12;
+    return config;
+}
+
+/**
+ * WiFi invariants, param = max_retries:
+ *  - retry count stays within [0, max_retries] and resets on connect and timer expiry
+ *  - CONNECT on disconnect while retries remain, with the count incremented
+ *  - FAIL exactly once per exhaustion, on the first disconnect with no retries left
+ *  - the timer flag is set iff FAIL was emitted since the last connect; STOP_TIMER iff it was set
+ *  - the connected flag follows the last connect/disconnect
+ */
+static std::string wifi_property(const prop::Case<RetryOp>& c)
+{
+    wifi_retry_state_t state;
+    wifi_retry_init(&state, c.param, 30000);
+
+    bool failed_since_reset = false;    // FAIL emitted since last connect or timer expiry
+    bool timer_expected = false;        // FAIL emitted since last connect
+    bool connected = false;
+
+    for (size_t i = 0; i < c.ops.size(); i++) {
+        int count_before = wifi_retry_get_count(&state);
+        wifi_retry_result_t r;
+
+        switch (c.ops[i]) {
+            case OP_DISCONNECT:
+                r = wifi_retry_on_disconnect(&state);
+                connected = false;
+                if (!r.should_callback_disconnected) {
+                    return at_step(i, "disconnect did not request the disconnected callback");
+                }
+                if (count_before < c.param) {
+                    if (r.action != WIFI_RETRY_ACTION_CONNECT) {
+                        return at_step(i, "disconnect with retries left did not reconnect");
+                    }
+                    if (wifi_retry_get_count(&state) != count_before + 1) {
+                        return at_step(i, "retry count did not increment");
+                    }
+                } else if (!failed_since_reset) {
+                    if (r.action != WIFI_RETRY_ACTION_FAIL || !r.should_callback_failed) {
+                        return at_step(i, "first exhausted disconnect did not FAIL");
+                    }
+                    failed_since_reset = true;
+                    timer_expected = true;
+                } else if (r.action != WIFI_RETRY_ACTION_NONE) {
+                    return at_step(i, "FAIL or reconnect emitted again for the same exhaustion");
+                }
+                if (r.callback_retry_count != wifi_retry_get_count(&state)) {
+                    return at_step(i, "callback retry count differs from state");
+                }
+                break;
+
+            case OP_CONNECT:
+                r = wifi_retry_on_connected(&state);
+                connected = true;
+                if (r.action != (timer_expected ? WIFI_RETRY_ACTION_STOP_TIMER : WIFI_RETRY_ACTION_NONE)) {
+                    return at_step(i, "connect did not stop exactly a running timer");
+                }
+                if (!r.should_callback_connected) {
+                    return at_step(i, "connect did not request the connected callback");
+                }
+                if (wifi_retry_get_count(&state) != 0) {
+                    return at_step(i, "retry count not reset on connect");
+                }
+                failed_since_reset = false;
+                timer_expected = false;
+                break;
+
+            case OP_TIMER_EXPIRED:
+            default:
+                r = wifi_retry_on_timer_expired(&state);
+                if (r.action != WIFI_RETRY_ACTION_CONNECT) {
+                    return at_step(i, "timer expiry did not reconnect");
+                }
+                if (wifi_retry_get_count(&state) != 0) {
+                    return at_step(i, "retry count not reset on timer expiry");
+                }
+                failed_since_reset = false;
+                break;
+        }
+
+        if (wifi_retry_get_count(&state) < 0 || wifi_retry_get_count(&state) > c.param) {
+            return at_step(i, "retry count out of range");
+        }
+        if (wifi_retry_should_timer_run(&state) != timer_expected) {
+            return at_step(i, "timer flag inconsistent with FAIL/connect history");
+        }
+        if (wifi_retry_is_connected(&state) != connected) {
+            return at_step(i, "connected flag does not follow the last event");
+        }
+    }
+    return std::string();
+}
+
+/**
+ * MQTT invariants, param = auto_reconnect (0/1); timer expiry has no MQTT
+ * equivalent and is ignored:
+ *  - disconnect counts every disconnect and requests RECONNECT iff auto-reconnect is on
+ *  - every event requests its callback; the connected flag follows the last event
+ */
+static std::string mqtt_property(const prop::Case<RetryOp>& c)
+{
+    mqtt_retry_state_t state;
+    bool auto_reconnect = c.param != 0;
+    mqtt_retry_init(&state, auto_reconnect);
+
+    int disconnects = 0;
+    bool connected = false;
+
+    for (size_t i = 0; i < c.ops.size(); i++) {
+        mqtt_retry_result_t r;
+        if (c.ops[i] == OP_DISCONNECT) {
+            r = mqtt_retry_on_disconnect(&state);
+            disconnects++;
+            connected = false;
+            if (r.action != (auto_reconnect ? MQTT_RETRY_ACTION_RECONNECT : MQTT_RETRY_ACTION_NONE)) {
+                return at_step(i, "reconnect action does not match auto-reconnect");
+            }
+            if (!r.should_callback_disconnected || r.should_callback_connected) {
+                return at_step(i, "wrong callbacks on disconnect");
+            }
+        } else if (c.ops[i] == OP_CONNECT) {
+            r = mqtt_retry_on_connected(&state);
+            connected = true;
+            if (r.action != MQTT_RETRY_ACTION_NONE) {
+                return at_step(i, "connect requested an action");
+            }
+            if (!r.should_callback_connected || r.should_callback_disconnected) {
+                return at_step(i, "wrong callbacks on connect");
+            }
+        }
+
+        if (mqtt_retry_get_disconnect_count(&state) != disconnects) {
+            return at_step(i, "disconnect count drifted");
+        }
+        if (mqtt_retry_is_connected(&state) != connected) {
+            return at_step(i, "connected flag does not follow the last event");
+        }
+    }
+    return std::string();
+}
+
+// ========== Test Cases ==========
+
+/**
+ * Test: WiFi retry invariants hold for random event interleavings
+ */
+TEST(RetryProperties, WifiInvariants)
+{
+    prop::Result<RetryOp> result = prop::check<RetryOp>(retry_config(), random_op, wifi_property);
+
+    EXPECT_TRUE(result.passed) << prop::describe(result, op_name);
+    RecordProperty("runs_per_second", (int) result.runs_per_second());
+}
+
+/**
+ * Test: MQTT retry invariants hold for random event interleavings
+ */
+TEST(RetryProperties, MqttInvariants)
+{
+    prop::Config config = retry_config();
+    config.param_max = 1;
+
+    prop::Result<RetryOp> result = prop::check<RetryOp>(config, random_op, mqtt_property);
+
+    EXPECT_TRUE(result.passed) << prop::describe(result, op_name);
+    RecordProperty("runs_per_second", (int) result.runs_per_second());
+}
+
+/**
+ * Test: Repeated disconnects after exhaustion report FAIL once and leave the timer alone
+ */
+TEST(RetryProperties, FailOncePerExhaustion)
+{
+    wifi_retry_state_t state;
+    wifi_retry_init(&state, 1, 30000);
+
+    EXPECT_EQ(WIFI_RETRY_ACTION_CONNECT, wifi_retry_on_disconnect(&state).action);
+    EXPECT_EQ(WIFI_RETRY_ACTION_FAIL, wifi_retry_on_disconnect(&state).action);
+    EXPECT_EQ(WIFI_RETRY_ACTION_NONE, wifi_retry_on_disconnect(&state).action) << "No second FAIL";
+
+    // Timer expiry starts a new round of retries that can fail again
+    wifi_retry_on_timer_expired(&state);
+    EXPECT_EQ(WIFI_RETRY_ACTION_CONNECT, wifi_retry_on_disconnect(&state).action);
+    EXPECT_EQ(WIFI_RETRY_ACTION_FAIL, wifi_retry_on_disconnect(&state).action);
+}
+
+/**
+ * Test: The harness shrinks a failing sequence to a minimal counterexample
+ */
+TEST(RetryProperties, ShrinksToMinimalCounterexample)
+{
+    // Deliberately false: "never two disconnects in a row once param >= 2"
+    auto property = [](const prop::Case<RetryOp>& c) -> std::string {
+        if (c.param < 2) {
+            return std::string();
+        }
+        for (size_t i = 1; i < c.ops.size(); i++) {
+            if (c.ops[i - 1] == OP_DISCONNECT && c.ops[i] == OP_DISCONNECT) {
+                return at_step(i, "two disconnects");
+            }
+        }
+        return std::string();
+    };
+
+    prop::Result<RetryOp> result = prop::check<RetryOp>(retry_config(), random_op, property);
+
+    ASSERT_FALSE(result.passed);
+    EXPECT_EQ(2, result.counterexample.param) << "Parameter shrunk to the smallest failing value";
+    ASSERT_EQ(2u, result.counterexample.ops.size()) << prop::describe(result, op_name);
+    EXPECT_EQ(OP_DISCONNECT, result.counterexample.ops[0]);
+    EXPECT_EQ(OP_DISCONNECT, result.counterexample.ops[1]);
+}
@@ -0,0 +1,106 @@
+/**
+ * @file test_scenarios.cpp
+ * @brief Runs the built-in door scenarios on a virtual clock
+ *
+ * The same scenario tables run in real time under TEST_MODE on the device.
+ */
+
+#include <gtest/gtest.h>
+#include <cstdio>
+
+extern "C" {
+#include "garage_scenario.h"
+#include "gpio_hal_sim.h"
+#include "scenario_sim.h"
+}
+
+#define REED_GPIO   4
+#define RELAY_GPIO  5
+
+class ScenarioTest : public ::testing::TestWithParam<int> {
+protected:
+    garage_controller_t ctrl;
+    scenario_sim_t sim;
+
+    void SetUp() override
+    {
+        gpio_hal_sim_reset();
+        gpio_hal_config_output(1u << RELAY_GPIO);
+
+        garage_controller_config_t config = {};
+        config.reed_switch_gpio = REED_GPIO;
+        config.relay_gpio = RELAY_GPIO;
+        config.relay_pulse_ms = GARAGE_RELAY_PULSE_MS;
+        config.sm_config.timeout_ms = 15000;
+        garage_controller_init(&ctrl, &config, GARAGE_STATE_UNKNOWN);
+        scenario_sim_init(&sim, &ctrl);
+    }
+};
+
+/**
+ * Test: Every built-in scenario passes and reports per-step latency
+ */
+TEST_P(ScenarioTest, Passes)
+{
+    const garage_scenario_t* scenario = &garage_scenarios[GetParam()];
+    garage_scenario_ops_t ops = scenario_sim_ops(&sim);
+    garage_scenario_report_t report;
+
+    int failed = garage_scenario_run(scenario, &ops, &report);
+
+    EXPECT_EQ(0, failed) << "Scenario " << scenario->name << " failed";
+    EXPECT_EQ(scenario->step_count, report.steps_run);
+    for (int i = 0; i < report.steps_run; i++) {
+        const garage_scenario_step_t* step = &scenario->steps[i];
+        EXPECT_TRUE(report.steps[i].passed)
+            << scenario->name << " step " << i << ": expected "
+            << garage_state_to_string(step->expected_state) << ", got "
+            << garage_state_to_string(report.steps[i].actual_state);
+        printf("  %-34s step %2d %-14s -> %-8s latency %8.1f ms\n", scenario->name, i,
+               garage_input_to_string(step->input), garage_state_to_string(report.steps[i].actual_state),
+               report.steps[i].latency_us < 0 ? -1.0 : report.steps[i].latency_us / 1000.0);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(BuiltIn, ScenarioTest, ::testing::Range(0, garage_scenario_count));
+
+/**
+ * Test: Latency reflects the virtual time taken by the transition
+ */
+TEST_F(ScenarioTest, LatencyMeasuresTimeout)
+{
+    static const garage_scenario_step_t steps[] = {
+        { GARAGE_INPUT_SENSOR_CLOSED, 100,   GARAGE_STATE_CLOSED },
+        { GARAGE_INPUT_COMMAND_OPEN,  20000, GARAGE_STATE_OPEN },
+        { GARAGE_INPUT_NONE,          1000,  GARAGE_STATE_OPEN },
+    };
+    const garage_scenario_t scenario = { "latency", steps, 3 };
+    garage_scenario_ops_t ops = scenario_sim_ops(&sim);
+    garage_scenario_report_t report;
+
+    EXPECT_EQ(0, garage_scenario_run(&scenario, &ops, &report));
+    EXPECT_EQ(0, report.steps[0].latency_us) << "Injected sensor reading changes state immediately";
+    EXPECT_EQ(15000 * 1000, report.steps[1].latency_us) << "Last change in the step is the 15 s timeout";
+    EXPECT_EQ(-1, report.steps[2].latency_us) << "No change during a pure wait";
+    EXPECT_EQ(15000 * 1000, report.max_latency_us);
+    EXPECT_EQ(21100 * 1000, gpio_hal_get_time_us()) << "Virtual clock advanced by the sum of delays";
+}
+
+/**
+ * Test: A mismatching expectation is reported as a failed step
+ */
+TEST_F(ScenarioTest, ReportsFailedStep)
+{
+    static const garage_scenario_step_t steps[] = {
+        { GARAGE_INPUT_SENSOR_CLOSED, 100, GARAGE_STATE_CLOSED },
+        { GARAGE_INPUT_COMMAND_OPEN,  100, GARAGE_STATE_OPEN },
+    };
+    const garage_scenario_t scenario = { "failing", steps, 2 };
+    garage_scenario_ops_t ops = scenario_sim_ops(&sim);
+    garage_scenario_report_t report;
+
+    EXPECT_EQ(1, garage_scenario_run(&scenario, &ops, &report));
+    EXPECT_TRUE(report.steps[0].passed);
+    EXPECT_FALSE(report.steps[1].passed);
+    EXPECT_EQ(GARAGE_STATE_OPENING, report.steps[1].actual_state);
+}
@@ -0,0 +1,301 @@
+/**
+ * @file test_schedule.cpp
+ * @brief Unit tests for the auto-close, reminder and lockout scheduler
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "garage_schedule.h"
+}
+
+class GarageScheduleTest : public ::testing::Test {
+protected:
+    garage_schedule_t sched;
+
+    void SetUp() override
+    {
+        garage_schedule_init(&sched, 0);
+    }
+
+    garage_schedule_status_t set(const std::string& id, const std::string& text, uint32_t now_s = 0)
+    {
+        return garage_schedule_set_rule(&sched, id.data(), (int) id.size(), text.data(), (int) text.size(), now_s);
+    }
+
+    std::vector<garage_schedule_event_t> tick(uint32_t now_s)
+    {
+        garage_schedule_event_t events[8];
+        int count = garage_schedule_tick(&sched, now_s, events, 8);
+        return std::vector<garage_schedule_event_t>(events, events + count);
+    }
+};
+
+/**
+ * Test: Auto-close fires once the door has been open for the period, then repeats
+ */
+TEST_F(GarageScheduleTest, AutoCloseAfterPeriod)
+{
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("evening", "auto_close 10"));
+    EXPECT_TRUE(tick(3600).empty());            // Closed: nothing armed
+
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 4000);
+    EXPECT_TRUE(tick(4599).empty());
+    std::vector<garage_schedule_event_t> events = tick(4600);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(GARAGE_SCHEDULE_EVENT_AUTO_CLOSE, events[0].kind);
+    EXPECT_STREQ("evening", events[0].rule_id);
+    EXPECT_EQ(600u, events[0].open_s);
+
+    // Still open (the close was refused or reversed): try again a period later
+    EXPECT_TRUE(tick(5199).empty());
+    EXPECT_EQ(1u, tick(5200).size());
+}
+
+/**
+ * Test: After a floor reversal auto-close is only reported, until a close stays closed; reminders go on
+ */
+TEST_F(GarageScheduleTest, AutoCloseSuspendedAfterReversal)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("evening", "auto_close 10"));
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("nag", "reminder 10"));
+    // As the owner does on every tick
+    auto follow = [&](uint32_t now_s) {
+        garage_schedule_on_state(&sched, garage_sm_get_state(&sm), now_s);
+        garage_schedule_suspend_auto_close(&sched, sm.obstructed || sm.close_failures > 0);
+    };
+
+    // Floor reversal: the switch opens again just after the close, then the open times out
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 10000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_update_timer(&sm, 1000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN);
+    garage_sm_update_timer(&sm, 15000);
+    ASSERT_EQ(GARAGE_STATE_OPEN, garage_sm_get_state(&sm));
+    ASSERT_EQ(GARAGE_OBSTRUCTION_FLOOR_REVERSAL, sm.last_obstruction);
+    follow(100);
+
+    for (uint32_t now_s = 700; now_s <= 1900; now_s += 600) {
+        follow(now_s);
+        std::vector<garage_schedule_event_t> events = tick(now_s);
+        ASSERT_EQ(2u, events.size()) << now_s;
+        for (const garage_schedule_event_t& event : events) {
+            EXPECT_NE(GARAGE_SCHEDULE_EVENT_AUTO_CLOSE, event.kind) << now_s;
+            EXPECT_EQ(strcmp(event.rule_id, "nag") == 0 ? GARAGE_SCHEDULE_EVENT_REMINDER
+                                                         : GARAGE_SCHEDULE_EVENT_AUTO_CLOSE_SUSPENDED,
+                      event.kind);
+        }
+    }
+
+    // A close by hand that stays closed lifts the suspension
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    follow(2000);
+    garage_sm_update_timer(&sm, 10000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_update_timer(&sm, 5000);
+    follow(2015);
+    EXPECT_FALSE(sched.auto_close_suspended);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN);
+    garage_sm_update_timer(&sm, 15000);
+    follow(3000);
+    std::vector<garage_schedule_event_t> events = tick(3600);
+    ASSERT_EQ(2u, events.size());
+    EXPECT_TRUE(events[0].kind == GARAGE_SCHEDULE_EVENT_AUTO_CLOSE || events[1].kind == GARAGE_SCHEDULE_EVENT_AUTO_CLOSE);
+}
+
+/**
+ * Test: Closing cancels the open-door timers; STOPPED counts as open
+ */
+TEST_F(GarageScheduleTest, CloseCancelsStoppedCounts)
+{
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("nag", "reminder 5"));
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 0);
+    garage_schedule_on_state(&sched, GARAGE_STATE_CLOSING, 100);
+    garage_schedule_on_state(&sched, GARAGE_STATE_CLOSED, 112);
+    EXPECT_TRUE(tick(1000).empty());
+
+    garage_schedule_on_state(&sched, GARAGE_STATE_STOPPED, 1000);
+    std::vector<garage_schedule_event_t> events = tick(1300);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(GARAGE_SCHEDULE_EVENT_REMINDER, events[0].kind);
+
+    // STOPPED -> OPEN keeps the original open time
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 1400);
+    events = tick(1600);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(600u, events[0].open_s);
+}
+
+/**
+ * Test: A rule added while the door is open counts from when it opened
+ */
+TEST_F(GarageScheduleTest, RuleAddedWhileOpen)
+{
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 100);
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("late", "auto_close 5", 500));
+    std::vector<garage_schedule_event_t> events = tick(500);
+    ASSERT_EQ(1u, events.size());               // Already overdue
+    EXPECT_EQ(400u, events[0].open_s);
+}
+
+/**
+ * Test: Replacing a rule re-arms it; deleting it cancels it
+ */
+TEST_F(GarageScheduleTest, ReplaceAndDelete)
+{
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 0);
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("r", "reminder 1"));
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("r", "reminder 2"));
+    EXPECT_TRUE(tick(60).empty());
+    EXPECT_EQ(1u, tick(120).size());
+
+    EXPECT_EQ(GARAGE_SCHEDULE_DELETED, set("r", ""));
+    EXPECT_EQ(GARAGE_SCHEDULE_DELETED, set("r", ""));
+    EXPECT_TRUE(tick(10000).empty());
+    EXPECT_EQ(0u, sched.wheel.active);
+}
+
+/**
+ * Test: Malformed ids and rules are rejected and leave an existing rule alone
+ */
+TEST_F(GarageScheduleTest, RejectsBadInput)
+{
+    EXPECT_EQ(GARAGE_SCHEDULE_BAD_ID, set("", "auto_close 5"));
+    EXPECT_EQ(GARAGE_SCHEDULE_BAD_ID, set("has space", "auto_close 5"));
+    EXPECT_EQ(GARAGE_SCHEDULE_BAD_ID, set("abcdefghijklmnopq", "auto_close 5"));
+    EXPECT_EQ(GARAGE_SCHEDULE_SET, set("abcdefghijklmnop", "auto_close 5"));
+
+    const char* bad[] = { "auto_close", "auto_close 0", "auto_close 1441", "auto_close 5 6", "auto_close -5",
+                          "reminder x", "AUTO_CLOSE 5", "lockout 22:00", "lockout 24:00 06:00",
+                          "lockout 22:60 06:00", "lockout 2200 0600", "lockout 22:00 22:00", "open_sesame 1" };
+    for (const char* text : bad) {
+        EXPECT_EQ(GARAGE_SCHEDULE_BAD_RULE, set("abcdefghijklmnop", text)) << text;
+    }
+
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 0);
+    EXPECT_EQ(1u, tick(300).size());            // The original rule is intact
+}
+
+/**
+ * Test: The rule table has a fixed size
+ */
+TEST_F(GarageScheduleTest, Full)
+{
+    for (int i = 0; i < GARAGE_SCHEDULE_MAX_RULES; i++) {
+        ASSERT_EQ(GARAGE_SCHEDULE_SET, set("r" + std::to_string(i), "reminder 5"));
+    }
+    EXPECT_EQ(GARAGE_SCHEDULE_FULL, set("extra", "reminder 5"));
+    EXPECT_EQ(GARAGE_SCHEDULE_SET, set("r0", "reminder 6"));
+    EXPECT_EQ(GARAGE_SCHEDULE_DELETED, set("r0", ""));
+    EXPECT_EQ(GARAGE_SCHEDULE_SET, set("extra", "reminder 5"));
+}
+
+/**
+ * Test: Events past the caller's capacity are counted, not lost silently
+ */
+TEST_F(GarageScheduleTest, DroppedEventsCounted)
+{
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(GARAGE_SCHEDULE_SET, set("r" + std::to_string(i), "reminder 1"));
+    }
+    garage_schedule_on_state(&sched, GARAGE_STATE_OPEN, 0);
+    garage_schedule_event_t events[2];
+    EXPECT_EQ(2, garage_schedule_tick(&sched, 60, events, 2));
+    EXPECT_EQ(1u, sched.dropped_events);
+}
+
+/**
+ * Test: A lockout needs the time of day, then refuses OPEN inside its window only
+ */
+TEST_F(GarageScheduleTest, LockoutWindow)
+{
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("night", "lockout 22:00 6:00"));
+    EXPECT_TRUE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_OPEN, nullptr));
+
+    // 21:00 at monotonic 1000
+    garage_schedule_set_time_of_day(&sched, 21 * 3600, 1000);
+    EXPECT_TRUE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_OPEN, nullptr));
+    EXPECT_TRUE(tick(1000 + 3599).empty());
+
+    std::vector<garage_schedule_event_t> events = tick(1000 + 3600);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(GARAGE_SCHEDULE_EVENT_LOCKOUT_START, events[0].kind);
+
+    garage_schedule_event_t refused;
+    EXPECT_FALSE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_OPEN, &refused));
+    EXPECT_EQ(GARAGE_SCHEDULE_EVENT_REFUSED, refused.kind);
+    EXPECT_STREQ("night", refused.rule_id);
+    EXPECT_EQ(GARAGE_INPUT_COMMAND_OPEN, refused.input);
+    EXPECT_TRUE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_CLOSE, nullptr));
+    EXPECT_TRUE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_STOP, nullptr));
+
+    // Past midnight to 06:00
+    events = tick(1000 + 9 * 3600);
+    ASSERT_EQ(1u, events.size());
+    EXPECT_EQ(GARAGE_SCHEDULE_EVENT_LOCKOUT_END, events[0].kind);
+    EXPECT_TRUE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_OPEN, nullptr));
+
+    // And again the next evening
+    EXPECT_TRUE(tick(1000 + 24 * 3600).empty());
+    EXPECT_EQ(1u, tick(1000 + 25 * 3600).size());
+}
+
+/**
+ * Test: Small clock corrections are ignored; a jump or a lost clock re-evaluates the windows
+ */
+TEST_F(GarageScheduleTest, ClockChanges)
+{
+    ASSERT_EQ(GARAGE_SCHEDULE_SET, set("lunch", "lockout 12:00 13:00"));
+    garage_schedule_set_time_of_day(&sched, 11 * 3600, 0);
+    uint32_t offset = sched.day_offset_s;
+    garage_schedule_set_time_of_day(&sched, 11 * 3600 + 2, 0);
+    EXPECT_EQ(offset, sched.day_offset_s);
+
+    // Jump into the window: it applies straight away
+    garage_schedule_set_time_of_day(&sched, 12 * 3600 + 30 * 60, 10);
+    EXPECT_FALSE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_OPEN, nullptr));
+
+    garage_schedule_set_time_of_day(&sched, GARAGE_SCHEDULE_TIME_UNKNOWN, 20);
+    EXPECT_TRUE(garage_schedule_check_command(&sched, GARAGE_INPUT_COMMAND_OPEN, nullptr));
+    EXPECT_TRUE(tick(100000).empty());
+}
+
+/**
+ * Test: Events format as JSON and outcomes as strings
+ */
+TEST_F(GarageScheduleTest, JsonAndStrings)
+{
+    garage_schedule_event_t event;
+    memset(&event, 0, sizeof(event));
+    event.kind = GARAGE_SCHEDULE_EVENT_AUTO_CLOSE;
+    strcpy(event.rule_id, "evening");
+    event.open_s = 600;
+
+    char buf[96];
+    ASSERT_GT(garage_schedule_event_to_json(&event, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"rule\":\"evening\",\"event\":\"auto_close\",\"open_s\":600}", buf);
+
+    event.kind = GARAGE_SCHEDULE_EVENT_AUTO_CLOSE_SUSPENDED;
+    ASSERT_GT(garage_schedule_event_to_json(&event, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"rule\":\"evening\",\"event\":\"auto_close_suspended\",\"open_s\":600}", buf);
+
+    event.kind = GARAGE_SCHEDULE_EVENT_REFUSED;
+    event.input = GARAGE_INPUT_COMMAND_OPEN;
+    ASSERT_GT(garage_schedule_event_to_json(&event, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"rule\":\"evening\",\"event\":\"refused\",\"command\":\"OPEN\"}", buf);
+
+    event.kind = GARAGE_SCHEDULE_EVENT_LOCKOUT_END;
+    ASSERT_GT(garage_schedule_event_to_json(&event, buf, sizeof(buf)), 0);
+    EXPECT_STREQ("{\"rule\":\"evening\",\"event\":\"lockout_end\"}", buf);
+    EXPECT_EQ(-1, garage_schedule_event_to_json(&event, buf, 10));
+
+    EXPECT_STREQ("set", garage_schedule_status_to_string(GARAGE_SCHEDULE_SET));
+    EXPECT_STREQ("bad_rule", garage_schedule_status_to_string(GARAGE_SCHEDULE_BAD_RULE));
+}
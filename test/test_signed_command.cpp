@@ -0,0 +1,222 @@
+/**
+ * @file test_signed_command.cpp
+ * @brief Unit tests for signed MQTT command verification and replay protection
+ */
+
+#include <gtest/gtest.h>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+extern "C" {
+#include "hmac_sha256.h"
+#include "signed_command.h"
+}
+
+static const uint8_t KEY[] = "device key for the signed command tests";
+
+class SignedCommandTest : public ::testing::Test {
+protected:
+    signed_command_window_t window;     // Stands in for RTC memory
+    signed_command_verifier_t verifier;
+    uint32_t stored_floor = 0;          // Stands in for NVS
+    int stores = 0;
+    bool store_fails = false;
+
+    static bool store(uint32_t floor, void* ctx)
+    {
+        SignedCommandTest* test = static_cast<SignedCommandTest*>(ctx);
+        if (test->store_fails) {
+            return false;
+        }
+        test->stored_floor = floor;
+        test->stores++;
+        return true;
+    }
+
+    void SetUp() override
+    {
+        memset(&window, 0, sizeof(window));
+        EXPECT_FALSE(boot());
+    }
+
+    /// Re-create the verifier as a reboot would, with the window as RTC memory left it
+    bool boot()
+    {
+        return signed_command_init(&verifier, KEY, sizeof(KEY) - 1, &window, stored_floor, store, this);
+    }
+
+    static std::string sign(garage_input_t input, uint32_t counter)
+    {
+        char buf[SIGNED_COMMAND_MAX_LEN + 1];
+        int len = signed_command_sign(KEY, sizeof(KEY) - 1, input, counter, buf, sizeof(buf));
+        EXPECT_GT(len, 0);
+        return std::string(buf, len > 0 ? (size_t) len : 0);
+    }
+
+    signed_command_status_t verify(const std::string& payload, garage_input_t* input = nullptr)
+    {
+        garage_input_t parsed;
+        signed_command_status_t status =
+            signed_command_verify(&verifier, payload.data(), (int) payload.size(), &parsed, nullptr);
+        if (input != nullptr) {
+            *input = parsed;
+        }
+        return status;
+    }
+};
+
+/**
+ * Test: A signed command verifies and names its command; the format is as documented
+ */
+TEST_F(SignedCommandTest, SignAndVerify)
+{
+    std::string payload = sign(GARAGE_INPUT_COMMAND_CLOSE, 42);
+    ASSERT_EQ(6u + 3u + 32u, payload.size());
+    EXPECT_EQ("CLOSE 42 ", payload.substr(0, 9));
+
+    uint8_t mac[SHA256_DIGEST_LEN];
+    hmac_sha256(KEY, sizeof(KEY) - 1, "CLOSE 42", 8, mac);
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02x", mac[0]);
+    EXPECT_EQ(std::string(hex), payload.substr(9, 2));
+
+    garage_input_t input;
+    uint32_t counter;
+    EXPECT_EQ(SIGNED_COMMAND_OK, signed_command_verify(&verifier, payload.data(), (int) payload.size(), &input,
+                                                       &counter));
+    EXPECT_EQ(GARAGE_INPUT_COMMAND_CLOSE, input);
+    EXPECT_EQ(42u, counter);
+    EXPECT_EQ(1u, verifier.accepted);
+
+    std::string upper = sign(GARAGE_INPUT_COMMAND_OPEN, 43);
+    for (size_t i = 8; i < upper.size(); i++) {
+        upper[i] = (char) toupper((unsigned char) upper[i]);
+    }
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(upper));
+}
+
+/**
+ * Test: Changing any byte of a signed command gets it refused, and nothing is queued
+ */
+TEST_F(SignedCommandTest, TamperingRefused)
+{
+    std::string payload = sign(GARAGE_INPUT_COMMAND_STOP, 1000);
+    for (size_t i = 0; i < payload.size(); i++) {
+        std::string tampered = payload;
+        tampered[i] = tampered[i] == '1' ? '2' : '1';
+        garage_input_t input;
+        EXPECT_NE(SIGNED_COMMAND_OK, verify(tampered, &input)) << i;
+        EXPECT_EQ(GARAGE_INPUT_NONE, input);
+    }
+    EXPECT_EQ(0u, verifier.accepted);
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(payload));
+}
+
+/**
+ * Test: Anything that is not exactly "<command> <counter> <32 hex digits>" is malformed
+ */
+TEST_F(SignedCommandTest, MalformedRefused)
+{
+    std::string good = sign(GARAGE_INPUT_COMMAND_OPEN, 7);
+    std::string mac = good.substr(7);
+    for (const std::string& bad : { std::string(""), std::string("OPEN"), std::string("OPEN 7"),
+                                    "OPEN  7 " + mac, "OPEN 7 " + mac.substr(1), "OPEN 7 " + mac + "0",
+                                    "OPEN 0 " + mac, "OPEN -7 " + mac, "OPEN 4294967296 " + mac,
+                                    "OPEN 12345678901 " + mac, "open 7 " + mac, "OPEN 7 " + mac.substr(2) + "zz",
+                                    "OPEN 7\t" + mac, std::string("OPEN 7 ") + std::string(32, '\0') }) {
+        EXPECT_EQ(SIGNED_COMMAND_MALFORMED, verify(bad)) << bad;
+    }
+
+    garage_input_t input;
+    EXPECT_EQ(SIGNED_COMMAND_MALFORMED, signed_command_verify(&verifier, nullptr, 40, &input, nullptr));
+    EXPECT_EQ(SIGNED_COMMAND_MALFORMED, signed_command_verify(&verifier, good.data(), -1, &input, nullptr));
+
+    char small[20];
+    EXPECT_EQ(-1, signed_command_sign(KEY, sizeof(KEY) - 1, GARAGE_INPUT_COMMAND_OPEN, 7, small, sizeof(small)));
+    char buf[SIGNED_COMMAND_MAX_LEN + 1];
+    EXPECT_EQ(-1, signed_command_sign(KEY, sizeof(KEY) - 1, GARAGE_INPUT_REED_SWITCH, 7, buf, sizeof(buf)));
+    EXPECT_EQ(-1, signed_command_sign(KEY, sizeof(KEY) - 1, GARAGE_INPUT_COMMAND_OPEN, 0, buf, sizeof(buf)));
+    EXPECT_EQ(SIGNED_COMMAND_MAX_LEN,
+              signed_command_sign(KEY, sizeof(KEY) - 1, GARAGE_INPUT_COMMAND_CLOSE, UINT32_MAX, buf, sizeof(buf)));
+}
+
+/**
+ * Test: Each counter is accepted once; late arrivals inside the window still count
+ */
+TEST_F(SignedCommandTest, ReplayWindow)
+{
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 100)));
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 100)));
+
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_CLOSE, 110)));
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_STOP, 105)));     // Out of order
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(sign(GARAGE_INPUT_COMMAND_STOP, 105)));
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 100)));
+
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 110 + SIGNED_COMMAND_WINDOW - 1)));
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 109)));   // Fell out of the window
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 110)));
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 111)));
+    EXPECT_EQ(5u, verifier.accepted);
+    EXPECT_EQ(5u, verifier.rejected);
+}
+
+/**
+ * Test: A software reset keeps the window; a power cut falls back to the stored floor
+ */
+TEST_F(SignedCommandTest, SurvivesResets)
+{
+    std::string first = sign(GARAGE_INPUT_COMMAND_OPEN, 5);
+    std::string second = sign(GARAGE_INPUT_COMMAND_CLOSE, 6);
+    ASSERT_EQ(SIGNED_COMMAND_OK, verify(first));
+    ASSERT_EQ(SIGNED_COMMAND_OK, verify(second));
+    EXPECT_EQ(1, stores);                                   // Once for the first 64 counters
+    EXPECT_EQ(5u + SIGNED_COMMAND_RESERVE, stored_floor);
+
+    EXPECT_TRUE(boot());                                    // Software reset
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(first));
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_STOP, 7)));
+
+    memset(&window, 0xA5, sizeof(window));                  // Power cut: RTC memory is garbage
+    EXPECT_FALSE(boot());
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(second));
+    EXPECT_EQ(SIGNED_COMMAND_REPLAYED, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 5 + SIGNED_COMMAND_RESERVE)));
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 6 + SIGNED_COMMAND_RESERVE)));
+    EXPECT_EQ(2, stores);
+
+    window.seen ^= 1;                                       // A flipped bit is caught too
+    EXPECT_FALSE(boot());
+}
+
+/**
+ * Test: A counter past the floor is refused, not accepted, when the new floor cannot be stored
+ */
+TEST_F(SignedCommandTest, StoreFailureRefuses)
+{
+    store_fails = true;
+    std::string payload = sign(GARAGE_INPUT_COMMAND_OPEN, 1);
+    EXPECT_EQ(SIGNED_COMMAND_STORE_FAILED, verify(payload));
+    EXPECT_EQ(0u, window.last);
+
+    store_fails = false;
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(payload));
+    EXPECT_EQ(1u + SIGNED_COMMAND_RESERVE, stored_floor);
+
+    stored_floor = UINT32_MAX - 10;                         // The floor saturates
+    memset(&window, 0, sizeof(window));
+    boot();
+    EXPECT_EQ(SIGNED_COMMAND_OK, verify(sign(GARAGE_INPUT_COMMAND_OPEN, UINT32_MAX - 1)));
+    EXPECT_EQ(UINT32_MAX, stored_floor);
+}
+
+/**
+ * Test: Without a key every signed command is refused
+ */
+TEST_F(SignedCommandTest, NoKey)
+{
+    signed_command_init(&verifier, nullptr, 16, &window, 0, store, this);
+    EXPECT_EQ(SIGNED_COMMAND_NO_KEY, verify(sign(GARAGE_INPUT_COMMAND_OPEN, 1)));
+    EXPECT_STREQ("no key", signed_command_status_to_string(SIGNED_COMMAND_NO_KEY));
+}
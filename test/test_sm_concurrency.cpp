@@ -0,0 +1,229 @@
+/**
+ * @file test_sm_concurrency.cpp
+ * @brief Threaded tests for the single-owner controller design
+ *
+ * On the device the reed switch ISR and the MQTT task post inputs to the
+ * state machine queue, and state_machine_handler is the only task that calls
+ * into the controller: it handles inputs and ticks the relay pulse and state
+ * machine timeout itself (garage_controller_tick_to). These tests run the same
+ * owner loop on a real thread against concurrent producer threads. The
+ * concurrency_tsan target builds this file with ThreadSanitizer; the SANITIZE
+ * cache variable builds the whole tests target with e.g. address,undefined.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "garage_controller.h"
+#include "gpio_hal_sim.h"
+}
+
+#define REED_GPIO   4
+#define RELAY_GPIO  5
+
+/**
+ * @brief Bounded queue with the xQueueSend/xQueueReceive semantics the firmware relies on
+ */
+class HostQueue {
+public:
+    explicit HostQueue(size_t depth) : depth_(depth) {}
+
+    /// Blocks while full (the producers here must not drop inputs, unlike xQueueSend(..., 0))
+    void send(garage_input_t input)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&] { return items_.size() < depth_; });
+        items_.push_back(input);
+        not_empty_.notify_one();
+    }
+
+    /// Like xQueueReceive with a timeout: false if nothing arrived in time
+    bool receive(garage_input_t* input, int timeout_ms)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!not_empty_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] { return !items_.empty(); })) {
+            return false;
+        }
+        *input = items_.front();
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+private:
+    size_t depth_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<garage_input_t> items_;
+};
+
+class SmConcurrencyTest : public ::testing::Test {
+protected:
+    garage_controller_t ctrl;
+    HostQueue queue{5};     // Same depth as the firmware queue
+    std::chrono::steady_clock::time_point start;
+    std::atomic<bool> stop{false};
+
+    // Written by the owner thread only; read after it is joined
+    uint32_t handled = 0;
+    uint32_t timeouts = 0;
+    uint32_t invariant_failures = 0;
+
+    void SetUp() override
+    {
+        gpio_hal_sim_reset();
+        gpio_hal_config_output(1u << RELAY_GPIO);
+        gpio_hal_config_input(1u << REED_GPIO, GPIO_HAL_EDGE_ANY, true);
+    }
+
+    void init_controller(int timeout_ms, int relay_pulse_ms)
+    {
+        garage_controller_config_t config = {};
+        config.reed_switch_gpio = REED_GPIO;
+        config.relay_gpio = RELAY_GPIO;
+        config.relay_pulse_ms = relay_pulse_ms;
+        config.sm_config.timeout_ms = timeout_ms;
+        garage_controller_init(&ctrl, &config, GARAGE_STATE_UNKNOWN);
+        start = std::chrono::steady_clock::now();
+    }
+
+    /// Controller time: microseconds since init (the simulated GPIO clock stays at 0)
+    int64_t now_us() const
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void check_invariants()
+    {
+        garage_state_t state = garage_controller_get_state(&ctrl);
+        bool moving = state == GARAGE_STATE_OPENING || state == GARAGE_STATE_CLOSING;
+        if (garage_sm_is_timer_active(&ctrl.sm) != moving) {
+            invariant_failures++;
+        }
+        if (ctrl.relay_active != (gpio_hal_get_level(RELAY_GPIO) == 1)) {
+            invariant_failures++;
+        }
+    }
+
+    /// The firmware's state_machine_handler loop
+    void owner_loop()
+    {
+        garage_input_t input;
+        while (!stop.load()) {
+            int wait_ms = garage_controller_ms_until_tick(&ctrl, now_us());
+            if (queue.receive(&input, wait_ms)) {
+                garage_controller_handle_input(&ctrl, input);
+                handled++;
+            }
+            garage_transition_result_t result = garage_controller_tick_to(&ctrl, now_us());
+            if (result.state_changed) {
+                timeouts++;
+            }
+            check_invariants();
+        }
+        // Drain what the producers left behind
+        while (queue.receive(&input, 0)) {
+            garage_controller_handle_input(&ctrl, input);
+            handled++;
+        }
+    }
+};
+
+/**
+ * Test: tick_to ticks whole milliseconds once a period has passed and carries the remainder
+ */
+TEST_F(SmConcurrencyTest, TickToCarriesRemainder)
+{
+    init_controller(1000, 300);
+
+    EXPECT_EQ(GARAGE_TICK_PERIOD_MS, garage_controller_ms_until_tick(&ctrl, 0));
+    EXPECT_EQ(1, garage_controller_ms_until_tick(&ctrl, 99001));
+    EXPECT_EQ(0, garage_controller_ms_until_tick(&ctrl, 100000));
+
+    garage_controller_handle_input(&ctrl, GARAGE_INPUT_COMMAND_OPEN);
+    ASSERT_TRUE(garage_controller_is_relay_active(&ctrl));
+
+    garage_controller_tick_to(&ctrl, 99999);
+    EXPECT_EQ(0, ctrl.last_tick_us) << "Less than a period: nothing ticked";
+
+    garage_controller_tick_to(&ctrl, 150700);
+    EXPECT_EQ(150000, ctrl.last_tick_us) << "Sub-millisecond remainder carried";
+    EXPECT_EQ(300 - 150, ctrl.relay_remaining_ms);
+
+    garage_controller_tick_to(&ctrl, 310000);
+    EXPECT_FALSE(garage_controller_is_relay_active(&ctrl));
+
+    garage_transition_result_t result = garage_controller_tick_to(&ctrl, 1000000);
+    EXPECT_TRUE(result.state_changed);
+    EXPECT_EQ(GARAGE_STATE_OPEN, result.new_state) << "Timeout measured from the command";
+}
+
+/**
+ * Test: The owner thread times out a command on its own, with no timer thread
+ */
+TEST_F(SmConcurrencyTest, OwnerKeepsTimeWithoutTimerThread)
+{
+    init_controller(300, 100);
+    std::thread owner([this] { owner_loop(); });
+
+    queue.send(GARAGE_INPUT_COMMAND_OPEN);
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    stop.store(true);
+    owner.join();
+
+    EXPECT_EQ(1u, handled);
+    EXPECT_EQ(1u, timeouts);
+    EXPECT_EQ(GARAGE_STATE_OPEN, garage_controller_get_state(&ctrl));
+    EXPECT_FALSE(garage_controller_is_relay_active(&ctrl));
+    EXPECT_EQ(0, gpio_hal_get_level(RELAY_GPIO));
+    EXPECT_EQ(0u, invariant_failures);
+}
+
+/**
+ * Test: Producers on several threads (ISR, MQTT task, scenario task) race the owner; every input
+ * is handled exactly once, controller invariants hold after every step, and TSan sees no race
+ */
+TEST_F(SmConcurrencyTest, ConcurrentProducersSingleOwner)
+{
+    const int PRODUCERS = 4;
+    const int INPUTS_PER_PRODUCER = 5000;
+    init_controller(20, 10);   // Short enough that timeouts and relay releases interleave with inputs
+
+    std::thread owner([this] { owner_loop(); });
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([this, p] {
+            const garage_input_t inputs[] = {
+                GARAGE_INPUT_SENSOR_CLOSED, GARAGE_INPUT_SENSOR_OPEN,
+                GARAGE_INPUT_COMMAND_OPEN, GARAGE_INPUT_COMMAND_CLOSE, GARAGE_INPUT_REED_SWITCH,
+            };
+            std::mt19937 rng((uint32_t) p + 1);
+            for (int i = 0; i < INPUTS_PER_PRODUCER; i++) {
+                queue.send(inputs[rng() % 5]);
+                if (rng() % 64 == 0) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(rng() % 2000));
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    stop.store(true);
+    owner.join();
+
+    EXPECT_EQ((uint32_t) (PRODUCERS * INPUTS_PER_PRODUCER), handled);
+    EXPECT_EQ(0u, invariant_failures);
+    EXPECT_GT(garage_controller_get_transition_count(&ctrl), 0u);
+}
@@ -478,3 +478,495 @@ TEST(StateMachineTimer, TimerInactiveInStableStates)
     result = garage_sm_update_timer(&sm, 10000);
     EXPECT_FALSE(result.state_changed) << "Timer update should have no effect in UNKNOWN";
 }
+
+// ========== Position Tests ==========
+
+/**
+ * Test: Stable states report endpoints; UNKNOWN has no position
+ */
+TEST(StateMachinePosition, StableStatesReportEndpoints)
+{
+    garage_state_machine_t sm;
+
+    garage_sm_init(&sm, GARAGE_STATE_CLOSED);
+    EXPECT_EQ(GARAGE_POSITION_CLOSED, garage_sm_get_position(&sm));
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    EXPECT_EQ(GARAGE_POSITION_OPEN, garage_sm_get_position(&sm));
+    garage_sm_init(&sm, GARAGE_STATE_UNKNOWN);
+    EXPECT_EQ(GARAGE_POSITION_UNKNOWN, garage_sm_get_position(&sm));
+    EXPECT_EQ(GARAGE_POSITION_UNKNOWN, garage_sm_get_position(NULL));
+}
+
+/**
+ * Test: Position is interpolated from the travel time and held short of the endpoints
+ */
+TEST(StateMachinePosition, InterpolatesWhileMoving)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 10000, .close_travel_ms = 12000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_CLOSED, &config);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    EXPECT_EQ(1, garage_sm_get_position(&sm)) << "Moving, so not reported as closed";
+    garage_sm_update_timer(&sm, 2500);
+    EXPECT_EQ(25, garage_sm_get_position(&sm));
+    garage_sm_update_timer(&sm, 9000);
+    EXPECT_EQ(99, garage_sm_get_position(&sm)) << "Only the timeout reports fully open";
+    garage_sm_update_timer(&sm, 3500);
+    EXPECT_EQ(GARAGE_STATE_OPEN, garage_sm_get_state(&sm));
+    EXPECT_EQ(GARAGE_POSITION_OPEN, garage_sm_get_position(&sm));
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 3000);
+    EXPECT_EQ(75, garage_sm_get_position(&sm));
+}
+
+/**
+ * Test: A full close ended by the reed switch refines the close travel time
+ */
+TEST(StateMachinePosition, LearnsCloseTravelTime)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 12000, .close_travel_ms = 12000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+
+    for (int i = 0; i < 20; i++) {
+        garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+        garage_sm_update_timer(&sm, 8000);
+        garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+        EXPECT_EQ(GARAGE_POSITION_CLOSED, garage_sm_get_position(&sm));
+        garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+        garage_sm_update_timer(&sm, 15000);
+    }
+    EXPECT_NEAR(8000, sm.close_travel_ms, 50);
+    EXPECT_EQ(12000, sm.open_travel_ms) << "Opening cannot be measured with one reed switch";
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 4000);
+    EXPECT_NEAR(50, garage_sm_get_position(&sm), 1);
+}
+
+/**
+ * Test: A close that times out keeps its last estimate; the next motion starts from it
+ */
+TEST(StateMachinePosition, TimeoutKeepsEstimate)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 6000, .open_travel_ms = 12000, .close_travel_ms = 12000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 6000);
+    ASSERT_EQ(GARAGE_STATE_UNKNOWN, garage_sm_get_state(&sm));
+    EXPECT_EQ(50, garage_sm_get_position(&sm));
+    EXPECT_EQ(12000, sm.close_travel_ms) << "Timeouts are not learned";
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    garage_sm_update_timer(&sm, 1200);
+    EXPECT_EQ(60, garage_sm_get_position(&sm));
+}
+
+// ========== Stop Tests ==========
+
+/**
+ * Test: STOP presses once while moving and is ignored at rest
+ */
+TEST(StateMachineStop, StopWhileMovingPressesOnce)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_CLOSED);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    EXPECT_FALSE(result.state_changed) << "A press at rest would start the door";
+    EXPECT_FALSE(result.actions.trigger_button_press);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    garage_sm_update_timer(&sm, 3000);
+    result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    EXPECT_EQ(GARAGE_STATE_STOPPED, result.new_state);
+    EXPECT_TRUE(result.actions.publish_state);
+    EXPECT_TRUE(result.actions.trigger_button_press);
+    EXPECT_EQ(1, result.actions.button_presses);
+    EXPECT_FALSE(garage_sm_is_timer_active(&sm)) << "STOPPED does not time out";
+    EXPECT_EQ(25, garage_sm_get_position(&sm)) << "Position kept where the door stopped";
+    EXPECT_STREQ("stopped", garage_state_to_string(GARAGE_STATE_STOPPED));
+
+    result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    EXPECT_FALSE(result.actions.trigger_button_press) << "Already stopped";
+}
+
+/**
+ * Test: From STOPPED the next press moves against the interrupted motion
+ */
+TEST(StateMachineStop, PressCyclePredictsDirection)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_CLOSED);
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_sm_next_press_direction(&sm));
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    EXPECT_EQ(GARAGE_STATE_UNKNOWN, garage_sm_next_press_direction(&sm)) << "A press would stop the door";
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    EXPECT_EQ(GARAGE_STATE_CLOSING, garage_sm_next_press_direction(&sm));
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    EXPECT_EQ(GARAGE_STATE_CLOSING, result.new_state);
+    EXPECT_EQ(1, result.actions.button_presses);
+    EXPECT_TRUE(garage_sm_is_timer_active(&sm));
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    EXPECT_EQ(GARAGE_STATE_OPENING, garage_sm_next_press_direction(&sm));
+}
+
+/**
+ * Test: A command against the predicted direction takes three presses
+ */
+TEST(StateMachineStop, CommandAgainstCycleTakesThreePresses)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_CLOSED);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    EXPECT_EQ(GARAGE_STATE_OPENING, result.new_state);
+    EXPECT_TRUE(result.actions.trigger_button_press);
+    EXPECT_EQ(3, result.actions.button_presses);
+    EXPECT_TRUE(garage_sm_is_timer_active(&sm));
+}
+
+/**
+ * Test: After a three-press sequence the motion clock starts when the last press is released
+ */
+TEST(StateMachineStop, MotionStartsAfterPressSequence)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 6000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    ASSERT_EQ(50, garage_sm_get_position(&sm));
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    ASSERT_EQ(3, result.actions.button_presses);
+    garage_sm_update_timer(&sm, 2500);
+    EXPECT_EQ(50, garage_sm_get_position(&sm)) << "Held while the sequence is sent";
+    EXPECT_FALSE(sm.obstructed);
+
+    garage_sm_start_motion(&sm);
+    EXPECT_EQ(0, garage_sm_get_timer_elapsed(&sm));
+    garage_sm_update_timer(&sm, 3000);
+    EXPECT_EQ(25, garage_sm_get_position(&sm));
+    garage_sm_start_motion(&sm);
+    EXPECT_EQ(3000, garage_sm_get_timer_elapsed(&sm)) << "Only a pending sequence restarts the clock";
+}
+
+/**
+ * Test: The reed switch still reports a stopped door closed by hand
+ */
+TEST(StateMachineStop, SensorClosedFromStopped)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+
+    EXPECT_FALSE(garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN).state_changed);
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    EXPECT_EQ(GARAGE_STATE_CLOSED, result.new_state);
+    EXPECT_EQ(GARAGE_POSITION_CLOSED, garage_sm_get_position(&sm));
+}
+
+// ========== Obstruction Tests ==========
+
+/**
+ * Test: The switch opening again just after a close is a reversal, once it stays open
+ */
+TEST(StateMachineObstruction, FloorReversalDetected)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 10000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_update_timer(&sm, 1000);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN);
+    EXPECT_EQ(GARAGE_STATE_OPENING, result.new_state) << "Transitions are unchanged";
+    EXPECT_FALSE(sm.obstructed) << "Could still be contact bounce";
+
+    result = garage_sm_update_timer(&sm, 100);
+    EXPECT_FALSE(sm.obstructed);
+    result = garage_sm_update_timer(&sm, 100);
+    EXPECT_TRUE(result.actions.publish_attributes);
+    EXPECT_TRUE(sm.obstructed);
+    EXPECT_EQ(GARAGE_OBSTRUCTION_FLOOR_REVERSAL, sm.last_obstruction);
+    EXPECT_EQ(1u, sm.obstruction_count);
+    EXPECT_EQ(1u, sm.close_failures);
+
+    char json[128];
+    ASSERT_GT(garage_sm_attributes_to_json(&sm, json, sizeof(json)), 0);
+    EXPECT_STREQ("{\"obstructed\":true,\"last_obstruction\":\"floor_reversal\",\"obstructions\":1,\"close_failures\":1}",
+                 json);
+    EXPECT_EQ(-1, garage_sm_attributes_to_json(&sm, json, 16));
+}
+
+/**
+ * Test: Contact bounce at the close and an open edge after the window are not reversals
+ */
+TEST(StateMachineObstruction, BounceAndLateOpenIgnored)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 10000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN);
+    garage_sm_update_timer(&sm, 100);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_update_timer(&sm, 500);
+    EXPECT_FALSE(sm.obstructed) << "Bounce settled closed across a tick";
+
+    garage_sm_update_timer(&sm, 3000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN);
+    garage_sm_update_timer(&sm, 1000);
+    EXPECT_FALSE(sm.obstructed) << "Opened by hand after the window";
+    EXPECT_EQ(0u, sm.obstruction_count);
+}
+
+/**
+ * Test: A close running well over the learned travel time is flagged before the timeout
+ */
+TEST(StateMachineObstruction, OverdueCloseFlaggedBeforeTimeout)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 10000, .close_travel_ms = 10000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_transition_result_t result = garage_sm_update_timer(&sm, 11900);
+    EXPECT_FALSE(result.actions.publish_attributes);
+    result = garage_sm_update_timer(&sm, 100);
+    EXPECT_TRUE(result.actions.publish_attributes) << "120% of 10 s";
+    EXPECT_EQ(GARAGE_STATE_CLOSING, result.new_state);
+    EXPECT_EQ(GARAGE_OBSTRUCTION_CLOSE_OVERDUE, sm.last_obstruction);
+
+    result = garage_sm_update_timer(&sm, 3000);
+    EXPECT_EQ(GARAGE_STATE_UNKNOWN, result.new_state);
+    EXPECT_EQ(1u, sm.obstruction_count) << "Timeout does not count the same close twice";
+}
+
+/**
+ * Test: The overdue budget of a close sent as three presses counts from the last press
+ */
+TEST(StateMachineObstruction, OverdueBudgetExcludesPressSequence)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 10000, .close_travel_ms = 10000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 9000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_STOP);
+    ASSERT_EQ(10, garage_sm_get_position(&sm));
+
+    // 1.2 s budget, shorter than the sequence itself
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    ASSERT_EQ(3, result.actions.button_presses);
+    result = garage_sm_update_timer(&sm, 2500);
+    EXPECT_FALSE(result.actions.publish_attributes);
+    EXPECT_FALSE(sm.obstructed) << "Still sending the presses";
+
+    garage_sm_start_motion(&sm);
+    result = garage_sm_update_timer(&sm, 1100);
+    EXPECT_FALSE(sm.obstructed);
+    result = garage_sm_update_timer(&sm, 100);
+    EXPECT_TRUE(result.actions.publish_attributes) << "120% of 1 s after the last press";
+    EXPECT_EQ(GARAGE_OBSTRUCTION_CLOSE_OVERDUE, sm.last_obstruction);
+}
+
+/**
+ * Test: An overdue close that reaches the switch was slow, not obstructed
+ */
+TEST(StateMachineObstruction, SlowCloseRetracted)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 10000, .close_travel_ms = 10000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 12500);
+    ASSERT_TRUE(sm.obstructed);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    EXPECT_TRUE(result.actions.publish_attributes);
+    EXPECT_FALSE(sm.obstructed);
+    EXPECT_EQ(0u, sm.obstruction_count);
+    EXPECT_EQ(0u, sm.close_failures);
+}
+
+/**
+ * Test: An overdue close is confirmed only when it does not reach the switch, so a slow close never counts
+ */
+TEST(StateMachineObstruction, OverdueConfirmedOnlyWhenNotRetracted)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 10000, .close_travel_ms = 10000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+
+    // Slow: flagged, then retracted; never confirmed
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 12500);
+    ASSERT_EQ(1u, sm.obstruction_count);
+    EXPECT_EQ(0u, garage_sm_confirmed_obstruction_count(&sm));
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    EXPECT_EQ(0u, sm.obstruction_count);
+    EXPECT_EQ(0u, garage_sm_confirmed_obstruction_count(&sm));
+
+    // Obstructed: confirmed at the timeout
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 12500);
+    EXPECT_EQ(0u, garage_sm_confirmed_obstruction_count(&sm));
+    garage_sm_update_timer(&sm, 2500);
+    ASSERT_EQ(GARAGE_STATE_UNKNOWN, garage_sm_get_state(&sm));
+    EXPECT_EQ(1u, garage_sm_confirmed_obstruction_count(&sm));
+}
+
+/**
+ * Test: Close timeouts count as consecutive failures until a close stays closed
+ */
+TEST(StateMachineObstruction, RepeatedCloseFailuresCounted)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+
+    for (int i = 1; i <= 3; i++) {
+        garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+        EXPECT_FALSE(sm.obstructed) << "Cleared by the new attempt";
+        garage_transition_result_t result = garage_sm_update_timer(&sm, 15000);
+        EXPECT_TRUE(result.actions.publish_attributes);
+        EXPECT_EQ(GARAGE_OBSTRUCTION_CLOSE_TIMEOUT, sm.last_obstruction);
+        EXPECT_EQ((uint32_t) i, sm.close_failures);
+    }
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    EXPECT_EQ(3u, sm.close_failures) << "Not yet past the reversal window";
+    garage_transition_result_t result = garage_sm_update_timer(&sm, 3000);
+    EXPECT_TRUE(result.actions.publish_attributes);
+    EXPECT_EQ(0u, sm.close_failures);
+    EXPECT_EQ(3u, sm.obstruction_count) << "Total kept for maintenance";
+}
+
+/**
+ * Test: Opening by command right after a close is not a reversal, even if the switch bounces
+ */
+TEST(StateMachineObstruction, CommandedOpenAfterCloseIgnored)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_update_timer(&sm, 1000);
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_OPEN);
+    garage_sm_update_timer(&sm, 1000);
+    EXPECT_FALSE(sm.obstructed);
+    EXPECT_EQ(0u, sm.obstruction_count);
+}
+
+// ========== Distance Sensor Fusion Tests ==========
+
+/**
+ * Test: The distance sensor ends an opening, or a stopped or unknown door, at the open end
+ */
+TEST(StateMachineDistance, OpenEndMeasured)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_CLOSED);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_OPEN);
+    garage_sm_update_timer(&sm, 11000);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_OPEN);
+    EXPECT_EQ(GARAGE_STATE_OPEN, result.new_state);
+    EXPECT_TRUE(result.actions.publish_state);
+    EXPECT_FALSE(result.actions.trigger_button_press);
+    EXPECT_FALSE(garage_sm_is_timer_active(&sm));
+    EXPECT_EQ(GARAGE_POSITION_OPEN, garage_sm_get_position(&sm));
+
+    for (garage_state_t state : { GARAGE_STATE_UNKNOWN, GARAGE_STATE_STOPPED }) {
+        garage_sm_init(&sm, state);
+        EXPECT_FALSE(garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_CLEAR).state_changed) << "Could be anywhere";
+        EXPECT_EQ(GARAGE_STATE_OPEN, garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_OPEN).new_state) << state;
+    }
+}
+
+/**
+ * Test: The door leaving the open end by itself is a close from the wall button, and is timed
+ */
+TEST(StateMachineDistance, WallButtonCloseTracked)
+{
+    garage_state_machine_t sm;
+    garage_sm_config_t config = { .timeout_ms = 15000, .open_travel_ms = 12000, .close_travel_ms = 12000 };
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_CLEAR);
+    EXPECT_EQ(GARAGE_STATE_CLOSING, result.new_state);
+    EXPECT_FALSE(result.actions.trigger_button_press) << "Already moving";
+    EXPECT_TRUE(garage_sm_is_timer_active(&sm));
+
+    garage_sm_update_timer(&sm, 6000);
+    EXPECT_EQ(50, garage_sm_get_position(&sm));
+    garage_sm_update_timer(&sm, 2000);
+    garage_sm_process_event(&sm, GARAGE_EVENT_SENSOR_CLOSED);
+    EXPECT_EQ(11000, sm.close_travel_ms) << "Full close from the open end is learned";
+
+    // A commanded close leaves the open end too; that edge changes nothing
+    garage_sm_init_with_config(&sm, GARAGE_STATE_OPEN, &config);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 1000);
+    result = garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_CLEAR);
+    EXPECT_FALSE(result.state_changed);
+    EXPECT_EQ(1000, garage_sm_get_timer_elapsed(&sm));
+}
+
+/**
+ * Test: The reed switch stays the only authority for closed
+ */
+TEST(StateMachineDistance, ReedSwitchOwnsClosed)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_CLOSED);
+    EXPECT_FALSE(garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_OPEN).state_changed);
+    EXPECT_FALSE(garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_CLEAR).state_changed);
+    EXPECT_EQ(GARAGE_STATE_CLOSED, garage_sm_get_state(&sm));
+}
+
+/**
+ * Test: A close that ends with the door back at the open end is an obstruction, counted once
+ */
+TEST(StateMachineDistance, ReopenedDuringClose)
+{
+    garage_state_machine_t sm;
+    garage_sm_init(&sm, GARAGE_STATE_OPEN);
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_CLEAR);
+    garage_sm_update_timer(&sm, 5000);
+
+    garage_transition_result_t result = garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_OPEN);
+    EXPECT_EQ(GARAGE_STATE_OPEN, result.new_state);
+    EXPECT_FALSE(result.actions.trigger_button_press);
+    EXPECT_TRUE(result.actions.publish_attributes);
+    EXPECT_TRUE(sm.obstructed);
+    EXPECT_EQ(GARAGE_OBSTRUCTION_REOPENED, sm.last_obstruction);
+    EXPECT_EQ(1u, sm.obstruction_count);
+    EXPECT_STREQ("reopened", garage_obstruction_to_string(sm.last_obstruction));
+
+    garage_sm_process_event(&sm, GARAGE_EVENT_COMMAND_CLOSE);
+    garage_sm_update_timer(&sm, 14500);
+    ASSERT_TRUE(sm.obstructed) << "Overdue";
+    garage_sm_process_event(&sm, GARAGE_EVENT_DISTANCE_OPEN);
+    EXPECT_EQ(2u, sm.obstruction_count) << "Same close not counted twice";
+}
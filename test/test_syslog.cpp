@@ -0,0 +1,298 @@
+/**
+ * @file test_syslog.cpp
+ * @brief Tests for remote logging: the log ring, syslog formatting, batching and rate limiting
+ *
+ * The socket test plays the collector: a loopback listener receives the
+ * packet and splits it on newlines, as syslog-ng or Vector would.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "log_ring.h"
+#include "syslog_sink.h"
+}
+
+/// Feed text to the ring one character at a time, as the putchar hook does
+static void put(log_ring_t* ring, const std::string& text)
+{
+    for (char ch : text) {
+        log_ring_putc(ring, ch);
+    }
+}
+
+/// Next line from the ring, or "<empty>"
+static std::string pop(log_ring_t* ring, uint32_t* seq = nullptr)
+{
+    char line[LOG_RING_LINE_MAX + 1];
+    int len = log_ring_pop(ring, line, sizeof(line), seq);
+    return len < 0 ? "<empty>" : std::string(line, len);
+}
+
+/// Packet split into its messages
+static std::vector<std::string> messages(const char* packet, size_t len)
+{
+    std::vector<std::string> out;
+    std::string all(packet, len);
+    size_t start = 0;
+    for (size_t nl; (nl = all.find('\n', start)) != std::string::npos; start = nl + 1) {
+        out.push_back(all.substr(start, nl - start));
+    }
+    out.push_back(all.substr(start));
+    return out;
+}
+
+static syslog_sink_t make_sink(uint32_t rate_per_s, uint32_t burst, uint32_t now_ms = 0)
+{
+    syslog_sink_t sink;
+    const syslog_sink_config_t config = { "garage-door", rate_per_s, burst };
+    syslog_sink_init(&sink, &config, now_ms);
+    return sink;
+}
+
+/**
+ * Test: Lines are assembled from characters without colours or carriage returns; empty lines are skipped
+ */
+TEST(LogRingTest, AssemblesCleanLines)
+{
+    log_ring_t ring;
+    log_ring_init(&ring);
+    put(&ring, "\x1b[0;32mI (120) app: Door closed\x1b[0m\r\n\n\r\n");
+    put(&ring, "raw text\n");
+    put(&ring, "partial");
+
+    EXPECT_EQ(2u, ring.lines);
+    uint32_t seq = 0;
+    EXPECT_EQ("I (120) app: Door closed", pop(&ring, &seq));
+    EXPECT_EQ(1u, seq);
+    EXPECT_EQ("raw text", pop(&ring, &seq));
+    EXPECT_EQ(2u, seq);
+    EXPECT_EQ("<empty>", pop(&ring));
+
+    put(&ring, "\n");
+    EXPECT_EQ("partial", pop(&ring, &seq));
+    EXPECT_EQ(3u, seq);
+}
+
+/**
+ * Test: A full ring overwrites whole oldest lines and counts them; the sequence numbers show the gap
+ */
+TEST(LogRingTest, OverwritesOldestWholeLines)
+{
+    log_ring_t ring;
+    log_ring_init(&ring);
+    const std::string text(99, 'x');        // 100 bytes a line with its length byte
+    const int total = LOG_RING_SIZE / 100 + 5;
+    for (int i = 0; i < total; i++) {
+        put(&ring, text + "\n");
+    }
+
+    EXPECT_EQ((uint32_t) total, ring.lines);
+    EXPECT_GT(ring.overwritten, 0u);
+    EXPECT_LE(ring.used, (size_t) LOG_RING_SIZE);
+    uint32_t seq = 0;
+    EXPECT_EQ(text, pop(&ring, &seq));
+    EXPECT_EQ(ring.overwritten + 1, seq);
+
+    uint32_t popped = 1;
+    while (pop(&ring) != "<empty>") {
+        popped++;
+    }
+    EXPECT_EQ(ring.lines - ring.overwritten, popped);
+    EXPECT_EQ(ring.lines, ring.removed);
+}
+
+/**
+ * Test: Lines over LOG_RING_LINE_MAX are cut and counted
+ */
+TEST(LogRingTest, CutsLongLines)
+{
+    log_ring_t ring;
+    log_ring_init(&ring);
+    put(&ring, std::string(LOG_RING_LINE_MAX + 40, 'y') + "\nnext\n");
+
+    EXPECT_EQ(1u, ring.cut);
+    EXPECT_EQ(std::string(LOG_RING_LINE_MAX, 'y'), pop(&ring));
+    EXPECT_EQ("next", pop(&ring));
+}
+
+/**
+ * Test: An ESP_LOG line maps to severity, APP-NAME and meta parameters; other lines go out whole at info
+ */
+TEST(SyslogFormatTest, MapsEspLogLines)
+{
+    char buf[256];
+    const char* line = "W (12345) wifi: Disconnected";
+    int len = syslog_format("garage-door", line, strlen(line), 57, nullptr, buf, sizeof(buf));
+    ASSERT_GT(len, 0);
+    EXPECT_EQ("<132>1 - garage-door wifi - - [meta sequenceId=\"57\" sysUpTime=\"1234\"] Disconnected",
+              std::string(buf, len));
+
+    // After SNTP, the line's uptime is mapped to UTC
+    wall_clock_t clock;
+    wall_clock_init(&clock);
+    wall_clock_update(&clock, 10000, 1792225800000LL);      // 2026-10-17T08:30:00.000Z at 10 s
+    len = syslog_format("garage-door", line, strlen(line), 57, &clock, buf, sizeof(buf));
+    ASSERT_GT(len, 0);
+    EXPECT_EQ("<132>1 2026-10-17T08:30:02.345Z garage-door wifi - - [meta sequenceId=\"57\" sysUpTime=\"1234\"] "
+              "Disconnected",
+              std::string(buf, len));
+
+    line = "ets Jan  8 2013,rst cause:2";
+    len = syslog_format("garage-door", line, strlen(line), 3, nullptr, buf, sizeof(buf));
+    ASSERT_GT(len, 0);
+    EXPECT_EQ("<134>1 - garage-door - - - [meta sequenceId=\"3\"] ets Jan  8 2013,rst cause:2",
+              std::string(buf, len));
+
+    line = "E (5) no tag here";
+    len = syslog_format("h", line, strlen(line), 0, nullptr, buf, sizeof(buf));
+    ASSERT_GT(len, 0);
+    EXPECT_EQ("<131>1 - h - - - - no tag here", std::string(buf, len));
+
+    EXPECT_EQ(-1, syslog_format("garage-door", line, strlen(line), 1, nullptr, buf, 20));
+}
+
+/**
+ * Test: The bucket lets a burst through, drops and counts the rest, and refills at the set rate
+ */
+TEST(SyslogSinkTest, TokenBucketLimitsRate)
+{
+    syslog_sink_t sink = make_sink(10, 5, 1000);
+    const char* line = "I (1) app: tick";
+    int added = 0;
+    for (int i = 0; i < 8; i++) {
+        added += syslog_sink_add(&sink, line, strlen(line), i + 1, 1000) == SYSLOG_ADDED;
+    }
+    EXPECT_EQ(5, added);
+    EXPECT_EQ(3u, sink.rate_limited);
+    EXPECT_EQ(5, sink.packet_lines);
+
+    // 10 lines a second: one more after 100 ms, none after another 50 ms
+    EXPECT_EQ(SYSLOG_ADDED, syslog_sink_add(&sink, line, strlen(line), 9, 1100));
+    EXPECT_EQ(SYSLOG_RATE_LIMITED, syslog_sink_add(&sink, line, strlen(line), 10, 1150));
+
+    // A long quiet spell refills no more than the burst
+    added = 0;
+    for (int i = 0; i < 10; i++) {
+        added += syslog_sink_add(&sink, line, strlen(line), 11 + i, 60000) == SYSLOG_ADDED;
+    }
+    EXPECT_EQ(5, added);
+}
+
+/**
+ * Test: Lines are batched up to the packet size; a full packet takes no token and changes nothing
+ */
+TEST(SyslogSinkTest, BatchesUntilPacketFull)
+{
+    syslog_sink_t sink = make_sink(1000, 1000);
+    const std::string line = "I (42) app: " + std::string(100, 'z');
+    uint32_t seq = 1;
+    while (syslog_sink_add(&sink, line.c_str(), line.size(), seq, 0) == SYSLOG_ADDED) {
+        seq++;
+    }
+    EXPECT_GT(sink.packet_lines, 1);
+    EXPECT_LE(sink.packet_len, (size_t) SYSLOG_PACKET_MAX);
+    EXPECT_EQ(0u, sink.rate_limited);
+
+    std::vector<std::string> split = messages(sink.packet, sink.packet_len);
+    ASSERT_EQ((size_t) sink.packet_lines, split.size());
+    EXPECT_NE(std::string::npos, split.back().find("sequenceId=\"" + std::to_string(seq - 1) + "\""));
+
+    size_t len = sink.packet_len;
+    EXPECT_EQ(SYSLOG_PACKET_FULL, syslog_sink_add(&sink, line.c_str(), line.size(), seq, 0));
+    EXPECT_EQ(len, sink.packet_len);
+
+    int lines = sink.packet_lines;
+    syslog_sink_packet_done(&sink, true);
+    EXPECT_EQ((uint32_t) lines, sink.sent_lines);
+    EXPECT_EQ(0u, sink.packet_len);
+    EXPECT_EQ(SYSLOG_ADDED, syslog_sink_add(&sink, line.c_str(), line.size(), seq, 0));
+    syslog_sink_packet_done(&sink, false);
+    EXPECT_EQ(1u, sink.send_failed);
+}
+
+/**
+ * Test: Drops from the ring, the bucket and failed sends are reported once, and again only when they grow
+ */
+TEST(SyslogSinkTest, ReportsDrops)
+{
+    syslog_sink_t sink = make_sink(1, 1);
+    EXPECT_TRUE(syslog_sink_add_drop_report(&sink, 0));
+    EXPECT_EQ(0u, sink.packet_len);
+
+    const char* line = "I (1) app: x";
+    syslog_sink_add(&sink, line, strlen(line), 1, 0);
+    syslog_sink_add(&sink, line, strlen(line), 2, 0);
+    EXPECT_TRUE(syslog_sink_add_drop_report(&sink, 4));
+    std::vector<std::string> split = messages(sink.packet, sink.packet_len);
+    ASSERT_EQ(2u, split.size());
+    EXPECT_EQ("<132>1 - garage-door syslog - - - 5 log lines dropped: 4 overwritten in RAM, "
+              "1 over the rate limit, 0 unsent", split[1]);
+    EXPECT_EQ(1, sink.packet_lines);
+
+    syslog_sink_packet_done(&sink, true);
+    EXPECT_TRUE(syslog_sink_add_drop_report(&sink, 4));
+    EXPECT_EQ(0u, sink.packet_len);
+    EXPECT_TRUE(syslog_sink_add_drop_report(&sink, 6));
+    EXPECT_NE(std::string::npos, std::string(sink.packet, sink.packet_len).find("7 log lines dropped"));
+}
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "syslog_udp.h"
+}
+
+/**
+ * Test: A packet from the log ring reaches a loopback collector, which splits it into one message per line
+ */
+TEST(SyslogUdpTest, CollectorReceivesBatch)
+{
+    int collector = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_GE(collector, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, bind(collector, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+    socklen_t addr_len = sizeof(addr);
+    getsockname(collector, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+    timeval timeout = { 2, 0 };
+    setsockopt(collector, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    EXPECT_EQ(-1, syslog_udp_open("not an address", 514));
+    int fd = syslog_udp_open("127.0.0.1", ntohs(addr.sin_port));
+    ASSERT_GE(fd, 0);
+
+    log_ring_t ring;
+    log_ring_init(&ring);
+    put(&ring, "I (10) app: Boot\nW (20) wifi: Retry\nE (30) mqtt: Lost\n");
+    syslog_sink_t sink = make_sink(20, 60);
+    char line[LOG_RING_LINE_MAX + 1];
+    uint32_t seq;
+    for (int len; (len = log_ring_pop(&ring, line, sizeof(line), &seq)) >= 0;) {
+        ASSERT_EQ(SYSLOG_ADDED, syslog_sink_add(&sink, line, (size_t) len, seq, 0));
+    }
+    syslog_sink_packet_done(&sink, syslog_udp_send(fd, sink.packet, sink.packet_len));
+    EXPECT_EQ(3u, sink.sent_lines);
+
+    char packet[SYSLOG_PACKET_MAX];
+    ssize_t received = recv(collector, packet, sizeof(packet), 0);
+    ASSERT_GT(received, 0);
+    std::vector<std::string> split = messages(packet, (size_t) received);
+    ASSERT_EQ(3u, split.size());
+    EXPECT_EQ("<134>1 - garage-door app - - [meta sequenceId=\"1\" sysUpTime=\"1\"] Boot", split[0]);
+    EXPECT_EQ("<132>1 - garage-door wifi - - [meta sequenceId=\"2\" sysUpTime=\"2\"] Retry", split[1]);
+    EXPECT_EQ("<131>1 - garage-door mqtt - - [meta sequenceId=\"3\" sysUpTime=\"3\"] Lost", split[2]);
+
+    syslog_udp_close(fd);
+    close(collector);
+}
+#endif
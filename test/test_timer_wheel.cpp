@@ -0,0 +1,146 @@
+/**
+ * @file test_timer_wheel.cpp
+ * @brief Unit tests for the hashed timer wheel
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C" {
+#include "timer_wheel.h"
+}
+
+class TimerWheelTest : public ::testing::Test {
+protected:
+    timer_wheel_t wheel;
+    timer_wheel_timer_t timers[8];
+
+    void SetUp() override
+    {
+        timer_wheel_init(&wheel, 0);
+        for (int i = 0; i < 8; i++) {
+            timer_wheel_timer_init(&timers[i], &timers[i]);
+        }
+    }
+
+    /// Indices of the timers that expire by now, in the order they come out
+    std::vector<int> expire(uint32_t now)
+    {
+        std::vector<int> fired;
+        timer_wheel_timer_t* timer;
+        while ((timer = timer_wheel_expire(&wheel, now)) != nullptr) {
+            fired.push_back((int) (timer - timers));
+        }
+        return fired;
+    }
+};
+
+/**
+ * Test: A timer fires at its tick and not before
+ */
+TEST_F(TimerWheelTest, FiresAtExpiry)
+{
+    timer_wheel_start(&wheel, &timers[0], 10);
+    EXPECT_TRUE(timers[0].active);
+    EXPECT_EQ(1u, wheel.active);
+
+    EXPECT_TRUE(expire(9).empty());
+    EXPECT_EQ(std::vector<int>({0}), expire(10));
+    EXPECT_FALSE(timers[0].active);
+    EXPECT_EQ(0u, wheel.active);
+    EXPECT_TRUE(expire(100).empty());
+}
+
+/**
+ * Test: Cancelled timers never fire, wherever they sit in their slot's list
+ */
+TEST_F(TimerWheelTest, CancelUnlinks)
+{
+    // Same slot: 5, 5 + SLOTS, 5 + 2 * SLOTS
+    for (int i = 0; i < 3; i++) {
+        timer_wheel_start(&wheel, &timers[i], 5 + (uint32_t) i * TIMER_WHEEL_SLOTS);
+    }
+    timer_wheel_cancel(&wheel, &timers[1]);
+    timer_wheel_cancel(&wheel, &timers[1]);     // No-op the second time
+    EXPECT_EQ(2u, wheel.active);
+
+    EXPECT_EQ(std::vector<int>({0}), expire(5));
+    EXPECT_TRUE(expire(5 + TIMER_WHEEL_SLOTS).empty());
+    EXPECT_EQ(std::vector<int>({2}), expire(5 + 2 * TIMER_WHEEL_SLOTS));
+}
+
+/**
+ * Test: Timers more than one revolution out wait for their own tick
+ */
+TEST_F(TimerWheelTest, LongDelaysSurviveRevolutions)
+{
+    timer_wheel_start(&wheel, &timers[0], 3 * TIMER_WHEEL_SLOTS + 7);
+    timer_wheel_start(&wheel, &timers[1], 7);
+
+    EXPECT_EQ(std::vector<int>({1}), expire(TIMER_WHEEL_SLOTS + 7));
+    EXPECT_TRUE(expire(3 * TIMER_WHEEL_SLOTS + 6).empty());
+    EXPECT_EQ(std::vector<int>({0}), expire(3 * TIMER_WHEEL_SLOTS + 7));
+}
+
+/**
+ * Test: A late expire call returns everything due, and past expiries fire on the next call
+ */
+TEST_F(TimerWheelTest, CatchesUpAndClampsPastExpiries)
+{
+    timer_wheel_start(&wheel, &timers[0], 3);
+    timer_wheel_start(&wheel, &timers[1], 40);
+    timer_wheel_start(&wheel, &timers[2], 200);
+    EXPECT_EQ(std::vector<int>({0, 1}), expire(100));
+
+    timer_wheel_start(&wheel, &timers[3], 50);  // Already in the past
+    EXPECT_EQ(std::vector<int>({3}), expire(100));
+    EXPECT_EQ(std::vector<int>({2}), expire(250));
+}
+
+/**
+ * Test: Restarting a running timer moves it; restarting the one just expired re-arms it
+ */
+TEST_F(TimerWheelTest, RestartDuringExpire)
+{
+    timer_wheel_start(&wheel, &timers[0], 10);
+    timer_wheel_start(&wheel, &timers[0], 20);
+    EXPECT_EQ(1u, wheel.active);
+    EXPECT_TRUE(expire(15).empty());
+
+    int fired = 0;
+    timer_wheel_timer_t* timer;
+    while ((timer = timer_wheel_expire(&wheel, 20)) != nullptr) {
+        fired++;
+        timer_wheel_start(&wheel, timer, 30);
+    }
+    EXPECT_EQ(1, fired);
+    EXPECT_TRUE(timers[0].active);
+    EXPECT_EQ(std::vector<int>({0}), expire(30));
+}
+
+/**
+ * Test: An idle wheel jumps straight to now instead of walking the gap
+ */
+TEST_F(TimerWheelTest, IdleWheelJumps)
+{
+    EXPECT_TRUE(expire(1000000).empty());
+    EXPECT_EQ(1000000u, wheel.cursor);
+
+    timer_wheel_start(&wheel, &timers[0], 1000001);
+    EXPECT_EQ(std::vector<int>({0}), expire(1000001));
+}
+
+/**
+ * Test: Expiry order and timing hold across the 32-bit tick wrap
+ */
+TEST_F(TimerWheelTest, TickWrap)
+{
+    const uint32_t start = UINT32_MAX - 10;
+    timer_wheel_init(&wheel, start);
+    timer_wheel_start(&wheel, &timers[0], start + 5);
+    timer_wheel_start(&wheel, &timers[1], start + 20);     // Wraps to 9
+
+    EXPECT_EQ(std::vector<int>({0}), expire(start + 5));
+    EXPECT_TRUE(expire(start + 19).empty());
+    EXPECT_EQ(std::vector<int>({1}), expire(start + 20));
+}
@@ -0,0 +1,362 @@
+/**
+ * @file test_udp.cpp
+ * @brief Tests for the UDP control channel: frames, command handling, notifications and sockets
+ *
+ * The test plays the gateway: it signs commands with the shared key and checks
+ * the device's replies. The socket test runs udp_server_serve_one() on a
+ * thread against a loopback client.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "udp_control.h"
+#include "udp_frame.h"
+}
+
+static const uint8_t key[] = { 's', 'h', 'a', 'r', 'e', 'd', '-', 'k', 'e', 'y' };
+static const uint32_t session = 0x5eed0001;
+
+/// Signed command frame as the gateway sends it
+static std::vector<uint8_t> command(uint8_t op, uint32_t counter, uint32_t cmd_session = session,
+                                    const uint8_t* k = key, size_t k_len = sizeof(key))
+{
+    udp_frame_t frame = {};
+    frame.type = UDP_FRAME_COMMAND;
+    frame.session = cmd_session;
+    frame.counter = counter;
+    frame.payload[0] = op;
+    std::vector<uint8_t> out(UDP_FRAME_LEN);
+    udp_frame_encode(&frame, k, k_len, out.data());
+    return out;
+}
+
+/**
+ * Test: Frames round-trip, and any flipped bit fails authentication or the header check
+ */
+TEST(UdpFrameTest, RoundTripAndTamperDetection)
+{
+    udp_state_payload_t state = { GARAGE_STATE_CLOSING, 42, true, UDP_RESULT_ACCEPTED, 9, 77 };
+    udp_frame_t frame = {};
+    frame.type = UDP_FRAME_REPLY;
+    frame.session = session;
+    frame.counter = 3;
+    udp_frame_put_state(&state, frame.payload);
+    uint8_t buf[UDP_FRAME_LEN];
+    udp_frame_encode(&frame, key, sizeof(key), buf);
+
+    udp_frame_t decoded;
+    ASSERT_EQ(UDP_FRAME_OK, udp_frame_decode(buf, sizeof(buf), key, sizeof(key), &decoded));
+    EXPECT_EQ(UDP_FRAME_REPLY, decoded.type);
+    EXPECT_EQ(session, decoded.session);
+    EXPECT_EQ(3u, decoded.counter);
+    udp_state_payload_t out;
+    udp_frame_get_state(decoded.payload, &out);
+    EXPECT_EQ(GARAGE_STATE_CLOSING, out.state);
+    EXPECT_EQ(42, out.position);
+    EXPECT_TRUE(out.obstructed);
+    EXPECT_EQ(UDP_RESULT_ACCEPTED, out.result);
+    EXPECT_EQ(9u, out.transition_count);
+    EXPECT_EQ(77u, out.answered_counter);
+
+    for (size_t bit = 0; bit < sizeof(buf) * 8; bit++) {
+        uint8_t tampered[UDP_FRAME_LEN];
+        memcpy(tampered, buf, sizeof(buf));
+        tampered[bit / 8] ^= (uint8_t) (1u << (bit % 8));
+        EXPECT_NE(UDP_FRAME_OK, udp_frame_decode(tampered, sizeof(tampered), key, sizeof(key), &decoded))
+            << "bit " << bit;
+    }
+
+    const uint8_t other_key[] = { 'o', 't', 'h', 'e', 'r' };
+    EXPECT_EQ(UDP_FRAME_BAD_MAC, udp_frame_decode(buf, sizeof(buf), other_key, sizeof(other_key), &decoded));
+    EXPECT_EQ(UDP_FRAME_BAD_LENGTH, udp_frame_decode(buf, sizeof(buf) - 1, key, sizeof(key), &decoded));
+}
+
+/**
+ * Test: An unknown position survives the int8 encoding
+ */
+TEST(UdpFrameTest, UnknownPositionEncodesAsMinusOne)
+{
+    udp_state_payload_t state = { GARAGE_STATE_UNKNOWN, GARAGE_POSITION_UNKNOWN, false, UDP_RESULT_NOTIFY, 0, 0 };
+    uint8_t payload[UDP_FRAME_PAYLOAD_LEN];
+    udp_frame_put_state(&state, payload);
+    udp_state_payload_t out;
+    udp_frame_get_state(payload, &out);
+    EXPECT_EQ(GARAGE_POSITION_UNKNOWN, out.position);
+}
+
+/// Stand-in for the app: records queued commands and serves a fixed snapshot
+struct FakeOwner {
+    std::vector<garage_input_t> queued;
+    bool queue_full = false;
+    garage_controller_snapshot_t snapshot = {};
+};
+
+static bool fake_command(garage_input_t input, void* ctx)
+{
+    FakeOwner* owner = static_cast<FakeOwner*>(ctx);
+    if (owner->queue_full) {
+        return false;
+    }
+    owner->queued.push_back(input);
+    return true;
+}
+
+static void fake_snapshot(garage_controller_snapshot_t* snapshot, void* ctx)
+{
+    *snapshot = static_cast<FakeOwner*>(ctx)->snapshot;
+}
+
+class UdpControlTest : public ::testing::Test {
+protected:
+    FakeOwner owner;
+    udp_control_t ctrl;
+
+    void SetUp() override
+    {
+        owner.snapshot.state = GARAGE_STATE_CLOSED;
+        owner.snapshot.position = GARAGE_POSITION_CLOSED;
+        owner.snapshot.transition_count = 4;
+        udp_control_config_t config = {};
+        config.key = key;
+        config.key_len = sizeof(key);
+        config.session = session;
+        config.position_step_pct = 10;
+        config.heartbeat_ms = UDP_CONTROL_HEARTBEAT_MS;
+        config.on_command = fake_command;
+        config.get_snapshot = fake_snapshot;
+        config.ctx = &owner;
+        udp_control_init(&ctrl, &config);
+    }
+
+    /// Handle a datagram; returns the decoded reply, or result -1 if dropped
+    bool send(const std::vector<uint8_t>& datagram, udp_frame_t* reply_frame, udp_state_payload_t* reply)
+    {
+        uint8_t out[UDP_FRAME_LEN];
+        if (!udp_control_handle(&ctrl, datagram.data(), datagram.size(), out)) {
+            return false;
+        }
+        EXPECT_EQ(UDP_FRAME_OK, udp_frame_decode(out, sizeof(out), key, sizeof(key), reply_frame));
+        EXPECT_EQ(UDP_FRAME_REPLY, reply_frame->type);
+        udp_frame_get_state(reply_frame->payload, reply);
+        return true;
+    }
+};
+
+/**
+ * Test: Authenticated commands are queued and answered with the state
+ */
+TEST_F(UdpControlTest, CommandsAreQueuedAndAnswered)
+{
+    udp_frame_t frame;
+    udp_state_payload_t reply;
+    ASSERT_TRUE(send(command(UDP_OP_OPEN, 10), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_ACCEPTED, reply.result);
+    EXPECT_EQ(10u, reply.answered_counter);
+    EXPECT_EQ(GARAGE_STATE_CLOSED, reply.state);
+    EXPECT_EQ(4u, reply.transition_count);
+    EXPECT_EQ(session, frame.session);
+
+    ASSERT_TRUE(send(command(UDP_OP_STOP, 11), &frame, &reply));
+    ASSERT_TRUE(send(command(UDP_OP_CLOSE, 15), &frame, &reply));
+    ASSERT_TRUE(send(command(UDP_OP_QUERY, 16), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_STATE, reply.result);
+    ASSERT_TRUE(send(command(99, 17), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_BAD_OP, reply.result);
+    EXPECT_EQ(5u, frame.counter);               // Reply counter increases per reply
+
+    std::vector<garage_input_t> expected = { GARAGE_INPUT_COMMAND_OPEN, GARAGE_INPUT_COMMAND_STOP,
+                                             GARAGE_INPUT_COMMAND_CLOSE };
+    EXPECT_EQ(expected, owner.queued);
+    EXPECT_EQ(3u, ctrl.commands);
+}
+
+/**
+ * Test: Replayed, reordered, unauthenticated and malformed frames are dropped without a reply
+ */
+TEST_F(UdpControlTest, DropsReplaysAndForgeries)
+{
+    udp_frame_t frame;
+    udp_state_payload_t reply;
+    std::vector<uint8_t> open = command(UDP_OP_OPEN, 20);
+    ASSERT_TRUE(send(open, &frame, &reply));
+
+    EXPECT_FALSE(send(open, &frame, &reply));                           // Replay
+    EXPECT_FALSE(send(command(UDP_OP_CLOSE, 19), &frame, &reply));      // Older counter
+    const uint8_t wrong_key[] = { 'g', 'u', 'e', 's', 's' };
+    EXPECT_FALSE(send(command(UDP_OP_CLOSE, 21, session, wrong_key, sizeof(wrong_key)), &frame, &reply));
+    EXPECT_FALSE(send(std::vector<uint8_t>(open.begin(), open.end() - 1), &frame, &reply));
+    EXPECT_FALSE(send(std::vector<uint8_t>(), &frame, &reply));
+
+    // The device's own reply is signed with the same key but is not a command
+    uint8_t own_reply[UDP_FRAME_LEN];
+    ASSERT_TRUE(udp_control_handle(&ctrl, command(UDP_OP_QUERY, 22).data(), UDP_FRAME_LEN, own_reply));
+    EXPECT_FALSE(send(std::vector<uint8_t>(own_reply, own_reply + UDP_FRAME_LEN), &frame, &reply));
+
+    EXPECT_EQ(1u, owner.queued.size());
+    EXPECT_EQ(6u, ctrl.dropped);
+}
+
+/**
+ * Test: A gateway without the session gets a RESYNC reply and nothing is executed
+ */
+TEST_F(UdpControlTest, WrongSessionResyncs)
+{
+    udp_frame_t frame;
+    udp_state_payload_t reply;
+    ASSERT_TRUE(send(command(UDP_OP_QUERY, 1, 0), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_RESYNC, reply.result);
+    EXPECT_EQ(session, frame.session);
+
+    ASSERT_TRUE(send(command(UDP_OP_OPEN, 2, session + 1), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_RESYNC, reply.result);
+    EXPECT_TRUE(owner.queued.empty());
+
+    // Resyncs do not consume counters
+    ASSERT_TRUE(send(command(UDP_OP_OPEN, 2), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_ACCEPTED, reply.result);
+    EXPECT_EQ(2u, ctrl.resyncs);
+}
+
+/**
+ * Test: A full queue is reported as BUSY, and the counter is still consumed
+ */
+TEST_F(UdpControlTest, FullQueueIsBusy)
+{
+    udp_frame_t frame;
+    udp_state_payload_t reply;
+    owner.queue_full = true;
+    ASSERT_TRUE(send(command(UDP_OP_OPEN, 5), &frame, &reply));
+    EXPECT_EQ(UDP_RESULT_BUSY, reply.result);
+    EXPECT_FALSE(send(command(UDP_OP_OPEN, 5), &frame, &reply));
+    EXPECT_EQ(0u, ctrl.commands);
+}
+
+/**
+ * Test: Notifications on state changes, position steps, endpoints and heartbeats only
+ */
+TEST_F(UdpControlTest, NotificationsFollowChanges)
+{
+    uint8_t buf[UDP_FRAME_LEN];
+    garage_controller_snapshot_t snapshot = owner.snapshot;
+    int64_t now = 1000;
+
+    ASSERT_TRUE(udp_control_poll_notification(&ctrl, &snapshot, now, buf));   // First one always
+    EXPECT_FALSE(udp_control_poll_notification(&ctrl, &snapshot, now += 100, buf));
+
+    snapshot.state = GARAGE_STATE_OPENING;
+    snapshot.position = 1;
+    ASSERT_TRUE(udp_control_poll_notification(&ctrl, &snapshot, now += 100, buf));
+    udp_frame_t frame;
+    ASSERT_EQ(UDP_FRAME_OK, udp_frame_decode(buf, sizeof(buf), key, sizeof(key), &frame));
+    EXPECT_EQ(UDP_FRAME_NOTIFY, frame.type);
+    EXPECT_EQ(2u, frame.counter);
+    udp_state_payload_t state;
+    udp_frame_get_state(frame.payload, &state);
+    EXPECT_EQ(GARAGE_STATE_OPENING, state.state);
+    EXPECT_EQ(UDP_RESULT_NOTIFY, state.result);
+    EXPECT_EQ(0u, state.answered_counter);
+
+    snapshot.position = 9;
+    EXPECT_FALSE(udp_control_poll_notification(&ctrl, &snapshot, now += 100, buf));
+    snapshot.position = 11;
+    EXPECT_TRUE(udp_control_poll_notification(&ctrl, &snapshot, now += 100, buf));
+    snapshot.state = GARAGE_STATE_OPEN;
+    snapshot.position = GARAGE_POSITION_OPEN;
+    EXPECT_TRUE(udp_control_poll_notification(&ctrl, &snapshot, now += 100, buf));
+    snapshot.obstructed = true;
+    EXPECT_TRUE(udp_control_poll_notification(&ctrl, &snapshot, now += 100, buf));
+
+    EXPECT_FALSE(udp_control_poll_notification(&ctrl, &snapshot, now + UDP_CONTROL_HEARTBEAT_MS - 1, buf));
+    EXPECT_TRUE(udp_control_poll_notification(&ctrl, &snapshot, now + UDP_CONTROL_HEARTBEAT_MS, buf));
+}
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <thread>
+
+extern "C" {
+#include "udp_server.h"
+}
+
+/// Loopback socket with a receive timeout so a lost datagram fails the test instead of hanging it
+static int client_socket(uint16_t bind_port = 0)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(bind_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    timeval timeout = { 2, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+/**
+ * Test: The server answers a loopback gateway and notifications reach a unicast listener
+ */
+TEST_F(UdpControlTest, ServerAnswersLoopbackGateway)
+{
+    int server_fd = udp_server_open(0);
+    ASSERT_GE(server_fd, 0);
+    sockaddr_in server = {};
+    server.sin_family = AF_INET;
+    server.sin_port = htons(udp_server_port(server_fd));
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::vector<int> results;
+    std::thread task([&] {
+        for (int i = 0; i < 2; i++) {
+            results.push_back(udp_server_serve_one(server_fd, &ctrl));
+        }
+    });
+
+    int gateway = client_socket();
+    std::vector<uint8_t> forged = command(UDP_OP_OPEN, 1, session, (const uint8_t*) "nope", 4);
+    sendto(gateway, forged.data(), forged.size(), 0, reinterpret_cast<sockaddr*>(&server), sizeof(server));
+    std::vector<uint8_t> open = command(UDP_OP_OPEN, 1);
+    sendto(gateway, open.data(), open.size(), 0, reinterpret_cast<sockaddr*>(&server), sizeof(server));
+
+    uint8_t reply[UDP_FRAME_LEN + 8];
+    ssize_t n = recv(gateway, reply, sizeof(reply), 0);
+    task.join();
+    udp_server_close(server_fd);
+
+    ASSERT_EQ((ssize_t) UDP_FRAME_LEN, n);
+    udp_frame_t frame;
+    ASSERT_EQ(UDP_FRAME_OK, udp_frame_decode(reply, (size_t) n, key, sizeof(key), &frame));
+    udp_state_payload_t state;
+    udp_frame_get_state(frame.payload, &state);
+    EXPECT_EQ(UDP_RESULT_ACCEPTED, state.result);
+    std::vector<int> expected = { 0, 1 };
+    EXPECT_EQ(expected, results);
+    ASSERT_EQ(1u, owner.queued.size());
+
+    // Notification to a unicast address
+    int listener = client_socket();
+    sockaddr_in listen_addr = {};
+    socklen_t len = sizeof(listen_addr);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&listen_addr), &len);
+    int notifier = udp_server_open_notifier();
+    ASSERT_GE(notifier, 0);
+    uint8_t notify[UDP_FRAME_LEN];
+    ASSERT_TRUE(udp_control_poll_notification(&ctrl, &owner.snapshot, 0, notify));
+    EXPECT_TRUE(udp_server_notify(notifier, "127.0.0.1", ntohs(listen_addr.sin_port), notify));
+    EXPECT_FALSE(udp_server_notify(notifier, "not an address", 1, notify));
+    n = recv(listener, reply, sizeof(reply), 0);
+    ASSERT_EQ((ssize_t) UDP_FRAME_LEN, n);
+    EXPECT_EQ(UDP_FRAME_OK, udp_frame_decode(reply, (size_t) n, key, sizeof(key), &frame));
+    EXPECT_EQ(UDP_FRAME_NOTIFY, frame.type);
+
+    close(gateway);
+    close(listener);
+    udp_server_close(notifier);
+}
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file test_wall_clock.cpp
+ * @brief Tests for the uptime to UTC mapping and the timestamps it puts on payloads
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <string>
+
+extern "C" {
+#include "wall_clock.h"
+}
+
+static std::string format(int64_t utc_ms)
+{
+    char buf[WALL_CLOCK_TEXT_MAX + 1];
+    int len = wall_clock_format(utc_ms, buf, sizeof(buf));
+    return len < 0 ? "<error>" : std::string(buf, len);
+}
+
+/**
+ * Test: The mapping is unknown until the system time is set, follows drift, and reports steps
+ */
+TEST(WallClockTest, MappingFollowsSync)
+{
+    wall_clock_t clock;
+    wall_clock_init(&clock);
+    int64_t utc_ms = 0;
+    EXPECT_FALSE(wall_clock_to_utc_ms(&clock, 5000, &utc_ms));
+
+    // The system time before SNTP is 1970 plus the uptime
+    EXPECT_FALSE(wall_clock_update(&clock, 5000, 5000));
+    EXPECT_FALSE(clock.synced);
+
+    EXPECT_TRUE(wall_clock_update(&clock, 10000, 1792225800000LL));
+    ASSERT_TRUE(wall_clock_to_utc_ms(&clock, 12500, &utc_ms));
+    EXPECT_EQ(1792225802500LL, utc_ms);
+    EXPECT_EQ(1u, clock.steps);
+
+    // Drift is taken in quietly; a correction of WALL_CLOCK_STEP_MS or more is a step
+    EXPECT_FALSE(wall_clock_update(&clock, 70000, 1792225860000LL + 150));
+    ASSERT_TRUE(wall_clock_to_utc_ms(&clock, 70000, &utc_ms));
+    EXPECT_EQ(1792225860150LL, utc_ms);
+    EXPECT_TRUE(wall_clock_update(&clock, 130000, 1792225920000LL - WALL_CLOCK_STEP_MS));
+    EXPECT_EQ(2u, clock.steps);
+}
+
+/**
+ * Test: UTC times format as RFC 3339 with milliseconds, across leap days and centuries
+ */
+TEST(WallClockTest, FormatsRfc3339)
+{
+    EXPECT_EQ("1970-01-01T00:00:00.000Z", format(0));
+    EXPECT_EQ("2020-01-01T00:00:00.000Z", format((int64_t) WALL_CLOCK_MIN_UTC_S * 1000));
+    EXPECT_EQ("2026-10-17T08:30:00.250Z", format(1792225800250LL));
+    EXPECT_EQ("2024-02-29T23:59:59.999Z", format(1709251199999LL));
+    EXPECT_EQ("2100-03-01T00:00:00.000Z", format(4107542400000LL));
+    EXPECT_EQ("<error>", format(-1));
+
+    char small[WALL_CLOCK_TEXT_MAX];
+    EXPECT_EQ(-1, wall_clock_format(0, small, sizeof(small)));
+}
+
+/**
+ * Test: A "time" member is added to JSON objects that have room for it, and nothing else is touched
+ */
+TEST(WallClockTest, StampsJsonObjects)
+{
+    char json[96] = "{\"rule\":\"night\",\"status\":\"ok\"}";
+    int len = wall_clock_stamp_json(json, (int) strlen(json), sizeof(json), 1792225800250LL);
+    EXPECT_EQ("{\"rule\":\"night\",\"status\":\"ok\",\"time\":\"2026-10-17T08:30:00.250Z\"}", std::string(json, len));
+    EXPECT_EQ((size_t) len, strlen(json));
+
+    char empty[48] = "{}";
+    len = wall_clock_stamp_json(empty, 2, sizeof(empty), 0);
+    EXPECT_EQ("{\"time\":\"1970-01-01T00:00:00.000Z\"}", std::string(empty, len));
+
+    char tight[40] = "{\"a\":1}";
+    EXPECT_EQ(7, wall_clock_stamp_json(tight, 7, sizeof(tight), 0));
+    EXPECT_STREQ("{\"a\":1}", tight);
+
+    char text[16] = "open";
+    EXPECT_EQ(4, wall_clock_stamp_json(text, 4, sizeof(text), 0));
+    EXPECT_STREQ("open", text);
+}
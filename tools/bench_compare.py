@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Host benchmark regression check against a checked-in baseline.
+
+Runs the `benchmarks` target with repeated timings (or reads results it wrote
+with --json) and compares every baseline benchmark with Welch's t interval on
+the difference of means. A benchmark regresses when the lower bound of the
+one-sided 95% interval for its slowdown is above the threshold, i.e. it is
+slower by more than the threshold with 95% confidence. The exit status is 1 if
+any benchmark regresses or is missing, 2 on a usage or context error.
+
+The baseline covers the firmware paths tuned for the 80 MHz part: state
+machine, retry managers, event dispatch and serializers. Host timings are
+machine specific and drift by several percent between sessions on a shared
+host, hence the 10% default threshold; regenerate the baseline on the
+reference machine with --update-baseline after an intended change.
+
+Usage:
+    bench_compare.py --benchmarks <benchmarks exe> [--baseline baseline.json] [--threshold 0.10]
+    bench_compare.py --current results.json [--baseline baseline.json]
+    bench_compare.py --benchmarks <benchmarks exe> --update-baseline [--repetitions 10]
+"""
+
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+import tempfile
+
+# Benchmark name prefixes kept in the baseline
+BASELINE_PREFIXES = (
+    "BM_StateMachine_",
+    "BM_WifiRetry_",
+    "BM_MqttRetry_",
+    "BM_GpioPath_",
+    "BM_MqttIngress_",
+    "BM_Serializer_",
+)
+
+# One-sided 95% Student t quantiles by degrees of freedom
+T_95 = [
+    (1, 6.314), (2, 2.920), (3, 2.353), (4, 2.132), (5, 2.015), (6, 1.943), (7, 1.895),
+    (8, 1.860), (9, 1.833), (10, 1.812), (12, 1.782), (15, 1.753), (20, 1.725), (25, 1.708),
+    (30, 1.697), (40, 1.684), (60, 1.671), (120, 1.658),
+]
+
+
+def t_quantile(df):
+    """One-sided 95% t quantile; between table entries the smaller df is used (conservative)."""
+    value = T_95[0][1]
+    for table_df, quantile in T_95:
+        if df >= table_df:
+            value = quantile
+    return value
+
+
+def mean_var(samples):
+    n = len(samples)
+    mean = sum(samples) / n
+    var = sum((x - mean) ** 2 for x in samples) / (n - 1) if n > 1 else 0.0
+    return mean, var
+
+
+def compare(baseline, current):
+    """Return (relative change, lower bound, upper bound) of current vs baseline mean ns/op."""
+    b_mean, b_var = mean_var(baseline)
+    c_mean, c_var = mean_var(current)
+    se_b = b_var / len(baseline)
+    se_c = c_var / len(current)
+    se = math.sqrt(se_b + se_c)
+    if se == 0:
+        change = (c_mean - b_mean) / b_mean
+        return change, change, change
+    # Welch-Satterthwaite degrees of freedom
+    denominator = 0.0
+    if len(baseline) > 1:
+        denominator += se_b ** 2 / (len(baseline) - 1)
+    if len(current) > 1:
+        denominator += se_c ** 2 / (len(current) - 1)
+    df = (se_b + se_c) ** 2 / denominator if denominator > 0 else 1
+    margin = t_quantile(int(df)) * se
+    diff = c_mean - b_mean
+    return diff / b_mean, (diff - margin) / b_mean, (diff + margin) / b_mean
+
+
+def run_benchmarks(exe, repetitions, min_time_ms):
+    fd, path = tempfile.mkstemp(suffix=".json")
+    os.close(fd)
+    try:
+        subprocess.run([exe, "--repetitions", str(repetitions), "--min-time-ms", str(min_time_ms), "--json", path],
+                       check=True, stdout=sys.stderr)
+        with open(path) as f:
+            return json.load(f)
+    finally:
+        os.remove(path)
+
+
+def by_name(results):
+    return {b["name"]: b for b in results["benchmarks"]}
+
+
+def main(argv):
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--baseline", default=os.path.join(here, "..", "test", "bench", "baseline.json"))
+    parser.add_argument("--benchmarks", help="benchmarks executable to run")
+    parser.add_argument("--current", help="results written by `benchmarks --json` instead of running")
+    parser.add_argument("--repetitions", type=int, default=10, help="timed runs per benchmark")
+    parser.add_argument("--min-time-ms", type=float, help="per-run time (default: the baseline's)")
+    parser.add_argument("--threshold", type=float, default=0.10, help="tolerated slowdown, 0.10 = 10%%")
+    parser.add_argument("--update-baseline", action="store_true", help="rewrite the baseline from this run")
+    args = parser.parse_args(argv)
+
+    if (args.benchmarks is None) == (args.current is None):
+        parser.error("give exactly one of --benchmarks or --current")
+
+    baseline = None
+    if not args.update_baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    if args.current is not None:
+        with open(args.current) as f:
+            current = json.load(f)
+    else:
+        min_time_ms = args.min_time_ms
+        if min_time_ms is None:
+            min_time_ms = baseline["context"]["min_time_ms"] if baseline else 100
+        current = run_benchmarks(args.benchmarks, args.repetitions, min_time_ms)
+
+    if args.update_baseline:
+        current["benchmarks"] = [b for b in current["benchmarks"] if b["name"].startswith(BASELINE_PREFIXES)]
+        with open(args.baseline, "w") as f:
+            json.dump(current, f, indent=2)
+            f.write("\n")
+        print("Baseline updated: %s (%d benchmarks)" % (args.baseline, len(current["benchmarks"])))
+        return 0
+
+    for key in ("compiler", "build"):
+        if baseline["context"].get(key) != current["context"].get(key):
+            print("error: baseline %s is %r but this run is %r; rebuild to match or update the baseline"
+                  % (key, baseline["context"].get(key), current["context"].get(key)), file=sys.stderr)
+            return 2
+
+    current_by_name = by_name(current)
+    failures = []
+    print("%-40s %12s %12s %9s %21s" % ("benchmark", "base ns/op", "now ns/op", "change", "95% interval"))
+    for name, base in sorted(by_name(baseline).items()):
+        now = current_by_name.get(name)
+        if now is None:
+            print("%-40s %12.1f %12s" % (name, base["mean_ns"], "missing"))
+            failures.append("%s: missing from this run" % name)
+            continue
+        change, low, high = compare(base["samples_ns"], now["samples_ns"])
+        verdict = ""
+        if low > args.threshold:
+            verdict = "REGRESSED"
+            failures.append("%s: %+.1f%% (at least %+.1f%% with 95%% confidence)" % (name, change * 100, low * 100))
+        elif high < -args.threshold:
+            verdict = "faster"
+        print("%-40s %12.1f %12.1f %+8.1f%% [%+8.1f%%, %+8.1f%%] %s"
+              % (name, base["mean_ns"], now["mean_ns"], change * 100, low * 100, high * 100, verdict))
+
+    print()
+    if failures:
+        print("Regressions beyond %.0f%%:" % (args.threshold * 100))
+        for failure in failures:
+            print("  " + failure)
+        return 1
+    print("No significant regressions beyond %.0f%%" % (args.threshold * 100))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,263 @@
+#!/usr/bin/env python3
+"""Firmware size and RAM budget report from the ESP8266 linker map.
+
+Parses the GNU ld map file produced by the ESP8266 RTOS SDK build and reports
+IRAM, .text, .rodata, .data and .bss per source module of this project and
+per library, plus IRAM/DRAM headroom from the map's memory configuration.
+The results are compared against the checked-in budgets (size_budgets.json);
+the exit status is 1 if any budget is exceeded.
+
+Usage:
+    size_report.py <firmware.map> [--budgets size_budgets.json] [--source-dir main]
+    size_report.py <firmware.map> --update-budgets [--margin 0.10]
+"""
+
+import argparse
+import fnmatch
+import json
+import os
+import re
+import sys
+
+SECTION_KINDS = ("iram", "text", "rodata", "data", "bss")
+
+# Memory regions of interest in the ESP8266 linker scripts
+REGIONS = {
+    "iram": "iram1_0_seg",
+    "dram": "dram0_0_seg",
+}
+
+# ld map input-section line: " .name  0xaddr  0xsize  file"; long names wrap onto the next line
+INPUT_SECTION_RE = re.compile(r"^ (\.\S+|COMMON)\s*$|^ (\.\S+|COMMON)\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S.*)$")
+CONTINUATION_RE = re.compile(r"^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S.*)$")
+OUTPUT_SECTION_RE = re.compile(r"^(\.\S+)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+))?\s*$")
+MEMORY_RE = re.compile(r"^(\S+)\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)(?:\s+\S+)?\s*$")
+ARCHIVE_MEMBER_RE = re.compile(r"^(?P<archive>.*?)\((?P<member>[^()]+)\)$")
+
+
+def classify(output_section, input_section):
+    """Map an input section to one of SECTION_KINDS and whether it occupies DRAM."""
+    if output_section.startswith(".iram") or input_section.startswith(".iram"):
+        return "iram", False
+    in_dram = output_section.startswith(".dram")
+    if input_section == "COMMON" or input_section.startswith((".bss", ".sbss")):
+        return "bss", True
+    if input_section.startswith((".data", ".sdata")):
+        return "data", True
+    if input_section.startswith(".rodata"):
+        return "rodata", in_dram
+    if input_section.startswith((".text", ".literal", ".irom")):
+        return "text", False
+    if in_dram:
+        return "data", True
+    return None, False
+
+
+def parse_map(path):
+    """Return (memory regions, list of (output_section, input_section, size, file))."""
+    regions = {}
+    entries = []
+    mode = None
+    output_section = ""
+    pending_input = None
+
+    with open(path, encoding="utf-8", errors="replace") as handle:
+        for line in handle:
+            line = line.rstrip("\n")
+            if line.startswith("Memory Configuration"):
+                mode = "memory"
+                continue
+            if line.startswith("Linker script and memory map"):
+                mode = "map"
+                continue
+            if mode == "memory":
+                match = MEMORY_RE.match(line)
+                if match and match.group(1) not in ("Name", "*default*"):
+                    regions[match.group(1)] = int(match.group(3), 16)
+                continue
+            if mode != "map":
+                continue
+
+            if pending_input is not None:
+                match = CONTINUATION_RE.match(line)
+                if match:
+                    entries.append((output_section, pending_input, int(match.group(2), 16), match.group(3).strip()))
+                pending_input = None
+                continue
+
+            match = OUTPUT_SECTION_RE.match(line)
+            if match and not line.startswith(" "):
+                output_section = match.group(1)
+                continue
+
+            match = INPUT_SECTION_RE.match(line)
+            if match:
+                if match.group(1):
+                    pending_input = match.group(1)
+                else:
+                    entries.append((output_section, match.group(2), int(match.group(4), 16), match.group(5).strip()))
+    return regions, entries
+
+
+def index_sources(source_dir):
+    """Map object basenames (foo.c) to paths relative to source_dir (wifi/foo.c)."""
+    index = {}
+    if not source_dir or not os.path.isdir(source_dir):
+        return index
+    for root, _dirs, files in os.walk(source_dir):
+        for name in files:
+            if name.endswith((".c", ".cpp", ".S")):
+                rel = os.path.relpath(os.path.join(root, name), source_dir).replace(os.sep, "/")
+                index[name] = rel
+    return index
+
+
+def split_origin(origin):
+    """Return (library, object basename) for an ld map file column."""
+    match = ARCHIVE_MEMBER_RE.match(origin)
+    if match:
+        return os.path.basename(match.group("archive")), os.path.basename(match.group("member"))
+    return "(objects)", os.path.basename(origin)
+
+
+def source_name(member):
+    """garage_state_machine.c.obj / garage_state_machine.o -> garage_state_machine.c"""
+    for suffix in (".obj", ".o"):
+        if member.endswith(suffix):
+            member = member[: -len(suffix)]
+            break
+    if not os.path.splitext(member)[1]:
+        member += ".c"
+    return member
+
+
+def empty_sizes():
+    return {kind: 0 for kind in SECTION_KINDS}
+
+
+def summarize(regions, entries, module_patterns, sources, project_library):
+    modules = {name: empty_sizes() for name in module_patterns}
+    libraries = {}
+    used = {"iram": 0, "dram": 0}
+
+    for output_section, input_section, size, origin in entries:
+        if size == 0:
+            continue
+        kind, in_dram = classify(output_section, input_section)
+        if kind is None:
+            continue
+        if kind == "iram":
+            used["iram"] += size
+        elif in_dram:
+            used["dram"] += size
+
+        library, member = split_origin(origin)
+        libraries.setdefault(library, empty_sizes())[kind] += size
+
+        if library != project_library:
+            continue
+        source = sources.get(source_name(member), source_name(member))
+        for module, patterns in module_patterns.items():
+            if any(fnmatch.fnmatch(source, pattern) for pattern in patterns):
+                modules[module][kind] += size
+                break
+
+    headroom = {}
+    for region, segment in REGIONS.items():
+        if segment in regions:
+            headroom[region] = {"size": regions[segment], "used": used[region], "free": regions[segment] - used[region]}
+        else:
+            headroom[region] = {"size": 0, "used": used[region], "free": 0}
+    return modules, libraries, headroom
+
+
+def check_budgets(budgets, modules, libraries, headroom):
+    violations = []
+    for group_name, actual in (("modules", modules), ("libraries", libraries)):
+        for name, limits in budgets.get(group_name, {}).items():
+            sizes = actual.get(name, empty_sizes())
+            for kind, limit in limits.items():
+                if kind in SECTION_KINDS and sizes[kind] > limit:
+                    violations.append("%s %s: %s %d > budget %d" % (group_name[:-1], name, kind, sizes[kind], limit))
+    for region, limits in budgets.get("regions", {}).items():
+        info = headroom.get(region)
+        if info is None:
+            continue
+        if "max_used" in limits and info["used"] > limits["max_used"]:
+            violations.append("region %s: used %d > budget %d" % (region, info["used"], limits["max_used"]))
+        if "min_free" in limits and info["size"] and info["free"] < limits["min_free"]:
+            violations.append("region %s: free %d < required %d" % (region, info["free"], limits["min_free"]))
+    return violations
+
+
+def print_table(title, rows):
+    print(title)
+    print("  %-28s %8s %8s %8s %8s %8s" % (("name",) + SECTION_KINDS))
+    for name, sizes in rows:
+        print("  %-28s %8d %8d %8d %8d %8d" % ((name,) + tuple(sizes[kind] for kind in SECTION_KINDS)))
+    print()
+
+
+def updated_budgets(budgets, modules, libraries, headroom, margin):
+    """Budgets set to the current sizes plus margin, keeping the configured module patterns."""
+    def padded(sizes):
+        return {kind: int(sizes[kind] * (1.0 + margin) + 0.5) for kind in SECTION_KINDS}
+
+    result = dict(budgets)
+    result["modules"] = {name: padded(sizes) for name, sizes in modules.items()}
+    result["libraries"] = {name: padded(sizes) for name, sizes in libraries.items()}
+    result.setdefault("regions", {})
+    for region, info in headroom.items():
+        result["regions"].setdefault(region, {})["max_used"] = int(info["used"] * (1.0 + margin) + 0.5)
+    return result
+
+
+def main(argv):
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map produced by the firmware build")
+    parser.add_argument("--budgets", default=os.path.join(here, "size_budgets.json"))
+    parser.add_argument("--source-dir", default=os.path.join(here, "..", "main"),
+                        help="component sources, used to resolve archive members to module paths")
+    parser.add_argument("--update-budgets", action="store_true", help="rewrite the budgets from this map")
+    parser.add_argument("--margin", type=float, default=0.10, help="headroom added by --update-budgets")
+    args = parser.parse_args(argv)
+
+    with open(args.budgets, encoding="utf-8") as handle:
+        budgets = json.load(handle)
+
+    regions, entries = parse_map(args.map)
+    if not entries:
+        print("error: no input sections found in %s" % args.map, file=sys.stderr)
+        return 2
+
+    modules, libraries, headroom = summarize(regions, entries, budgets.get("module_patterns", {}),
+                                             index_sources(args.source_dir),
+                                             budgets.get("project_library", "libmain.a"))
+
+    print_table("Per module (%s)" % budgets.get("project_library", "libmain.a"), sorted(modules.items()))
+    library_rows = sorted(libraries.items(), key=lambda item: -sum(item[1].values()))
+    print_table("Per library", library_rows)
+    for region, info in headroom.items():
+        print("%-5s used %7d of %7d bytes, %7d free" % (region.upper(), info["used"], info["size"], info["free"]))
+
+    if args.update_budgets:
+        with open(args.budgets, "w", encoding="utf-8") as handle:
+            json.dump(updated_budgets(budgets, modules, libraries, headroom, args.margin), handle, indent=2)
+            handle.write("\n")
+        print("\nBudgets updated: %s" % args.budgets)
+        return 0
+
+    violations = check_budgets(budgets, modules, libraries, headroom)
+    print()
+    if violations:
+        print("Budget exceeded:")
+        for violation in violations:
+            print("  " + violation)
+        return 1
+    print("All budgets met")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))